@@ -1,4 +1,5 @@
 #include "ConfigurationManager.h"
+#include "HeapProfiler/HeapProfiler.h"
 
 ConfigurationManager::ConfigurationManager(const char* name, HTTPServerManager& serverManager, Logger* logger)
         : _name(name), 
@@ -7,6 +8,7 @@ ConfigurationManager::ConfigurationManager(const char* name, HTTPServerManager&
           {}
 
 bool ConfigurationManager::loadConfig() {
+    HEAP_SCOPE(HEAP_TAG_CFG);
     if (!LittleFS.begin()) {
         return false;
     }
@@ -23,6 +25,7 @@ bool ConfigurationManager::loadConfig() {
 }
 
 bool ConfigurationManager::saveConfig() {
+    HEAP_SCOPE(HEAP_TAG_CFG);
     File configFile = LittleFS.open("/"+String(_name)+".json", "w");
     if (!configFile) {
         return false;
@@ -76,6 +79,12 @@ int ConfigurationManager::getValue(const char* path, int defaultValue) {
     }
     return defaultValue;
 }
+/**
+ * Usage example: wifiManager.addNetworks(getArray("wifi.networks"));
+*/
+JsonArray ConfigurationManager::getArray(const char* path) {
+    return resolvePath(_config, path).as<JsonArray>();
+}
 
 
 
@@ -102,12 +111,14 @@ void ConfigurationManager::registerEndpoints() {
 }
 
 void ConfigurationManager::handleGetCurrentConfig(ESP8266WebServer& server) {
+    HEAP_SCOPE(HEAP_TAG_CFG);
     String configJson = "";
     serializeJson(getConfig(), configJson);
     server.send(200, "application/json", configJson);
 }
 
 void ConfigurationManager::handleConfigPost(ESP8266WebServer& server) {
+    HEAP_SCOPE(HEAP_TAG_CFG);
     if (!server.hasArg("plain")) {
         server.send(400, "application/json", "{\"status\": \"nok1\", \"error\":\"Bad Request\"}");
         return;
@@ -119,7 +130,7 @@ void ConfigurationManager::handleConfigPost(ESP8266WebServer& server) {
     //serializeJsonPretty(json, output);
 
     // Print the pretty JSON string
-    if (_logger != nullptr) _logger->log(json+"\n");
+    _logger.log(json+"\n");
     JsonDocument newConfig;
     DeserializationError error = deserializeJson(newConfig, json);
     if(error) {
@@ -134,7 +145,7 @@ void ConfigurationManager::handleConfigPost(ESP8266WebServer& server) {
     }
 
     server.send(200, "application/json", "{\"status\": \"ok\", \"message\":\"Configuration saved successfully\"}");
-    if (_logger != nullptr) _logger->log("Configuration updated via HTTP POST.\n");
+    _logger.log("Configuration updated via HTTP POST.\n");
 }
 
 
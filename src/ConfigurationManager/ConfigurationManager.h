@@ -4,7 +4,7 @@
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include "HTTPServerManager/HTTPServerManager.h"
-#include "Logger/Logger.h"
+#include "Logger/LogSink.h"
 
 /**
  * @class ConfigurationManager
@@ -62,6 +62,14 @@ public:
      */
     int getValue(const char* path, int defaultValue);
 
+    /**
+     * @brief Retrieves an array from the configuration.
+     * 
+     * @param path The path to the array (e.g., "wifi.networks").
+     * @return The array, referencing the configuration data, or a null array if not found.
+     */
+    JsonArray getArray(const char* path);
+
     /**
      * @brief Sets the current configuration to the provided JSON object.
      * 
@@ -103,7 +111,7 @@ public:
 private:
     const char* _name;               ///< The name of the configuration file.
     HTTPServerManager& _serverManager; ///< Reference to the HTTPServerManager.
-    Logger* _logger;                 ///< Pointer to the Logger for logging messages.
+    ComponentLogger _logger;         ///< Logger for logging messages.
     JsonDocument _config;            ///< The current configuration data.
 };
 
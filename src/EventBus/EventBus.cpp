@@ -0,0 +1,71 @@
+/**
+ * @file EventBus.cpp
+ * @brief Implementation of the EventBus class.
+ */
+#include "EventBus/EventBus.h"
+
+bool EventBus::subscribe(EventHandler handler, void* context, EventSource source, bool deferred) {
+    if (handler == nullptr) {
+        return false;
+    }
+    for (Slot& slot : _slots) {
+        if (slot.handler == nullptr) {
+            slot = { handler, context, source, deferred };
+            if (deferred) _deferredCount++;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool EventBus::unsubscribe(EventHandler handler, void* context) {
+    for (Slot& slot : _slots) {
+        if (slot.handler == handler && slot.context == context) {
+            if (slot.deferred) _deferredCount--;
+            slot.handler = nullptr;
+            return true;
+        }
+    }
+    return false;
+}
+
+void EventBus::emit(EventSource source, EventType type, int32_t value) {
+    Event event = { source, type, value };
+    dispatch(event, false);
+    if (_deferredCount == 0) {
+        return;
+    }
+
+    if (_count > 0) {
+        Event& last = _queue[(_head + _count - 1) % EVENT_BUS_QUEUE_SIZE];
+        if (last.source == source && last.type == type) {
+            last.value = value; // Coalesce repeated events, e.g. progress
+            return;
+        }
+    }
+    if (_count >= EVENT_BUS_QUEUE_SIZE) {
+        _dropped++;
+        return;
+    }
+    _queue[(_head + _count) % EVENT_BUS_QUEUE_SIZE] = event;
+    _count++;
+}
+
+void EventBus::loop() {
+    uint8_t queued = _count; // Events emitted by the handlers wait for the next call
+    while (queued-- > 0 && _count > 0) {
+        Event event = _queue[_head]; // Copied: a handler may emit and reuse the slot
+        _head = (_head + 1) % EVENT_BUS_QUEUE_SIZE;
+        _count--;
+        dispatch(event, true);
+    }
+}
+
+void EventBus::dispatch(const Event& event, bool deferred) {
+    for (const Slot& slot : _slots) {
+        if (slot.handler != nullptr && slot.deferred == deferred
+            && (slot.source == EVENT_SOURCE_ANY || slot.source == event.source)) {
+            slot.handler(event, slot.context);
+        }
+    }
+}
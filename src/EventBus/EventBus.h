@@ -0,0 +1,152 @@
+/**
+ * @file EventBus.h
+ * @brief Typed events published by the framework components.
+ * 
+ * Components emit events tagged with their source, instead of calling hooks with step 
+ * numbers. Handlers are plain function pointers with a context, stored in fixed slots. 
+ * A handler is either called synchronously by emit(), or deferred: the event is queued 
+ * and the handler is called from loop(), outside the time-critical path that emitted it.
+ */
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef EVENT_BUS_MAX_HANDLERS
+#define EVENT_BUS_MAX_HANDLERS 8   ///< Number of handler slots.
+#endif
+
+#ifndef EVENT_BUS_QUEUE_SIZE
+#define EVENT_BUS_QUEUE_SIZE 16    ///< Number of events waiting for the deferred handlers.
+#endif
+
+/**
+ * @brief Component that emitted an event.
+ */
+enum EventSource : uint8_t {
+    EVENT_SOURCE_WIFI,        ///< WiFiManager.
+    EVENT_SOURCE_OTA,         ///< OTA.
+    EVENT_SOURCE_MQTT,        ///< MqttManager.
+    EVENT_SOURCE_APP,         ///< The application.
+    EVENT_SOURCE_ANY = 0xFF   ///< Subscription filter matching every source.
+};
+
+/**
+ * @brief Type of an event. The meaning of Event::value is given for each type.
+ */
+enum EventType : uint8_t {
+    EVENT_WIFI_CONNECTING,         ///< Connection to the configured networks started.
+    EVENT_WIFI_CONNECT_PROGRESS,   ///< Still waiting for the access point; value: elapsed ms.
+    EVENT_WIFI_CONNECTED,          ///< Connected; value: connection time in ms.
+    EVENT_WIFI_ROAMING,            ///< Moving to a better access point; value: RSSI of the target.
+    EVENT_WIFI_NO_CREDENTIALS,     ///< No network is configured.
+    EVENT_WIFI_CONNECT_FAILED,     ///< No configured network could be joined.
+    EVENT_WIFI_LOST,               ///< Connection lost, switched to the settings mode.
+
+    EVENT_OTA_START,               ///< Firmware upload started.
+    EVENT_OTA_PROGRESS,            ///< Firmware chunk written; value: bytes received so far.
+    EVENT_OTA_SUCCESS,             ///< Firmware installed, about to reboot; value: firmware size.
+    EVENT_OTA_FAILED,              ///< Firmware update failed; value: error code of the response (nokN).
+    EVENT_OTA_ABORTED,             ///< Firmware upload aborted by the client.
+    EVENT_OTA_AVAILABLE,           ///< OTAPull: the manifest announces a new version, download starting; value: image size.
+    EVENT_UPLOAD_START,            ///< File upload started.
+    EVENT_UPLOAD_PROGRESS,         ///< File chunk written; value: bytes received so far.
+    EVENT_UPLOAD_SUCCESS,          ///< File saved; value: file size.
+    EVENT_UPLOAD_FAILED,           ///< File upload failed; value: error code of the response (nokN).
+    EVENT_UPLOAD_ABORTED,          ///< File upload aborted by the client.
+
+    EVENT_MQTT_CONNECTING,         ///< Connection attempt started.
+    EVENT_MQTT_CONNECTED,          ///< Connected to the broker; value: attempt duration in ms.
+    EVENT_MQTT_CONNECT_FAILED,     ///< Connection attempt failed; value: PubSubClient state.
+    EVENT_MQTT_DNS_FAILED,         ///< The broker name could not be resolved.
+    EVENT_MQTT_LOST,               ///< Connection lost; value: PubSubClient state.
+    EVENT_MQTT_MESSAGE_DROPPED,    ///< Outbound message dropped (topic too long or queue full).
+
+    EVENT_APP = 0x80               ///< First type available to the application.
+};
+
+/**
+ * @brief An event.
+ */
+struct Event {
+    EventSource source;  ///< Component that emitted the event.
+    EventType type;      ///< Type of the event.
+    int32_t value;       ///< Value, depending on the type.
+};
+
+/**
+ * @brief Handler of events.
+ * @param event The event, valid only during the call.
+ * @param context Pointer given at subscription, e.g. the object handling the event.
+ */
+typedef void (*EventHandler)(const Event& event, void* context);
+
+class EventBus {
+public:
+    /**
+     * @brief Registers a handler.
+     * 
+     * @param handler Function called for each event.
+     * @param context Pointer passed to the handler.
+     * @param source Only events from this source are passed, EVENT_SOURCE_ANY for all.
+     * @param deferred Call the handler from loop() instead of from emit().
+     * @return False if all the slots are taken.
+     */
+    bool subscribe(EventHandler handler, void* context = nullptr, EventSource source = EVENT_SOURCE_ANY, bool deferred = false);
+
+    /**
+     * @brief Removes a handler registered with the same context.
+     * 
+     * @return False if the handler was not registered.
+     */
+    bool unsubscribe(EventHandler handler, void* context = nullptr);
+
+    /**
+     * @brief Emits an event.
+     * 
+     * Synchronous handlers are called now. For deferred handlers the event is queued; when 
+     * the last queued event has the same source and type, it is updated instead, so a run 
+     * of progress events takes one slot. Only the last event is compared: interleaved 
+     * events of different types each take a slot.
+     * 
+     * @param source Component emitting the event.
+     * @param type Type of the event.
+     * @param value Value, depending on the type.
+     */
+    void emit(EventSource source, EventType type, int32_t value = 0);
+
+    /**
+     * @brief Dispatches the queued events to the deferred handlers.
+     * 
+     * Only the events queued when the call starts are dispatched: events emitted by the 
+     * deferred handlers wait for the next call, so a handler re-emitting an event cannot 
+     * keep loop() from returning.
+     */
+    void loop();
+
+    size_t pending() const { return _count; }              ///< Number of queued events.
+    uint32_t getDropped() const { return _dropped; }       ///< Number of events dropped because the queue was full.
+
+private:
+    /**
+     * @brief A registered handler.
+     */
+    struct Slot {
+        EventHandler handler;  ///< Handler, nullptr if the slot is free.
+        void* context;         ///< Pointer passed to the handler.
+        EventSource source;    ///< Source filter.
+        bool deferred;         ///< Called from loop().
+    };
+
+    void dispatch(const Event& event, bool deferred);
+
+    Slot _slots[EVENT_BUS_MAX_HANDLERS] = {};   ///< Handler slots.
+    uint8_t _deferredCount = 0;                 ///< Number of deferred handlers.
+    Event _queue[EVENT_BUS_QUEUE_SIZE];         ///< Events waiting for the deferred handlers.
+    uint8_t _head = 0;                          ///< Index of the oldest queued event.
+    uint8_t _count = 0;                         ///< Number of queued events.
+    uint32_t _dropped = 0;                      ///< Events dropped.
+};
+
+#endif
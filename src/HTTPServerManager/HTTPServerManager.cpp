@@ -2,13 +2,15 @@
 #include <LittleFS.h>
 #include <ESP8266WiFi.h>
 #include <ESP8266WebServer.h>
+#include "HeapProfiler/HeapProfiler.h"
+#include <new>
 
 HTTPServerManager::HTTPServerManager(Logger* logger)
     : server(80), webSocket(81), _logger(logger) {}
 
 void HTTPServerManager::begin() {
     if (!LittleFS.begin()) {
-        if (_logger != nullptr) _logger->log("Failed to mount filesystem.\n");
+        _logger.log("Failed to mount filesystem.\n");
         return;
     }
 
@@ -18,12 +20,18 @@ void HTTPServerManager::begin() {
         handleWebSocketEvent(num, type, payload, length);
     });
 
+    // Request headers read by streamFile()
+    const char* headers[] = { "Range", "If-Range" };
+    server.collectHeaders(headers, 2);
+
     // Serve static files from LittleFS
     server.onNotFound([this]() { handleFileRequest(); });
 
+    server.on("/api/metrics", HTTP_GET, [this]() { handleMetricsRequest(); });
+
     // Start the server
     server.begin();
-    if (_logger != nullptr) _logger->log("HTTP server started.\n");
+    _logger.log("HTTP server started.\n");
 }
 
 void HTTPServerManager::loop() {
@@ -38,6 +46,8 @@ void HTTPServerManager::loop() {
  *               Used to access request parameters and send responses.
  */
 void HTTPServerManager::handleFileRequest() {
+    HEAP_SCOPE(HEAP_TAG_HTTP);
+    uint32_t start = micros();
     String path = server.uri();
     if (path == "/") path = "/index.html";
 
@@ -49,11 +59,111 @@ void HTTPServerManager::handleFileRequest() {
     path = "public_html/" + path;
     if (LittleFS.exists(path)) {
         File file = LittleFS.open(path, "r");
-        server.streamFile(file, contentType);
+        _fileBytes += streamFile(file, contentType);
         file.close();
     } else {
         server.send(404, "text/plain", "File Not Found");
     }
+    _fileLatency.record(micros() - start);
+}
+
+/**
+ * @brief Streams a file as the response to the current request.
+ *
+ * A single `Range: bytes=first-last` (or `first-`, or `-suffix`) is answered with 
+ * 206 Partial Content, so that interrupted downloads resume and media players seek; 
+ * with `If-Range`, only if it matches the ETag of the file (size and modification time), 
+ * the whole file being sent otherwise. A range starting past the end of the file is 
+ * answered with 416; multiple or malformed ranges (e.g. `bytes=5-3`) with the whole file. A file that is not open, or cannot be positioned at 
+ * the start of the range, is answered with 500, before any header is sent.
+ *
+ * The body is read from flash and written to the client a buffer at a time. WiFiClient 
+ * copies each write into the TCP send buffer and returns, so lwIP transmits one buffer 
+ * while the next is read from flash; the buffer should not exceed the TCP send buffer 
+ * (two segments with the default lwIP build), or the write waits for ACKs instead.
+ *
+ * @param file File open for reading, positioned at its start.
+ * @param contentType MIME type of the response.
+ * @return Bytes of the body sent.
+ */
+size_t HTTPServerManager::streamFile(File& file, const String& contentType) {
+    if (!file) {
+        server.send(500, "text/plain", "File Not Readable");
+        return 0;
+    }
+    size_t size = file.size();
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (unsigned long)size, (unsigned long)file.getLastWrite());
+    size_t first = 0;
+    size_t last = size > 0 ? size - 1 : 0;
+    int code = 200;
+
+    String range = server.header("Range");
+    int dash = range.indexOf('-');
+    String from = dash > 0 ? range.substring(6, dash) : String();
+    String to = dash > 0 ? range.substring(dash + 1) : String();
+    auto isNumber = [](const String& text) {
+        for (size_t i = 0; i < text.length(); i++) {
+            if (!isdigit((unsigned char)text[i])) return false;
+        }
+        return true;
+    };
+    // A malformed range (e.g. bytes=5-3) is ignored and the whole file sent
+    bool valid = range.startsWith("bytes=") && dash > 0 && range.indexOf(',') < 0
+        && isNumber(from) && isNumber(to) && !(from.isEmpty() && to.isEmpty())
+        && (from.isEmpty() || to.isEmpty() || to.toInt() >= from.toInt());
+    if (valid && (!server.hasHeader("If-Range") || server.header("If-Range") == etag)) {
+        bool satisfiable;
+        if (from.isEmpty()) { // Suffix: the last bytes
+            size_t suffix = to.toInt();
+            first = suffix >= size ? 0 : size - suffix;
+            satisfiable = suffix > 0 && size > 0;
+        } else {
+            first = from.toInt();
+            if (!to.isEmpty() && (size_t)to.toInt() < last) last = to.toInt();
+            satisfiable = first < size;
+        }
+        if (!satisfiable) {
+            server.sendHeader("Content-Range", String("bytes */") + String((unsigned long)size));
+            server.send(416, "text/plain", "Range Not Satisfiable");
+            return 0;
+        }
+        code = 206;
+        _rangeRequests++;
+        server.sendHeader("Content-Range", String("bytes ") + String((unsigned long)first) + "-" + String((unsigned long)last) + "/" + String((unsigned long)size));
+    }
+    size_t length = size > 0 ? last - first + 1 : 0;
+    if (first > 0 && !file.seek(first)) { // Before the headers, which would promise the range
+        server.send(500, "text/plain", "File Not Readable");
+        return 0;
+    }
+    server.sendHeader("Accept-Ranges", "bytes");
+    server.sendHeader("ETag", etag);
+    server.setContentLength(length);
+    server.send(code, contentType.c_str(), "");
+    if (server.method() == HTTP_HEAD || length == 0) {
+        return 0;
+    }
+
+    uint8_t fallback[256];
+    size_t bufferSize = _streamBufferSize;
+    uint8_t* buffer = new (std::nothrow) uint8_t[bufferSize];
+    if (buffer == nullptr) { // Short of memory: stream slowly rather than fail
+        buffer = fallback;
+        bufferSize = sizeof(fallback);
+    }
+    WiFiClient& client = server.client();
+    size_t sent = 0;
+    while (sent < length && client.connected()) {
+        size_t count = length - sent < bufferSize ? length - sent : bufferSize;
+        int read = file.read(buffer, count);
+        if (read <= 0) break;
+        size_t written = client.write(buffer, read);
+        sent += written;
+        if (written != (size_t)read) break; // Client gone
+    }
+    if (buffer != fallback) delete[] buffer;
+    return sent;
 }
 
 /**
@@ -73,7 +183,9 @@ void HTTPServerManager::registerPage(
     if (uploadHandler) { // To support file uploads, you need to include a second handler for file uploads
         server.on(uri.c_str(), method, 
             [this, handler]() { 
+                uint32_t start = micros();
                 handler(server); 
+                _pageLatency.record(micros() - start);
             }, 
             [this, uploadHandler]() { 
                 uploadHandler(server); 
@@ -81,7 +193,9 @@ void HTTPServerManager::registerPage(
         );
     } else {
         server.on(uri.c_str(), method, [this, handler]() {
+            uint32_t start = micros();
             handler(server);
+            _pageLatency.record(micros() - start);
         });
     }
 
@@ -92,8 +206,72 @@ void HTTPServerManager::registerPage(
  * @param message 
 */
 void HTTPServerManager::broadcastWebSocketMessage(const String& message) {
+    HEAP_SCOPE(HEAP_TAG_HTTP);
+    uint32_t start = micros();
     String mutableMessage = message; // Create a mutable copy of the const String
     webSocket.broadcastTXT(mutableMessage);
+    _broadcastLatency.record(micros() - start);
+    _broadcastBytes += (uint64_t)message.length() * webSocket.connectedClients();
+}
+
+/**
+ * @brief Adds a section to the /api/metrics response.
+ *
+ * @param name Key of the section (not copied), e.g. "mqtt".
+ * @param provider Lambda function filling the section, called at each request.
+ */
+void HTTPServerManager::addMetricsProvider(const char* name, std::function<void(JsonObject)> provider) {
+    _metricsProviders.push_back({ name, provider });
+}
+
+void HTTPServerManager::resetMetrics() {
+    _fileLatency.reset();
+    _pageLatency.reset();
+    _broadcastLatency.reset();
+    _fileBytes = 0;
+    _rangeRequests = 0;
+    _broadcastBytes = 0;
+}
+
+void HTTPServerManager::writeHistogram(JsonObject object, const LatencyHistogram& histogram) {
+    object["count"] = histogram.count();
+    object["avg"] = histogram.average();
+    object["p50"] = histogram.percentile(50);
+    object["p90"] = histogram.percentile(90);
+    object["p99"] = histogram.percentile(99);
+    object["max"] = histogram.max();
+}
+
+/**
+ * @brief Sends the request, broadcast and provider metrics as JSON. With the argument 
+ * reset=1, the request and broadcast metrics are cleared after being sent.
+ */
+void HTTPServerManager::handleMetricsRequest() {
+    JsonDocument doc;
+    doc["status"] = "ok";
+    doc["uptime"] = millis();
+    doc["heap"] = ESP.getFreeHeap();
+
+    JsonObject files = doc["files"].to<JsonObject>();
+    writeHistogram(files, _fileLatency);
+    files["bytes"] = _fileBytes;
+    files["ranges"] = _rangeRequests;
+    writeHistogram(doc["pages"].to<JsonObject>(), _pageLatency);
+    JsonObject broadcasts = doc["websocket"].to<JsonObject>();
+    writeHistogram(broadcasts, _broadcastLatency);
+    broadcasts["bytes"] = _broadcastBytes;
+    broadcasts["clients"] = webSocket.connectedClients();
+
+    for (MetricsProvider& metrics : _metricsProviders) {
+        metrics.provider(doc[metrics.name].to<JsonObject>());
+    }
+
+    String response;
+    serializeJson(doc, response);
+    server.send(200, "application/json", response);
+    if (server.arg("reset") == "1") {
+        resetMetrics();
+    }
 }
 
 void HTTPServerManager::handleWebSocketEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
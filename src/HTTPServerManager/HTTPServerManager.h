@@ -4,7 +4,13 @@
 #include <ArduinoJson.h>
 #include <ESP8266WebServer.h>
 #include <WebSocketsServer.h>
-#include "Logger/Logger.h"
+#include <vector>
+#include "Logger/LogSink.h"
+#include "Metrics/LatencyHistogram.h"
+
+#ifndef HTTP_STREAM_BUFFER_SIZE
+#define HTTP_STREAM_BUFFER_SIZE 2920  // Default file streaming buffer: two TCP segments (TCP_MSS 1460)
+#endif
 
 class HTTPServerManager {
 public:
@@ -16,18 +22,53 @@ public:
     // Register a custom route
     void registerPage(const String& uri, HTTPMethod method, std::function<void(ESP8266WebServer&)> handler, std::function<void(ESP8266WebServer&)> uploadHandler = nullptr);
 
+    // Stream a file as the response, honoring Range and If-Range (206 Partial Content); returns the bytes sent
+    size_t streamFile(File& file, const String& contentType);
+
+    // Set the size of the buffer files are streamed through, in bytes; 0 is rejected (returns false)
+    bool setStreamBufferSize(size_t size) {
+        if (size == 0) return false;
+        _streamBufferSize = size;
+        return true;
+    }
+
     // Broadcast message to all WebSocket clients
     void broadcastWebSocketMessage(const String& message);
 
+    // Add a section to the /api/metrics response, filled by provider at each request
+    void addMetricsProvider(const char* name, std::function<void(JsonObject)> provider);
+
+    // Clear the request and broadcast metrics
+    void resetMetrics();
+
+    // Write count, average, p50/p90/p99 and max of a histogram (in µs) into a JSON object
+    static void writeHistogram(JsonObject object, const LatencyHistogram& histogram);
+
 private:
     ESP8266WebServer server;
     WebSocketsServer webSocket;
-    Logger* _logger;
+    ComponentLogger _logger;
 
     // Internal method to handle WebSocket events
     void handleWebSocketEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length);
 
     void handleFileRequest();
+
+    void handleMetricsRequest();
+
+    struct MetricsProvider {
+        const char* name;
+        std::function<void(JsonObject)> provider;
+    };
+    std::vector<MetricsProvider> _metricsProviders; // Sections added to /api/metrics
+
+    LatencyHistogram _fileLatency;       // Static file requests
+    LatencyHistogram _pageLatency;       // Registered pages (API endpoints)
+    LatencyHistogram _broadcastLatency;  // WebSocket broadcasts
+    uint64_t _fileBytes = 0;             // Bytes of static files sent
+    uint32_t _rangeRequests = 0;         // Partial (206) file responses
+    size_t _streamBufferSize = HTTP_STREAM_BUFFER_SIZE; // Buffer files are streamed through
+    uint64_t _broadcastBytes = 0;        // Bytes broadcast, times the number of clients
 };
 
 #endif
\ No newline at end of file
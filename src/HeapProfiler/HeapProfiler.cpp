@@ -0,0 +1,86 @@
+/**
+ * @file HeapProfiler.cpp
+ * @brief Implementation of the HeapProfiler class: periodic snapshots, logging and /api/heap.
+ * 
+ * The snapshots and the accounting of the tags, which only need the core, are in HeapScope.cpp.
+ */
+#include "HeapProfiler/HeapProfiler.h"
+#include "HTTPServerManager/HTTPServerManager.h"
+#include "Logger/LogSink.h"
+
+HeapProfiler::HeapProfiler(HTTPServerManager& serverManager, Logger* logger) : _serverManager(serverManager), _logger(logger) {}
+
+void HeapProfiler::begin() {
+    _serverManager.registerPage("/api/heap", HTTP_GET, [this](ESP8266WebServer& server) {
+        handleHeapRequest(server);
+    });
+    _lastSnapshot = millis() - _interval; // First periodic snapshot on the first loop()
+}
+
+void HeapProfiler::loop() {
+    unsigned long now = millis();
+    if (now - _lastSnapshot < _interval) {
+        return;
+    }
+    _lastSnapshot = now;
+    HeapSnapshot current = snapshot();
+    _history[(_historyHead + _historyCount) % HEAP_PROFILER_HISTORY_SIZE] = current;
+    if (_historyCount < HEAP_PROFILER_HISTORY_SIZE) {
+        _historyCount++;
+    } else {
+        _historyHead = (_historyHead + 1) % HEAP_PROFILER_HISTORY_SIZE;
+    }
+    if (_logging) {
+        _logger.logf("Heap: free %lu, max block %lu, fragmentation %u%%, min free %lu\n", (unsigned long)current.free,
+            (unsigned long)current.maxBlock, current.fragmentation, (unsigned long)_minFree);
+    }
+}
+
+void HeapProfiler::logStats() {
+    if (!_logger.enabled()) {
+        return;
+    }
+    HeapSnapshot current = snapshot();
+    _logger.logf("Heap: free %lu, max block %lu, fragmentation %u%%, min free %lu\n", (unsigned long)current.free,
+        (unsigned long)current.maxBlock, current.fragmentation, (unsigned long)_minFree);
+    for (uint8_t i = 0; isTracking() && i < HEAP_TAG_COUNT; i++) {
+        _logger.logf("Heap %-4s scopes %lu, retained %ld, max retained %ld\n", getTagName((HeapTag)i),
+            (unsigned long)_tags[i].scopes, (long)_tags[i].retained, (long)_tags[i].maxRetained);
+    }
+}
+
+/**
+ * @brief Sends the current snapshot, the periodic ones and the accounting of the tags as JSON.
+ */
+void HeapProfiler::handleHeapRequest(ESP8266WebServer& server) {
+    HeapSnapshot current = snapshot();
+    JsonDocument doc;
+    doc["status"] = "ok";
+    doc["free"] = current.free;
+    doc["maxBlock"] = current.maxBlock;
+    doc["fragmentation"] = current.fragmentation;
+    doc["minFree"] = _minFree;
+    doc["tracking"] = isTracking();
+
+    JsonArray history = doc["history"].to<JsonArray>();
+    for (uint8_t i = 0; i < _historyCount; i++) {
+        const HeapSnapshot& entry = _history[(_historyHead + i) % HEAP_PROFILER_HISTORY_SIZE];
+        JsonObject item = history.add<JsonObject>();
+        item["time"] = entry.time;
+        item["free"] = entry.free;
+        item["maxBlock"] = entry.maxBlock;
+        item["fragmentation"] = entry.fragmentation;
+    }
+
+    JsonObject tags = doc["tags"].to<JsonObject>();
+    for (uint8_t i = 0; isTracking() && i < HEAP_TAG_COUNT; i++) {
+        JsonObject tag = tags[getTagName((HeapTag)i)].to<JsonObject>();
+        tag["scopes"] = _tags[i].scopes;
+        tag["retained"] = _tags[i].retained;
+        tag["maxRetained"] = _tags[i].maxRetained;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    server.send(200, "application/json", response);
+}
@@ -0,0 +1,149 @@
+/**
+ * @file HeapProfiler.h
+ * @brief Heap snapshots and per-subsystem heap accounting.
+ * 
+ * Snapshots record the free heap, the largest free block and the fragmentation, 
+ * periodically or on demand, and keep the lowest free heap seen. 
+ * 
+ * When the build defines IOT_HEAP_PROFILER, the HEAP_SCOPE(tag) markers placed in the 
+ * framework (HTTP handlers, configuration, OTA, scans, MQTT) attribute to their tag the 
+ * heap retained between the start and the end of the scope. Without the flag, the 
+ * markers compile to nothing.
+ */
+#ifndef HEAP_PROFILER_H
+#define HEAP_PROFILER_H
+
+#include <Arduino.h>
+#include "Logger/LogSink.h"
+
+class HTTPServerManager;
+class ESP8266WebServer;
+
+#ifndef HEAP_PROFILER_HISTORY_SIZE
+#define HEAP_PROFILER_HISTORY_SIZE 16   ///< Number of periodic snapshots kept.
+#endif
+
+/**
+ * @brief Subsystem to which heap usage is attributed.
+ */
+enum HeapTag : uint8_t {
+    HEAP_TAG_HTTP,   ///< Static files and registered pages.
+    HEAP_TAG_CFG,    ///< ConfigurationManager.
+    HEAP_TAG_OTA,    ///< Firmware and file management.
+    HEAP_TAG_WIFI,   ///< WiFiManager.
+    HEAP_TAG_MQTT,   ///< MqttManager.
+    HEAP_TAG_APP,    ///< The application.
+    HEAP_TAG_COUNT   ///< Number of tags.
+};
+
+/**
+ * @brief State of the heap at a point in time.
+ */
+struct HeapSnapshot {
+    uint32_t time;           ///< millis() of the snapshot.
+    uint32_t free;           ///< Free heap, in bytes.
+    uint32_t maxBlock;       ///< Largest free block, in bytes.
+    uint8_t fragmentation;   ///< Fragmentation, in percent.
+};
+
+/**
+ * @brief Heap accounting of a tag.
+ */
+struct HeapTagStats {
+    uint32_t scopes = 0;     ///< Number of scopes closed.
+    int32_t retained = 0;    ///< Sum of the heap retained by the scopes (negative when they freed more than they took).
+    int32_t maxRetained = 0; ///< Largest heap retained by a single scope.
+};
+
+class HeapProfiler {
+public:
+    /**
+     * @brief Constructs a HeapProfiler object.
+     * 
+     * @param serverManager Reference to the HTTPServerManager, for the /api/heap endpoint.
+     * @param logger Pointer to the Logger instance.
+     */
+    HeapProfiler(HTTPServerManager& serverManager, Logger* logger = nullptr);
+
+    /**
+     * @brief Registers the /api/heap endpoint and takes a first snapshot.
+     */
+    void begin();
+
+    /**
+     * @brief Takes the periodic snapshots, and logs them if enabled.
+     */
+    void loop();
+
+    void setInterval(unsigned long value){ _interval = value; }     ///< Interval of the periodic snapshots in ms (default: 60000).
+    void setLogging(bool value){ _logging = value; }                ///< Logs each periodic snapshot (default: false).
+
+    /**
+     * @brief Takes a snapshot of the heap and updates the lowest free heap.
+     */
+    static HeapSnapshot snapshot();
+
+    /**
+     * @brief Attributes heap retained by a scope to a tag. Called by HEAP_SCOPE.
+     * 
+     * @param tag Subsystem of the scope.
+     * @param retained Free heap at the start minus free heap at the end, in bytes.
+     */
+    static void record(HeapTag tag, int32_t retained);
+
+    /**
+     * @brief Logs the current snapshot and the accounting of every tag.
+     */
+    void logStats();
+
+    /**
+     * @brief Clears the accounting of every tag and restarts the lowest free heap from the current one.
+     */
+    static void resetStats();
+
+    static uint32_t getMinFree() { return _minFree; }                               ///< Lowest free heap seen, in bytes.
+    static const HeapTagStats& getStats(HeapTag tag) { return _tags[tag]; }         ///< Accounting of a tag.
+    static const char* getTagName(HeapTag tag);                                     ///< Name of a tag, e.g. "HTTP".
+    static bool isTracking();                                                       ///< true if built with IOT_HEAP_PROFILER.
+
+private:
+    HTTPServerManager& _serverManager;                  ///< Server of the /api/heap endpoint.
+    ComponentLogger _logger;                            ///< Logger instance.
+    unsigned long _interval = 60000;                    ///< Interval of the periodic snapshots, in ms.
+    unsigned long _lastSnapshot = 0;                    ///< millis() of the last periodic snapshot.
+    bool _logging = false;                              ///< Log the periodic snapshots.
+    HeapSnapshot _history[HEAP_PROFILER_HISTORY_SIZE];  ///< Periodic snapshots, ring buffer.
+    uint8_t _historyHead = 0;                           ///< Index of the oldest snapshot.
+    uint8_t _historyCount = 0;                          ///< Number of snapshots kept.
+
+    static uint32_t _minFree;                           ///< Lowest free heap seen.
+    static HeapTagStats _tags[HEAP_TAG_COUNT];          ///< Accounting of the tags.
+
+    void handleHeapRequest(ESP8266WebServer& server);
+};
+
+/**
+ * @brief Attributes to a tag the heap retained between its construction and destruction.
+ * 
+ * Use through HEAP_SCOPE(tag). Nested scopes are counted in each enclosing scope too.
+ */
+class HeapScope {
+public:
+    HeapScope(HeapTag tag) : _tag(tag), _free(ESP.getFreeHeap()) {}
+    ~HeapScope() { HeapProfiler::record(_tag, (int32_t)_free - (int32_t)ESP.getFreeHeap()); }
+
+private:
+    HeapTag _tag;    ///< Subsystem of the scope.
+    uint32_t _free;  ///< Free heap at the start of the scope.
+};
+
+#define HEAP_SCOPE_NAME(line) heapScope##line
+#define HEAP_SCOPE_AT(tag, line) HeapScope HEAP_SCOPE_NAME(line)(tag)
+
+#ifdef IOT_HEAP_PROFILER
+#define HEAP_SCOPE(tag) HEAP_SCOPE_AT(tag, __LINE__)  ///< Attributes the heap retained until the end of the enclosing block to tag.
+#else
+#define HEAP_SCOPE(tag)
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file HeapScope.cpp
+ * @brief Heap snapshots and accounting of the tags, shared by HeapProfiler and HEAP_SCOPE.
+ * 
+ * Depends only on the core (ESP heap figures), so that the framework components using 
+ * HEAP_SCOPE also build, and can be profiled, without the HTTP server.
+ */
+#include "HeapProfiler/HeapProfiler.h"
+
+uint32_t HeapProfiler::_minFree = UINT32_MAX;
+HeapTagStats HeapProfiler::_tags[HEAP_TAG_COUNT];
+
+static const char* const heapTagNames[HEAP_TAG_COUNT] = { "HTTP", "CFG", "OTA", "WIFI", "MQTT", "APP" };
+
+HeapSnapshot HeapProfiler::snapshot() {
+    HeapSnapshot current;
+    current.time = millis();
+    current.free = ESP.getFreeHeap();
+    current.maxBlock = ESP.getMaxFreeBlockSize();
+    current.fragmentation = ESP.getHeapFragmentation();
+    if (current.free < _minFree) {
+        _minFree = current.free;
+    }
+    return current;
+}
+
+void HeapProfiler::record(HeapTag tag, int32_t retained) {
+    HeapTagStats& stats = _tags[tag];
+    stats.scopes++;
+    stats.retained += retained;
+    if (retained > stats.maxRetained) {
+        stats.maxRetained = retained;
+    }
+    uint32_t free = ESP.getFreeHeap();
+    if (free < _minFree) {
+        _minFree = free;
+    }
+}
+
+void HeapProfiler::resetStats() {
+    for (HeapTagStats& stats : _tags) {
+        stats = HeapTagStats();
+    }
+    _minFree = ESP.getFreeHeap();
+}
+
+const char* HeapProfiler::getTagName(HeapTag tag) {
+    return tag < HEAP_TAG_COUNT ? heapTagNames[tag] : "?";
+}
+
+bool HeapProfiler::isTracking() {
+#ifdef IOT_HEAP_PROFILER
+    return true;
+#else
+    return false;
+#endif
+}
@@ -5,11 +5,18 @@
 
 #include "ConfigurationManager/ConfigurationManager.h"
 #include "Logger/Logger.h"
+#include "Logger/LogSink.h"
 #include "Logger/ConsoleLogger.h"
 #include "Logger/TelnetLogger.h"
 #include "WiFiManager/WiFiManager.h"
 #include "HTTPServerManager/HTTPServerManager.h"
 #include "OTA/OTA.h"
+#include "OTA/OTAPull.h"
 #include "MqttManager/MqttManager.h"
+#include "MqttManager/MqttBatchPublisher.h"
+#include "TimeService/TimeService.h"
+#include "Scheduler/Scheduler.h"
+#include "EventBus/EventBus.h"
+#include "HeapProfiler/HeapProfiler.h"
 
 #endif
\ No newline at end of file
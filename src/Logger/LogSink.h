@@ -0,0 +1,106 @@
+/**
+ * @file LogSink.h
+ * @brief Logging facade of the components, with the sink chosen at compile time.
+ *
+ * LogSink<Sink> is a CRTP base: log() and logf() call Sink::write() directly, without a
+ * virtual call, so they are inlined into the call site. The components hold a
+ * ComponentLogger by value, the sink selected by IOT_LOG_SINK for the whole build:
+ * - LoggerSink (default): adapter to the runtime Logger interface; the Logger* given to
+ *   the constructors of the components, nullptr for none. The null check lives here,
+ *   once, instead of at each call site, and logf() formats nothing without a logger.
+ * - SerialSink: prints to Serial, without a virtual call; the Logger* is ignored.
+ * - NullSink: logs nothing; every call compiles to nothing, and the sinks are not linked
+ *   unless the sketch uses them itself. Arguments built by the caller, such as String
+ *   concatenations, are still evaluated: hot paths format with logf() instead.
+ *
+ * Select with a build flag, e.g. `-DIOT_LOG_SINK=NullSink`. A custom sink derives from
+ * LogSink<Self>, has a constructor taking a Logger*, and defines write(const char*) and,
+ * optionally, enabled().
+ */
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include "Logger.h"
+
+#ifndef IOT_LOG_SINK
+#define IOT_LOG_SINK LoggerSink   ///< Sink of the components: LoggerSink, SerialSink, NullSink or a custom sink.
+#endif
+
+#ifndef IOT_LOG_BUFFER_SIZE
+#define IOT_LOG_BUFFER_SIZE 128   ///< Buffer of logf(), in bytes; longer messages are truncated.
+#endif
+
+/**
+ * @brief CRTP base of the sinks: the logging methods of the components.
+ */
+template <typename Sink>
+class LogSink {
+public:
+    /**
+     * @brief Tells whether messages are written; false lets callers skip preparing them.
+     */
+    bool enabled() const { return true; }
+
+    void log(const char* message) { sink().write(message); }
+
+    void log(const String& message) { sink().write(message.c_str()); }
+
+    // Usage example: _logger.logf("Connected in %lu ms\n", duration); formats only if enabled().
+    template <typename... Args>
+    void logf(const char* format, Args... args) {
+        if (!sink().enabled()) {
+            return;
+        }
+        char buffer[IOT_LOG_BUFFER_SIZE];
+        snprintf(buffer, sizeof(buffer), format, args...);
+        sink().write(buffer);
+    }
+
+private:
+    Sink& sink() { return static_cast<Sink&>(*this); }
+};
+
+/**
+ * @brief Sink writing to a runtime Logger (ConsoleLogger, TelnetLogger...), if any.
+ */
+class LoggerSink : public LogSink<LoggerSink> {
+public:
+    LoggerSink(Logger* logger = nullptr) : _logger(logger) {}
+
+    bool enabled() const { return _logger != nullptr; }
+
+    void write(const char* message) {
+        if (_logger != nullptr) _logger->log(message);
+    }
+
+    Logger* getLogger() const { return _logger; } ///< Logger written to, nullptr if none.
+
+private:
+    Logger* _logger; ///< Logger written to, nullptr if none.
+};
+
+/**
+ * @brief Sink printing to Serial, begun by the sketch (e.g. by ConsoleLogger::begin()).
+ */
+class SerialSink : public LogSink<SerialSink> {
+public:
+    SerialSink(Logger* = nullptr) {}
+
+    void write(const char* message) { Serial.print(message); }
+};
+
+/**
+ * @brief Sink discarding everything, at no cost.
+ */
+class NullSink : public LogSink<NullSink> {
+public:
+    NullSink(Logger* = nullptr) {}
+
+    constexpr bool enabled() const { return false; }
+
+    void write(const char*) {}
+};
+
+typedef IOT_LOG_SINK ComponentLogger; ///< Sink held by the components.
+
+#endif
@@ -9,7 +9,7 @@ public:
     virtual void begin() {};
     virtual void loop() {};
     virtual void log(const char* message) = 0;
-    virtual void log(String message) {
+    virtual void log(const String& message) {
         log(message.c_str());
     }
 
@@ -21,11 +21,15 @@ public:
         log(buffer);
     }
 
+    // Returns the local date and time, or "" while the clock has not been synchronized.
+    // Reads the clock directly: getLocalTime() waits up to 5 s for a synchronization.
     static String timeToString() {
-        struct tm timeinfo;
-        if (!getLocalTime(&timeinfo)) {
+        time_t now = time(nullptr);
+        if (now < 1577836800) { // 2020-01-01, the clock starts at 1970 until synchronized
             return String("");
         }
+        struct tm timeinfo;
+        localtime_r(&now, &timeinfo);
         
         char timeString[40];  // Safe buffer size
         snprintf(timeString, sizeof(timeString), "%04d-%02d-%02d %02d:%02d:%02d", 
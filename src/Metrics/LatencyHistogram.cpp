@@ -0,0 +1,46 @@
+/**
+ * @file LatencyHistogram.cpp
+ * @brief Implementation of the LatencyHistogram class.
+ */
+#include "Metrics/LatencyHistogram.h"
+
+void LatencyHistogram::record(uint32_t micros) {
+    uint8_t bucket = micros == 0 ? 0 : 32 - __builtin_clz(micros);
+    if (bucket >= LATENCY_HISTOGRAM_BUCKETS) {
+        bucket = LATENCY_HISTOGRAM_BUCKETS - 1;
+    }
+    _buckets[bucket]++;
+    _count++;
+    _total += micros;
+    if (micros > _max) {
+        _max = micros;
+    }
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t percent) const {
+    if (_count == 0) {
+        return 0;
+    }
+    uint64_t target = ((uint64_t)_count * (percent > 100 ? 100 : percent) + 99) / 100; // Rank of the sample, rounded up
+    if (target == 0) {
+        target = 1;
+    }
+    uint64_t cumulative = 0;
+    for (uint8_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS - 1; i++) {
+        cumulative += _buckets[i];
+        if (cumulative >= target) {
+            uint32_t bound = i == 0 ? 0 : (uint32_t)((1ULL << i) - 1);
+            return bound < _max ? bound : _max;
+        }
+    }
+    return _max;
+}
+
+void LatencyHistogram::reset() {
+    for (uint32_t& bucket : _buckets) {
+        bucket = 0;
+    }
+    _count = 0;
+    _total = 0;
+    _max = 0;
+}
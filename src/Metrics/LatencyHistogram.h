@@ -0,0 +1,56 @@
+/**
+ * @file LatencyHistogram.h
+ * @brief Fixed-size histogram of durations, for percentiles without storing samples.
+ * 
+ * Durations in microseconds are counted in power-of-two buckets: recording costs a 
+ * count-leading-zeros and an increment, and the memory is fixed whatever the number 
+ * of samples. Percentiles are resolved to the upper bound of their bucket, i.e. within 
+ * a factor of two, and are clamped to the largest recorded duration.
+ * 
+ * Depends only on the C++ standard library.
+ */
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef LATENCY_HISTOGRAM_BUCKETS
+#define LATENCY_HISTOGRAM_BUCKETS 25   ///< Number of buckets; the last one holds every duration above 2^23 µs (8.4 s).
+#endif
+
+class LatencyHistogram {
+public:
+    /**
+     * @brief Records a duration.
+     * 
+     * @param micros Duration in µs.
+     */
+    void record(uint32_t micros);
+
+    /**
+     * @brief Returns a percentile of the recorded durations.
+     * 
+     * @param percent Percentile, from 0 to 100 (e.g. 99).
+     * @return Upper bound of the bucket holding the percentile in µs, at most the maximum; 0 without samples.
+     */
+    uint32_t percentile(uint8_t percent) const;
+
+    /**
+     * @brief Clears the samples.
+     */
+    void reset();
+
+    uint32_t count() const { return _count; }                                   ///< Number of samples.
+    uint64_t total() const { return _total; }                                   ///< Sum of the samples, in µs.
+    uint32_t max() const { return _max; }                                       ///< Largest sample, in µs.
+    uint32_t average() const { return _count > 0 ? (uint32_t)(_total / _count) : 0; } ///< Mean of the samples, in µs.
+
+private:
+    uint32_t _buckets[LATENCY_HISTOGRAM_BUCKETS] = {}; ///< Bucket i > 0 counts the durations in [2^(i-1), 2^i) µs.
+    uint32_t _count = 0;                               ///< Number of samples.
+    uint64_t _total = 0;                               ///< Sum of the samples.
+    uint32_t _max = 0;                                 ///< Largest sample.
+};
+
+#endif
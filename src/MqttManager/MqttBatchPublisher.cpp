@@ -0,0 +1,198 @@
+/**
+ * @file MqttBatchPublisher.cpp
+ * @brief Implementation of the MqttBatchPublisher class.
+ */
+#include "MqttManager/MqttBatchPublisher.h"
+#include "TimeService/TimeService.h"
+
+#define MSGPACK_MAP16 0xDE
+#define MSGPACK_FIXSTR 0xA0
+#define MSGPACK_FLOAT32 0xCA
+#define MSGPACK_UINT64 0xCF
+#define MSGPACK_INT8 0xD0
+#define MSGPACK_INT16 0xD1
+#define MSGPACK_INT32 0xD2
+#define MSGPACK_INT64 0xD3
+
+MqttBatchPublisher::MqttBatchPublisher(MqttManager& mqtt, const char* topic, MqttBatchEncoding encoding):
+    _mqtt(mqtt),
+    _topic(topic),
+    _encoding(encoding)
+    {}
+
+void MqttBatchPublisher::loop() {
+    if (_count > 0 && millis() - _started >= _window) {
+        flush();
+    }
+}
+
+bool MqttBatchPublisher::add(const char* name, long value) {
+    return append(name, VALUE_LONG, value, 0, 0);
+}
+
+bool MqttBatchPublisher::add(const char* name, double value, uint8_t decimals) {
+    return append(name, VALUE_DOUBLE, 0, value, decimals);
+}
+
+/**
+ * @brief Appends a reading, publishing the pending batch first if the reading does not fit.
+ */
+bool MqttBatchPublisher::append(const char* name, ValueType type, long integer, double number, uint8_t decimals) {
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+        // Larger while the batch can be sent at once, a queue slot while it would be queued
+        _capacity = _mqtt.getMaxPayloadSize(strlen(_topic), _flags);
+        if (_capacity > sizeof(_buffer)) _capacity = sizeof(_buffer);
+        size_t mark = _length;
+        uint16_t fields = _fields;
+        if ((_count > 0 || start())
+            && writeKey(name)
+            && (type == VALUE_LONG ? writeLong(integer) : writeDouble(number, decimals))) {
+            if (_count == 0) {
+                _started = millis();
+            }
+            _fields++;
+            _count++;
+            return true;
+        }
+        _length = _count > 0 ? mark : 0; // Roll back the partial reading
+        _fields = _count > 0 ? fields : 0;
+        if (_count == 0) {
+            break; // Too large on its own
+        }
+        flush();
+    }
+    _dropped++;
+    return false;
+}
+
+/**
+ * @brief Writes the header of a new batch and its timestamp.
+ */
+bool MqttBatchPublisher::start() {
+    _length = 0;
+    _fields = 0;
+    if (_encoding == MQTT_BATCH_JSON) {
+        if (!writeByte('{')) return false;
+    } else if (!writeByte(MSGPACK_MAP16) || !writeBigEndian(0, 2)) { // Key count, patched by flush()
+        return false;
+    }
+
+    uint64_t epoch = TimeService::epochMicros();
+    if (!_timestamp || epoch == 0) {
+        return true;
+    }
+    uint64_t epochMillis = epoch / 1000;
+    if (!writeKey("ts")) return false;
+    if (_encoding == MQTT_BATCH_JSON) {
+        char text[24];
+        int length = snprintf(text, sizeof(text), "%lu.%03u", (unsigned long)(epochMillis / 1000), (unsigned)(epochMillis % 1000));
+        if (!write(text, length)) return false;
+    } else if (!writeByte(MSGPACK_UINT64) || !writeBigEndian(epochMillis, 8)) {
+        return false;
+    }
+    _fields++;
+    return true;
+}
+
+bool MqttBatchPublisher::writeKey(const char* name) {
+    size_t length = strlen(name);
+    if (_encoding == MQTT_BATCH_JSON) {
+        if ((_fields != 0 && !writeByte(',')) || !writeByte('"')) return false;
+        for (const char* c = name; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                if (!writeByte('\\') || !writeByte(*c)) return false;
+            } else if ((uint8_t)*c < 0x20) {
+                char escape[7];
+                snprintf(escape, sizeof(escape), "\\u%04x", (unsigned)*c);
+                if (!write(escape, 6)) return false;
+            } else if (!writeByte(*c)) {
+                return false;
+            }
+        }
+        return writeByte('"') && writeByte(':');
+    }
+    return length < 32 && writeByte(MSGPACK_FIXSTR | length) && write(name, length);
+}
+
+/**
+ * @brief Writes an integer in its shortest form: decimal text, or the smallest MessagePack integer type.
+ */
+bool MqttBatchPublisher::writeLong(long value) {
+    if (_encoding == MQTT_BATCH_JSON) {
+        char text[21]; // Down to -9223372036854775808 where long is 64-bit
+        ltoa(value, text, 10);
+        return write(text, strlen(text));
+    }
+    if (value >= -32 && value <= 127) {
+        return writeByte((uint8_t)(int8_t)value); // Positive or negative fixint
+    }
+    if (value >= -128 && value <= 127) {
+        return writeByte(MSGPACK_INT8) && writeBigEndian((uint8_t)value, 1);
+    }
+    if (value >= -32768 && value <= 32767) {
+        return writeByte(MSGPACK_INT16) && writeBigEndian((uint16_t)value, 2);
+    }
+    if (value >= INT32_MIN && value <= INT32_MAX) {
+        return writeByte(MSGPACK_INT32) && writeBigEndian((uint32_t)value, 4);
+    }
+    return writeByte(MSGPACK_INT64) && writeBigEndian((uint64_t)value, 8);
+}
+
+bool MqttBatchPublisher::writeDouble(double value, uint8_t decimals) {
+    if (_encoding == MQTT_BATCH_JSON) {
+        if (isnan(value) || value > 1e15 || value < -1e15) {
+            return write("null", 4); // Not representable as a JSON number
+        }
+        char text[32];
+        dtostrf(value, 1, decimals > 8 ? 8 : decimals, text);
+        return write(text, strlen(text));
+    }
+    float single = value;
+    uint32_t bits;
+    memcpy(&bits, &single, sizeof(bits));
+    return writeByte(MSGPACK_FLOAT32) && writeBigEndian(bits, 4);
+}
+
+/**
+ * @brief Copies bytes into the payload, keeping room for the closing brace of a JSON batch.
+ */
+bool MqttBatchPublisher::write(const void* data, size_t length) {
+    size_t reserve = _encoding == MQTT_BATCH_JSON ? 1 : 0;
+    if (_length + length + reserve > _capacity) {
+        return false;
+    }
+    memcpy(_buffer + _length, data, length);
+    _length += length;
+    return true;
+}
+
+bool MqttBatchPublisher::writeBigEndian(uint64_t value, uint8_t bytes) {
+    uint8_t data[8];
+    for (uint8_t i = 0; i < bytes; i++) {
+        data[i] = value >> (8 * (bytes - 1 - i));
+    }
+    return write(data, bytes);
+}
+
+bool MqttBatchPublisher::flush() {
+    if (_count == 0) {
+        return false;
+    }
+    if (_encoding == MQTT_BATCH_JSON) {
+        _buffer[_length++] = '}'; // Room kept by write()
+    } else {
+        _buffer[1] = _fields >> 8;
+        _buffer[2] = _fields & 0xFF;
+    }
+    bool published = _mqtt.publish(_topic, strlen(_topic), _buffer, _length, _flags);
+    if (published) {
+        _readings += _count;
+        _batches++;
+    } else {
+        _dropped += _count;
+    }
+    _length = 0;
+    _fields = 0;
+    _count = 0;
+    return published;
+}
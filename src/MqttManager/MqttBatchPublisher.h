@@ -0,0 +1,118 @@
+/**
+ * @file MqttBatchPublisher.h
+ * @brief Accumulates readings into a single MQTT message.
+ * 
+ * Readings added within a time window are encoded into one payload, as a JSON object or 
+ * a MessagePack map, and published as a single message when the window elapses or the 
+ * payload is full. One packet then carries many readings instead of one header per value.
+ */
+#ifndef MQTT_BATCH_PUBLISHER_H
+#define MQTT_BATCH_PUBLISHER_H
+
+#include "MqttManager/MqttManager.h"
+
+#ifndef MQTT_BATCH_PAYLOAD_SIZE
+#define MQTT_BATCH_PAYLOAD_SIZE 256   ///< Size of the batch buffer, the largest batch payload.
+#endif
+
+/**
+ * @brief Encoding of a batch payload.
+ */
+enum MqttBatchEncoding : uint8_t {
+    MQTT_BATCH_JSON,     ///< JSON object: {"ts":1700000000.123,"temp":21.5,...}
+    MQTT_BATCH_MSGPACK   ///< MessagePack map with the same keys, integers and float32 values.
+};
+
+class MqttBatchPublisher {
+public:
+    /**
+     * @brief Constructs a MqttBatchPublisher.
+     * @param mqtt The MqttManager publishing the batches.
+     * @param topic Subtopic of the batches, relative to the topic prefix (e.g., "metrics").
+     * @param encoding Payload encoding.
+     */
+    MqttBatchPublisher(MqttManager& mqtt, const char* topic, MqttBatchEncoding encoding = MQTT_BATCH_JSON);
+
+    /**
+     * @brief Publishes the pending batch when its time window has elapsed.
+     */
+    void loop();
+
+    /**
+     * @brief Sets the time window of a batch.
+     * @param value Maximum age of the first reading of a batch before it is published, in ms (default 1000).
+     */
+    void setWindow(unsigned long value){ _window = value;}
+
+    /**
+     * @brief Sets the MqttPublishFlags of the batches (default MQTT_PUBLISH_DEFAULT).
+     */
+    void setFlags(uint8_t value){ _flags = value;}
+
+    /**
+     * @brief Adds a "ts" key with the epoch time to each batch, once the clock is synchronized (default true).
+     */
+    void setTimestamp(bool value){ _timestamp = value;}
+
+    /**
+     * @brief Adds an integer reading to the batch.
+     * @details When the payload is full, the pending batch is published first.
+     * @param name Key of the reading, escaped in JSON (shorter than 32 characters for MessagePack fixstr).
+     * @param value Value of the reading.
+     * @return false The reading alone does not fit in a payload, or the full batch could not be published.
+     */
+    bool add(const char* name, long value);
+    bool add(const char* name, int value){ return add(name, (long)value);}
+
+    /**
+     * @brief Adds a floating point reading to the batch.
+     * @param decimals Digits after the decimal point in JSON. MessagePack stores a float32.
+     */
+    bool add(const char* name, double value, uint8_t decimals = 2);
+
+    /**
+     * @brief Publishes the pending batch now.
+     * @return false Nothing to publish, or the message was dropped.
+     */
+    bool flush();
+
+    size_t size() const { return _count; }                ///< Number of readings in the pending batch.
+    uint32_t getReadings() const { return _readings; }    ///< Readings published since boot.
+    uint32_t getBatches() const { return _batches; }      ///< Batches published since boot.
+    uint32_t getDropped() const { return _dropped; }      ///< Readings rejected since boot.
+
+private:
+    /**
+     * @brief Type of the value being appended.
+     */
+    enum ValueType : uint8_t { VALUE_LONG, VALUE_DOUBLE };
+
+    bool append(const char* name, ValueType type, long integer, double number, uint8_t decimals);
+    bool start();
+    bool writeKey(const char* name);
+    bool writeLong(long value);
+    bool writeDouble(double value, uint8_t decimals);
+    bool write(const void* data, size_t length);
+    bool writeByte(uint8_t b){ return write(&b, 1);}
+    bool writeBigEndian(uint64_t value, uint8_t bytes);
+
+    MqttManager& _mqtt;                            ///< Publisher of the batches.
+    const char* _topic;                            ///< Subtopic of the batches.
+    MqttBatchEncoding _encoding;                   ///< Payload encoding.
+    uint8_t _flags = MQTT_PUBLISH_DEFAULT;         ///< MqttPublishFlags of the batches.
+    bool _timestamp = true;                        ///< Add the "ts" key.
+    unsigned long _window = 1000;                  ///< Time window, in ms.
+
+    uint8_t _buffer[MQTT_BATCH_PAYLOAD_SIZE];      ///< Payload of the pending batch.
+    size_t _length = 0;                            ///< Bytes used in _buffer.
+    size_t _capacity = 0;                          ///< Bytes of _buffer the batch may use, as MqttManager can deliver them.
+    uint16_t _fields = 0;                          ///< Keys in the pending batch, including "ts".
+    uint16_t _count = 0;                           ///< Readings in the pending batch.
+    unsigned long _started = 0;                    ///< millis() of the first reading of the pending batch.
+
+    uint32_t _readings = 0;                        ///< Readings published.
+    uint32_t _batches = 0;                         ///< Batches published.
+    uint32_t _dropped = 0;                         ///< Readings rejected.
+};
+
+#endif
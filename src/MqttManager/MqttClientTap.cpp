@@ -0,0 +1,61 @@
+/**
+ * @file MqttClientTap.cpp
+ * @brief Implementation of the MqttClientTap class.
+ */
+#include "MqttManager/MqttClientTap.h"
+
+#define MQTT_PACKET_PUBACK 0x40
+
+int MqttClientTap::read() {
+    int b = _client.read();
+    if (b >= 0) {
+        feed((uint8_t)b);
+    }
+    return b;
+}
+
+int MqttClientTap::read(uint8_t* buf, size_t size) {
+    int n = _client.read(buf, size);
+    for (int i = 0; i < n; i++) {
+        feed(buf[i]);
+    }
+    return n;
+}
+
+void MqttClientTap::feed(uint8_t b) {
+    switch (_state) {
+        case PARSE_HEADER:
+            _type = b;
+            _remaining = 0;
+            _shift = 0;
+            _headLength = 0;
+            _state = PARSE_LENGTH;
+            break;
+        case PARSE_LENGTH:
+            _remaining |= (uint32_t)(b & 0x7F) << _shift;
+            _shift += 7;
+            if (!(b & 0x80)) {
+                if (_remaining == 0) {
+                    packetDone();
+                } else {
+                    _state = PARSE_BODY;
+                }
+            }
+            break;
+        case PARSE_BODY:
+            if (_headLength < sizeof(_head)) {
+                _head[_headLength++] = b;
+            }
+            if (--_remaining == 0) {
+                packetDone();
+            }
+            break;
+    }
+}
+
+void MqttClientTap::packetDone() {
+    _state = PARSE_HEADER;
+    if ((_type & 0xF0) == MQTT_PACKET_PUBACK && _headLength == sizeof(_head) && _pubackHandler) {
+        _pubackHandler(((uint16_t)_head[0] << 8) | _head[1]);
+    }
+}
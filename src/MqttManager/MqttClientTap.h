@@ -0,0 +1,80 @@
+/**
+ * @file MqttClientTap.h
+ * @brief Network client wrapper that follows the inbound MQTT stream.
+ * 
+ * PubSubClient publishes at QoS 0 only and silently discards PUBACK packets. Placed 
+ * between PubSubClient and the network client, this wrapper forwards every call and 
+ * tracks the MQTT packet boundaries of the bytes PubSubClient reads, reporting the 
+ * packet identifier of every PUBACK. It also lets MqttManager write its own QoS 1 
+ * PUBLISH packets on the same connection.
+ */
+#ifndef MQTT_CLIENT_TAP_H
+#define MQTT_CLIENT_TAP_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <functional>
+
+class MqttClientTap : public Client {
+public:
+    /**
+     * @brief Constructs a MqttClientTap around a network client.
+     * @param client The client actually connected to the broker (e.g. a WiFiClient).
+     */
+    MqttClientTap(Client& client) : _client(client) {}
+
+    /**
+     * @brief Sets the handler called with the packet identifier of every PUBACK received.
+     */
+    void onPuback(std::function<void(uint16_t)> handler) { _pubackHandler = handler; }
+
+    int connect(IPAddress ip, uint16_t port) override { reset(); return _client.connect(ip, port); }
+    int connect(const char* host, uint16_t port) override { reset(); return _client.connect(host, port); }
+    size_t write(uint8_t b) override { return _client.write(b); }
+    size_t write(const uint8_t* buf, size_t size) override { return _client.write(buf, size); }
+    int available() override { return _client.available(); }
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override { return _client.peek(); }
+    void flush() override { _client.flush(); }
+    void stop() override { _client.stop(); }
+    uint8_t connected() override { return _client.connected(); }
+    operator bool() override { return (bool)_client; }
+
+private:
+    /**
+     * @brief Position in the inbound packet being parsed.
+     */
+    enum ParserState : uint8_t {
+        PARSE_HEADER,  ///< Expecting the fixed header byte.
+        PARSE_LENGTH,  ///< Reading the remaining length varint.
+        PARSE_BODY     ///< Reading the variable header and payload.
+    };
+
+    /**
+     * @brief Restarts parsing at a packet boundary, for a new connection.
+     */
+    void reset() { _state = PARSE_HEADER; }
+
+    /**
+     * @brief Advances the parser by one inbound byte.
+     */
+    void feed(uint8_t b);
+
+    /**
+     * @brief Handles a complete inbound packet.
+     */
+    void packetDone();
+
+    Client& _client;                             ///< Wrapped network client.
+    std::function<void(uint16_t)> _pubackHandler; ///< PUBACK handler.
+
+    ParserState _state = PARSE_HEADER;           ///< Parser state.
+    uint8_t _type = 0;                           ///< Fixed header of the current packet.
+    uint8_t _shift = 0;                          ///< Bit position in the remaining length varint.
+    uint32_t _remaining = 0;                     ///< Bytes left in the current packet.
+    uint8_t _head[2];                            ///< First two bytes of the body (packet identifier of a PUBACK).
+    uint8_t _headLength = 0;                     ///< Number of bytes stored in _head.
+};
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * @file MqttInflight.cpp
+ * @brief Implementation of the MqttInflightWindow class.
+ */
+#include "MqttManager/MqttInflight.h"
+
+bool MqttInflightWindow::setLogFile(const char* path) {
+    if (_logFile) {
+        _logFile.close();
+    }
+    _logPath = path;
+    replay();
+    compact();
+    return (bool)_logFile;
+}
+
+MqttInflightEntry* MqttInflightWindow::add(const char* topic, const uint8_t* payload, size_t length, uint8_t flags) {
+    if (strlen(topic) >= MQTT_MANAGER_TOPIC_SIZE || length > MQTT_MANAGER_PAYLOAD_SIZE) {
+        return nullptr;
+    }
+    MqttInflightEntry* entry = freeEntry();
+    if (entry == nullptr) {
+        return nullptr;
+    }
+
+    while (_nextId == 0 || find(_nextId) != nullptr) { // Identifiers are non-zero and unique in the window
+        _nextId++;
+    }
+
+    strcpy(entry->message.topic, topic);
+    memcpy(entry->message.payload, payload, length);
+    entry->message.length = length;
+    entry->message.flags = flags;
+    entry->message.reserved = 0;
+    entry->packetId = _nextId++;
+    entry->retries = 0;
+    entry->sentAt = 0;
+    entry->sent = false;
+    _count++;
+    _stats.sent++;
+
+    appendRecord(LOG_ADD, entry->packetId, &entry->message);
+    return entry;
+}
+
+bool MqttInflightWindow::acknowledge(uint16_t packetId) {
+    MqttInflightEntry* entry = find(packetId);
+    if (entry == nullptr) {
+        return false;
+    }
+    entry->packetId = 0;
+    _count--;
+    _stats.acknowledged++;
+
+    appendRecord(LOG_ACK, packetId, nullptr);
+    if (_logFile && _logFile.size() > MQTT_MANAGER_INFLIGHT_LOG_SIZE) {
+        compact();
+    }
+    return true;
+}
+
+void MqttInflightWindow::markSent(MqttInflightEntry& entry, unsigned long now) {
+    if (entry.sent) {
+        entry.retries++;
+        _stats.retransmits++;
+    }
+    entry.sent = true;
+    entry.sentAt = now;
+}
+
+MqttInflightEntry* MqttInflightWindow::find(uint16_t packetId) {
+    for (MqttInflightEntry& entry : _entries) {
+        if (entry.packetId == packetId) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+MqttInflightEntry* MqttInflightWindow::freeEntry() {
+    return _count < MQTT_MANAGER_INFLIGHT_SIZE ? find(0) : nullptr;
+}
+
+/**
+ * @brief Applies the records of the log in order. A truncated last record (power loss 
+ * while writing) ends the replay.
+ */
+void MqttInflightWindow::replay() {
+    File file = LittleFS.open(_logPath, "r");
+    if (!file) {
+        return;
+    }
+    LogRecord record;
+    MqttMessage message;
+    while (file.read((uint8_t*)&record, sizeof(record)) == sizeof(record)) {
+        if (record.type == LOG_ADD) {
+            if (file.read((uint8_t*)&message, sizeof(message)) != sizeof(message)) {
+                break;
+            }
+            MqttInflightEntry* entry = find(record.packetId);
+            if (entry == nullptr) {
+                entry = freeEntry();
+                if (entry == nullptr) {
+                    continue; // More messages than slots, e.g. after MQTT_MANAGER_INFLIGHT_SIZE was reduced
+                }
+                _count++;
+                _stats.restored++;
+            }
+            entry->message = message;
+            entry->packetId = record.packetId;
+            entry->retries = 0;
+            entry->sentAt = 0;
+            entry->sent = true; // It may have reached the broker before the reboot
+            if ((uint16_t)(record.packetId - _nextId) < 0x8000) {
+                _nextId = record.packetId + 1;
+            }
+        } else if (record.type == LOG_ACK) {
+            MqttInflightEntry* entry = find(record.packetId);
+            if (entry != nullptr && record.packetId != 0) {
+                entry->packetId = 0;
+                _count--;
+                _stats.restored--;
+            }
+        } else {
+            break;
+        }
+    }
+    file.close();
+}
+
+/**
+ * @brief Rewrites the log with the entries still in the window, so it stays small.
+ * 
+ * The entries are written to a temporary file renamed over the log, so that a reset during 
+ * the compaction leaves the previous log whole. If the rewrite fails, the previous log is 
+ * kept and appended to.
+ */
+void MqttInflightWindow::compact() {
+    if (_logPath.length() == 0) {
+        return;
+    }
+    if (_logFile) {
+        _logFile.close();
+    }
+    String tempPath = _logPath + ".tmp";
+    _logFile = LittleFS.open(tempPath, "w");
+    bool written = (bool)_logFile;
+    for (const MqttInflightEntry& entry : _entries) {
+        if (written && entry.packetId != 0) {
+            written = appendRecord(LOG_ADD, entry.packetId, &entry.message);
+        }
+    }
+    if (_logFile) {
+        _logFile.close();
+    }
+    if (!written || !LittleFS.rename(tempPath, _logPath)) {
+        LittleFS.remove(tempPath);
+    }
+    _logFile = LittleFS.open(_logPath, "a");
+}
+
+/**
+ * @brief Appends a record and flushes it, so it survives a reset.
+ */
+bool MqttInflightWindow::appendRecord(uint8_t type, uint16_t packetId, const MqttMessage* message) {
+    if (!_logFile) {
+        return false;
+    }
+    LogRecord record = { type, 0, packetId };
+    bool written = _logFile.write((const uint8_t*)&record, sizeof(record)) == sizeof(record)
+        && (message == nullptr || _logFile.write((const uint8_t*)message, sizeof(*message)) == sizeof(*message));
+    _logFile.flush();
+    return written;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file MqttInflight.h
+ * @brief Window of QoS 1 messages sent to the broker and not yet acknowledged.
+ * 
+ * Each message keeps its packet identifier until the broker answers with a PUBACK. 
+ * The window can be backed by an append-only log on LittleFS, replayed at boot, so 
+ * messages not acknowledged before a reset or power loss are sent again.
+ */
+#ifndef MQTT_INFLIGHT_H
+#define MQTT_INFLIGHT_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "MqttManager/MqttQueue.h"
+
+#ifndef MQTT_MANAGER_INFLIGHT_SIZE
+#define MQTT_MANAGER_INFLIGHT_SIZE 8         ///< Number of QoS 1 messages awaiting a PUBACK.
+#endif
+
+#ifndef MQTT_MANAGER_INFLIGHT_LOG_SIZE
+#define MQTT_MANAGER_INFLIGHT_LOG_SIZE 8192  ///< Size of the in-flight log above which it is compacted, in bytes.
+#endif
+
+/**
+ * @brief A QoS 1 message awaiting its PUBACK.
+ */
+struct MqttInflightEntry {
+    MqttMessage message;        ///< The message.
+    uint16_t packetId;          ///< Packet identifier, 0 if the entry is free.
+    uint16_t retries;           ///< Number of retransmissions.
+    unsigned long sentAt;       ///< millis() of the last transmission.
+    bool sent;                  ///< Transmitted at least once (possibly before a reboot): resend with the DUP flag.
+};
+
+/**
+ * @brief Delivery metrics of the QoS 1 messages.
+ */
+struct MqttInflightStats {
+    uint32_t sent = 0;          ///< Messages entered in the window since boot.
+    uint32_t acknowledged = 0;  ///< Messages acknowledged by the broker since boot.
+    uint32_t retransmits = 0;   ///< Retransmissions since boot.
+    uint32_t restored = 0;      ///< Messages restored from the log at boot.
+};
+
+class MqttInflightWindow {
+public:
+    /**
+     * @brief Backs the window with an append-only log file and replays it.
+     * 
+     * Messages added and not acknowledged before the reboot are restored into the 
+     * window, then the log is compacted.
+     * 
+     * @param path Path of the log file (e.g. "/mqtt.inflight").
+     * @return False if the file could not be opened or created.
+     */
+    bool setLogFile(const char* path);
+
+    /**
+     * @brief Enters a message in the window and assigns it a packet identifier.
+     * 
+     * @param topic Subtopic, relative to the topic prefix.
+     * @param payload Payload bytes.
+     * @param length Payload length.
+     * @param flags MqttPublishFlags.
+     * @return The entry, or nullptr if the window is full or the message too large.
+     */
+    MqttInflightEntry* add(const char* topic, const uint8_t* payload, size_t length, uint8_t flags);
+
+    /**
+     * @brief Releases the entry of an acknowledged packet.
+     * 
+     * @param packetId Packet identifier of the PUBACK.
+     * @return False if no entry has this identifier (e.g. a late duplicate PUBACK).
+     */
+    bool acknowledge(uint16_t packetId);
+
+    /**
+     * @brief Records a (re)transmission of an entry.
+     */
+    void markSent(MqttInflightEntry& entry, unsigned long now);
+
+    /**
+     * @brief Returns the entry at a slot index.
+     * 
+     * @param index Slot index, below MQTT_MANAGER_INFLIGHT_SIZE.
+     * @return The entry, or nullptr if the slot is free.
+     */
+    MqttInflightEntry* at(uint8_t index) { return _entries[index].packetId != 0 ? &_entries[index] : nullptr; }
+
+    size_t size() const { return _count; }                              ///< Number of messages awaiting a PUBACK.
+    bool isFull() const { return _count >= MQTT_MANAGER_INFLIGHT_SIZE; } ///< Tells whether the window is full.
+    const MqttInflightStats& getStats() const { return _stats; }        ///< Delivery metrics.
+
+private:
+    /**
+     * @brief Type of a log record.
+     */
+    enum LogRecordType : uint8_t {
+        LOG_ADD = 0xA1,  ///< Message entered, followed by the MqttMessage.
+        LOG_ACK = 0xAC   ///< Message acknowledged.
+    };
+
+    /**
+     * @brief Header of a log record.
+     */
+    struct LogRecord {
+        uint8_t type;       ///< LogRecordType.
+        uint8_t reserved;   ///< Padding.
+        uint16_t packetId;  ///< Packet identifier.
+    };
+
+    MqttInflightEntry* find(uint16_t packetId);
+    MqttInflightEntry* freeEntry();
+    void replay();
+    void compact();
+    bool appendRecord(uint8_t type, uint16_t packetId, const MqttMessage* message);
+
+    MqttInflightEntry _entries[MQTT_MANAGER_INFLIGHT_SIZE] = {}; ///< Preallocated entries.
+    uint8_t _count = 0;                                        ///< Number of entries in use.
+    uint16_t _nextId = 1;                                      ///< Next packet identifier.
+    MqttInflightStats _stats;                                  ///< Delivery metrics.
+
+    String _logPath;                                           ///< Path of the log, empty if disabled.
+    File _logFile;                                             ///< Log file, open for appending.
+};
+
+#endif
@@ -3,6 +3,7 @@
  * @brief Implementation of the MqttManager class for MQTT communication handling.
  */
 #include "MqttManager/MqttManager.h"
+#include "HeapProfiler/HeapProfiler.h"
 
 /**
  * @brief Construct a new MqttManager object.
@@ -11,54 +12,387 @@
 MqttManager::MqttManager(Logger* logger):  
     _logger(logger),
     _espClient(), 
-    _client(_espClient)
+    _tap(_espClient),
+    _client(_tap)
     {}
 
 /**
  * @brief Initializes MQTT client settings and connects to the broker.
  */
 void MqttManager::begin(){
+    _espClient.setTimeout(_connectTimeout);
     _client.setServer(_server, _port);      
+    _client.setCallback([this](char* topic, uint8_t* payload, unsigned int length) { dispatch(topic, payload, length); });
+    _tap.onPuback([this](uint16_t packetId) { _inflight.acknowledge(packetId); });
 }
 
 /**
  * @brief Processes MQTT loop and manages reconnection.
  */
 void  MqttManager::loop(){ 
-    if (!_client.loop()) {
-      _client.connect(_clientId, _username, _password);
+    if (_client.loop()) {
+      _state = MQTT_STATE_CONNECTED;
+      retransmit(false);
+    } else {
+      if (_state == MQTT_STATE_CONNECTED) { // Connection lost, retry right away
+        _state = MQTT_STATE_DISCONNECTED;
+        _attempted = false;
+        _logger.logf("MQTT connection lost (state %d).\n", _client.state());
+        emit(EVENT_MQTT_LOST, _client.state());
+      }
+      if (WiFi.status() == WL_CONNECTED && (!_attempted || millis() - _lastAttempt >= _stats.retryDelay)) {
+        connect();
+      }
     }
+    drainQueue();
+    _queue.sync();
 }
 
 /**
- * @brief Publishes a message to the MQTT broker.
- * @return bool True if successful, false otherwise.
+ * @brief Makes one connection attempt; PubSubClient::connect() blocks for at most the connect timeout.
  */
-bool MqttManager::publish(String topic, String value) {
-  if (_client.connected()){
-    _client.publish((_topicPrefix +"/"+ topic).c_str(), value.c_str());
+void MqttManager::connect(){
+    _attempted = true;
+    _stats.attempts++;
+    emit(EVENT_MQTT_CONNECTING);
+
+    if (!resolveServer()) {
+      _stats.dnsFailures++;
+      _stats.failures++;
+      _logger.logf("MQTT broker '%s' cannot be resolved.\n", _server);
+      emit(EVENT_MQTT_DNS_FAILED);
+      scheduleRetry();
+      return;
+    }
+
+    unsigned long start = millis();
+    bool connected = _client.connect(_clientId, _username, _password);
+    _lastAttempt = millis();
+    _stats.lastAttemptDuration = _lastAttempt - start;
+    _stats.lastState = _client.state();
+
+    if (connected) {
+      _state = MQTT_STATE_CONNECTED;
+      _stats.successes++;
+      _stats.consecutiveFailures = 0;
+      _stats.retryDelay = 0;
+      _logger.logf("MQTT connected in %lu ms.\n", _stats.lastAttemptDuration);
+      resubscribe();
+      retransmit(true);
+      emit(EVENT_MQTT_CONNECTED, _stats.lastAttemptDuration);
+      return;
+    }
+
+    _stats.failures++;
+    _logger.logf("MQTT connection failed (state %d).\n", _stats.lastState);
+    emit(EVENT_MQTT_CONNECT_FAILED, _stats.lastState);
+    scheduleRetry();
+    if (_stats.consecutiveFailures % 3 == 0) {
+      _serverResolved = false; // The broker may have moved, resolve again on the next attempt
+    }
+}
+
+/**
+ * @brief Resolves the broker once and reuses the address, so attempts do not repeat the DNS lookup.
+ */
+bool MqttManager::resolveServer(){
+    if (_serverResolved) {
+      return true;
+    }
+    if (!_serverIP.fromString(_server) && !WiFi.hostByName(_server, _serverIP)) {
+      return false;
+    }
+    _client.setServer(_serverIP, _port);
+    _serverResolved = true;
+    return true;
+}
+
+void MqttManager::scheduleRetry(){
+    _lastAttempt = millis();
+    _stats.consecutiveFailures++;
+    unsigned long delay = _minRetryDelay;
+    for (uint16_t i = 1; i < _stats.consecutiveFailures && delay < _maxRetryDelay; i++) {
+      delay *= 2;
+    }
+    if (delay > _maxRetryDelay) delay = _maxRetryDelay;
+    _stats.retryDelay = delay - delay / 4 + random(delay / 2 + 1); // Jitter spreads the reconnections of a fleet
+}
+
+/**
+ * @brief Writes the prefix into the topic buffer, truncated to MQTT_MANAGER_PREFIX_SIZE.
+ */
+void MqttManager::setTopicPrefix(const char* IoTclassName, const char* IoTName){
+  int length = snprintf(_topicBuffer, MQTT_MANAGER_PREFIX_SIZE, "%s/%s/", IoTclassName, IoTName);
+  _topicPrefixLength = length < MQTT_MANAGER_PREFIX_SIZE ? length : MQTT_MANAGER_PREFIX_SIZE - 1;
+}
+
+/**
+ * @brief Publishes a message to the MQTT broker, or queues it until the broker is reachable.
+ * @return bool True if sent or queued, false if dropped.
+ */
+bool MqttManager::publish(const char* topic, size_t topicLength, const uint8_t* payload, size_t length, uint8_t flags) {
+  uint32_t start = micros();
+  bool published = enqueue(topic, topicLength, payload, length, flags);
+  _publishLatency.record(micros() - start);
+  return published;
+}
+
+size_t MqttManager::getMaxPayloadSize(size_t topicLength, uint8_t flags) {
+  size_t overhead = MQTT_MAX_HEADER_SIZE + 2 + _topicPrefixLength + topicLength + ((flags & MQTT_PUBLISH_QOS1) ? 2 : 0);
+  size_t packet = _client.getBufferSize() > overhead ? _client.getBufferSize() - overhead : 0;
+  bool direct = !(flags & MQTT_PUBLISH_QOS1) && !_dispatching && _queue.isEmpty() && _state == MQTT_STATE_CONNECTED;
+  return direct || packet < MQTT_MANAGER_PAYLOAD_SIZE ? packet : MQTT_MANAGER_PAYLOAD_SIZE;
+}
+
+/**
+ * @brief Sends the message right away when possible, otherwise queues it.
+ */
+bool MqttManager::enqueue(const char* topic, size_t topicLength, const uint8_t* payload, size_t length, uint8_t flags) {
+  if (topicLength >= MQTT_MANAGER_TOPIC_SIZE) {
+    _logger.log("MQTT topic too long, message dropped.\n");
+    emit(EVENT_MQTT_MESSAGE_DROPPED);
+    return false;
+  }
+  char subtopic[MQTT_MANAGER_TOPIC_SIZE];
+  memcpy(subtopic, topic, topicLength);
+  subtopic[topicLength] = '\0';
+
+  // While dispatching, the incoming topic and payload still live in the client's buffer: queue
+  if (!_dispatching && _queue.isEmpty() && _client.connected() && send(subtopic, payload, length, flags)) {
+    return true;
+  }
+  if (_queue.push(subtopic, payload, length, flags)) {
     return true;
   }
-  reportStep(-1);
+  _logger.logf("MQTT queue full, message to '%s' dropped.\n", subtopic);
+  emit(EVENT_MQTT_MESSAGE_DROPPED);
   return false;
 } 
 
+bool MqttManager::publish(const char* topic, long value, uint8_t flags) {
+  char buffer[12];
+  ltoa(value, buffer, 10);
+  return publish(topic, strlen(topic), (const uint8_t*)buffer, strlen(buffer), flags);
+}
+
+bool MqttManager::publish(const char* topic, unsigned long value, uint8_t flags) {
+  char buffer[12];
+  ultoa(value, buffer, 10);
+  return publish(topic, strlen(topic), (const uint8_t*)buffer, strlen(buffer), flags);
+}
+
+/**
+ * @brief Formats with dtostrf(), which unlike printf("%f") does not allocate on the ESP8266.
+ */
+bool MqttManager::publish(const char* topic, double value, uint8_t decimals, uint8_t flags) {
+  char buffer[32];
+  if (value > 1e15 || value < -1e15) { // Keep the integer part within the buffer
+    return publish(topic, "NaN", flags);
+  }
+  dtostrf(value, 1, decimals > 8 ? 8 : decimals, buffer);
+  return publish(topic, strlen(topic), (const uint8_t*)buffer, strlen(buffer), flags);
+}
+
+/**
+ * @brief Sends queued messages while connected, limited by a token bucket to the drain rate.
+ */
+void MqttManager::drainQueue() {
+  HEAP_SCOPE(HEAP_TAG_MQTT);
+  unsigned long now = millis();
+  _drainTokens += (now - _lastDrain) * _drainRate / 1000.0f;
+  if (_drainTokens > _drainRate) _drainTokens = _drainRate;
+  _lastDrain = now;
+
+  while (_drainTokens >= 1 && _client.connected()) {
+    const MqttMessage* message = _queue.front();
+    if (message == nullptr || !send(message->topic, message->payload, message->length, message->flags)) {
+      return; // Empty, or the client failed: keep the message for the next attempt
+    }
+    _queue.pop();
+    _drainTokens -= 1;
+  }
+}
+
 /**
- * @brief Adds a callback function to the reporting hooks list.
- * @param func Callback function to add.
+ * @brief Sends one message under the topic prefix.
+ * @return bool True if the client accepted the message.
  */
-void MqttManager::addReportStepHook(std::function<void(int)> func) {
-  _reportStepsHooks.push_back(func);
+bool MqttManager::send(const char* topic, const uint8_t* payload, size_t length, uint8_t flags) {
+  if (flags & MQTT_PUBLISH_QOS1) {
+    MqttInflightEntry* entry = _inflight.add(topic, payload, length, flags);
+    if (entry == nullptr) {
+      return false; // Window full: the message waits in the queue
+    }
+    sendInflight(*entry, false); // Once in the window, a failed write is retried like a missing PUBACK
+    return true;
+  }
+  const char* fullTopic = buildTopic(topic, strlen(topic));
+  return fullTopic != nullptr && _client.publish(fullTopic, payload, length, (flags & MQTT_PUBLISH_RETAINED) != 0);
 }
 
 /**
- * @brief Executes all registered reporting hooks with the given step value.
- * @param step Step value to report.
+ * @brief Writes the PUBLISH packet directly to the connection, as PubSubClient only publishes at QoS 0.
+ * @return bool True if the whole packet was written.
  */
-void MqttManager::reportStep(int step){
-  for (auto& hook : _reportStepsHooks) {
-    if (hook) {
-        hook(step);
+bool MqttManager::sendInflight(MqttInflightEntry& entry, bool dup) {
+  _inflight.markSent(entry, millis());
+  const MqttMessage& message = entry.message;
+  const char* fullTopic = buildTopic(message.topic, strlen(message.topic));
+  if (fullTopic == nullptr) {
+    return false;
+  }
+  size_t topicLength = strlen(fullTopic);
+
+  uint8_t header[5 + 2];
+  size_t headerLength = 0;
+  header[headerLength++] = 0x32 | (dup ? 0x08 : 0) | ((message.flags & MQTT_PUBLISH_RETAINED) ? 0x01 : 0);
+  uint32_t remaining = 2 + topicLength + 2 + message.length;
+  do { // Remaining length, 7 bits per byte
+    uint8_t b = remaining & 0x7F;
+    remaining >>= 7;
+    header[headerLength++] = remaining > 0 ? (b | 0x80) : b;
+  } while (remaining > 0);
+  header[headerLength++] = topicLength >> 8;
+  header[headerLength++] = topicLength & 0xFF;
+  uint8_t packetId[2] = { (uint8_t)(entry.packetId >> 8), (uint8_t)(entry.packetId & 0xFF) };
+
+  return _tap.write(header, headerLength) == headerLength
+    && _tap.write((const uint8_t*)fullTopic, topicLength) == topicLength
+    && _tap.write(packetId, sizeof(packetId)) == sizeof(packetId)
+    && _tap.write(message.payload, message.length) == message.length;
+}
+
+/**
+ * @brief Sends again the in-flight messages with the DUP flag.
+ */
+void MqttManager::retransmit(bool all) {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < MQTT_MANAGER_INFLIGHT_SIZE && _client.connected(); i++) {
+    MqttInflightEntry* entry = _inflight.at(i);
+    if (entry != nullptr && (all || !entry->sent || now - entry->sentAt >= _retransmitTimeout)) {
+      sendInflight(*entry, entry->sent);
+    }
+  }
+}
+
+const char* MqttManager::buildTopic(const char* topic, size_t topicLength) {
+  if (_topicPrefixLength + topicLength >= sizeof(_topicBuffer)) {
+    return nullptr;
+  }
+  memcpy(_topicBuffer + _topicPrefixLength, topic, topicLength);
+  _topicBuffer[_topicPrefixLength + topicLength] = '\0';
+  return _topicBuffer;
+}
+
+/**
+ * @brief Registers a subscription and sends it to the broker if connected.
+ * @return bool True if registered.
+ */
+bool MqttManager::subscribe(const char* topic, MqttMessageHandler handler, uint8_t qos) {
+  if (topic == nullptr || topic[0] == '\0' || !handler) {
+    return false;
+  }
+  const char* filter = buildTopic(topic, strlen(topic));
+  if (filter == nullptr) {
+    return false;
+  }
+  // Reuse a removed slot: not in the trie, and its unsubscription already sent
+  size_t id = 0;
+  while (id < _subscriptions.size() && (_subscriptions[id].handler || _subscriptions[id].pending)) {
+    id++;
+  }
+  Subscription subscription = { String(filter), handler, qos, _dispatching };
+  if (id < _subscriptions.size()) {
+    _subscriptions[id] = subscription;
+  } else {
+    _subscriptions.push_back(subscription);
+  }
+  _topics.insert(subscription.filter.c_str(), id);
+  if (_client.connected() && !_dispatching) {
+    _client.subscribe(subscription.filter.c_str(), qos);
+  }
+  return true;
+}
+
+/**
+ * @brief Removes the subscriptions to a filter and unsubscribes from the broker.
+ * @return bool True if at least one subscription was removed.
+ */
+bool MqttManager::unsubscribe(const char* topic) {
+  const char* fullFilter = buildTopic(topic, strlen(topic));
+  if (fullFilter == nullptr) {
+    return false;
+  }
+  String filter(fullFilter);
+  bool removed = false;
+  for (size_t i = 0; i < _subscriptions.size(); i++) {
+    if (_subscriptions[i].handler && _subscriptions[i].filter == filter) {
+      _topics.remove(filter.c_str(), i);
+      _subscriptions[i].handler = nullptr; // The slot is reused by a later subscribe()
+      _subscriptions[i].pending = _dispatching;
+      removed = true;
+    }
+  }
+  if (removed && _client.connected() && !_dispatching) {
+    _client.unsubscribe(filter.c_str());
+  }
+  return removed;
+}
+
+/**
+ * @brief Matches the topic in the trie and passes the payload by pointer, without copying it.
+ * 
+ * The topic and the payload point into the client's buffer, which the next packet sent 
+ * overwrites. The topic is copied before matching, and the client is left untouched until 
+ * the last handler returns: messages published meanwhile are queued, subscription changes 
+ * are sent afterwards.
+ */
+void MqttManager::dispatch(char* topic, uint8_t* payload, unsigned int length) {
+  HEAP_SCOPE(HEAP_TAG_MQTT);
+  size_t topicLength = strlen(topic);
+  char fullTopic[MQTT_MANAGER_PREFIX_SIZE + MQTT_MANAGER_TOPIC_SIZE];
+  if (topicLength >= sizeof(fullTopic)) {
+    _logger.log("MQTT incoming topic too long, message ignored.\n");
+    return;
+  }
+  memcpy(fullTopic, topic, topicLength + 1);
+  const char* subtopic = fullTopic;
+  if (topicLength >= _topicPrefixLength && strncmp(fullTopic, _topicBuffer, _topicPrefixLength) == 0) {
+    subtopic += _topicPrefixLength;
+  }
+
+  // Collect the identifiers first: a handler may subscribe or unsubscribe, changing the trie
+  uint16_t ids[MQTT_MANAGER_DISPATCH_SIZE];
+  size_t count = 0;
+  _topics.match(fullTopic, topicLength, [&](uint16_t id) {
+    if (count < MQTT_MANAGER_DISPATCH_SIZE) ids[count++] = id;
+  });
+
+  _dispatching = true;
+  for (size_t i = 0; i < count; i++) {
+    if (_subscriptions[ids[i]].handler) { // Not removed by a previous handler
+      MqttMessageHandler handler = _subscriptions[ids[i]].handler; // The vector may grow during the call
+      handler(subtopic, payload, length);
+    }
+  }
+  _dispatching = false;
+
+  for (Subscription& subscription : _subscriptions) { // Changes made by the handlers
+    if (!subscription.pending) continue;
+    subscription.pending = false;
+    if (!_client.connected()) continue; // Restored by resubscribe() on connection
+    if (subscription.handler) {
+      _client.subscribe(subscription.filter.c_str(), subscription.qos);
+    } else {
+      _client.unsubscribe(subscription.filter.c_str());
+    }
+  }
+}
+
+void MqttManager::resubscribe() {
+  for (const Subscription& subscription : _subscriptions) {
+    if (subscription.handler) {
+      _client.subscribe(subscription.filter.c_str(), subscription.qos);
     }
   }
 }
\ No newline at end of file
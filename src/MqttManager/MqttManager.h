@@ -13,8 +13,53 @@
 #include <Stream.h>
 #include <vector>
 //#include "common.h"
-#include "Logger/Logger.h"
+#include "Logger/LogSink.h"
+#include "EventBus/EventBus.h"
+#include "Metrics/LatencyHistogram.h"
+#include "MqttManager/MqttQueue.h"
+#include "MqttManager/MqttInflight.h"
+#include "MqttManager/MqttClientTap.h"
+#include "MqttManager/TopicTrie.h"
 
+/**
+ * @brief Handler of incoming messages.
+ * @param topic Subtopic of the message, relative to the topic prefix.
+ * @param payload Payload bytes, valid only during the call (not null-terminated). Messages 
+ * published by the handler are queued and sent once all handlers have returned.
+ * @param length Payload length.
+ */
+typedef std::function<void(const char* topic, const uint8_t* payload, size_t length)> MqttMessageHandler;
+
+#ifndef MQTT_MANAGER_PREFIX_SIZE
+#define MQTT_MANAGER_PREFIX_SIZE 64   ///< Maximum topic prefix length, including the separating '/'.
+#endif
+
+#ifndef MQTT_MANAGER_DISPATCH_SIZE
+#define MQTT_MANAGER_DISPATCH_SIZE 8  ///< Maximum number of subscriptions an incoming message is dispatched to.
+#endif
+
+
+/**
+ * @brief State of the connection to the broker.
+ */
+enum MqttConnectionState {
+    MQTT_STATE_DISCONNECTED,  ///< Not connected, waiting for the next attempt.
+    MQTT_STATE_CONNECTED      ///< Connected to the broker.
+};
+
+/**
+ * @brief Connection attempt metrics.
+ */
+struct MqttConnectionStats {
+    uint32_t attempts = 0;             ///< Connection attempts since boot.
+    uint32_t successes = 0;            ///< Successful connections since boot.
+    uint32_t failures = 0;             ///< Failed connection attempts since boot.
+    uint32_t dnsFailures = 0;          ///< Failed resolutions of the broker name.
+    uint16_t consecutiveFailures = 0;  ///< Failed attempts since the last successful connection.
+    int lastState = 0;                 ///< PubSubClient::state() after the last attempt.
+    unsigned long lastAttemptDuration = 0; ///< Time spent in the last connect() call, in ms.
+    unsigned long retryDelay = 0;      ///< Current delay between attempts, in ms.
+};
 
 class MqttManager {
 public:
@@ -31,21 +76,24 @@ public:
     
     /**
      * @brief Maintains MQTT connection and processes incoming messages.
-     * @details Automatically reconnects to the broker if disconnected.
+     * @details Automatically reconnects to the broker if disconnected. Attempts are spaced by an 
+     * exponential backoff with jitter, so an unreachable broker does not stall every loop.
      */
     void loop();
 
     /**
-     * @brief Sets the base topic for MQTT messages.
-     * @param value The base topic string (e.g., "EnergyMonitor").
+     * @brief Sets the base topic for MQTT messages, in the form `IoTclassName/IoTName`.
+     * @details The prefix is written once into the topic buffer that every publish completes in place.
+     * @param IoTclassName The class of the device (e.g., "EnergyMonitor").
+     * @param IoTName The name of the device (e.g., "Device1").
      */
-    void setTopicPrefix(const char* IoTclassName, const char* IoTName){ _topicPrefix = String(IoTclassName)+"/"+String(IoTName);};
+    void setTopicPrefix(const char* IoTclassName, const char* IoTName);
     
     /**
      * @brief Sets the MQTT broker server address.
      * @param value Broker IP or hostname (e.g., "mqtt.eclipse.org").
      */
-    void setServer(const char* value){ _server = value;};
+    void setServer(const char* value){ _server = value; _serverResolved = false;};
     
     /**
      * @brief Sets the MQTT broker port.
@@ -71,35 +119,277 @@ public:
      */
     void setPassword(const char* value){ _password = value;};
 
+    /**
+     * @brief Sets the bounds of the exponential backoff between connection attempts.
+     * @param minDelay Delay after the first failure, in ms (default 1000).
+     * @param maxDelay Maximum delay, in ms (default 60000).
+     */
+    void setReconnectBackoff(unsigned long minDelay, unsigned long maxDelay){ _minRetryDelay = minDelay; _maxRetryDelay = maxDelay;}
+
+    /**
+     * @brief Sets the TCP connect timeout of a connection attempt.
+     * @param value Timeout in ms (default 2000).
+     */
+    void setConnectTimeout(unsigned long value){ _connectTimeout = value;}
+
+    /**
+     * @brief Returns the state of the connection to the broker.
+     */
+    MqttConnectionState getState() const { return _state;}
+
+    /**
+     * @brief Returns the connection attempt metrics.
+     */
+    const MqttConnectionStats& getConnectionStats() const { return _stats;}
+
+    /**
+     * @brief Sets how many queued messages are sent per second by loop().
+     * @param value Messages per second (default 20). Up to one second worth of messages is sent in a burst.
+     */
+    void setDrainRate(uint16_t value){ _drainRate = value;}
+
+    /**
+     * @brief Enables spilling of the outbound queue to a ring file on LittleFS when the RAM slots are full.
+     * @param path Path of the ring file (e.g., "/mqtt.queue").
+     * @param capacity Number of messages the file can hold.
+     * @return false The file could not be opened or created.
+     */
+    bool setSpillFile(const char* path, uint16_t capacity){ return _queue.setSpillFile(path, capacity);}
+
+    /**
+     * @brief Writes the spill file header now; loop() writes it at most once per MQTT_MANAGER_SPILL_SYNC_INTERVAL.
+     * @details Call before a deep sleep or a restart, so that the spilled messages are resumed exactly.
+     */
+    void syncSpillFile(){ _queue.sync(true);}
+
+    /**
+     * @brief Persists the QoS 1 messages awaiting a PUBACK in an append-only log on LittleFS.
+     * @details Call before begin(). Messages not acknowledged before a reboot are restored 
+     * from the log and sent again on the next connection.
+     * @param path Path of the log file (e.g., "/mqtt.inflight").
+     * @return false The file could not be opened or created.
+     */
+    bool setInflightLog(const char* path){ return _inflight.setLogFile(path);}
+
+    /**
+     * @brief Sets how long a QoS 1 message waits for its PUBACK before being sent again.
+     * @param value Timeout in ms (default 10000). Every unacknowledged message is also sent again after a reconnection.
+     */
+    void setRetransmitTimeout(unsigned long value){ _retransmitTimeout = value;}
+
+    /**
+     * @brief Returns the window of QoS 1 messages awaiting a PUBACK, e.g. to read its size and metrics.
+     */
+    const MqttInflightWindow& getInflight() const { return _inflight;}
+
     /**
      * @brief Publishes a message to the MQTT broker.
-     * @param topic Subtopic under the base topic (e.g., "status").
-     * @param value Message payload to publish.
-     * @return true Message sent successfully.
-     * @return false Client not connected to the broker.
+     * @details The message is sent right away when the client is connected and nothing is queued. 
+     * Otherwise it is queued and sent by loop() once the broker is reachable. The full topic is 
+     * completed in a preallocated buffer holding the prefix, so publishing does not allocate.
+     * @param topic Subtopic under the base topic (e.g., "status"), not necessarily null-terminated.
+     * @param topicLength Subtopic length.
+     * @param payload Message payload.
+     * @param length Payload length.
+     * @param flags MqttPublishFlags, e.g. MQTT_PUBLISH_LATEST for values where only the latest one matters, 
+     * or MQTT_PUBLISH_QOS1 for messages that must be delivered at least once.
+     * @return true Message sent or queued.
+     * @return false Message dropped: subtopic too long, too large for a queue slot, or the queue is full.
      */
-    bool publish(String topic, String value);
-    
+    bool publish(const char* topic, size_t topicLength, const uint8_t* payload, size_t length, uint8_t flags = MQTT_PUBLISH_DEFAULT);
+
     /**
-     * @brief Registers a callback function to report execution steps.
-     * @param func Callback function accepting an integer step parameter.
+     * @brief Publishes a text message. See publish(const char*, size_t, const uint8_t*, size_t, uint8_t).
      */
-    void addReportStepHook(std::function<void(int)> func);
+    bool publish(const char* topic, const char* value, uint8_t flags = MQTT_PUBLISH_DEFAULT){ return publish(topic, strlen(topic), (const uint8_t*)value, strlen(value), flags);}
+
+    /**
+     * @brief Publishes a text message. See publish(const char*, size_t, const uint8_t*, size_t, uint8_t).
+     */
+    bool publish(const String& topic, const String& value, uint8_t flags = MQTT_PUBLISH_DEFAULT){ return publish(topic.c_str(), topic.length(), (const uint8_t*)value.c_str(), value.length(), flags);}
+
+    /**
+     * @brief Publishes a number, formatted as decimal text without heap allocation.
+     */
+    bool publish(const char* topic, int value, uint8_t flags = MQTT_PUBLISH_DEFAULT){ return publish(topic, (long)value, flags);}
+    bool publish(const char* topic, unsigned int value, uint8_t flags = MQTT_PUBLISH_DEFAULT){ return publish(topic, (unsigned long)value, flags);}
+    bool publish(const char* topic, long value, uint8_t flags = MQTT_PUBLISH_DEFAULT);
+    bool publish(const char* topic, unsigned long value, uint8_t flags = MQTT_PUBLISH_DEFAULT);
+
+    /**
+     * @brief Publishes a floating point number, formatted as decimal text without heap allocation.
+     * @param decimals Number of digits after the decimal point.
+     */
+    bool publish(const char* topic, double value, uint8_t decimals = 2, uint8_t flags = MQTT_PUBLISH_DEFAULT);
+
+    /**
+     * @brief Subscribes to a topic filter under the topic prefix.
+     * @details The subscription is kept and restored automatically after every reconnection. 
+     * Set the topic prefix before subscribing.
+     * @param topic Subtopic filter, may contain the `+` and `#` wildcards (e.g., "cmd/#").
+     * @param handler Called for every incoming message matching the filter.
+     * @param qos Requested QoS level, 0 or 1.
+     * @return true Subscription registered (sent to the broker now if connected, otherwise on connection).
+     * @return false Empty filter or handler.
+     */
+    bool subscribe(const char* topic, MqttMessageHandler handler, uint8_t qos = 0);
+
+    /**
+     * @brief Removes all subscriptions to a topic filter.
+     * @param topic Subtopic filter, as given to subscribe().
+     * @return true At least one subscription was removed.
+     */
+    bool unsubscribe(const char* topic);
+
+    /**
+     * @brief Slots of the subscription table, in use or freed by unsubscribe() and reused by subscribe().
+     */
+    size_t getSubscriptionSlots() const { return _subscriptions.size();}
+
+    /**
+     * @brief Sets the size of the client's packet buffer, which bounds incoming and outgoing packets.
+     * @param value Size in bytes (PubSubClient default: 256).
+     * @return false The buffer could not be allocated.
+     */
+    bool setBufferSize(uint16_t value){ return _client.setBufferSize(value);}
+
+    /**
+     * @brief Returns the largest payload a publish() to a subtopic can deliver now.
+     * @details A message sent at once is bounded by the client's buffer. A message that is 
+     * queued (not connected, older messages waiting) or sent at QoS 1 must also fit a queue 
+     * slot, MQTT_MANAGER_PAYLOAD_SIZE bytes.
+     * @param topicLength Length of the subtopic.
+     * @param flags MqttPublishFlags of the message.
+     */
+    size_t getMaxPayloadSize(size_t topicLength, uint8_t flags = MQTT_PUBLISH_DEFAULT);
+
+    /**
+     * @brief Returns the outbound queue, e.g. to read its size and counters.
+     */
+    const MqttQueue& getQueue() const { return _queue;}
+
+    /**
+     * @brief Returns the time spent in publish() calls, in µs, e.g. to measure the publish rate.
+     */
+    const LatencyHistogram& getPublishLatency() const { return _publishLatency;}
     
     /**
-     * @brief Triggers all registered step-reporting callbacks.
-     * @param step Step value to report (e.g., -1 for errors, 1/2 for progress).
+     * @brief Sets the event bus receiving the connection events (EVENT_SOURCE_MQTT).
+     * @param eventBus Pointer to the EventBus, nullptr to emit no events.
      */
-    void reportStep(int step);
+    void setEventBus(EventBus* eventBus){ _eventBus = eventBus;}
 
 private:
-    Logger* _logger; ///< Logger instance for event logging.
+    ComponentLogger _logger; ///< Logger instance for event logging.
     WiFiClient _espClient; ///< Underlying WiFi client for MQTT.
+    MqttClientTap _tap; ///< Wrapper of _espClient reporting PUBACKs and carrying QoS 1 publishes.
     PubSubClient _client; ///< MQTT client instance.
-    String _topicPrefix = "IoT"; ///< Base topic prefix for messages.
-    const char *_topic, *_server, *_clientId, *_username, *_password; ///< MQTT configuration parameters.
+    char _topicBuffer[MQTT_MANAGER_PREFIX_SIZE + MQTT_MANAGER_TOPIC_SIZE] = "IoT/"; ///< Topic buffer: prefix with its trailing '/', completed in place by each publish.
+    size_t _topicPrefixLength = 4; ///< Length of the prefix in _topicBuffer, including the trailing '/'.
+    const char* _server = nullptr; ///< Broker host name or address.
+    const char* _clientId = nullptr; ///< Client identifier.
+    const char* _username = nullptr; ///< User name, nullptr for none.
+    const char* _password = nullptr; ///< Password, nullptr for none.
     int _port; ///< MQTT broker port number.
-    std::vector<std::function<void(int)>> _reportStepsHooks; ///< List of registered step-reporting hooks.
+    EventBus* _eventBus = nullptr; ///< Event bus receiving the connection events.
+
+    /**
+     * @brief Emits an event, if an event bus is set.
+     */
+    void emit(EventType type, int32_t value = 0){ if (_eventBus != nullptr) _eventBus->emit(EVENT_SOURCE_MQTT, type, value);}
+
+    MqttQueue _queue; ///< Outbound messages waiting for the broker.
+    LatencyHistogram _publishLatency; ///< Time spent in publish().
+    uint16_t _drainRate = 20; ///< Queued messages sent per second.
+    float _drainTokens = 0; ///< Token bucket limiting the drain rate.
+    unsigned long _lastDrain = 0; ///< millis() of the last drain.
+
+    MqttInflightWindow _inflight; ///< QoS 1 messages awaiting a PUBACK.
+    unsigned long _retransmitTimeout = 10000; ///< Time to wait for a PUBACK, in ms.
+
+    /**
+     * @brief A registered subscription.
+     */
+    struct Subscription {
+        String filter;              ///< Full topic filter, including the prefix.
+        MqttMessageHandler handler; ///< Handler, empty once unsubscribed.
+        uint8_t qos;                ///< Requested QoS level.
+        bool pending;               ///< Changed by a handler, (un)subscription not sent yet.
+    };
+    std::vector<Subscription> _subscriptions; ///< Subscriptions, indexed by the trie identifiers.
+    TopicTrie _topics; ///< Topic filters of the subscriptions.
+    bool _dispatching = false; ///< Handlers are running, the client's buffer holds the incoming message.
+
+    /**
+     * @brief Dispatches an incoming message to the handlers of the matching subscriptions.
+     */
+    void dispatch(char* topic, uint8_t* payload, unsigned int length);
+
+    /**
+     * @brief Sends all subscriptions to the broker, after a (re)connection.
+     */
+    void resubscribe();
+
+    MqttConnectionState _state = MQTT_STATE_DISCONNECTED; ///< State of the connection.
+    MqttConnectionStats _stats; ///< Connection attempt metrics.
+    unsigned long _minRetryDelay = 1000; ///< Delay after the first failure, in ms.
+    unsigned long _maxRetryDelay = 60000; ///< Maximum delay between attempts, in ms.
+    unsigned long _connectTimeout = 2000; ///< TCP connect timeout, in ms.
+    unsigned long _lastAttempt = 0; ///< millis() of the last attempt.
+    bool _attempted = false; ///< At least one attempt was made.
+    IPAddress _serverIP; ///< Cached address of the broker.
+    bool _serverResolved = false; ///< _serverIP holds the address of _server.
+
+    /**
+     * @brief Makes one connection attempt, and schedules the next one on failure.
+     */
+    void connect();
+
+    /**
+     * @brief Resolves the broker name, using the cached address when available.
+     * @return true The address is known.
+     */
+    bool resolveServer();
+
+    /**
+     * @brief Doubles the delay before the next attempt, up to the maximum, with +/-25% jitter.
+     */
+    void scheduleRetry();
+
+    /**
+     * @brief Sends a published message, or queues it.
+     * @return true Message sent or queued.
+     */
+    bool enqueue(const char* topic, size_t topicLength, const uint8_t* payload, size_t length, uint8_t flags);
+
+    /**
+     * @brief Sends queued messages, within the drain rate.
+     */
+    void drainQueue();
+
+    /**
+     * @brief Sends one message to the broker.
+     * @return true The client accepted the message.
+     */
+    bool send(const char* topic, const uint8_t* payload, size_t length, uint8_t flags);
+
+    /**
+     * @brief Writes a QoS 1 PUBLISH packet for an in-flight message.
+     * @param dup Sets the DUP flag, for a message that may have been received already.
+     * @return true The packet was written to the connection.
+     */
+    bool sendInflight(MqttInflightEntry& entry, bool dup);
+
+    /**
+     * @brief Sends again the in-flight messages, all of them or only those whose PUBACK timed out.
+     */
+    void retransmit(bool all);
+
+    /**
+     * @brief Completes the topic buffer with a subtopic.
+     * @return The full topic, or nullptr if it does not fit.
+     */
+    const char* buildTopic(const char* topic, size_t topicLength);
 };
 
 #endif
\ No newline at end of file
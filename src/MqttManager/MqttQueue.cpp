@@ -0,0 +1,210 @@
+/**
+ * @file MqttQueue.cpp
+ * @brief Implementation of the MqttQueue class.
+ */
+#include "MqttManager/MqttQueue.h"
+#include <new>
+
+#define MQTT_SPILL_MAGIC 0x4D515131 // "MQQ1"
+
+/**
+ * @brief Hashes a topic for the spilled "latest value" lookup; never 0, which marks the other records.
+ */
+static uint16_t topicHash(const char* topic) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    while (*topic) {
+        hash = (hash ^ (uint8_t)*topic++) * 16777619u;
+    }
+    uint16_t folded = (uint16_t)(hash ^ (hash >> 16));
+    return folded != 0 ? folded : 1;
+}
+
+MqttQueue::~MqttQueue() {
+    delete[] _spillTopics;
+}
+
+bool MqttQueue::setSpillFile(const char* path, uint16_t capacity) {
+    if (_spillFile) {
+        sync(true);
+        _spillFile.close();
+    }
+    _spillCapacity = 0;
+    _spillHead = 0;
+    _spillCount = 0;
+    _spillDirty = false;
+    delete[] _spillTopics;
+    _spillTopics = new (std::nothrow) uint16_t[capacity](); // Without it, spilled messages are not coalesced
+
+    SpillHeader header;
+    if (LittleFS.exists(path)) {
+        _spillFile = LittleFS.open(path, "r+");
+        if (_spillFile && _spillFile.read((uint8_t*)&header, sizeof(header)) == sizeof(header)
+            && header.magic == MQTT_SPILL_MAGIC && header.capacity == capacity && header.count <= capacity) {
+            _spillCapacity = capacity;
+            _spillHead = header.head;
+            _spillCount = header.count;
+            for (uint16_t i = 0; _spillTopics != nullptr && i < _spillCount; i++) { // Index the resumed records
+                uint16_t index = (_spillHead + i) % _spillCapacity;
+                MqttMessage message;
+                if (_spillFile.seek(sizeof(SpillHeader) + (uint32_t)index * sizeof(MqttMessage))
+                    && _spillFile.read((uint8_t*)&message, sizeof(message)) == sizeof(message)
+                    && (message.flags & MQTT_PUBLISH_LATEST)) {
+                    message.topic[MQTT_MANAGER_TOPIC_SIZE - 1] = 0;
+                    _spillTopics[index] = topicHash(message.topic);
+                }
+            }
+            return true; // Resume the messages spilled before the reboot
+        }
+        if (_spillFile) _spillFile.close();
+    }
+
+    _spillFile = LittleFS.open(path, "w+");
+    if (!_spillFile) {
+        return false;
+    }
+    _spillCapacity = capacity;
+    writeSpillHeader();
+    return true;
+}
+
+bool MqttQueue::push(const char* topic, const uint8_t* payload, size_t length, uint8_t flags) {
+    if (strlen(topic) >= MQTT_MANAGER_TOPIC_SIZE || length > MQTT_MANAGER_PAYLOAD_SIZE) {
+        _dropped++;
+        return false;
+    }
+
+    if (flags & MQTT_PUBLISH_LATEST) {
+        for (uint16_t i = 0; i < _count; i++) {
+            MqttMessage& queued = _slots[(_head + i) % MQTT_MANAGER_QUEUE_SIZE];
+            if ((queued.flags & MQTT_PUBLISH_LATEST) && strcmp(queued.topic, topic) == 0) {
+                memcpy(queued.payload, payload, length);
+                queued.length = length;
+                queued.flags = flags;
+                _coalesced++;
+                return true;
+            }
+        }
+        if (_spillCount > 0 && coalesceSpilled(topic, payload, length, flags)) {
+            _coalesced++;
+            return true;
+        }
+    }
+
+    MqttMessage* message;
+    MqttMessage spilled;
+    if (_count < MQTT_MANAGER_QUEUE_SIZE && _spillCount == 0) {
+        message = &_slots[(_head + _count) % MQTT_MANAGER_QUEUE_SIZE];
+    } else if (_spillCapacity > 0 && _spillCount < _spillCapacity) {
+        message = &spilled; // Keep the order: once spilling, newer messages go to the file too
+    } else {
+        _dropped++;
+        return false;
+    }
+
+    strcpy(message->topic, topic);
+    memcpy(message->payload, payload, length);
+    message->length = length;
+    message->flags = flags;
+    message->reserved = 0;
+
+    if (message == &spilled) {
+        if (!spill(spilled)) {
+            _dropped++;
+            return false;
+        }
+    } else {
+        _count++;
+    }
+    return true;
+}
+
+const MqttMessage* MqttQueue::front() {
+    if (_count == 0) {
+        if (_spillCount == 0 || !unspill(_slots[_head])) {
+            return nullptr;
+        }
+        _count = 1;
+    }
+    return &_slots[_head];
+}
+
+void MqttQueue::pop() {
+    if (_count == 0) {
+        return;
+    }
+    _head = (_head + 1) % MQTT_MANAGER_QUEUE_SIZE;
+    _count--;
+}
+
+void MqttQueue::sync(bool force) {
+    if (_spillDirty && (force || _spillCount == 0 || millis() - _lastSpillSync >= MQTT_MANAGER_SPILL_SYNC_INTERVAL)) {
+        writeSpillHeader();
+    }
+}
+
+bool MqttQueue::spill(const MqttMessage& message) {
+    uint16_t index = (_spillHead + _spillCount) % _spillCapacity;
+    if (!_spillFile.seek(sizeof(SpillHeader) + (uint32_t)index * sizeof(MqttMessage))
+        || _spillFile.write((const uint8_t*)&message, sizeof(message)) != sizeof(message)) {
+        return false;
+    }
+    if (_spillTopics != nullptr) {
+        _spillTopics[index] = (message.flags & MQTT_PUBLISH_LATEST) ? topicHash(message.topic) : 0;
+    }
+    _spillCount++;
+    _spillDirty = true;
+    sync();
+    return true;
+}
+
+bool MqttQueue::unspill(MqttMessage& message) {
+    if (!_spillFile.seek(sizeof(SpillHeader) + (uint32_t)_spillHead * sizeof(MqttMessage))
+        || _spillFile.read((uint8_t*)&message, sizeof(message)) != sizeof(message)) {
+        return false;
+    }
+    if (_spillTopics != nullptr) {
+        _spillTopics[_spillHead] = 0;
+    }
+    _spillHead = (_spillHead + 1) % _spillCapacity;
+    _spillCount--;
+    _spillDirty = true;
+    sync();
+    return true;
+}
+
+/**
+ * @brief Replaces the payload of a spilled "latest value" record of the same topic, in place.
+ * @return False if no spilled record has this topic.
+ */
+bool MqttQueue::coalesceSpilled(const char* topic, const uint8_t* payload, size_t length, uint8_t flags) {
+    if (_spillTopics == nullptr) {
+        return false;
+    }
+    uint16_t hash = topicHash(topic);
+    for (uint16_t i = 0; i < _spillCount; i++) {
+        uint16_t index = (_spillHead + i) % _spillCapacity;
+        if (_spillTopics[index] != hash) {
+            continue;
+        }
+        uint32_t position = sizeof(SpillHeader) + (uint32_t)index * sizeof(MqttMessage);
+        MqttMessage message;
+        if (!_spillFile.seek(position) || _spillFile.read((uint8_t*)&message, sizeof(message)) != sizeof(message)
+            || strncmp(message.topic, topic, MQTT_MANAGER_TOPIC_SIZE) != 0) {
+            continue; // Hash collision
+        }
+        memcpy(message.payload, payload, length);
+        message.length = length;
+        message.flags = flags;
+        return _spillFile.seek(position) && _spillFile.write((const uint8_t*)&message, sizeof(message)) == sizeof(message);
+    }
+    return false;
+}
+
+void MqttQueue::writeSpillHeader() {
+    SpillHeader header = { MQTT_SPILL_MAGIC, _spillCapacity, _spillHead, _spillCount, 0 };
+    _spillFile.seek(0);
+    _spillFile.write((const uint8_t*)&header, sizeof(header));
+    _spillFile.flush();
+    _spillDirty = false;
+    _lastSpillSync = millis();
+}
@@ -0,0 +1,142 @@
+/**
+ * @file MqttQueue.h
+ * @brief Bounded, preallocated queue of outbound MQTT messages.
+ * 
+ * Holds messages while the broker is unreachable. Messages flagged as "latest value" 
+ * replace a queued message of the same topic instead of taking a new slot. When the 
+ * RAM slots are full, messages can optionally spill to a fixed-size ring file on LittleFS.
+ * 
+ * The header of the ring file (head and count) is written at most once per 
+ * MQTT_MANAGER_SPILL_SYNC_INTERVAL, not on every spilled or delivered message. After a 
+ * reset, messages delivered since the last header write are sent again, and messages 
+ * spilled since then are lost.
+ */
+#ifndef MQTT_QUEUE_H
+#define MQTT_QUEUE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#ifndef MQTT_MANAGER_QUEUE_SIZE
+#define MQTT_MANAGER_QUEUE_SIZE 16     ///< Number of messages held in RAM.
+#endif
+
+#ifndef MQTT_MANAGER_TOPIC_SIZE
+#define MQTT_MANAGER_TOPIC_SIZE 48     ///< Maximum subtopic length, including the terminating null.
+#endif
+
+#ifndef MQTT_MANAGER_PAYLOAD_SIZE
+#define MQTT_MANAGER_PAYLOAD_SIZE 128  ///< Maximum payload length of a queued message.
+#endif
+
+#ifndef MQTT_MANAGER_SPILL_SYNC_INTERVAL
+#define MQTT_MANAGER_SPILL_SYNC_INTERVAL 1000  ///< Minimum interval between writes of the spill file header, in ms.
+#endif
+
+/**
+ * @brief Flags of an outbound message.
+ */
+enum MqttPublishFlags : uint8_t {
+    MQTT_PUBLISH_DEFAULT = 0,        ///< Queue every message.
+    MQTT_PUBLISH_LATEST = 1 << 0,    ///< Only the latest value matters: replaces a queued message of the same topic.
+    MQTT_PUBLISH_RETAINED = 1 << 1,  ///< Publish with the retained flag.
+    MQTT_PUBLISH_QOS1 = 1 << 2       ///< Publish at QoS 1: kept and sent again until the broker acknowledges it.
+};
+
+/**
+ * @brief An outbound message, stored in a preallocated slot.
+ */
+struct MqttMessage {
+    char topic[MQTT_MANAGER_TOPIC_SIZE];        ///< Subtopic, relative to the topic prefix.
+    uint8_t payload[MQTT_MANAGER_PAYLOAD_SIZE]; ///< Payload bytes.
+    uint16_t length;                            ///< Payload length.
+    uint8_t flags;                              ///< MqttPublishFlags.
+    uint8_t reserved;                           ///< Padding.
+};
+
+class MqttQueue {
+public:
+    ~MqttQueue();
+
+    /**
+     * @brief Enables spilling to a ring file on LittleFS when the RAM slots are full.
+     * 
+     * An existing spill file with the same capacity is resumed, so messages spilled 
+     * before a reboot are delivered too.
+     * 
+     * @param path Path of the ring file (e.g. "/mqtt.queue").
+     * @param capacity Number of messages the file can hold.
+     * @return False if the file could not be opened or created.
+     */
+    bool setSpillFile(const char* path, uint16_t capacity);
+
+    /**
+     * @brief Queues a message.
+     * 
+     * @param topic Subtopic, relative to the topic prefix.
+     * @param payload Payload bytes.
+     * @param length Payload length.
+     * @param flags MqttPublishFlags.
+     * @return False if the message is too large or the queue (and spill file) is full.
+     */
+    bool push(const char* topic, const uint8_t* payload, size_t length, uint8_t flags);
+
+    /**
+     * @brief Returns the oldest message, refilling the RAM slots from the spill file if needed.
+     * 
+     * @return The message, or nullptr if the queue is empty.
+     */
+    const MqttMessage* front();
+
+    /**
+     * @brief Removes the oldest message.
+     */
+    void pop();
+
+    /**
+     * @brief Writes the spill file header if the spilled messages changed since it was last 
+     * written, and the sync interval elapsed.
+     * 
+     * @param force Write it regardless of the interval, e.g. before a deep sleep.
+     */
+    void sync(bool force = false);
+
+    size_t size() const { return _count + _spillCount; }   ///< Number of queued messages, in RAM and spilled.
+    bool isEmpty() const { return size() == 0; }           ///< Tells whether the queue is empty.
+    uint32_t getDropped() const { return _dropped; }       ///< Number of messages rejected since boot.
+    uint32_t getCoalesced() const { return _coalesced; }   ///< Number of messages replaced by a later value.
+
+private:
+    /**
+     * @brief Header of the spill file, followed by `capacity` MqttMessage records.
+     */
+    struct SpillHeader {
+        uint32_t magic;     ///< File format identifier.
+        uint16_t capacity;  ///< Number of records.
+        uint16_t head;      ///< Index of the oldest record.
+        uint16_t count;     ///< Number of records in use.
+        uint16_t reserved;  ///< Padding.
+    };
+
+    bool spill(const MqttMessage& message);
+    bool unspill(MqttMessage& message);
+    bool coalesceSpilled(const char* topic, const uint8_t* payload, size_t length, uint8_t flags);
+    void writeSpillHeader();
+
+    MqttMessage _slots[MQTT_MANAGER_QUEUE_SIZE]; ///< Preallocated RAM slots.
+    uint16_t _head = 0;                          ///< Index of the oldest RAM slot.
+    uint16_t _count = 0;                         ///< Number of RAM slots in use.
+
+    File _spillFile;                             ///< Spill ring file, open while spilling is enabled.
+    uint16_t _spillCapacity = 0;                 ///< Number of records of the spill file, 0 if disabled.
+    uint16_t _spillHead = 0;                     ///< Index of the oldest spilled record.
+    uint16_t _spillCount = 0;                    ///< Number of spilled records.
+    uint16_t* _spillTopics = nullptr;            ///< Topic hash of each spilled "latest value" record, 0 for the others.
+    bool _spillDirty = false;                    ///< The header on file is older than _spillHead/_spillCount.
+    unsigned long _lastSpillSync = 0;            ///< millis() of the last header write.
+
+    uint32_t _dropped = 0;                       ///< Messages rejected.
+    uint32_t _coalesced = 0;                     ///< Messages replaced by a later value.
+};
+
+#endif
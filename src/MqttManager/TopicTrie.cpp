@@ -0,0 +1,67 @@
+/**
+ * @file TopicTrie.cpp
+ * @brief Implementation of the TopicTrie class.
+ */
+#include "MqttManager/TopicTrie.h"
+#include <algorithm>
+#include <string.h>
+
+void TopicTrie::insert(const char* filter, uint16_t id) {
+    Node* node = &_root;
+    const char* level = filter;
+    while (true) {
+        const char* levelEnd = strchr(level, '/');
+        size_t length = levelEnd != nullptr ? (size_t)(levelEnd - level) : strlen(level);
+
+        Node* next = nullptr;
+        for (Node& child : node->children) {
+            if (child.level.compare(0, std::string::npos, level, length) == 0) {
+                next = &child;
+                break;
+            }
+        }
+        if (next == nullptr) {
+            node->children.emplace_back();
+            next = &node->children.back();
+            next->level.assign(level, length);
+        }
+        node = next;
+
+        if (levelEnd == nullptr) {
+            break;
+        }
+        level = levelEnd + 1;
+    }
+    node->ids.push_back(id);
+}
+
+bool TopicTrie::remove(const char* filter, uint16_t id) {
+    Node* node = &_root;
+    const char* level = filter;
+    while (node != nullptr) {
+        const char* levelEnd = strchr(level, '/');
+        size_t length = levelEnd != nullptr ? (size_t)(levelEnd - level) : strlen(level);
+
+        Node* next = nullptr;
+        for (Node& child : node->children) {
+            if (child.level.compare(0, std::string::npos, level, length) == 0) {
+                next = &child;
+                break;
+            }
+        }
+        node = next;
+        if (levelEnd == nullptr) {
+            break;
+        }
+        level = levelEnd + 1;
+    }
+    if (node == nullptr) {
+        return false;
+    }
+    auto it = std::find(node->ids.begin(), node->ids.end(), id);
+    if (it == node->ids.end()) {
+        return false;
+    }
+    node->ids.erase(it); // Empty nodes are kept, subscriptions are few and mostly static
+    return true;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file TopicTrie.h
+ * @brief Trie of MQTT topic filters, matched level by level against incoming topics.
+ * 
+ * Each node holds one topic level. The single-level (`+`) and multi-level (`#`) wildcards 
+ * are ordinary nodes that are followed for any level, so a topic is matched in one walk 
+ * of depth equal to its number of levels, whatever the number of filters. The trie stores 
+ * filter identifiers only and has no Arduino dependencies.
+ */
+#ifndef TOPIC_TRIE_H
+#define TOPIC_TRIE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class TopicTrie {
+public:
+    /**
+     * @brief Adds a topic filter.
+     * @param filter Topic filter, may contain `+` and a trailing `#`.
+     * @param id Identifier reported on a match.
+     */
+    void insert(const char* filter, uint16_t id);
+
+    /**
+     * @brief Removes a topic filter.
+     * @param filter Topic filter, as inserted.
+     * @param id Identifier given to insert().
+     * @return true The filter was found and removed.
+     */
+    bool remove(const char* filter, uint16_t id);
+
+    /**
+     * @brief Calls visit(id) for every filter matching a topic.
+     * @param topic Topic of an incoming message (no wildcards).
+     * @param length Topic length.
+     * @param visit Callable taking a uint16_t identifier.
+     */
+    template <typename Visitor>
+    void match(const char* topic, size_t length, Visitor&& visit) const {
+        matchLevel(_root, topic, topic + length, true, visit);
+    }
+
+private:
+    struct Node {
+        std::string level;           ///< Topic level of this node ("+" and "#" for wildcards).
+        std::vector<Node> children;  ///< Next levels.
+        std::vector<uint16_t> ids;   ///< Filters ending at this node.
+    };
+
+    template <typename Visitor>
+    static void matchLevel(const Node& node, const char* level, const char* end, bool first, Visitor& visit) {
+        const char* levelEnd = level;
+        while (levelEnd < end && *levelEnd != '/') levelEnd++;
+        size_t length = levelEnd - level;
+        bool system = first && level < end && *level == '$'; // Wildcards do not match $SYS-like topics at the first level
+
+        for (const Node& child : node.children) {
+            if (child.level == "#") {
+                if (!system) visitAll(child, visit);
+            } else if ((child.level == "+" && !system) || child.level.compare(0, std::string::npos, level, length) == 0) {
+                if (levelEnd == end) { // Last level: the filter ends here, or continues with "#" matching the parent level
+                    visitAll(child, visit);
+                    for (const Node& grandChild : child.children) {
+                        if (grandChild.level == "#") visitAll(grandChild, visit);
+                    }
+                } else {
+                    matchLevel(child, levelEnd + 1, end, false, visit);
+                }
+            }
+        }
+    }
+
+    template <typename Visitor>
+    static void visitAll(const Node& node, Visitor& visit) {
+        for (uint16_t id : node.ids) visit(id);
+    }
+
+    Node _root; ///< Root, above the first topic level.
+};
+
+#endif
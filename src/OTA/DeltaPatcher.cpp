@@ -0,0 +1,189 @@
+/**
+ * @file DeltaPatcher.cpp
+ * @brief Implementation of the DeltaPatcher class.
+ *
+ * The header and each control record are gathered in _field, whatever the chunking of the
+ * input; diff and extra runs are then consumed straight from the input into the block
+ * buffer, the base bytes of a diff run being read directly into the block before the diff
+ * is added to them.
+ */
+#include "OTA/DeltaPatcher.h"
+#include <string.h>
+
+static const uint8_t patchMagic[8] = { 'I', 'O', 'T', 'D', 'I', 'F', 'F', '1' };
+static const size_t controlSize = 12;
+
+static uint32_t readLE32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+bool DeltaPatcher::isPatch(const uint8_t* data, size_t length) {
+    return length >= sizeof(patchMagic) && memcmp(data, patchMagic, sizeof(patchMagic)) == 0;
+}
+
+void DeltaPatcher::begin(Source source, Sink sink, BaseCheck baseCheck) {
+    _source = source;
+    _sink = sink;
+    _baseCheck = baseCheck;
+    _fieldLength = 0;
+    _fill = 0;
+    _baseSize = 0;
+    _newSize = 0;
+    memset(_baseMD5, 0, sizeof(_baseMD5));
+    memset(_newSHA256, 0, sizeof(_newSHA256));
+    _basePos = 0;
+    _planned = 0;
+    _produced = 0;
+    _copied = 0;
+    _remaining = 0;
+    _extraLength = 0;
+    _seek = 0;
+    _inputSize = 0;
+    _state = STATE_HEADER;
+    _error = DELTA_OK;
+}
+
+bool DeltaPatcher::write(const uint8_t* data, size_t length) {
+    if (_state == STATE_ERROR) {
+        return false;
+    }
+    _inputSize += length;
+    while (length > 0) {
+        size_t count;
+        switch (_state) {
+        case STATE_HEADER:
+        case STATE_CONTROL: {
+            size_t fieldSize = _state == STATE_HEADER ? DELTA_PATCHER_HEADER_SIZE : controlSize;
+            count = fieldSize - _fieldLength;
+            if (count > length) count = length;
+            memcpy(_field + _fieldLength, data, count);
+            _fieldLength += count;
+            if (_fieldLength == fieldSize) {
+                _fieldLength = 0;
+                if (!(_state == STATE_HEADER ? parseHeader() : parseControl())) {
+                    return false;
+                }
+            }
+            break;
+        }
+        case STATE_DIFF:
+            count = DELTA_PATCHER_BLOCK_SIZE - _fill;
+            if (count > length) count = length;
+            if (count > _remaining) count = _remaining;
+            if (!_source(_basePos, _block + _fill, count)) {
+                return fail(DELTA_ERROR_SOURCE);
+            }
+            for (size_t i = 0; i < count; i++) {
+                _block[_fill + i] += data[i];
+            }
+            _fill += count;
+            _basePos += count;
+            _copied += count;
+            _remaining -= count;
+            if (_remaining == 0) {
+                _remaining = _extraLength;
+                _state = STATE_EXTRA;
+            }
+            break;
+        case STATE_EXTRA:
+            count = DELTA_PATCHER_BLOCK_SIZE - _fill;
+            if (count > length) count = length;
+            if (count > _remaining) count = _remaining;
+            memcpy(_block + _fill, data, count);
+            _fill += count;
+            _remaining -= count;
+            break;
+        default:
+            return fail(DELTA_ERROR_DATA); // Bytes after the end of the patch
+        }
+        data += count;
+        length -= count;
+        if (_fill == DELTA_PATCHER_BLOCK_SIZE && !flush()) {
+            return false;
+        }
+        if ((_state == STATE_DIFF || _state == STATE_EXTRA) && _remaining == 0 && !nextRecord()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeltaPatcher::end() {
+    if (_state == STATE_ERROR) {
+        return false;
+    }
+    if (_state != STATE_DONE) {
+        return fail(DELTA_ERROR_TRUNCATED);
+    }
+    return true;
+}
+
+bool DeltaPatcher::parseHeader() {
+    if (!isPatch(_field, DELTA_PATCHER_HEADER_SIZE)) {
+        return fail(DELTA_ERROR_HEADER);
+    }
+    _baseSize = readLE32(_field + 8);
+    _newSize = readLE32(_field + 12);
+    memcpy(_baseMD5, _field + 16, sizeof(_baseMD5));
+    memcpy(_newSHA256, _field + 32, sizeof(_newSHA256));
+    _state = STATE_CONTROL;
+    if (_baseCheck && !_baseCheck(*this)) {
+        return fail(DELTA_ERROR_BASE);
+    }
+    if (_newSize == 0) {
+        _state = STATE_DONE;
+    }
+    return true;
+}
+
+bool DeltaPatcher::parseControl() {
+    uint32_t diffLength = readLE32(_field);
+    _extraLength = readLE32(_field + 4);
+    _seek = (int32_t)readLE32(_field + 8);
+    if ((uint64_t)diffLength + _extraLength > _newSize - _planned || (uint64_t)_basePos + diffLength > _baseSize) {
+        return fail(DELTA_ERROR_DATA);
+    }
+    _planned += diffLength + _extraLength;
+    _remaining = diffLength;
+    _state = STATE_DIFF;
+    if (_remaining == 0) {
+        _remaining = _extraLength;
+        _state = STATE_EXTRA;
+    }
+    return _remaining > 0 || nextRecord();
+}
+
+/**
+ * @brief Closes the current record: applies its seek, and ends the patch after the last one.
+ */
+bool DeltaPatcher::nextRecord() {
+    int64_t basePos = (int64_t)_basePos + _seek;
+    if (basePos < 0 || basePos > (int64_t)_baseSize) {
+        return fail(DELTA_ERROR_DATA);
+    }
+    _basePos = (uint32_t)basePos;
+    if (_planned < _newSize) {
+        _state = STATE_CONTROL;
+        return true;
+    }
+    _state = STATE_DONE;
+    return flush();
+}
+
+bool DeltaPatcher::flush() {
+    if (_fill == 0) {
+        return true;
+    }
+    if (!_sink(_block, _fill)) {
+        return fail(DELTA_ERROR_OUTPUT);
+    }
+    _produced += _fill;
+    _fill = 0;
+    return true;
+}
+
+bool DeltaPatcher::fail(DeltaPatcherError error) {
+    _state = STATE_ERROR;
+    _error = error;
+    return false;
+}
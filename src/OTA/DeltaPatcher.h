@@ -0,0 +1,148 @@
+/**
+ * @file DeltaPatcher.h
+ * @brief Streaming applier of binary delta patches (bsdiff-style) against a base image.
+ *
+ * A patch, produced by tools/delta_patch.py, describes a new image as a sequence of records:
+ * a run of bytes added to bytes of the base image (mostly zeros when code only moved, so
+ * it compresses well), a run of new bytes copied as they are, and a seek in the base. The
+ * records are interleaved in one stream, so the patch is applied as it arrives, in any
+ * chunk size, and the new image is produced in order, DELTA_PATCHER_BLOCK_SIZE bytes at a
+ * time. Memory is fixed: the block buffer and a few counters.
+ *
+ * Patch format (integers little-endian):
+ * - header: "IOTDIFF1", base size (u32), new size (u32), MD5 of the base (16 bytes),
+ *   SHA-256 of the new image (32 bytes);
+ * - records: diff length (u32), extra length (u32), seek (i32), then the diff bytes,
+ *   then the extra bytes.
+ *
+ * The patch is usually gzip-compressed; inflating it is left to the caller (GzipInflater).
+ * Verifying the SHA-256 of the output is also left to the caller.
+ *
+ * Depends only on the C++ standard library.
+ */
+#ifndef DELTA_PATCHER_H
+#define DELTA_PATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+#ifndef DELTA_PATCHER_BLOCK_SIZE
+#define DELTA_PATCHER_BLOCK_SIZE 512   ///< Output block, in bytes; also the largest read of the base image.
+#endif
+
+#define DELTA_PATCHER_HEADER_SIZE 64   ///< Size of the patch header, in bytes.
+
+/**
+ * @brief Error of a DeltaPatcher.
+ */
+enum DeltaPatcherError : uint8_t {
+    DELTA_OK,                ///< No error.
+    DELTA_ERROR_HEADER,      ///< Not a delta patch, or unsupported version.
+    DELTA_ERROR_BASE,        ///< The patch was made for another base image.
+    DELTA_ERROR_DATA,        ///< A record reaches outside the base or the new image.
+    DELTA_ERROR_SOURCE,      ///< The base image could not be read.
+    DELTA_ERROR_TRUNCATED,   ///< The patch ended before the new image was complete.
+    DELTA_ERROR_OUTPUT       ///< The sink refused the output.
+};
+
+class DeltaPatcher {
+public:
+    /**
+     * @brief Reads length bytes of the base image at offset; returns false on error.
+     */
+    typedef std::function<bool(uint32_t offset, uint8_t* data, size_t length)> Source;
+
+    /**
+     * @brief Receives the new image in order; returns false to stop with DELTA_ERROR_OUTPUT.
+     */
+    typedef std::function<bool(const uint8_t* data, size_t length)> Sink;
+
+    /**
+     * @brief Checks the header (base size and MD5) before any byte is produced; returns
+     * false to stop with DELTA_ERROR_BASE.
+     */
+    typedef std::function<bool(const DeltaPatcher& patcher)> BaseCheck;
+
+    DeltaPatcher() = default;
+
+    DeltaPatcher(const DeltaPatcher&) = delete;
+    DeltaPatcher& operator=(const DeltaPatcher&) = delete;
+
+    /**
+     * @brief Starts a new patch.
+     *
+     * @param source Reader of the base image.
+     * @param sink Receiver of the new image.
+     * @param baseCheck Check of the base image, nullptr to apply the patch to any base.
+     */
+    void begin(Source source, Sink sink, BaseCheck baseCheck = nullptr);
+
+    /**
+     * @brief Applies a chunk of the patch.
+     *
+     * @param data Patch bytes.
+     * @param length Number of bytes.
+     * @return False on error, see getError().
+     */
+    bool write(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Ends the patch.
+     *
+     * @return True if the new image is complete and was handed to the sink.
+     */
+    bool end();
+
+    DeltaPatcherError getError() const { return _error; }     ///< Error that stopped the patch, DELTA_OK if none.
+    bool hasHeader() const { return _state > STATE_HEADER; }   ///< True once the header has been received.
+    uint32_t getBaseSize() const { return _baseSize; }         ///< Size of the base image the patch was made for.
+    uint32_t getNewSize() const { return _newSize; }           ///< Size of the new image.
+    const uint8_t* getBaseMD5() const { return _baseMD5; }     ///< MD5 of the base image (16 bytes).
+    const uint8_t* getNewSHA256() const { return _newSHA256; } ///< SHA-256 of the new image (32 bytes).
+    uint32_t getInputSize() const { return _inputSize; }       ///< Patch bytes received.
+    uint32_t getOutputSize() const { return _produced; }       ///< Bytes of the new image handed to the sink.
+    uint32_t getCopiedSize() const { return _copied; }         ///< Bytes of the new image derived from the base.
+
+    /**
+     * @brief Tells whether data starts with the magic bytes of an uncompressed patch.
+     */
+    static bool isPatch(const uint8_t* data, size_t length);
+
+private:
+    enum State : uint8_t { STATE_HEADER, STATE_CONTROL, STATE_DIFF, STATE_EXTRA, STATE_DONE, STATE_ERROR };
+
+    bool parseHeader();
+    bool parseControl();
+    bool nextRecord();
+    bool flush();
+    bool fail(DeltaPatcherError error);
+
+    Source _source;                              ///< Reader of the base image.
+    Sink _sink;                                  ///< Receiver of the new image.
+    BaseCheck _baseCheck;                        ///< Check of the base image.
+
+    uint8_t _field[DELTA_PATCHER_HEADER_SIZE];   ///< Header or control record being received.
+    size_t _fieldLength = 0;                     ///< Bytes of _field received.
+    uint8_t _block[DELTA_PATCHER_BLOCK_SIZE];    ///< Output not yet handed to the sink.
+    size_t _fill = 0;                            ///< Bytes in _block.
+
+    uint32_t _baseSize = 0;                      ///< Size of the base image.
+    uint32_t _newSize = 0;                       ///< Size of the new image.
+    uint8_t _baseMD5[16] = {};                   ///< MD5 of the base image.
+    uint8_t _newSHA256[32] = {};                 ///< SHA-256 of the new image.
+
+    uint32_t _basePos = 0;                       ///< Offset in the base image of the next diff byte.
+    uint32_t _planned = 0;                       ///< Size of the new image covered by the records received.
+    uint32_t _produced = 0;                      ///< Bytes handed to the sink.
+    uint32_t _copied = 0;                        ///< Bytes derived from the base image.
+    uint32_t _remaining = 0;                     ///< Bytes left in the current diff or extra run.
+    uint32_t _extraLength = 0;                   ///< Extra length of the current record.
+    int32_t _seek = 0;                           ///< Seek of the current record.
+    uint32_t _inputSize = 0;                     ///< Patch bytes received.
+
+    State _state = STATE_HEADER;                 ///< Position in the patch.
+    DeltaPatcherError _error = DELTA_OK;         ///< Error that stopped the patch.
+};
+
+#endif
@@ -0,0 +1,264 @@
+/**
+ * @file FileSystemIndex.cpp
+ * @brief Implementation of the FileSystemIndex class.
+ */
+#include "OTA/FileSystemIndex.h"
+
+/**
+ * @brief Compares two paths, '/' sorting before any other character, so that the content
+ * of a directory directly follows the directory and precedes its siblings.
+ */
+static int comparePaths(const char* a, size_t aLength, const char* b, size_t bLength) {
+    size_t length = aLength < bLength ? aLength : bLength;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t ca = a[i] == '/' ? 0 : (uint8_t)a[i];
+        uint8_t cb = b[i] == '/' ? 0 : (uint8_t)b[i];
+        if (ca != cb) return ca < cb ? -1 : 1;
+    }
+    return aLength < bLength ? -1 : (aLength > bLength ? 1 : 0);
+}
+
+FileIndexPage FileSystemIndex::list(const FileIndexQuery& query, Visitor visitor) {
+    FileIndexPage page;
+    if (_built && millis() - _builtAt > OTA_INDEX_MAX_AGE) {
+        _built = false;
+    }
+    if (!_built) {
+        build();
+    }
+    uint32_t limit = query.limit == 0 || query.limit > OTA_INDEX_PAGE_SIZE ? OTA_INDEX_PAGE_SIZE : query.limit;
+    String directory = normalize(query.path);
+    String prefix = directory == "/" ? directory : directory + "/";
+    uint32_t matched = 0;
+    if (_overflow) {
+        walkPage(query, prefix, limit, visitor, matched, page);
+        return page;
+    }
+
+    for (size_t i = lowerBound(prefix.c_str(), prefix.length()); i < _entries.size(); i++) {
+        const Entry& entry = _entries[i];
+        const char* path = pathOf(entry);
+        if (entry.pathLength <= prefix.length() || memcmp(path, prefix.c_str(), prefix.length()) != 0) {
+            break; // Past the content of the directory
+        }
+        if (!query.recursive && memchr(path + prefix.length(), '/', entry.pathLength - prefix.length()) != nullptr) {
+            continue;
+        }
+        if (!(query.types & (entry.directory ? FILE_INDEX_DIRECTORIES : FILE_INDEX_FILES))) {
+            continue;
+        }
+        if (matched >= query.offset && page.listed < limit) {
+            String entryPath;
+            entryPath.concat(path, entry.pathLength);
+            visitor(entryPath, entry.directory, entry.size);
+            page.listed++;
+        }
+        matched++;
+    }
+    page.total = matched;
+    page.more = matched > query.offset + page.listed;
+    return page;
+}
+
+/**
+ * @brief Lists a directory of a tree too large to be indexed, stopping after the page.
+ *
+ * @return False once the page is full and a further matching entry was found.
+ */
+bool FileSystemIndex::walkPage(const FileIndexQuery& query, const String& directory, uint32_t limit, Visitor& visitor, uint32_t& matched, FileIndexPage& page) {
+    Dir dir = LittleFS.openDir(directory);
+    while (dir.next()) {
+        bool isDirectory = dir.isDirectory();
+        if (query.types & (isDirectory ? FILE_INDEX_DIRECTORIES : FILE_INDEX_FILES)) {
+            if (matched >= query.offset) {
+                if (page.listed == limit) {
+                    page.more = true;
+                    return false;
+                }
+                visitor(directory + dir.fileName(), isDirectory, isDirectory ? 0 : dir.fileSize());
+                page.listed++;
+            }
+            matched++;
+        }
+        if (isDirectory && query.recursive && !walkPage(query, directory + dir.fileName() + "/", limit, visitor, matched, page)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const FSInfo& FileSystemIndex::getInfo() {
+    if (!_infoValid) {
+        LittleFS.info(_info);
+        _infoValid = true;
+    }
+    return _info;
+}
+
+void FileSystemIndex::added(const String& path, bool directory, uint32_t size) {
+    _infoValid = false;
+    if (!isIndexed()) {
+        return;
+    }
+    String normalized = normalize(path);
+    for (int slash = normalized.indexOf('/', 1); slash > 0; slash = normalized.indexOf('/', slash + 1)) {
+        if (!insert(normalized.substring(0, slash), true, 0)) {
+            _overflow = true;
+            release();
+            return;
+        }
+    }
+    if (!insert(normalized, directory, size)) {
+        _overflow = true;
+        release();
+    }
+}
+
+void FileSystemIndex::removed(const String& path) {
+    _infoValid = false;
+    if (!isIndexed()) {
+        return;
+    }
+    String normalized = normalize(path);
+    size_t first = lowerBound(normalized.c_str(), normalized.length());
+    if (first == _entries.size() || comparePaths(pathOf(_entries[first]), _entries[first].pathLength, normalized.c_str(), normalized.length()) != 0) {
+        return;
+    }
+    size_t last = first + 1;
+    while (last < _entries.size() && _entries[last].pathLength > normalized.length()
+        && pathOf(_entries[last])[normalized.length()] == '/'
+        && memcmp(pathOf(_entries[last]), normalized.c_str(), normalized.length()) == 0) {
+        last++; // Content of a removed directory
+    }
+    for (size_t i = first; i < last; i++) {
+        _garbage += _entries[i].pathLength;
+    }
+    _entries.erase(_entries.begin() + first, _entries.begin() + last);
+    // LittleFS removes the directories left empty by a removal: drop them as well.
+    String parent = normalized;
+    for (int slash = parent.lastIndexOf('/'); slash > 0; slash = parent.lastIndexOf('/')) {
+        parent = parent.substring(0, slash);
+        if (LittleFS.exists(parent)) {
+            break;
+        }
+        size_t index = lowerBound(parent.c_str(), parent.length());
+        if (index < _entries.size() && comparePaths(pathOf(_entries[index]), _entries[index].pathLength, parent.c_str(), parent.length()) == 0) {
+            _garbage += _entries[index].pathLength;
+            _entries.erase(_entries.begin() + index);
+        }
+    }
+    if (_garbage > _paths.size() / 2) {
+        compact();
+    }
+}
+
+void FileSystemIndex::invalidate() {
+    release();
+    _built = false;
+    _overflow = false;
+    _infoValid = false;
+}
+
+String FileSystemIndex::normalize(const String& path) {
+    String result = "/";
+    for (size_t i = 0; i < path.length(); i++) {
+        char c = path[i];
+        if (c == '/' && result.endsWith("/")) {
+            continue;
+        }
+        result += c;
+    }
+    if (result.length() > 1 && result.endsWith("/")) {
+        result.remove(result.length() - 1);
+    }
+    return result;
+}
+
+size_t FileSystemIndex::getBytes() const {
+    return _entries.capacity() * sizeof(Entry) + _paths.capacity();
+}
+
+void FileSystemIndex::build() {
+    release();
+    _built = true;
+    _overflow = !walk("/");
+    _builtAt = millis();
+    _builds++;
+    if (_overflow) {
+        release();
+    } else {
+        _entries.shrink_to_fit();
+        _paths.shrink_to_fit();
+    }
+}
+
+bool FileSystemIndex::walk(const String& directory) {
+    Dir dir = LittleFS.openDir(directory);
+    while (dir.next()) {
+        String path = directory + dir.fileName();
+        bool isDirectory = dir.isDirectory();
+        if (!insert(path, isDirectory, isDirectory ? 0 : dir.fileSize())) {
+            return false;
+        }
+        if (isDirectory && !walk(path + "/")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Adds an entry, or updates the entry of the same path.
+ *
+ * @return False if the index would exceed OTA_INDEX_MAX_BYTES.
+ */
+bool FileSystemIndex::insert(const String& path, bool directory, uint32_t size) {
+    size_t index = lowerBound(path.c_str(), path.length());
+    if (index < _entries.size() && comparePaths(pathOf(_entries[index]), _entries[index].pathLength, path.c_str(), path.length()) == 0) {
+        _entries[index].directory = directory;
+        _entries[index].size = size;
+        return true;
+    }
+    if ((_entries.size() + 1) * sizeof(Entry) + _paths.size() + path.length() > OTA_INDEX_MAX_BYTES || path.length() > 0xFFFF) {
+        return false;
+    }
+    Entry entry = { size, (uint32_t)_paths.size(), (uint16_t)path.length(), directory };
+    _paths.insert(_paths.end(), path.c_str(), path.c_str() + path.length());
+    _entries.insert(_entries.begin() + index, entry);
+    return true;
+}
+
+size_t FileSystemIndex::lowerBound(const char* path, size_t length) const {
+    size_t low = 0;
+    size_t high = _entries.size();
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (comparePaths(pathOf(_entries[middle]), _entries[middle].pathLength, path, length) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Drops the paths of removed entries from the pool.
+ */
+void FileSystemIndex::compact() {
+    std::vector<char> paths;
+    paths.reserve(_paths.size() - _garbage);
+    for (Entry& entry : _entries) {
+        uint32_t offset = paths.size();
+        paths.insert(paths.end(), pathOf(entry), pathOf(entry) + entry.pathLength);
+        entry.pathOffset = offset;
+    }
+    _paths.swap(paths);
+    _garbage = 0;
+}
+
+void FileSystemIndex::release() {
+    std::vector<Entry>().swap(_entries);
+    std::vector<char>().swap(_paths);
+    _garbage = 0;
+}
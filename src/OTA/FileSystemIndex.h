@@ -0,0 +1,142 @@
+/**
+ * @file FileSystemIndex.h
+ * @brief In-memory index of the LittleFS tree, answering paginated and filtered listings.
+ *
+ * The index is built by one walk of the file system on the first listing, then kept up to
+ * date by the OTA handlers that change the tree (upload, delete, directory creation)
+ * instead of walking it again on every request. Paths are stored once, in a single pool,
+ * sorted so that the content of a directory is contiguous and found by binary search.
+ *
+ * Memory is bounded by OTA_INDEX_MAX_BYTES: a tree too large for it is not indexed, and
+ * listings walk the requested directory instead, with the same filters and pages, so that
+ * a directory of thousands of data files is listed a page at a time in bounded memory.
+ * Files written by other code are picked up after OTA_INDEX_MAX_AGE, or at once after
+ * invalidate().
+ */
+
+#ifndef FILE_SYSTEM_INDEX_H
+#define FILE_SYSTEM_INDEX_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <functional>
+#include <vector>
+
+#ifndef OTA_INDEX_MAX_BYTES
+#define OTA_INDEX_MAX_BYTES 8192   ///< Largest index (entries and paths), in bytes; larger trees are walked on each listing.
+#endif
+
+#ifndef OTA_INDEX_MAX_AGE
+#define OTA_INDEX_MAX_AGE 300000   ///< Age after which the index is rebuilt, in ms, to pick up files written by other code.
+#endif
+
+#ifndef OTA_INDEX_PAGE_SIZE
+#define OTA_INDEX_PAGE_SIZE 100    ///< Default and largest number of entries of a listing page.
+#endif
+
+#define FILE_INDEX_FILES 0x01         ///< Query type: files.
+#define FILE_INDEX_DIRECTORIES 0x02   ///< Query type: directories.
+
+/**
+ * @brief Listing request: directory, filters and page.
+ */
+struct FileIndexQuery {
+    String path = "/";                                            ///< Directory listed.
+    bool recursive = true;                                        ///< Include the content of subdirectories.
+    uint8_t types = FILE_INDEX_FILES | FILE_INDEX_DIRECTORIES;    ///< Types listed.
+    uint32_t offset = 0;                                          ///< Matching entries skipped.
+    uint32_t limit = OTA_INDEX_PAGE_SIZE;                         ///< Entries listed at most.
+};
+
+/**
+ * @brief Result of a listing, besides its entries.
+ */
+struct FileIndexPage {
+    uint32_t listed = 0;    ///< Entries listed.
+    int32_t total = -1;     ///< Matching entries in all pages, -1 if unknown (tree not indexed).
+    bool more = false;      ///< Matching entries follow this page.
+};
+
+/**
+ * @class FileSystemIndex
+ * @brief Lazily built, incrementally maintained index of the files and directories of LittleFS.
+ */
+class FileSystemIndex {
+public:
+    /**
+     * @brief Receives an entry of a listing: full path, type and size (0 for directories).
+     */
+    typedef std::function<void(const String& path, bool directory, uint32_t size)> Visitor;
+
+    /**
+     * @brief Lists the entries matching a query, in path order, building the index if needed.
+     *
+     * @param query Directory, filters and page.
+     * @param visitor Receiver of the entries of the page.
+     * @return Number of entries listed, total and whether more follow.
+     */
+    FileIndexPage list(const FileIndexQuery& query, Visitor visitor);
+
+    /**
+     * @brief Returns the file system usage, cached until the tree changes.
+     */
+    const FSInfo& getInfo();
+
+    /**
+     * @brief Records a file written or a directory created, with its missing parent directories.
+     */
+    void added(const String& path, bool directory, uint32_t size = 0);
+
+    /**
+     * @brief Records a file or directory removed, with the content of the directory and the
+     * parent directories that no longer exist.
+     */
+    void removed(const String& path);
+
+    /**
+     * @brief Drops the index and the usage; the next listing walks the file system again.
+     */
+    void invalidate();
+
+    /**
+     * @brief Returns the path with a leading slash, without duplicate or trailing slashes.
+     */
+    static String normalize(const String& path);
+
+    bool isIndexed() const { return _built && !_overflow; }   ///< True while listings are answered from memory.
+    size_t getEntries() const { return _entries.size(); }      ///< Entries in the index.
+    size_t getBytes() const;                                   ///< Memory used by the index, in bytes.
+    uint32_t getBuilds() const { return _builds; }             ///< Walks of the whole file system done to build the index.
+
+private:
+    /**
+     * @brief Indexed file or directory; its path is in the pool.
+     */
+    struct Entry {
+        uint32_t size;          ///< File size, 0 for directories.
+        uint32_t pathOffset;    ///< Offset of the path in _paths.
+        uint16_t pathLength;    ///< Length of the path.
+        bool directory;         ///< The entry is a directory.
+    };
+
+    void build();
+    bool walk(const String& directory);
+    bool insert(const String& path, bool directory, uint32_t size);
+    size_t lowerBound(const char* path, size_t length) const;
+    const char* pathOf(const Entry& entry) const { return _paths.data() + entry.pathOffset; }
+    void release();
+    bool walkPage(const FileIndexQuery& query, const String& directory, uint32_t limit, Visitor& visitor, uint32_t& matched, FileIndexPage& page);
+    void compact();
+
+    std::vector<Entry> _entries;   ///< Entries sorted by path, '/' sorting first.
+    std::vector<char> _paths;      ///< Pool of the paths, without terminators.
+    size_t _garbage = 0;           ///< Bytes of _paths of removed entries.
+    bool _built = false;           ///< The file system has been walked since the last invalidation.
+    bool _overflow = false;        ///< The tree exceeded OTA_INDEX_MAX_BYTES: listings walk the file system.
+    uint32_t _builtAt = 0;         ///< millis() of the last build.
+    uint32_t _builds = 0;          ///< Builds done.
+    FSInfo _info = {};             ///< Cached usage.
+    bool _infoValid = false;       ///< _info matches the file system.
+};
+
+#endif // FILE_SYSTEM_INDEX_H
@@ -0,0 +1,150 @@
+/**
+ * @file FileUploadSession.cpp
+ * @brief Implementation of the FileUploadSession class.
+ */
+#include "OTA/FileUploadSession.h"
+#include <new>
+
+FileUploadSession::FileUploadSession(const String& path) : _path(path) {
+    int slash = path.lastIndexOf('/');
+    _tempPath = path.substring(0, slash + 1) + OTA_UPLOAD_TEMP_NAME;
+}
+
+FileUploadSession::~FileUploadSession() {
+    abort();
+}
+
+bool FileUploadSession::begin(bool inflate) {
+    if (inflate) {
+        _inflater = new (std::nothrow) GzipInflater();
+        if (_inflater == nullptr || !_inflater->begin([this](const uint8_t* data, size_t length) { return store(data, length); })) {
+            return fail(FILE_UPLOAD_ERROR_MEMORY);
+        }
+    }
+    _file = LittleFS.open(_tempPath, "w");
+    if (!_file) {
+        return fail(FILE_UPLOAD_ERROR_OPEN);
+    }
+    _open = true;
+    _buffer = new (std::nothrow) uint8_t[OTA_UPLOAD_BUFFER_SIZE];
+    return true;
+}
+
+bool FileUploadSession::write(const uint8_t* data, size_t length) {
+    if (_error != FILE_UPLOAD_OK || !_open) {
+        return false;
+    }
+    if (_inflater == nullptr) {
+        return store(data, length);
+    }
+    uint32_t inflateStart = micros();
+    uint32_t writeMicros = _writeMicros;
+    bool inflated = _inflater->write(data, length);
+    _inflateMicros += (micros() - inflateStart) - (_writeMicros - writeMicros);
+    if (!inflated && _error == FILE_UPLOAD_OK) {
+        _inflateError = _inflater->getError();
+        return fail(FILE_UPLOAD_ERROR_INFLATE);
+    }
+    return inflated;
+}
+
+bool FileUploadSession::end() {
+    if (_error != FILE_UPLOAD_OK || !_open) {
+        return false;
+    }
+    if (_inflater != nullptr) {
+        uint32_t inflateStart = micros();
+        uint32_t writeMicros = _writeMicros;
+        bool inflated = _inflater->end();
+        _inflateMicros += (micros() - inflateStart) - (_writeMicros - writeMicros);
+        if (!inflated) {
+            if (_error != FILE_UPLOAD_OK) return false;
+            _inflateError = _inflater->getError();
+            return fail(FILE_UPLOAD_ERROR_INFLATE);
+        }
+    }
+    if (!flush()) {
+        return false;
+    }
+    _file.close();
+    if (!LittleFS.rename(_tempPath, _path)) { // Replaces the previous version atomically; on failure it is kept
+        return fail(FILE_UPLOAD_ERROR_RENAME);
+    }
+    _open = false;
+    abort(); // Frees the buffer and inflater
+    return true;
+}
+
+void FileUploadSession::abort() {
+    if (_open) {
+        _file.close();
+        LittleFS.remove(_tempPath);
+        _open = false;
+    }
+    delete[] _buffer;
+    _buffer = nullptr;
+    _fill = 0;
+    delete _inflater;
+    _inflater = nullptr;
+}
+
+/**
+ * @brief Adds received (or inflated) bytes to the buffer, writing it each time it is full.
+ *
+ * When the buffer is empty, whole buffers of a large chunk are written directly, at the
+ * same aligned offsets, without the copy.
+ */
+bool FileUploadSession::store(const uint8_t* data, size_t length) {
+    if (_buffer == nullptr) {
+        return writeFile(data, length);
+    }
+    while (length > 0) {
+        if (_fill == 0 && length >= OTA_UPLOAD_BUFFER_SIZE) {
+            size_t direct = length - length % OTA_UPLOAD_BUFFER_SIZE;
+            if (!writeFile(data, direct)) return false;
+            data += direct;
+            length -= direct;
+            continue;
+        }
+        size_t count = OTA_UPLOAD_BUFFER_SIZE - _fill;
+        if (count > length) count = length;
+        memcpy(_buffer + _fill, data, count);
+        _fill += count;
+        data += count;
+        length -= count;
+        if (_fill == OTA_UPLOAD_BUFFER_SIZE && !flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FileUploadSession::writeFile(const uint8_t* data, size_t length) {
+    uint32_t writeStart = micros();
+    size_t written = _file.write(data, length);
+    _writeMicros += micros() - writeStart;
+    _storedBytes += written;
+    _writes++;
+    if (written != length) {
+        return fail(FILE_UPLOAD_ERROR_WRITE);
+    }
+    return true;
+}
+
+bool FileUploadSession::flush() {
+    if (_fill == 0) {
+        return true;
+    }
+    size_t fill = _fill;
+    _fill = 0;
+    return writeFile(_buffer, fill);
+}
+
+/**
+ * @brief Records the error; the temporary file is removed by abort() or the destructor, not
+ * here, since the inflater may be the caller.
+ */
+bool FileUploadSession::fail(FileUploadError error) {
+    _error = error;
+    return false;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file FileUploadSession.h
+ * @brief State of one file upload: temporary file, write-behind buffer and inflater.
+ *
+ * The received (or inflated) bytes are gathered in a buffer of OTA_UPLOAD_BUFFER_SIZE bytes
+ * and written to the file system a full buffer at a time, at offsets aligned on the buffer
+ * size, instead of one small write per network chunk. The file is written under a temporary
+ * name in the target directory and renamed over the target once complete, so a failed or
+ * aborted upload never leaves a truncated file, nor replaces an existing one.
+ */
+
+#ifndef FILE_UPLOAD_SESSION_H
+#define FILE_UPLOAD_SESSION_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "OTA/GzipInflater.h"
+
+#ifndef OTA_UPLOAD_BUFFER_SIZE
+#define OTA_UPLOAD_BUFFER_SIZE 4096   ///< Write-behind buffer of file uploads, in bytes: one flash sector.
+#endif
+
+#ifndef OTA_UPLOAD_TEMP_NAME
+#define OTA_UPLOAD_TEMP_NAME ".upload.part"   ///< Name of the temporary file, in the target directory.
+#endif
+
+/**
+ * @brief Error of a FileUploadSession.
+ */
+enum FileUploadError : uint8_t {
+    FILE_UPLOAD_OK,             ///< No error.
+    FILE_UPLOAD_ERROR_OPEN,     ///< The temporary file could not be created.
+    FILE_UPLOAD_ERROR_MEMORY,   ///< Not enough memory for the inflater.
+    FILE_UPLOAD_ERROR_WRITE,    ///< A write failed: the file system is full.
+    FILE_UPLOAD_ERROR_INFLATE,  ///< Invalid compressed data.
+    FILE_UPLOAD_ERROR_RENAME    ///< The complete file could not replace the target.
+};
+
+/**
+ * @class FileUploadSession
+ * @brief Receives one file upload into a temporary file, renamed on success.
+ */
+class FileUploadSession {
+public:
+    /**
+     * @brief Constructs a session storing into path.
+     * @param path Path of the file once complete.
+     */
+    FileUploadSession(const String& path);
+
+    /**
+     * @brief Abandons the upload if it was not ended, removing the temporary file.
+     */
+    ~FileUploadSession();
+
+    FileUploadSession(const FileUploadSession&) = delete;
+    FileUploadSession& operator=(const FileUploadSession&) = delete;
+
+    /**
+     * @brief Creates the temporary file and allocates the buffer and, if inflating, the inflater.
+     *
+     * Without memory for the buffer the upload is written unbuffered.
+     *
+     * @param inflate Inflate the received bytes (gzip) before storing them.
+     * @return False on error, see getError().
+     */
+    bool begin(bool inflate);
+
+    /**
+     * @brief Stores a received chunk.
+     *
+     * @return False on error; later chunks are ignored.
+     */
+    bool write(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Flushes the buffer, verifies the compressed stream, and renames the file over the target.
+     *
+     * @return False on error; the temporary file is removed with the session, and a previous 
+     * version of the target is left as it was.
+     */
+    bool end();
+
+    /**
+     * @brief Abandons the upload and removes the temporary file.
+     */
+    void abort();
+
+    FileUploadError getError() const { return _error; }          ///< Error that stopped the upload, FILE_UPLOAD_OK if none.
+    GzipInflaterError getInflateError() const { return _inflateError; } ///< Error of the inflater, if inflating.
+    const String& getPath() const { return _path; }              ///< Path of the file once complete.
+    uint32_t getStoredBytes() const { return _storedBytes; }     ///< Bytes written to the file.
+    uint32_t getWrites() const { return _writes; }               ///< Write calls to the file system.
+    uint32_t getWriteMicros() const { return _writeMicros; }     ///< Time spent writing to the file system, in µs.
+    uint32_t getInflateMicros() const { return _inflateMicros; } ///< Time spent inflating, in µs.
+
+private:
+    bool store(const uint8_t* data, size_t length);
+    bool writeFile(const uint8_t* data, size_t length);
+    bool flush();
+    bool fail(FileUploadError error);
+
+    String _path;                                   ///< Path of the file once complete.
+    String _tempPath;                               ///< Path of the temporary file.
+    File _file;                                     ///< Temporary file, open during the upload.
+    uint8_t* _buffer = nullptr;                     ///< Write-behind buffer, nullptr if unbuffered.
+    size_t _fill = 0;                               ///< Bytes in _buffer.
+    GzipInflater* _inflater = nullptr;              ///< Inflater, nullptr if not inflating.
+    FileUploadError _error = FILE_UPLOAD_OK;        ///< Error that stopped the upload.
+    GzipInflaterError _inflateError = GZIP_OK;      ///< Error of the inflater.
+    bool _open = false;                             ///< The temporary file exists and was not renamed.
+    uint32_t _storedBytes = 0;                      ///< Bytes written to the file.
+    uint32_t _writes = 0;                           ///< Write calls to the file system.
+    uint32_t _writeMicros = 0;                      ///< Time spent writing, in µs.
+    uint32_t _inflateMicros = 0;                    ///< Time spent inflating, in µs.
+};
+
+#endif // FILE_UPLOAD_SESSION_H
@@ -0,0 +1,479 @@
+/**
+ * @file GzipInflater.cpp
+ * @brief Implementation of the GzipInflater class.
+ *
+ * The decoder works in units (a header field, a block header, one literal or match) and
+ * only starts a unit when the input buffer holds enough bits for its worst case, so that
+ * a unit never has to be suspended in the middle of a chunk boundary.
+ */
+#include "OTA/GzipInflater.h"
+#include <new>
+#include <string.h>
+
+static_assert(GZIP_INFLATER_INPUT_SIZE >= 600, "GZIP_INFLATER_INPUT_SIZE must hold a dynamic block header");
+
+static const uint32_t blockHeaderBits = 3 + 14 + 19 * 3 + 316 * 14;  ///< Worst case of a block header: type, counts, code length code, code lengths.
+static const uint32_t symbolBits = 15 + 5 + 15 + 13;                  ///< Worst case of a literal or match.
+
+static const uint8_t gzipFlagHeaderCrc = 0x02;
+static const uint8_t gzipFlagExtra = 0x04;
+static const uint8_t gzipFlagName = 0x08;
+static const uint8_t gzipFlagComment = 0x10;
+static const uint8_t gzipFlagReserved = 0xE0;
+
+static const uint16_t lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lengthBits[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t distanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t distanceBits[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static const uint32_t crcTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/**
+ * @brief Updates a CRC-32 (gzip polynomial) with a 16-entry table, a nibble at a time.
+ */
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = crcTable[crc & 0x0F] ^ (crc >> 4);
+        crc = crcTable[crc & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+GzipInflater::GzipInflater(size_t windowSize) : _windowSize(windowSize) {
+    if (_windowSize > 32768) {
+        _windowSize = 32768;
+    }
+    while (_windowSize & (_windowSize - 1)) {
+        _windowSize &= _windowSize - 1; // Round down to a power of two
+    }
+}
+
+GzipInflater::~GzipInflater() {
+    delete[] _window;
+}
+
+bool GzipInflater::begin(Sink sink) {
+    delete[] _window;
+    _window = new (std::nothrow) uint8_t[_windowSize];
+    _sink = sink;
+    _pos = 0;
+    _flushed = 0;
+    _crc = 0;
+    _inputSize = 0;
+    _inStart = 0;
+    _inEnd = 0;
+    _bitBuffer = 0;
+    _bitCount = 0;
+    _truncated = false;
+    _state = STATE_HEADER;
+    _error = GZIP_OK;
+    _flags = 0;
+    _lastBlock = false;
+    _remaining = 0;
+    if (_window == nullptr) {
+        return fail(GZIP_ERROR_MEMORY);
+    }
+    return true;
+}
+
+bool GzipInflater::write(const uint8_t* data, size_t length) {
+    if (_state == STATE_ERROR || _window == nullptr) {
+        return false;
+    }
+    _inputSize += length;
+    while (length > 0 && _state != STATE_DONE) {
+        if (_inStart > 0) {
+            memmove(_in, _in + _inStart, _inEnd - _inStart);
+            _inEnd -= _inStart;
+            _inStart = 0;
+        }
+        size_t count = sizeof(_in) - _inEnd;
+        if (count > length) {
+            count = length;
+        }
+        memcpy(_in + _inEnd, data, count);
+        _inEnd += count;
+        data += count;
+        length -= count;
+        if (!run(false)) {
+            return false;
+        }
+    }
+    return true; // Bytes after the trailer are ignored
+}
+
+bool GzipInflater::end() {
+    bool ok = _state != STATE_ERROR && _window != nullptr && run(true) && _state == STATE_DONE;
+    delete[] _window;
+    _window = nullptr;
+    return ok;
+}
+
+/**
+ * @brief Decodes the buffered input.
+ *
+ * @param final No more input will come: decode what is left, and fail if the stream is incomplete.
+ * @return False on error.
+ */
+bool GzipInflater::run(bool final) {
+    while (_state != STATE_DONE) {
+        switch (_state) {
+        case STATE_HEADER: {
+            if (!available(80, final)) return true;
+            uint32_t id1 = bits(8);
+            uint32_t id2 = bits(8);
+            uint32_t method = bits(8);
+            _flags = bits(8);
+            bits(16); // MTIME
+            bits(16);
+            bits(16); // XFL, OS
+            if (id1 != 0x1F || id2 != 0x8B || method != 8 || (_flags & gzipFlagReserved)) {
+                return fail(GZIP_ERROR_HEADER);
+            }
+            _state = STATE_EXTRA_LENGTH;
+            break;
+        }
+        case STATE_EXTRA_LENGTH:
+            if (!(_flags & gzipFlagExtra)) {
+                _state = STATE_NAME;
+                break;
+            }
+            if (!available(16, final)) return true;
+            _remaining = bits(16);
+            _state = STATE_EXTRA;
+            break;
+        case STATE_EXTRA:
+            if (_remaining == 0) {
+                _state = STATE_NAME;
+                break;
+            }
+            if (!available(8, final)) return true;
+            bits(8);
+            _remaining--;
+            break;
+        case STATE_NAME:
+        case STATE_COMMENT: {
+            uint8_t flag = _state == STATE_NAME ? gzipFlagName : gzipFlagComment;
+            if (!(_flags & flag)) {
+                _state = _state == STATE_NAME ? STATE_COMMENT : STATE_HEADER_CRC;
+                break;
+            }
+            if (!available(8, final)) return true;
+            if (bits(8) == 0) {
+                _flags &= ~flag; // End of the zero-terminated field
+            }
+            break;
+        }
+        case STATE_HEADER_CRC:
+            if (_flags & gzipFlagHeaderCrc) {
+                if (!available(16, final)) return true;
+                bits(16);
+            }
+            _state = STATE_BLOCK;
+            break;
+        case STATE_BLOCK: {
+            if (!available(blockHeaderBits, final)) return true;
+            _lastBlock = bits(1);
+            uint32_t type = bits(2);
+            if (type == 0) {
+                _state = STATE_STORED_LENGTH;
+            } else if (type == 1) {
+                uint8_t lengths[288];
+                memset(lengths, 8, 144);
+                memset(lengths + 144, 9, 112);
+                memset(lengths + 256, 7, 24);
+                memset(lengths + 280, 8, 8);
+                build(_literals, lengths, 288);
+                memset(lengths, 5, 30);
+                build(_distances, lengths, 30);
+                _state = STATE_CODES;
+            } else if (type == 2) {
+                if (!readDynamicTrees()) return false;
+                _state = STATE_CODES;
+            } else {
+                return fail(GZIP_ERROR_DATA);
+            }
+            break;
+        }
+        case STATE_STORED_LENGTH: {
+            _bitBuffer >>= _bitCount & 7; // Stored blocks start on a byte boundary
+            _bitCount -= _bitCount & 7;
+            if (!available(32, final)) return true;
+            uint16_t length = bits(16);
+            uint16_t inverse = bits(16);
+            if (!_truncated && (uint16_t)~inverse != length) {
+                return fail(GZIP_ERROR_DATA);
+            }
+            _remaining = length;
+            _state = STATE_STORED;
+            break;
+        }
+        case STATE_STORED: {
+            if (_remaining == 0) {
+                _state = _lastBlock ? STATE_TRAILER : STATE_BLOCK;
+                break;
+            }
+            if (!available(8, final)) return true;
+            if (_bitCount >= 8) {
+                put(bits(8));
+                _remaining--;
+                break;
+            }
+            size_t count = _inEnd - _inStart;
+            if (count == 0) {
+                _truncated = true;
+                break;
+            }
+            if (count > _remaining) {
+                count = _remaining;
+            }
+            for (size_t i = 0; i < count; i++) {
+                put(_in[_inStart + i]);
+            }
+            _inStart += count;
+            _remaining -= count;
+            break;
+        }
+        case STATE_CODES:
+            if (!available(symbolBits, final)) return true;
+            if (!inflateSymbol()) return false;
+            break;
+        case STATE_TRAILER: {
+            _bitBuffer >>= _bitCount & 7;
+            _bitCount -= _bitCount & 7;
+            if (!available(64, final)) return true;
+            uint32_t crc = bits(16);
+            crc |= bits(16) << 16;
+            uint32_t size = bits(16);
+            size |= bits(16) << 16;
+            if (_truncated) break;
+            if (!flush()) return false;
+            if (crc != _crc || size != _pos) {
+                return fail(GZIP_ERROR_CHECKSUM);
+            }
+            _state = STATE_DONE;
+            break;
+        }
+        default:
+            return false;
+        }
+        if (_truncated) {
+            return fail(GZIP_ERROR_TRUNCATED);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Tells whether a unit of at most `count` bits can be decoded now.
+ *
+ * At the end of the stream the unit is always attempted: if the input runs out, bits()
+ * sets _truncated.
+ */
+bool GzipInflater::available(uint32_t count, bool final) {
+    return final || _bitCount + 8 * (uint32_t)(_inEnd - _inStart) >= count;
+}
+
+/**
+ * @brief Reads up to 16 bits, least significant first. Returns zeros past the input and sets _truncated.
+ */
+uint32_t GzipInflater::bits(uint8_t count) {
+    while (_bitCount < count) {
+        if (_inStart == _inEnd) {
+            _truncated = true;
+            return 0;
+        }
+        _bitBuffer |= (uint32_t)_in[_inStart++] << _bitCount;
+        _bitCount += 8;
+    }
+    uint32_t value = _bitBuffer & ((1UL << count) - 1);
+    _bitBuffer >>= count;
+    _bitCount -= count;
+    return value;
+}
+
+/**
+ * @brief Decodes a symbol, one bit at a time through the canonical code.
+ *
+ * @return The symbol, or -1 for an invalid code.
+ */
+int GzipInflater::decode(const Tree& tree) {
+    int sum = 0;
+    int code = 0;
+    uint8_t length = 0;
+    do {
+        code = 2 * code + bits(1);
+        if (++length > 15) {
+            return -1;
+        }
+        sum += tree.counts[length];
+        code -= tree.counts[length];
+    } while (code >= 0);
+    return tree.symbols[sum + code];
+}
+
+void GzipInflater::build(Tree& tree, const uint8_t* lengths, uint16_t count) {
+    memset(tree.counts, 0, sizeof(tree.counts));
+    for (uint16_t i = 0; i < count; i++) {
+        tree.counts[lengths[i]]++;
+    }
+    tree.counts[0] = 0;
+
+    uint16_t offsets[16];
+    uint16_t sum = 0;
+    for (uint8_t i = 0; i < 16; i++) {
+        offsets[i] = sum;
+        sum += tree.counts[i];
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        if (lengths[i] != 0) {
+            tree.symbols[offsets[lengths[i]]++] = i;
+        }
+    }
+}
+
+/**
+ * @brief Reads the code lengths of a dynamic block and builds its codes.
+ */
+bool GzipInflater::readDynamicTrees() {
+    uint8_t lengths[288 + 32];
+    uint16_t literals = bits(5) + 257;
+    uint16_t distances = bits(5) + 1;
+    uint8_t codeLengths = bits(4) + 4;
+    if (literals > 286 || distances > 30) {
+        return fail(GZIP_ERROR_DATA);
+    }
+
+    memset(lengths, 0, 19);
+    for (uint8_t i = 0; i < codeLengths; i++) {
+        lengths[codeLengthOrder[i]] = bits(3);
+    }
+    build(_distances, lengths, 19); // Code length code, replaced below
+
+    uint16_t total = literals + distances;
+    for (uint16_t n = 0; n < total;) {
+        int symbol = decode(_distances);
+        if (symbol < 0) {
+            return fail(GZIP_ERROR_DATA);
+        }
+        uint8_t value = 0;
+        uint16_t repeat = 1;
+        if (symbol < 16) {
+            value = symbol;
+        } else if (symbol == 16) {
+            if (n == 0) {
+                return fail(GZIP_ERROR_DATA);
+            }
+            value = lengths[n - 1];
+            repeat = 3 + bits(2);
+        } else if (symbol == 17) {
+            repeat = 3 + bits(3);
+        } else {
+            repeat = 11 + bits(7);
+        }
+        if (n + repeat > total) {
+            return fail(GZIP_ERROR_DATA);
+        }
+        memset(lengths + n, value, repeat);
+        n += repeat;
+    }
+    if (lengths[256] == 0) {
+        return fail(GZIP_ERROR_DATA); // No end-of-block code
+    }
+
+    build(_literals, lengths, literals);
+    build(_distances, lengths + literals, distances);
+    return true;
+}
+
+/**
+ * @brief Decodes a literal, a match or the end of the block.
+ */
+bool GzipInflater::inflateSymbol() {
+    int symbol = decode(_literals);
+    if (symbol < 0) {
+        return fail(GZIP_ERROR_DATA);
+    }
+    if (symbol < 256) {
+        put(symbol);
+        return _state != STATE_ERROR;
+    }
+    if (symbol == 256) {
+        _state = _lastBlock ? STATE_TRAILER : STATE_BLOCK;
+        return true;
+    }
+
+    symbol -= 257;
+    if (symbol >= 29) {
+        return fail(GZIP_ERROR_DATA);
+    }
+    uint16_t length = lengthBase[symbol] + bits(lengthBits[symbol]);
+    int distanceSymbol = decode(_distances);
+    if (distanceSymbol < 0 || distanceSymbol >= 30) {
+        return fail(GZIP_ERROR_DATA);
+    }
+    uint32_t distance = distanceBase[distanceSymbol] + bits(distanceBits[distanceSymbol]);
+    if (_truncated) {
+        return fail(GZIP_ERROR_TRUNCATED);
+    }
+    if (distance > _windowSize || distance > _pos) {
+        return fail(GZIP_ERROR_DISTANCE);
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        put(_window[(_pos - distance) & (_windowSize - 1)]);
+    }
+    return _state != STATE_ERROR;
+}
+
+/**
+ * @brief Appends a byte to the window, handing the window to the sink each time it fills up.
+ */
+void GzipInflater::put(uint8_t value) {
+    _window[_pos & (_windowSize - 1)] = value;
+    _pos++;
+    if ((_pos & (_windowSize - 1)) == 0) {
+        flush();
+    }
+}
+
+/**
+ * @brief Hands the bytes produced since the last flush to the sink. They are contiguous,
+ * since the window is flushed each time it wraps.
+ */
+bool GzipInflater::flush() {
+    if (_state == STATE_ERROR) {
+        return false;
+    }
+    uint32_t length = _pos - _flushed;
+    if (length == 0) {
+        return true;
+    }
+    const uint8_t* data = _window + (_flushed & (_windowSize - 1));
+    _crc = crc32(_crc, data, length);
+    _flushed = _pos;
+    if (!_sink(data, length)) {
+        return fail(GZIP_ERROR_OUTPUT);
+    }
+    return true;
+}
+
+bool GzipInflater::fail(GzipInflaterError error) {
+    _error = _truncated ? GZIP_ERROR_TRUNCATED : error;
+    _state = STATE_ERROR;
+    return false;
+}
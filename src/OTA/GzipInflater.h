@@ -0,0 +1,147 @@
+/**
+ * @file GzipInflater.h
+ * @brief Streaming gzip decompressor with a fixed window.
+ *
+ * Compressed input is fed in chunks of any size, as they arrive from the network; the
+ * decompressed output is handed to a sink each time the window fills up, and at the end.
+ * Memory is fixed: the window (the distance back-references may reach) plus about 2.3 KB
+ * of input buffer and Huffman tables. The CRC-32 and size of the gzip trailer are verified,
+ * so a successful end() guarantees byte-exact output.
+ *
+ * The window must be at least as large as the one used by the compressor: 4 KB by default,
+ * as tools/compress.py compresses (`zlib.compressobj(9, zlib.DEFLATED, 16 + 12)`); the
+ * gzip tool needs 32 KB. A back-reference beyond the window fails with GZIP_ERROR_DISTANCE.
+ *
+ * Depends only on the C++ standard library.
+ */
+#ifndef GZIP_INFLATER_H
+#define GZIP_INFLATER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+#ifndef GZIP_INFLATER_WINDOW_SIZE
+#define GZIP_INFLATER_WINDOW_SIZE 4096    ///< Default window, in bytes; a power of two, up to 32768 (for the gzip tool).
+#endif
+
+#ifndef GZIP_INFLATER_INPUT_SIZE
+#define GZIP_INFLATER_INPUT_SIZE 1024     ///< Input buffer, in bytes; must hold a complete dynamic block header (at most 563 bytes).
+#endif
+
+/**
+ * @brief Error of a GzipInflater.
+ */
+enum GzipInflaterError : uint8_t {
+    GZIP_OK,                ///< No error.
+    GZIP_ERROR_MEMORY,      ///< The window could not be allocated.
+    GZIP_ERROR_HEADER,      ///< Not a gzip stream, or unsupported header.
+    GZIP_ERROR_DATA,        ///< Invalid compressed data.
+    GZIP_ERROR_DISTANCE,    ///< Back-reference beyond the window or the start of the output.
+    GZIP_ERROR_TRUNCATED,   ///< The stream ended before its trailer.
+    GZIP_ERROR_CHECKSUM,    ///< CRC-32 or size of the trailer does not match the output.
+    GZIP_ERROR_OUTPUT       ///< The sink refused the output.
+};
+
+class GzipInflater {
+public:
+    /**
+     * @brief Receives decompressed output; returns false to stop with GZIP_ERROR_OUTPUT.
+     */
+    typedef std::function<bool(const uint8_t* data, size_t length)> Sink;
+
+    /**
+     * @brief Constructs a GzipInflater. The window is allocated by begin().
+     *
+     * @param windowSize Window size in bytes, a power of two up to 32768.
+     */
+    GzipInflater(size_t windowSize = GZIP_INFLATER_WINDOW_SIZE);
+    ~GzipInflater();
+
+    GzipInflater(const GzipInflater&) = delete;
+    GzipInflater& operator=(const GzipInflater&) = delete;
+
+    /**
+     * @brief Allocates the window and starts a new stream.
+     *
+     * @param sink Receiver of the decompressed output.
+     * @return False if the window could not be allocated.
+     */
+    bool begin(Sink sink);
+
+    /**
+     * @brief Decompresses a chunk of the stream.
+     *
+     * @param data Compressed bytes.
+     * @param length Number of bytes.
+     * @return False on error, see getError().
+     */
+    bool write(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Ends the stream: flushes the output and verifies the trailer, then frees the window.
+     *
+     * @return True if the stream was complete and its checksum matches.
+     */
+    bool end();
+
+    GzipInflaterError getError() const { return _error; }    ///< Error that stopped the stream, GZIP_OK if none.
+    uint32_t getInputSize() const { return _inputSize; }     ///< Compressed bytes received.
+    uint32_t getOutputSize() const { return _pos; }          ///< Decompressed bytes produced.
+    bool isDone() const { return _state == STATE_DONE; }    ///< True once the trailer has been verified.
+
+    /**
+     * @brief Tells whether data starts with the gzip magic bytes.
+     */
+    static bool isGzip(const uint8_t* data, size_t length) { return length >= 2 && data[0] == 0x1F && data[1] == 0x8B; }
+
+private:
+    enum State : uint8_t {
+        STATE_HEADER, STATE_EXTRA_LENGTH, STATE_EXTRA, STATE_NAME, STATE_COMMENT, STATE_HEADER_CRC,
+        STATE_BLOCK, STATE_STORED_LENGTH, STATE_STORED, STATE_CODES, STATE_TRAILER, STATE_DONE, STATE_ERROR
+    };
+
+    /**
+     * @brief Canonical Huffman code: number of codes of each length, and symbols sorted by code.
+     */
+    struct Tree {
+        uint16_t counts[16];
+        uint16_t symbols[288];
+    };
+
+    bool run(bool final);
+    bool available(uint32_t bits, bool final);
+    uint32_t bits(uint8_t count);
+    int decode(const Tree& tree);
+    void build(Tree& tree, const uint8_t* lengths, uint16_t count);
+    bool readDynamicTrees();
+    bool inflateSymbol();
+    void put(uint8_t value);
+    bool flush();
+    bool fail(GzipInflaterError error);
+
+    size_t _windowSize;                       ///< Window size, a power of two.
+    uint8_t* _window = nullptr;               ///< Output ring, also the source of back-references.
+    uint32_t _pos = 0;                        ///< Bytes produced.
+    uint32_t _flushed = 0;                    ///< Bytes handed to the sink.
+    uint32_t _crc = 0;                        ///< CRC-32 of the bytes handed to the sink.
+    uint32_t _inputSize = 0;                  ///< Compressed bytes received.
+    Sink _sink;                               ///< Receiver of the output.
+
+    uint8_t _in[GZIP_INFLATER_INPUT_SIZE];    ///< Compressed bytes not yet consumed.
+    size_t _inStart = 0;                      ///< Index of the first unconsumed byte.
+    size_t _inEnd = 0;                        ///< Index past the last received byte.
+    uint32_t _bitBuffer = 0;                  ///< Bits read ahead, least significant first.
+    uint8_t _bitCount = 0;                    ///< Number of bits in _bitBuffer.
+    bool _truncated = false;                  ///< bits() ran out of input.
+
+    State _state = STATE_HEADER;              ///< Position in the stream.
+    GzipInflaterError _error = GZIP_OK;       ///< Error that stopped the stream.
+    uint8_t _flags = 0;                       ///< FLG byte of the gzip header.
+    bool _lastBlock = false;                  ///< The current block is the last one.
+    uint16_t _remaining = 0;                  ///< Bytes left in the current stored block or extra field.
+    Tree _literals;                           ///< Literal/length code of the current block.
+    Tree _distances;                          ///< Distance code of the current block.
+};
+
+#endif
@@ -1,9 +1,20 @@
 #include "OTA.h"
+#include "HeapProfiler/HeapProfiler.h"
+#include <new>
 
 OTA::OTA(HTTPServerManager& serverManager, Logger* logger) : _serverManager(serverManager),_logger(logger) {}
 
 void OTA::begin(){
     registerEndpoints();
+    _serverManager.addMetricsProvider("ota", [this](JsonObject metrics) {
+        writeTransfer(metrics["firmware"].to<JsonObject>(), _firmwareStats);
+        writeTransfer(metrics["upload"].to<JsonObject>(), _uploadStats);
+        JsonObject index = metrics["index"].to<JsonObject>();
+        index["indexed"] = _fileIndex.isIndexed();
+        index["entries"] = _fileIndex.getEntries();
+        index["bytes"] = _fileIndex.getBytes();
+        index["builds"] = _fileIndex.getBuilds();
+    });
 }
 
 void OTA::registerEndpoints() {
@@ -19,6 +30,39 @@ void OTA::registerEndpoints() {
         }
     );
 
+    // Register delta firmware upload endpoint
+    _serverManager.registerPage(
+        "/api/firmware/delta", 
+        HTTP_POST, 
+        [this](ESP8266WebServer& server) {
+          handleDeltaUpload(server);
+        }, 
+        [this](ESP8266WebServer& server) {
+          handleDeltaUpload(server); // Patch file upload handler
+        }
+    );
+
+    // Register resumable firmware upload endpoints
+    _serverManager.registerPage("/api/firmware/session", HTTP_GET, [this](ESP8266WebServer& server) {
+        handleSessionRequest(server);
+    });
+    _serverManager.registerPage("/api/firmware/session", HTTP_POST, [this](ESP8266WebServer& server) {
+        handleSessionRequest(server);
+    });
+    _serverManager.registerPage("/api/firmware/session", HTTP_DELETE, [this](ESP8266WebServer& server) {
+        handleSessionRequest(server);
+    });
+    _serverManager.registerPage(
+        "/api/firmware/chunk", 
+        HTTP_POST, 
+        [this](ESP8266WebServer& server) {
+          handleChunkRequest(server);
+        }, 
+        [this](ESP8266WebServer& server) {
+          handleChunkUpload(server); // Raw body
+        }
+    );
+
     // Register file upload endpoint
     _serverManager.registerPage(
         "/api/upload", 
@@ -32,7 +76,7 @@ void OTA::registerEndpoints() {
     );
     
     _serverManager.registerPage("/api/reboot", HTTP_GET, [this](ESP8266WebServer& server) {
-        if (_logger != nullptr) _logger->log("URI: /api/");
+        _logger.log("URI: /api/");
         server.send(200, "application/json", "{\"status\": \"ok\", \"message\": \"Microcontroller shall reboot in half a second.\"}"); 
         delay(500);
         ESP.restart();
@@ -40,7 +84,7 @@ void OTA::registerEndpoints() {
 
     // Register directory listing
     _serverManager.registerPage("/api/directories", HTTP_GET, [this](ESP8266WebServer& server) {
-        if (_logger != nullptr) _logger->log("URI: /api/directories");
+        _logger.log("URI: /api/directories");
         handleDirectoryList(server);
     });
 
@@ -54,6 +98,21 @@ void OTA::registerEndpoints() {
         handleDownloadRequest(server);
     });
 
+    // Register archive (tar) download and upload of directories
+    _serverManager.registerPage("/api/archive", HTTP_GET, [this](ESP8266WebServer& server) {
+        handleArchiveDownload(server);
+    });
+    _serverManager.registerPage(
+        "/api/archive", 
+        HTTP_POST, 
+        [this](ESP8266WebServer& server) {
+          handleArchiveUpload(server);
+        },
+        [this](ESP8266WebServer& server) {
+          handleArchiveUpload(server); // Archive file upload handler
+        }
+    );
+
     _serverManager.registerPage("/api/delete", HTTP_DELETE, [this](ESP8266WebServer& server) {
         handleDeleteRequest(server);
     });
@@ -63,129 +122,624 @@ void OTA::registerEndpoints() {
     });
 }
 
-void OTA::addReportStepHook(std::function<void(int)> func) {
-  _reportStepsHooks.push_back(func);
-}
-void OTA::reportStep(int step){
-  for (auto& hook : _reportStepsHooks) {
-    if (hook) {
-        hook(step);
+bool OTA::setSigningKey(const char* pemPublicKey) {
+    BearSSL::PublicKey* key = new BearSSL::PublicKey(pemPublicKey);
+    if (!key->isRSA() && !key->isEC()) {
+        delete key;
+        _logger.log("Firmware signing key could not be parsed.\n");
+        return false;
     }
-  }
+    delete _signatureVerifier;
+    delete _signingKey;
+    _signingKey = key;
+    if (_signatureHash == nullptr) {
+        _signatureHash = new BearSSL::HashSHA256();
+    }
+    _signatureVerifier = new BearSSL::SigningVerifier(_signingKey);
+    Update.installSignature(_signatureHash, _signatureVerifier);
+    return true;
 }
 
 /**
  * @brief Handles firmware upload via HTTP POST request.
+ * 
+ * Each chunk is hashed (SHA-256) as it is written. With `?sha256=<hex>` in the URL, the 
+ * image is rejected before the boot partition is switched if the hash does not match; 
+ * with a signing key, Update.end() also verifies the signature appended to the image. 
+ * The first write error abandons the update and closes the connection, instead of 
+ * receiving the rest of an image that can no longer be installed.
+ * 
+ * Gzip-compressed images are written as they are: Update recognizes them, and the 
+ * bootloader inflates them when it copies the new firmware in place, so the sketch 
+ * needs no inflate window.
+ * 
  * @param server Reference to the web server instance managing the request.
  */
 void OTA::handleFirmwareUpload(ESP8266WebServer& server) {
+    HEAP_SCOPE(HEAP_TAG_OTA);
     HTTPUpload& upload = server.upload();
     uint32_t update_size = ((ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000);
      
-    reportStep(1);
     //Update.runAsync(true);
     if (upload.status == UPLOAD_FILE_START) {
-        if (_logger != nullptr) _logger->log("Start firmware update: "+upload.filename+".\n");
+        _logger.log("Start firmware update: "+upload.filename+".\n");
+        closeSession(); // Update serves one upload at a time
+        if (refuseBusyUpdate(server)) {
+            return;
+        }
+        emit(EVENT_OTA_START);
+        _firmwareStats = OTATransferStats();
+        _transferStart = micros();
+        _firmwareFailed = false;
+        _firmwareSHA256[0] = '\0';
+        _expectedSHA256 = server.arg("sha256");
+        _expectedSHA256.toLowerCase();
+        _firmwareHash.begin();
        if (!Update.begin(update_size)) { // Begin OTA process
-            reportStep(2);
-            reportStep(-3);
             Update.printError(Serial);
-            server.send(500, "application/json", "{\"status\": \"nok1\", \"error\":\"Firmware update failed to start.\"}");
-            if (_logger != nullptr) _logger->log("Firmware update failed to start.\n");
+            failFirmware(server, "nok1", "Firmware update failed to start.", 1);
             return;
         }
-        reportStep(2);
+    } else if (_firmwareFailed) {
+        return; // Rejected: ignore the chunks still in flight
     } else if (upload.status == UPLOAD_FILE_WRITE) {
-        if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
+        if (_firmwareStats.storedBytes == 0) {
+            _firmwareStats.compressed = GzipInflater::isGzip(upload.buf, upload.currentSize);
+            if (_firmwareStats.compressed) _logger.log("Compressed firmware, inflated by the bootloader.\n");
+        }
+        uint32_t hashStart = micros();
+        _firmwareHash.add(upload.buf, upload.currentSize);
+        uint32_t writeStart = micros();
+        _firmwareStats.hashMicros += writeStart - hashStart;
+        size_t written = Update.write(upload.buf, upload.currentSize);
+        _firmwareStats.writeMicros += micros() - writeStart;
+        _firmwareStats.storedBytes += written;
+        _firmwareStats.writes++;
+        if (written != upload.currentSize) {
+            Update.printError(Serial);
+            failFirmware(server, "nok4", "Firmware write failed.", 4);
+            return;
+        }
+        emit(EVENT_OTA_PROGRESS, upload.totalSize);
+    } else if (upload.status == UPLOAD_FILE_END) {
+        digestFirmware();
+        finishTransfer(_firmwareStats, "Firmware", upload.totalSize);
+        _logger.logf("Firmware SHA-256: %s.\n", _firmwareSHA256);
+        if (!_expectedSHA256.isEmpty() && _expectedSHA256 != _firmwareSHA256) {
+            failFirmware(server, "nok5", "Firmware SHA-256 mismatch.", 5);
+            return;
+        }
+        if (Update.end(true)) { // End OTA process, verifies the signature if a key is set
+            server.send(200, "application/json", String("{\"status\": \"ok\", \"message\":\"Firmware updated successfully. Rebooting...\", \"sha256\":\"") + _firmwareSHA256 + "\"}");
+            _logger.log("Firmware update successful. Rebooting...\n");
+            emit(EVENT_OTA_SUCCESS, upload.totalSize);
+            delay(500);
+            ESP.restart();
+        } else {
+            Update.printError(Serial);
+            failFirmware(server, "nok2", "Firmware update failed.", 2); // Also rejects the call completing the request
+        }
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+        emit(EVENT_OTA_ABORTED);
+        Update.end();
+        server.send(500, "application/json", "{\"status\": \"nok3\", \"error\":\"Firmware update aborted.\"}");
+        _logger.log("Firmware update aborted.\n");
+    }
+}
+
+void OTA::digestFirmware() {
+    _firmwareHash.end();
+    const uint8_t* hash = (const uint8_t*)_firmwareHash.hash();
+    for (int i = 0; i < 32; i++) {
+        sprintf(_firmwareSHA256 + 2 * i, "%02x", hash[i]);
+    }
+}
+
+void OTA::loop() {
+    if (_sessionId != 0 && _sessionTimeout > 0 && millis() - _sessionActivity >= _sessionTimeout) {
+        _logger.logf("Firmware upload session %08lx idle, abandoned at %lu of %lu bytes.\n", 
+            (unsigned long)_sessionId, (unsigned long)_sessionOffset, (unsigned long)_sessionSize);
+        closeSession();
+        emit(EVENT_OTA_ABORTED);
+    }
+}
+
+/**
+ * @brief Handles the session of a resumable firmware upload.
+ * 
+ * - `POST ?size=<bytes>[&sha256=<hex>]` opens a session, replacing any open one, and 
+ *   reserves the flash for the image.
+ * - `GET` returns the open session and its committed offset, from which a client resumes.
+ * - `DELETE` abandons the session.
+ * 
+ * The image is then sent in chunks of OTA_CHUNK_SIZE bytes to /api/firmware/chunk. A 
+ * session without requests for the session timeout is abandoned by loop().
+ */
+void OTA::handleSessionRequest(ESP8266WebServer& server) {
+    if (server.method() == HTTP_GET) {
+        if (_sessionId == 0) {
+            sendSession(server, 404, "nok1", "No upload session.");
+        } else {
+            _sessionActivity = millis();
+            sendSession(server, 200, "ok");
+        }
+        return;
+    }
+
+    closeSession();
+    if (server.method() == HTTP_DELETE) {
+        _logger.log("Firmware upload session abandoned.\n");
+        emit(EVENT_OTA_ABORTED);
+        sendSession(server, 200, "ok");
+        return;
+    }
+
+    uint32_t size = server.arg("size").toInt();
+    uint32_t maxSize = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+    if (size == 0 || size >= maxSize) {
+        sendSession(server, 400, "nok2", "Invalid firmware size.");
+        return;
+    }
+    if (refuseBusyUpdate(server)) {
+        return;
+    }
+    _chunkBuffer = new (std::nothrow) uint8_t[OTA_CHUNK_SIZE];
+    if (_chunkBuffer == nullptr || !Update.begin(maxSize)) { // As for /api/firmware: until Update.end(true), abandoning never installs
+        Update.printError(Serial);
+        delete[] _chunkBuffer;
+        _chunkBuffer = nullptr;
+        emit(EVENT_OTA_FAILED, 1);
+        sendSession(server, 500, "nok1", "Firmware update failed to start.");
+        return;
+    }
+
+    do {
+        _sessionId = ESP.random();
+    } while (_sessionId == 0);
+    _sessionSize = size;
+    _sessionOffset = 0;
+    _sessionActivity = millis();
+    _firmwareStats = OTATransferStats();
+    _transferStart = micros();
+    _firmwareSHA256[0] = '\0';
+    _expectedSHA256 = server.arg("sha256");
+    _expectedSHA256.toLowerCase();
+    _firmwareHash.begin();
+    _logger.logf("Firmware upload session %08lx: %lu bytes.\n", (unsigned long)_sessionId, (unsigned long)size);
+    emit(EVENT_OTA_START);
+    sendSession(server, 200, "ok");
+}
+
+/**
+ * @brief Collects the raw body of a chunk. Nothing reaches the flash before the chunk is 
+ * complete: a chunk cut by a dropped connection is discarded and sent again.
+ */
+void OTA::handleChunkUpload(ESP8266WebServer& server) {
+    HTTPRaw& raw = server.raw();
+    if (raw.status == RAW_START) {
+        _chunkLength = 0;
+        _chunkValid = _chunkBuffer != nullptr;
+    } else if (raw.status == RAW_WRITE) {
+        if (_chunkValid && _chunkLength + raw.currentSize <= OTA_CHUNK_SIZE) {
+            memcpy(_chunkBuffer + _chunkLength, raw.buf, raw.currentSize);
+            _chunkLength += raw.currentSize;
+        } else {
+            _chunkValid = false;
+        }
+    } else if (raw.status == RAW_ABORTED) {
+        _chunkLength = 0;
+        _chunkValid = false;
+    }
+}
+
+/**
+ * @brief Commits the chunk `POST /api/firmware/chunk?session=<id>&offset=<bytes>`.
+ * 
+ * The chunk must start at the committed offset, and hold OTA_CHUNK_SIZE bytes (less for the 
+ * last one), so that each chunk fills whole flash sectors. A chunk already committed, sent 
+ * again because its response was lost, is acknowledged without being written. Every 
+ * response carries the committed offset.
+ */
+void OTA::handleChunkRequest(ESP8266WebServer& server) {
+    HEAP_SCOPE(HEAP_TAG_OTA);
+    if (_sessionId == 0 || strtoul(server.arg("session").c_str(), nullptr, 16) != _sessionId) {
+        sendSession(server, 404, "nok1", "No upload session.");
+        return;
+    }
+    _sessionActivity = millis();
+    uint32_t offset = server.arg("offset").toInt();
+    if (offset < _sessionOffset && offset + _chunkLength <= _sessionOffset) {
+        sendSession(server, 200, "ok"); // Already committed
+        return;
+    }
+    if (offset != _sessionOffset) {
+        sendSession(server, 409, "nok2", "Chunk offset does not match.");
+        return;
+    }
+    uint32_t expected = _sessionSize - _sessionOffset < OTA_CHUNK_SIZE ? _sessionSize - _sessionOffset : OTA_CHUNK_SIZE;
+    if (!_chunkValid || _chunkLength != expected) {
+        sendSession(server, 400, "nok3", "Invalid chunk length.");
+        return;
+    }
+
+    uint32_t hashStart = micros();
+    _firmwareHash.add(_chunkBuffer, _chunkLength);
+    uint32_t writeStart = micros();
+    _firmwareStats.hashMicros += writeStart - hashStart;
+    size_t written = Update.write(_chunkBuffer, _chunkLength);
+    _firmwareStats.writeMicros += micros() - writeStart;
+    _firmwareStats.storedBytes += written;
+    _firmwareStats.writes++;
+    if (written != _chunkLength) {
+        Update.printError(Serial);
+        closeSession();
+        emit(EVENT_OTA_FAILED, 4);
+        sendSession(server, 500, "nok4", "Firmware write failed.");
+        return;
+    }
+    _sessionOffset += _chunkLength;
+    _chunkLength = 0;
+    emit(EVENT_OTA_PROGRESS, _sessionOffset);
+    if (_sessionOffset < _sessionSize) {
+        sendSession(server, 200, "ok");
+        return;
+    }
+
+    digestFirmware();
+    finishTransfer(_firmwareStats, "Firmware", _sessionSize);
+    _logger.logf("Firmware SHA-256: %s.\n", _firmwareSHA256);
+    if (!_expectedSHA256.isEmpty() && _expectedSHA256 != _firmwareSHA256) {
+        closeSession();
+        emit(EVENT_OTA_FAILED, 5);
+        sendSession(server, 500, "nok5", "Firmware SHA-256 mismatch.");
+        return;
+    }
+    if (!Update.end(true)) { // Verifies the signature if a key is set
+        Update.printError(Serial);
+        closeSession();
+        emit(EVENT_OTA_FAILED, 6);
+        sendSession(server, 500, "nok6", "Firmware update failed.");
+        return;
+    }
+    sendSession(server, 200, "ok");
+    closeSession();
+    _logger.log("Firmware update successful. Rebooting...\n");
+    emit(EVENT_OTA_SUCCESS, _sessionSize);
+    delay(500);
+    ESP.restart();
+}
+
+void OTA::sendSession(ESP8266WebServer& server, int code, const char* status, const char* error) {
+    JsonDocument doc;
+    doc["status"] = status;
+    if (error != nullptr) {
+        doc["error"] = error;
+    }
+    if (_sessionId != 0) {
+        char id[9];
+        snprintf(id, sizeof(id), "%08lx", (unsigned long)_sessionId);
+        doc["session"] = id;
+        doc["size"] = _sessionSize;
+        doc["offset"] = _sessionOffset;
+        doc["chunk"] = OTA_CHUNK_SIZE;
+    }
+    if (_firmwareSHA256[0] != '\0') {
+        doc["sha256"] = _firmwareSHA256;
+    }
+    String response;
+    serializeJson(doc, response);
+    server.send(code, "application/json", response);
+}
+
+void OTA::closeSession() {
+    if (_sessionId != 0 && Update.isRunning()) {
+        Update.end(); // Abandons the update; the boot partition is not switched
+    }
+    _sessionId = 0;
+    _chunkLength = 0;
+    _chunkValid = false;
+    delete[] _chunkBuffer;
+    _chunkBuffer = nullptr;
+}
+
+bool OTA::refuseBusyUpdate(ESP8266WebServer& server) {
+    if (!Update.isRunning()) {
+        return false;
+    }
+    _firmwareFailed = true; // Ignores the rest of the upload, and leaves Update to its owner
+    server.send(409, "application/json", "{\"status\": \"nok8\", \"error\":\"A pull update is in progress.\"}");
+    server.client().stop();
+    _logger.log("Firmware upload refused: a pull update is in progress.\n");
+    return true;
+}
+
+void OTA::failFirmware(ESP8266WebServer& server, const char* status, const char* error, int32_t code) {
+    _firmwareFailed = true;
+    Update.end(); // Abandons the update; the boot partition is not switched
+    emit(EVENT_OTA_FAILED, code);
+    server.send(500, "application/json", String("{\"status\": \"") + status + "\", \"error\":\"" + error + "\"}");
+    server.client().stop();
+    _logger.logf("%s\n", error);
+}
+
+/**
+ * @brief Handles a delta firmware update via HTTP POST request.
+ * 
+ * The uploaded file is a patch made by tools/delta_patch.py against the running firmware, 
+ * gzip-compressed or not. It is applied as it arrives: blocks of the new image are built 
+ * from the running sketch, read from flash, and the patch, then hashed and written to the 
+ * update partition. A patch made for another firmware is rejected after its header, before 
+ * anything is written; the SHA-256 of the image built must match the one of the patch 
+ * before the boot partition is switched, and the signature is verified if a key is set.
+ * 
+ * @param server Reference to the web server instance managing the request.
+ */
+void OTA::handleDeltaUpload(ESP8266WebServer& server) {
+    HEAP_SCOPE(HEAP_TAG_OTA);
+    HTTPUpload& upload = server.upload();
+
+    if (upload.status == UPLOAD_FILE_START) {
+        _logger.log("Start delta firmware update: "+upload.filename+".\n");
+        closeSession(); // Update serves one upload at a time
+        releaseDelta();
+        if (refuseBusyUpdate(server)) {
+            return;
+        }
+        emit(EVENT_OTA_START);
+        _firmwareStats = OTATransferStats();
+        _firmwareStats.delta = true;
+        _transferStart = micros();
+        _firmwareFailed = false;
+        _firmwareSHA256[0] = '\0';
+        _firmwareHash.begin();
+        _deltaPatcher = new (std::nothrow) DeltaPatcher();
+        if (_deltaPatcher == nullptr || !Update.begin((ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000)) {
             Update.printError(Serial);
+            failFirmware(server, "nok1", "Firmware update failed to start.", 1);
+            releaseDelta();
+            return;
+        }
+        _deltaPatcher->begin(
+            [](uint32_t offset, uint8_t* data, size_t length) { return offset + length <= ESP.getSketchSize() && ESP.flashRead(offset, data, length); },
+            [this](const uint8_t* data, size_t length) { return storeDelta(data, length); },
+            [this](const DeltaPatcher& patcher) { return checkDeltaBase(patcher); });
+    } else if (_firmwareFailed || _deltaPatcher == nullptr) {
+        return; // Rejected: ignore the chunks still in flight
+    } else if (upload.status == UPLOAD_FILE_WRITE) {
+        if (_deltaInflater == nullptr && _deltaPatcher->getInputSize() == 0 && GzipInflater::isGzip(upload.buf, upload.currentSize)) {
+            _firmwareStats.compressed = true;
+            _deltaInflater = new (std::nothrow) GzipInflater(OTA_DELTA_WINDOW_SIZE);
+            if (_deltaInflater == nullptr || !_deltaInflater->begin([this](const uint8_t* data, size_t length) { return _deltaPatcher->write(data, length); })) {
+                failFirmware(server, "nok1", "Not enough memory to inflate the patch.", 1);
+                releaseDelta();
+                return;
+            }
+        }
+        uint32_t applyStart = micros();
+        uint32_t spentMicros = _firmwareStats.writeMicros + _firmwareStats.hashMicros;
+        bool applied = _deltaInflater != nullptr ? _deltaInflater->write(upload.buf, upload.currentSize) : _deltaPatcher->write(upload.buf, upload.currentSize);
+        _firmwareStats.inflateMicros += (micros() - applyStart) - (_firmwareStats.writeMicros + _firmwareStats.hashMicros - spentMicros);
+        if (!applied) {
+            failDelta(server);
+            return;
         }
-        reportStep(2);
+        emit(EVENT_OTA_PROGRESS, upload.totalSize);
     } else if (upload.status == UPLOAD_FILE_END) {
-        if (Update.end(true)) { // End OTA process
-            server.send(200, "application/json", "{\"status\": \"ok\", \"message\":\"Firmware updated successfully. Rebooting...\"}");
-            if (_logger != nullptr) _logger->log("Firmware update successful. Rebooting...\n");
+        bool applied = (_deltaInflater == nullptr || _deltaInflater->end()) && _deltaPatcher->end();
+        if (!applied) {
+            failDelta(server);
+            return;
+        }
+        digestFirmware();
+        finishTransfer(_firmwareStats, "Delta firmware", upload.totalSize);
+        char expected[65];
+        for (int i = 0; i < 32; i++) {
+            sprintf(expected + 2 * i, "%02x", _deltaPatcher->getNewSHA256()[i]);
+        }
+        releaseDelta();
+        _logger.logf("Firmware SHA-256: %s.\n", _firmwareSHA256);
+        if (strcmp(expected, _firmwareSHA256) != 0) {
+            failFirmware(server, "nok5", "Firmware SHA-256 mismatch.", 5);
+            return;
+        }
+        if (Update.end(true)) { // End OTA process, verifies the signature if a key is set
+            server.send(200, "application/json", String("{\"status\": \"ok\", \"message\":\"Firmware updated successfully. Rebooting...\", \"sha256\":\"") + _firmwareSHA256 + "\"}");
+            _logger.log("Delta firmware update successful. Rebooting...\n");
+            emit(EVENT_OTA_SUCCESS, _firmwareStats.storedBytes);
             delay(500);
             ESP.restart();
         } else {
-            reportStep(-3);
             Update.printError(Serial);
-            server.send(500, "application/json", "{\"status\": \"nok2\", \"error\":\"Firmware update failed.\"}");
-            if (_logger != nullptr) _logger->log("Firmware update failed.\\n");
+            failFirmware(server, "nok2", "Firmware update failed.", 2); // Also rejects the call completing the request
         }
     } else if (upload.status == UPLOAD_FILE_ABORTED) {
-        reportStep(2);
-        reportStep(-3);
+        emit(EVENT_OTA_ABORTED);
         Update.end();
+        releaseDelta();
         server.send(500, "application/json", "{\"status\": \"nok3\", \"error\":\"Firmware update aborted.\"}");
-        if (_logger != nullptr) _logger->log("Firmware update aborted.\\n");
+        _logger.log("Delta firmware update aborted.\n");
+    }
+}
+
+bool OTA::storeDelta(const uint8_t* data, size_t length) {
+    uint32_t hashStart = micros();
+    _firmwareHash.add(data, length);
+    uint32_t writeStart = micros();
+    _firmwareStats.hashMicros += writeStart - hashStart;
+    size_t written = Update.write(const_cast<uint8_t*>(data), length);
+    _firmwareStats.writeMicros += micros() - writeStart;
+    _firmwareStats.storedBytes += written;
+    _firmwareStats.writes++;
+    return written == length;
+}
+
+bool OTA::checkDeltaBase(const DeltaPatcher& patcher) {
+    char md5[33];
+    for (int i = 0; i < 16; i++) {
+        sprintf(md5 + 2 * i, "%02x", patcher.getBaseMD5()[i]);
+    }
+    if (patcher.getBaseSize() != ESP.getSketchSize() || ESP.getSketchMD5() != md5) {
+        _logger.logf("Patch made for firmware %s (%lu bytes), running %s (%lu bytes).\n", md5, 
+            (unsigned long)patcher.getBaseSize(), ESP.getSketchMD5().c_str(), (unsigned long)ESP.getSketchSize());
+        return false;
     }
+    return true;
+}
+
+void OTA::failDelta(ESP8266WebServer& server) {
+    DeltaPatcherError error = _deltaPatcher->getError();
+    if (error == DELTA_ERROR_BASE) {
+        failFirmware(server, "nok6", "Patch made for another firmware.", 6);
+    } else if (error == DELTA_ERROR_OUTPUT) {
+        Update.printError(Serial);
+        failFirmware(server, "nok4", "Firmware write failed.", 4);
+    } else {
+        _logger.logf("Invalid patch (error %u, inflate error %u).\n", error, _deltaInflater != nullptr ? _deltaInflater->getError() : 0);
+        failFirmware(server, "nok7", "Invalid patch.", 7);
+    }
+    releaseDelta();
+}
+
+void OTA::releaseDelta() {
+    delete _deltaInflater;
+    _deltaInflater = nullptr;
+    delete _deltaPatcher;
+    _deltaPatcher = nullptr;
 }
 
 /**
  * @brief Handles file upload via HTTP POST request.
+ * 
+ * The upload is received by a FileUploadSession: into a temporary file renamed over the 
+ * target once complete, through a write-behind buffer written in sector-sized blocks. 
+ * With `inflate=1`, a file named NAME.gz is inflated while it is received and stored as 
+ * NAME; the gzip trailer (CRC-32 and size) is verified at the end. Without it the file is 
+ * stored as it is: the gzip tool compresses with a window larger than the device's. A new 
+ * upload discards an unfinished one.
+ * 
  * @param server Reference to the web server instance managing the request.
  */
 void OTA::handleFileUpload(ESP8266WebServer& server) {
+    HEAP_SCOPE(HEAP_TAG_OTA);
     HTTPUpload& upload = server.upload();
-    static File file;         // Keeps file open across status changes
-    static String directory;  // Keeps directory path across status changes
     
-     reportStep(1);
     if (upload.status == UPLOAD_FILE_START) {
-        if (_logger != nullptr) _logger->log("Start file upload: "+upload.filename+";");
-        directory = server.arg("directory"); // Get the directory from the form
+        _logger.log("Start file upload: "+upload.filename+";");
+        emit(EVENT_UPLOAD_START);
+        _uploadStats = OTATransferStats();
+        _transferStart = micros();
+        String directory = server.arg("directory"); // Get the directory from the form
         if (directory.isEmpty()) directory = "/"; // Default to root if not provided
 
         String path = directory  + "/" + upload.filename; // Add subdirectory here
-        file = LittleFS.open(path, "w");
-        if (!file) {
+        _uploadStats.compressed = path.endsWith(".gz") && server.arg("inflate") == "1";
+        if (_uploadStats.compressed) {
+            path.remove(path.length() - 3);
+        }
+        delete _upload; // Removes the temporary file of an unfinished upload
+        _upload = new (std::nothrow) FileUploadSession(path);
+        if (_upload != nullptr && _upload->begin(_uploadStats.compressed)) {
+            _logger.log("\n");
+        } else if (_upload != nullptr && _upload->getError() == FILE_UPLOAD_ERROR_OPEN) {
             server.send(500, "application/json", "{\"status\": \"nok1\", \"error\":\"Failed to open file for writing.\"}");
-            if (_logger != nullptr) _logger->log(" Failed to open file '"+path+"' for writing.\n");
-            reportStep(2);
-            reportStep(-3);
-            return;
+            _logger.log(" Failed to open file '"+path+"' for writing.\n");
+            emit(EVENT_UPLOAD_FAILED, 1);
+            delete _upload;
+            _upload = nullptr;
+        } else {
+            server.send(500, "application/json", "{\"status\": \"nok4\", \"error\":\"Not enough memory to inflate the file.\"}");
+            _logger.log(" Not enough memory to inflate.\n");
+            emit(EVENT_UPLOAD_FAILED, 4);
+            delete _upload;
+            _upload = nullptr;
         }
-        if (_logger != nullptr) _logger->log("\n");
-        reportStep(2);
+    } else if (_upload == nullptr) {
+        return; // Failed to start (already answered), or already ended
     } else if (upload.status == UPLOAD_FILE_WRITE) {
-        if (_logger != nullptr) _logger->log("File uploading (writing)...\n");        
-        if (file) {
-            file.write(upload.buf, upload.currentSize);
-        }
-        reportStep(2);
+        _upload->write(upload.buf, upload.currentSize); // Errors are reported at the end
+        emit(EVENT_UPLOAD_PROGRESS, upload.totalSize);
     } else if (upload.status == UPLOAD_FILE_END) {
-        if (file) {
-            file.close();            
+        bool stored = _upload->end();
+        if (stored) _fileIndex.added(_upload->getPath(), false, _upload->getStoredBytes());
+        _uploadStats.storedBytes = _upload->getStoredBytes();
+        _uploadStats.writes = _upload->getWrites();
+        _uploadStats.writeMicros = _upload->getWriteMicros();
+        _uploadStats.inflateMicros = _upload->getInflateMicros();
+        finishTransfer(_uploadStats, "File", upload.totalSize);
+        if (stored) {
             server.send(200, "application/json", "{\"status\": \"ok\", \"message\":\"File uploaded successfully.\"}");
-            if (_logger != nullptr) _logger->log("File upload successful.\n");
+            _logger.log("File upload successful.\n");
+            emit(EVENT_UPLOAD_SUCCESS, upload.totalSize);
+        } else if (_upload->getError() == FILE_UPLOAD_ERROR_INFLATE) {
+            server.send(500, "application/json", "{\"status\": \"nok5\", \"error\":\"Invalid compressed file.\"}");
+            _logger.logf("Invalid compressed file (error %u).\n", _upload->getInflateError());
+            emit(EVENT_UPLOAD_FAILED, 5);
         } else {
             server.send(500, "application/json", "{\"status\": \"nok2\", \"error\":\"Failed to save file.\"}");
-            if (_logger != nullptr) _logger->log("Failed to save file.\n");
-            reportStep(-2);
+            _logger.logf("Failed to save file (error %u).\n", _upload->getError());
+            emit(EVENT_UPLOAD_FAILED, 2);
         }
-        reportStep(2);
+        delete _upload; // Removes the temporary file if the upload failed
+        _upload = nullptr;
     } else if (upload.status == UPLOAD_FILE_ABORTED) {
-        if (file) {
-            file.close();
-            LittleFS.remove(upload.filename); // Clean up
-        }
+        delete _upload; // Clean up
+        _upload = nullptr;
         server.send(500, "application/json", "{\"status\": \"nok3\", \"error\":\"File upload aborted.\"}");
-        if (_logger != nullptr) _logger->log("File upload aborted.\n");
-        reportStep(2);
-        reportStep(-1);
+        _logger.log("File upload aborted.\n");
+        emit(EVENT_UPLOAD_ABORTED);
+    }
+}
+
+void OTA::finishTransfer(OTATransferStats& stats, const char* kind, size_t bytes) {
+    stats.bytes = bytes;
+    stats.micros = micros() - _transferStart;
+    if (_logger.enabled() && stats.micros > 0) {
+        _logger.logf("%s received: %u bytes in %lu ms (%lu KB/s, %lu ms writing in %lu writes, %lu ms hashing).\n", kind, (unsigned)bytes, 
+            (unsigned long)(stats.micros / 1000), (unsigned long)((uint64_t)bytes * 1000000 / stats.micros / 1024), 
+            (unsigned long)(stats.writeMicros / 1000), (unsigned long)stats.writes, (unsigned long)(stats.hashMicros / 1000));
+        if (stats.compressed && stats.storedBytes != bytes) {
+            _logger.logf("Inflated to %lu bytes (%lu%%) in %lu ms.\n", (unsigned long)stats.storedBytes, 
+                (unsigned long)(stats.storedBytes > 0 ? (uint64_t)bytes * 100 / stats.storedBytes : 0), (unsigned long)(stats.inflateMicros / 1000));
+        }
     }
 }
 
+void OTA::writeTransfer(JsonObject object, const OTATransferStats& stats) {
+    object["bytes"] = stats.bytes;
+    object["ms"] = stats.micros / 1000;
+    object["writeMs"] = stats.writeMicros / 1000;
+    object["hashMs"] = stats.hashMicros / 1000;
+    object["compressed"] = stats.compressed;
+    object["delta"] = stats.delta;
+    object["storedBytes"] = stats.storedBytes;
+    object["writes"] = stats.writes;
+    object["inflateMs"] = stats.inflateMicros / 1000;
+    object["kbps"] = stats.micros > 0 ? (uint32_t)((uint64_t)stats.bytes * 1000000 / stats.micros / 1024) : 0;
+}
+
 /**
  * @brief Handles directory listing via HTTP GET request.
+ * 
+ * The response is a bare array, so it cannot carry `next`: all the matching entries are 
+ * listed, a page of the index at a time, and `offset` and `limit` are ignored.
+ * 
  * @param server Reference to the web server instance managing the request.
  */
 void OTA::handleDirectoryList(ESP8266WebServer& server) {
+    HEAP_SCOPE(HEAP_TAG_OTA);
+    FileIndexQuery query = listingQuery(server, "/", false);
+    query.offset = 0;
+    query.limit = OTA_INDEX_PAGE_SIZE;
+    String prefix = FileSystemIndex::normalize(query.path);
+    if (prefix != "/") prefix += "/";
     String response = "[";
-    Dir dir = LittleFS.openDir("/");
-    while (dir.next()) {
-        response += "\"" + dir.fileName() + "\",";
-    }
+    FileIndexPage page;
+    do {
+        page = _fileIndex.list(query, [&](const String& path, bool directory, uint32_t size) {
+            response += "\"" + path.substring(prefix.length()) + "\",";
+        });
+        query.offset += page.listed;
+    } while (page.more && page.listed > 0);
     if (response.endsWith(",")) response.remove(response.length() - 1); // Remove trailing comma
     response += "]";
     server.send(200, "application/json", response);
@@ -194,27 +748,61 @@ void OTA::handleDirectoryList(ESP8266WebServer& server) {
 
 /**
  * @brief Handles file system requests via HTTP GET request.
+ * 
+ * Lists a page of the entries of the file system index, see listingQuery() for the 
+ * parameters. `next` is the offset of the next page, present while entries follow; 
+ * `count` is the number of matching entries, present when the tree is indexed.
+ * 
  * @param server Reference to the web server instance managing the request.
  */
 void OTA::handleFileSystemRequest(ESP8266WebServer& server) {
-    if (_logger != nullptr) _logger->log("handleFileSystemRequest: ");
+    HEAP_SCOPE(HEAP_TAG_OTA);
+    _logger.log("handleFileSystemRequest: ");
     JsonDocument  doc;                     // Create a JSON document to store file data.
     JsonArray files = doc["files"].to<JsonArray>();
 
-    FSInfo fs_info;
-    LittleFS.info(fs_info);
+    const FSInfo& fs_info = _fileIndex.getInfo();
     doc["total"] = fs_info.totalBytes;
     doc["used"] = fs_info.usedBytes;
     doc["free"] = fs_info.totalBytes - fs_info.usedBytes;
 
-        // Start recursive listing from the root directory.
-    listFilesRecursive("/", files);
-        
+    FileIndexQuery query = listingQuery(server, "/", true);
+    FileIndexPage page = _fileIndex.list(query, [&](const String& path, bool directory, uint32_t size) {
+        JsonObject file = files.add<JsonObject>(); // Create a JSON object for the entry.
+        file["name"] = path; // Full path to the file/directory.
+        file["type"] = directory ? "directory" : "file"; // Type: file or directory.
+        file["size"] = size; // Size (0 for directories).
+    });
+    doc["offset"] = query.offset;
+    if (page.total >= 0) doc["count"] = page.total;
+    if (page.more) doc["next"] = query.offset + page.listed;
+
         // Serialize the JSON data and send it as the response.
     String response;
     serializeJson(doc, response);
     server.send(200, "application/json", response);
-    if (_logger != nullptr) _logger->log("ok\n");    
+    _logger.log("ok\n");    
+}
+
+/**
+ * Query string of the listings:
+ * - `path`: directory listed (default: the root),
+ * - `recursive`: `0` lists the directory only, `1` also its subdirectories,
+ * - `type`: `file` or `directory` lists only that type,
+ * - `offset`, `limit`: page, `limit` up to OTA_INDEX_PAGE_SIZE (the default).
+ * 
+ * @brief Reads the directory, filters and page of a listing from the query string.
+ */
+FileIndexQuery OTA::listingQuery(ESP8266WebServer& server, const char* defaultPath, bool defaultRecursive) {
+    FileIndexQuery query;
+    query.path = server.hasArg("path") ? server.arg("path") : String(defaultPath);
+    query.recursive = server.hasArg("recursive") ? server.arg("recursive") != "0" : defaultRecursive;
+    String type = server.arg("type");
+    if (type == "file") query.types = FILE_INDEX_FILES;
+    else if (type == "directory") query.types = FILE_INDEX_DIRECTORIES;
+    query.offset = server.arg("offset").toInt();
+    query.limit = server.hasArg("limit") ? server.arg("limit").toInt() : OTA_INDEX_PAGE_SIZE;
+    return query;
 }
 
 /**
@@ -223,28 +811,258 @@ void OTA::handleFileSystemRequest(ESP8266WebServer& server) {
  */
 void OTA::handleDownloadRequest(ESP8266WebServer& server) {
     String filePath = server.arg("file"); // Extract the 'file' parameter from the request if provided.
-    if (_logger != nullptr) _logger->log("handleDownloadRequest '"+filePath+"'");
+    _logger.log("handleDownloadRequest '"+filePath+"'");
 
     if (LittleFS.exists(filePath)) {
         File file = LittleFS.open(filePath, "r"); // Attempt to open the requested file in read mode.
-        server.streamFile(file, "application/octet-stream");
+        _serverManager.streamFile(file, "application/octet-stream"); // Range requests resume downloads
         file.close();
     } else {
         server.send(404, "application/json", "{\"status\": \"nok1\", \"error\":\"File not found\"}");
     }
-    if (_logger != nullptr) _logger->log("\n");
+    _logger.log("\n");
    
 }
 
+/**
+ * @brief Handles archive download requests: a tar of a directory.
+ * 
+ * `path` is the directory (default: the root); entry names are relative to it. The archive 
+ * is produced while it is sent, with chunked transfer encoding, a TAR_WRITER_BUFFER_SIZE 
+ * buffer at a time: files are read straight into the buffer, and nothing is staged on flash.
+ * 
+ * @param server Reference to the web server instance managing the request.
+ */
+void OTA::handleArchiveDownload(ESP8266WebServer& server) {
+    HEAP_SCOPE(HEAP_TAG_OTA);
+    String directory = FileSystemIndex::normalize(server.arg("path"));
+    _logger.log("handleArchiveDownload '"+directory+"'");
+    File root = LittleFS.open(directory, "r");
+    if (!root || !root.isDirectory()) {
+        server.send(404, "application/json", "{\"status\": \"nok1\", \"error\":\"Directory not found\"}");
+        _logger.log(": not found.\n");
+        return;
+    }
+    root.close();
+    TarWriter* writer = new (std::nothrow) TarWriter();
+    if (writer == nullptr) {
+        server.send(500, "application/json", "{\"status\": \"nok2\", \"error\":\"Not enough memory.\"}");
+        _logger.log(": not enough memory.\n");
+        return;
+    }
+
+    String name = directory == "/" ? String("littlefs") : directory.substring(directory.lastIndexOf('/') + 1);
+    server.sendHeader("Content-Disposition", "attachment; filename=\"" + name + ".tar\"");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/x-tar", "");
+    uint32_t start = millis();
+    writer->begin([&server](const uint8_t* data, size_t length) {
+        server.sendContent((const char*)data, length);
+        return server.client().connected();
+    });
+    bool sent = archiveDirectory(*writer, directory == "/" ? directory : directory + "/", "") && writer->end();
+    server.sendContent(""); // Last chunk
+    _logger.logf(": %s, %lu files, %lu directories, %lu bytes in %lu ms.\n", sent ? "ok" : "failed", 
+        (unsigned long)writer->getFiles(), (unsigned long)writer->getDirectories(), (unsigned long)writer->getOutputSize(), (unsigned long)(millis() - start));
+    delete writer;
+}
+
+bool OTA::archiveDirectory(TarWriter& writer, const String& directory, const String& prefix) {
+    Dir dir = LittleFS.openDir(directory);
+    while (dir.next()) {
+        String name = prefix + dir.fileName();
+        bool added;
+        if (dir.isDirectory()) {
+            added = writer.addDirectory(name.c_str(), dir.fileTime()) && archiveDirectory(writer, directory + dir.fileName() + "/", name + "/");
+        } else {
+            File file = dir.openFile("r");
+            if (!file) {
+                _logger.log(" (skipped '" + name + "')");
+                continue;
+            }
+            added = writer.addFile(name.c_str(), file.size(), dir.fileTime(), [&file](uint8_t* data, size_t length) {
+                return file.read(data, length);
+            });
+            file.close();
+        }
+        if (!added && writer.getError() != TAR_ERROR_NAME) {
+            return false;
+        }
+        if (!added) _logger.log(" (name too long '" + name + "')"); // Left out, the archive goes on
+        yield();
+    }
+    return true;
+}
+
+/**
+ * @brief Handles archive upload via HTTP POST request: a tar extracted into a directory.
+ * 
+ * `directory` is the target (default: the root). The archive is extracted as it arrives, 
+ * without being stored: directories are created, and each file is received by a 
+ * FileUploadSession, so it replaces an existing file only once complete. An archive named 
+ * NAME.tar.gz or NAME.tgz is inflated first if the request has `inflate=1`. The files 
+ * extracted before an error are kept.
+ * 
+ * @param server Reference to the web server instance managing the request.
+ */
+void OTA::handleArchiveUpload(ESP8266WebServer& server) {
+    HEAP_SCOPE(HEAP_TAG_OTA);
+    HTTPUpload& upload = server.upload();
+
+    if (upload.status == UPLOAD_FILE_START) {
+        _logger.log("Start archive upload: "+upload.filename+".\n");
+        emit(EVENT_UPLOAD_START);
+        _uploadStats = OTATransferStats();
+        _transferStart = micros();
+        releaseArchive(); // Discards an unfinished upload
+        delete _upload;
+        _upload = nullptr;
+        _archiveDirectory = FileSystemIndex::normalize(server.arg("directory"));
+        if (_archiveDirectory != "/") _archiveDirectory += "/";
+        _archiveStatus = 0;
+        _uploadStats.compressed = (upload.filename.endsWith(".gz") || upload.filename.endsWith(".tgz")) && server.arg("inflate") == "1";
+        _archive = new (std::nothrow) TarReader();
+        if (_archive != nullptr && _uploadStats.compressed) {
+            _archiveInflater = new (std::nothrow) GzipInflater();
+            if (_archiveInflater == nullptr || !_archiveInflater->begin([this](const uint8_t* data, size_t length) { return _archive->write(data, length); })) {
+                delete _archive;
+                _archive = nullptr;
+            }
+        }
+        if (_archive == nullptr) {
+            _archiveStatus = 4;
+            failArchive(server);
+            return;
+        }
+        _archive->begin(
+            [this](const TarEntry& entry) { return extractEntry(entry); }, 
+            [this](const uint8_t* data, size_t length) {
+                if (_upload->write(data, length)) return true;
+                _archiveStatus = 2;
+                return false;
+            }, 
+            [this](const TarEntry& entry) { return extractEnd(entry); });
+    } else if (_archive == nullptr) {
+        return; // Failed to start (already answered), or already ended
+    } else if (upload.status == UPLOAD_FILE_WRITE) {
+        if (_archiveInflater != nullptr) {
+            _archiveInflater->write(upload.buf, upload.currentSize); // Errors are reported at the end
+        } else {
+            _archive->write(upload.buf, upload.currentSize);
+        }
+        emit(EVENT_UPLOAD_PROGRESS, upload.totalSize);
+    } else if (upload.status == UPLOAD_FILE_END) {
+        bool extracted = (_archiveInflater == nullptr || _archiveInflater->end()) && _archive->end();
+        finishTransfer(_uploadStats, "Archive", upload.totalSize);
+        if (!extracted) {
+            failArchive(server);
+            return;
+        }
+        JsonDocument doc;
+        doc["status"] = "ok";
+        doc["files"] = _archive->getFiles();
+        doc["directories"] = _archive->getDirectories();
+        doc["skipped"] = _archive->getSkipped();
+        String response;
+        serializeJson(doc, response);
+        server.send(200, "application/json", response);
+        _logger.logf("Archive extracted: %lu files, %lu directories, %lu skipped.\n", 
+            (unsigned long)_archive->getFiles(), (unsigned long)_archive->getDirectories(), (unsigned long)_archive->getSkipped());
+        emit(EVENT_UPLOAD_SUCCESS, upload.totalSize);
+        releaseArchive();
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+        releaseArchive(); // Removes the temporary file of the file being extracted
+        server.send(500, "application/json", "{\"status\": \"nok3\", \"error\":\"Archive upload aborted.\"}");
+        _logger.log("Archive upload aborted.\n");
+        emit(EVENT_UPLOAD_ABORTED);
+    }
+}
+
+bool OTA::extractEntry(const TarEntry& entry) {
+    String path = _archiveDirectory + entry.name;
+    if (entry.type == TAR_ENTRY_DIRECTORY) {
+        // LittleFS.mkdir() needs the parent: create the missing ones, as opening a file does
+        for (int slash = path.indexOf('/', 1); slash > 0; slash = path.indexOf('/', slash + 1)) {
+            String parent = path.substring(0, slash);
+            if (!LittleFS.exists(parent) && LittleFS.mkdir(parent)) _fileIndex.added(parent, true);
+        }
+        if (!LittleFS.exists(path) && !LittleFS.mkdir(path)) {
+            _archiveStatus = 1;
+            return false;
+        }
+        _fileIndex.added(path, true);
+        return true;
+    }
+    delete _upload;
+    _upload = new (std::nothrow) FileUploadSession(path); // Parent directories are created with the file
+    if (_upload == nullptr) {
+        _archiveStatus = 4;
+        return false;
+    }
+    if (!_upload->begin(false)) {
+        _archiveStatus = 1;
+        return false;
+    }
+    return true;
+}
+
+bool OTA::extractEnd(const TarEntry& entry) {
+    bool stored = _upload->end();
+    _uploadStats.storedBytes += _upload->getStoredBytes();
+    _uploadStats.writes += _upload->getWrites();
+    _uploadStats.writeMicros += _upload->getWriteMicros();
+    if (!stored) {
+        _archiveStatus = 2;
+        return false;
+    }
+    _fileIndex.added(_upload->getPath(), false, _upload->getStoredBytes());
+    delete _upload;
+    _upload = nullptr;
+    return true;
+}
+
+void OTA::failArchive(ESP8266WebServer& server) {
+    static const char* const errors[] = { "Invalid archive.", "Failed to create a file or directory.", "Failed to save a file.", 
+        "Archive upload aborted.", "Not enough memory.", "Invalid compressed archive.", "Invalid archive." };
+    uint8_t status = _archiveStatus;
+    if (status == 0) {
+        bool inflateError = _archiveInflater != nullptr && _archiveInflater->getError() != GZIP_OK && _archiveInflater->getError() != GZIP_ERROR_OUTPUT;
+        status = inflateError ? 5 : 6;
+    }
+    JsonDocument doc;
+    doc["status"] = "nok" + String(status);
+    doc["error"] = errors[status];
+    if (_archive != nullptr && _archive->getEntry().name[0] != '\0') {
+        doc["file"] = _archive->getEntry().name;
+    }
+    String response;
+    serializeJson(doc, response);
+    server.send(500, "application/json", response);
+    _logger.logf("%s (archive error %u, inflate error %u)\n", errors[status], _archive != nullptr ? _archive->getError() : 0, 
+        _archiveInflater != nullptr ? _archiveInflater->getError() : 0);
+    emit(EVENT_UPLOAD_FAILED, status);
+    releaseArchive();
+}
+
+void OTA::releaseArchive() {
+    delete _upload; // Removes the temporary file of the file being extracted
+    _upload = nullptr;
+    delete _archiveInflater;
+    _archiveInflater = nullptr;
+    delete _archive;
+    _archive = nullptr;
+}
+
 /**
  * @brief Handles file deletion requests.
  * @param server Reference to the web server instance managing the request.
  */
 void OTA::handleDeleteRequest(ESP8266WebServer& server) {
     String path = server.arg("path");
-    if (_logger != nullptr) _logger->log("handleDeleteRequest: "+path);
+    _logger.log("handleDeleteRequest: "+path);
     if (LittleFS.exists(path)) { // Check if the file exists.
         if (LittleFS.remove(path)) { // Delete the file.
+            _fileIndex.removed(path);
             server.send(200, "application/json", "{\"status\": \"ok\", \"message\":\"File deleted successfully\"}");
         } else {
             server.send(500, "application/json", "{\"status\": \"nok1\", \"error\":\"Failed to delete file\"}");
@@ -252,7 +1070,7 @@ void OTA::handleDeleteRequest(ESP8266WebServer& server) {
     } else {
         server.send(404, "application/json", "{\"status\": \"nok2\", \"error\":\"File not found\"}");
     }
-    if (_logger != nullptr) _logger->log("\n");
+    _logger.log("\n");
    
 }
 
@@ -282,38 +1100,15 @@ void OTA::handleAddDirectoryRequest(ESP8266WebServer& server) {
     String parentPath = params["parentPath"];//server.arg("parentPath");
     String dirName =  params["dirName"];// server.arg("dirName");
     String fullPath = parentPath + "/" + dirName;
-    if (_logger != nullptr) _logger->log("handleAddDirectoryRequest '"+fullPath+"': ");
+    _logger.log("handleAddDirectoryRequest '"+fullPath+"': ");
 
     if (LittleFS.mkdir(fullPath)) {
+        _fileIndex.added(fullPath, true);
         server.send(200, "application/json", "{\"status\": \"ok\", \"message\":\"Directory created successfully\"}");
-        if (_logger != nullptr) _logger->log("ok\n");
+        _logger.log("ok\n");
     } else {
         server.send(500, "application/json", "{\"status\": \"nok3\", \"error\":\"Failed to create directory\"}");
-        if (_logger != nullptr) _logger->log("nok\n");
+        _logger.log("nok\n");
     }
    
 }
-
-/**
- * Recursively retrieves all files and directories from the file system,
- * starting from the specified directory.
- *
- * @brief Recursively lists files and directories in a given path.
- * @param dirPath  The path to start listing from.
- * @param filesArray JSON array to store file and directory details.
- */
-void OTA::listFilesRecursive(const String& dirPath, JsonArray& filesArray) {
-    Dir dir = LittleFS.openDir(dirPath); // Open the directory at dirPath.
-    while (dir.next()) {
-        JsonObject file = filesArray.add<JsonObject>(); // Create a JSON object for the entry.
-        file["name"] = dirPath + dir.fileName(); // Full path to the file/directory.
-        file["type"] = dir.isDirectory() ? "directory" : "file"; // Type: file or directory.
-        file["size"] = dir.isDirectory() ? 0 : dir.fileSize(); // Size (0 for directories).
-
-        // If it's a directory, recurse into it.
-        if (dir.isDirectory()) {
-            listFilesRecursive(dirPath + dir.fileName() + "/", filesArray);
-        }
-    }
-}
-
@@ -12,8 +12,42 @@
 #include <ESP8266WebServer.h>
 #include <LittleFS.h>
 #include <Updater.h>
+#include <BearSSLHelpers.h>
 #include "HTTPServerManager/HTTPServerManager.h"
-#include "Logger/Logger.h"
+#include "Logger/LogSink.h"
+#include "EventBus/EventBus.h"
+#include "OTA/GzipInflater.h"
+#include "OTA/DeltaPatcher.h"
+#include "OTA/FileUploadSession.h"
+#include "OTA/FileSystemIndex.h"
+#include "OTA/TarArchive.h"
+
+#ifndef OTA_CHUNK_SIZE
+#define OTA_CHUNK_SIZE 4096   ///< Size of the chunks of a firmware upload session: one flash sector.
+#endif
+
+#ifndef OTA_SESSION_TIMEOUT
+#define OTA_SESSION_TIMEOUT 300000   ///< Time without a request after which a firmware upload session is abandoned, in ms.
+#endif
+
+#ifndef OTA_DELTA_WINDOW_SIZE
+#define OTA_DELTA_WINDOW_SIZE 4096   ///< Inflate window of compressed delta patches; tools/delta_patch.py compresses for 4 KB.
+#endif
+
+/**
+ * @brief Timing of the last transfer of a kind (firmware or file upload).
+ */
+struct OTATransferStats {
+    uint32_t bytes = 0;          ///< Bytes received.
+    uint32_t storedBytes = 0;    ///< Bytes written to flash: the inflated size of compressed file uploads.
+    uint32_t writes = 0;         ///< Write calls to flash or to the file system.
+    uint32_t micros = 0;         ///< Time from the first to the last chunk, in µs.
+    uint32_t writeMicros = 0;    ///< Time spent writing to flash, in µs.
+    uint32_t hashMicros = 0;     ///< Time spent hashing the received bytes, in µs.
+    uint32_t inflateMicros = 0;  ///< Time spent inflating compressed file uploads, in µs.
+    bool compressed = false;     ///< The transfer was gzip-compressed.
+    bool delta = false;          ///< The transfer was a delta patch: storedBytes is the size of the image built.
+};
 
 /**
  * @class OTA
@@ -41,25 +75,212 @@ public:
     void registerEndpoints();
 
     /**
-     * @brief Adds a callback hook for reporting OTA update steps.
-     * @param func Callback function receiving an integer step indicator.
+     * @brief Abandons a firmware upload session left idle for the session timeout.
+     * 
+     * The session holds Update and a chunk buffer until its client finishes or deletes it; 
+     * a client that went away without doing so releases them here.
+     */
+    void loop();
+
+    /**
+     * @brief Sets the time without a request after which a session is abandoned.
+     * @param value Timeout in ms (default OTA_SESSION_TIMEOUT); 0 keeps sessions until replaced.
+     */
+    void setSessionTimeout(unsigned long value){ _sessionTimeout = value; }
+
+    /**
+     * @brief Sets the event bus receiving the update and upload events (EVENT_SOURCE_OTA).
+     * 
+     * Subscribe LED or UI handlers as deferred, so they run from EventBus::loop() 
+     * instead of inside the upload handlers.
+     * 
+     * @param eventBus Pointer to the EventBus, nullptr to emit no events.
      */
-    void addReportStepHook(std::function<void(int)> func);
+    void setEventBus(EventBus* eventBus){ _eventBus = eventBus; }
 
     /**
-     * @brief Reports an OTA update step to registered hooks.
-     * @param step The current step of the OTA update process.
+     * @brief Requires firmware images to be signed with the private key of a public key.
+     * 
+     * The signature is appended to the image by the core's signing tool and checked by 
+     * Update.end() before the boot partition is switched; unsigned or tampered images are 
+     * rejected. RSA and ECDSA keys are supported.
+     * 
+     * @param pemPublicKey Public key in PEM format, parsed and copied.
+     * @return False if the key could not be parsed.
      */
-    void reportStep(int step);
+    bool setSigningKey(const char* pemPublicKey);
+
+    /**
+     * @brief Returns the SHA-256 of the last firmware image received, as 64 hex digits.
+     */
+    const char* getFirmwareSHA256() const { return _firmwareSHA256; }
+
+    /**
+     * @brief Returns the timing of the last firmware upload.
+     */
+    const OTATransferStats& getFirmwareStats() const { return _firmwareStats; }
+
+    /**
+     * @brief Returns the timing of the last file upload.
+     */
+    const OTATransferStats& getUploadStats() const { return _uploadStats; }
+
+    /**
+     * @brief Returns the index answering /api/files and /api/directories.
+     * 
+     * The OTA handlers keep it up to date; code writing or removing files by itself calls 
+     * added()/removed(), or invalidate(), to have listings reflect the change at once.
+     */
+    FileSystemIndex& getFileIndex() { return _fileIndex; }
 
 private:
     HTTPServerManager& _serverManager; ///< Reference to the server manager.
-    Logger* _logger; ///< Pointer to the logger.
+    ComponentLogger _logger; ///< Logger.
+
+    EventBus* _eventBus = nullptr; ///< Event bus receiving the update and upload events.
+    OTATransferStats _firmwareStats; ///< Timing of the last firmware upload.
+    OTATransferStats _uploadStats; ///< Timing of the last file upload.
+    uint32_t _transferStart = 0; ///< micros() at the start of the current transfer.
+
+    BearSSL::HashSHA256 _firmwareHash; ///< SHA-256 of the firmware being received.
+    char _firmwareSHA256[65] = ""; ///< Hex SHA-256 of the last firmware received.
+    String _expectedSHA256; ///< SHA-256 the firmware being received must match, empty if none.
+    bool _firmwareFailed = false; ///< The firmware being received was rejected; remaining chunks are ignored.
+    FileUploadSession* _upload = nullptr; ///< File upload in progress, or file of the archive being extracted; nullptr if none.
+    TarReader* _archive = nullptr; ///< Reader of the archive being extracted, nullptr if none.
+    GzipInflater* _archiveInflater = nullptr; ///< Inflater of the compressed archive being extracted, nullptr if not compressed.
+    String _archiveDirectory; ///< Directory the archive is extracted into, with a trailing '/'.
+    uint8_t _archiveStatus = 0; ///< Error code (nokN) of the extraction, 0 if none.
+    FileSystemIndex _fileIndex; ///< Index of the file system, for the listings.
+
+    uint32_t _sessionId = 0; ///< Identifier of the firmware upload session, 0 if none is open.
+    uint32_t _sessionSize = 0; ///< Size of the image of the session.
+    uint32_t _sessionOffset = 0; ///< Bytes of the session hashed and written to flash.
+    unsigned long _sessionActivity = 0; ///< millis() of the last request of the session.
+    unsigned long _sessionTimeout = OTA_SESSION_TIMEOUT; ///< Idle time after which the session is abandoned, in ms; 0 for none.
+    uint8_t* _chunkBuffer = nullptr; ///< Chunk being received, OTA_CHUNK_SIZE bytes while a session is open.
+    size_t _chunkLength = 0; ///< Bytes of the chunk received so far.
+    bool _chunkValid = false; ///< The chunk being received fits the buffer.
+    DeltaPatcher* _deltaPatcher = nullptr; ///< Applier of the delta patch being received, nullptr if none.
+    GzipInflater* _deltaInflater = nullptr; ///< Inflater of the compressed delta patch being received, nullptr if not compressed.
+    BearSSL::PublicKey* _signingKey = nullptr; ///< Key verifying the firmware signature, nullptr if unsigned images are accepted.
+    BearSSL::HashSHA256* _signatureHash = nullptr; ///< Hash used by Update to verify the signature.
+    BearSSL::SigningVerifier* _signatureVerifier = nullptr; ///< Verifier installed in Update.
+
+    /**
+     * @brief Closes the timing of a transfer and logs its throughput.
+     */
+    void finishTransfer(OTATransferStats& stats, const char* kind, size_t bytes);
+
+    /**
+     * @brief Writes the timing of a transfer into a JSON object, for /api/metrics.
+     */
+    static void writeTransfer(JsonObject object, const OTATransferStats& stats);
+
+    /**
+     * @brief Writes the hex SHA-256 of the firmware received into _firmwareSHA256.
+     */
+    void digestFirmware();
+
+    /**
+     * @brief Handles GET (state), POST (start) and DELETE (abort) of /api/firmware/session.
+     */
+    void handleSessionRequest(ESP8266WebServer& server);
+
+    /**
+     * @brief Receives the raw body of a chunk into the chunk buffer.
+     */
+    void handleChunkUpload(ESP8266WebServer& server);
+
+    /**
+     * @brief Commits a received chunk, and installs the firmware after the last one.
+     */
+    void handleChunkRequest(ESP8266WebServer& server);
+
+    /**
+     * @brief Responds with the state of the session: identifier, size and committed offset.
+     */
+    void sendSession(ESP8266WebServer& server, int code, const char* status, const char* error = nullptr);
+
+    /**
+     * @brief Closes the session, abandoning the update if it is incomplete, and frees the chunk buffer.
+     */
+    void closeSession();
+
+    /**
+     * @brief Refuses a firmware upload with 409 while Update is in use by a pull update (OTAPull).
+     * 
+     * The OTA handlers end Update when an upload fails or is aborted; they must only do so 
+     * for an update they started. Called once the own session of the OTA object is closed.
+     * 
+     * @return True if the upload was refused; its remaining calls are then ignored.
+     */
+    bool refuseBusyUpdate(ESP8266WebServer& server);
+
+    /**
+     * @brief Abandons the firmware being received, responds with an error and closes the connection.
+     * 
+     * The remaining calls of the request, including the one completing it, are then ignored.
+     */
+    void failFirmware(ESP8266WebServer& server, const char* status, const char* error, int32_t code);
 
-    std::vector<std::function<void(int)>> _reportStepsHooks; ///< List of OTA update step hooks.
+    /**
+     * @brief Hashes and writes to flash a block of the firmware built from a delta patch.
+     */
+    bool storeDelta(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Checks that a delta patch was made for the running firmware: same size and MD5.
+     */
+    bool checkDeltaBase(const DeltaPatcher& patcher);
+
+    /**
+     * @brief Rejects the delta patch being received with the error matching the patcher's.
+     */
+    void failDelta(ESP8266WebServer& server);
+
+    /**
+     * @brief Frees the patcher and inflater of the delta patch.
+     */
+    void releaseDelta();
+
+    /**
+     * @brief Adds the entries of a directory, and of its subdirectories, to an archive.
+     * 
+     * @param prefix Name of the directory in the archive, empty or ending with '/'.
+     * @return False once the archive failed (the client is gone).
+     */
+    bool archiveDirectory(TarWriter& writer, const String& directory, const String& prefix);
+
+    /**
+     * @brief Creates a directory of the archive being extracted, or starts receiving a file.
+     */
+    bool extractEntry(const TarEntry& entry);
+
+    /**
+     * @brief Stores the file of the archive received completely.
+     */
+    bool extractEnd(const TarEntry& entry);
+
+    /**
+     * @brief Responds to an archive upload that failed, with the error of the extraction.
+     */
+    void failArchive(ESP8266WebServer& server);
+
+    /**
+     * @brief Frees the reader and inflater of the archive, and the file being extracted.
+     */
+    void releaseArchive();
+
+    /**
+     * @brief Emits an event, if an event bus is set.
+     */
+    void emit(EventType type, int32_t value = 0){ if (_eventBus != nullptr) _eventBus->emit(EVENT_SOURCE_OTA, type, value); }
     
     void handleFirmwareUpload(ESP8266WebServer& server);
 
+    void handleDeltaUpload(ESP8266WebServer& server);
+
     void handleFileUpload(ESP8266WebServer& server);
 
     void handleDirectoryList(ESP8266WebServer& server);
@@ -68,11 +289,18 @@ private:
 
     void handleDownloadRequest(ESP8266WebServer& server);
 
+    void handleArchiveUpload(ESP8266WebServer& server);
+
+    void handleArchiveDownload(ESP8266WebServer& server);
+
     void handleDeleteRequest(ESP8266WebServer& server);
 
     void handleAddDirectoryRequest(ESP8266WebServer& server);
 
-    void listFilesRecursive(const String& dirPath, JsonArray& filesArray);
+    /**
+     * @brief Reads the directory, filters and page of a listing from the query string.
+     */
+    static FileIndexQuery listingQuery(ESP8266WebServer& server, const char* defaultPath, bool defaultRecursive);
     
 };
 
@@ -0,0 +1,299 @@
+/**
+ * @file OTAPull.cpp
+ * @brief Implementation of the OTAPull class.
+ */
+#include "OTA/OTAPull.h"
+#include <ArduinoJson.h>
+#include "HeapProfiler/HeapProfiler.h"
+
+OTAPull::OTAPull(Logger* logger) : _logger(logger) {}
+
+void OTAPull::begin() {
+    _scheduled = true;
+    _lastCheck = millis();
+    _checkDelay = 0;
+}
+
+void OTAPull::loop() {
+    if (!_scheduled) {
+        return;
+    }
+    if (_state == OTA_PULL_DOWNLOADING) {
+        download();
+    } else if (WiFi.status() != WL_CONNECTED) {
+        return;
+    } else if (_state == OTA_PULL_RETRY_WAIT) {
+        if (millis() - _retryAt >= (_retryDelay << (_retries - 1))) {
+            openImage();
+        }
+    } else if (!_manifestUrl.isEmpty() && !_currentVersion.isEmpty() && millis() - _lastCheck >= _checkDelay) {
+        check();
+    }
+}
+
+bool OTAPull::check() {
+    HEAP_SCOPE(HEAP_TAG_OTA);
+    if (_state != OTA_PULL_IDLE) {
+        return false;
+    }
+    if (_currentVersion.isEmpty()) { // Any announced version would differ: the update would repeat at every boot
+        _logger.log("Update check refused: the current version is not set.\n");
+        return false;
+    }
+    _lastCheck = millis();
+    _checkDelay = _interval - _interval / 8 + random(_interval / 4 + 1); // Jitter spreads the checks of a fleet
+    _stats.checks++;
+
+    WiFiClient client;
+    HTTPClient http;
+    http.setTimeout(_timeout);
+    if (!http.begin(client, _manifestUrl)) {
+        _logger.log("Invalid update manifest URL.\n");
+        return false;
+    }
+    if (!_manifestETag.isEmpty()) http.addHeader("If-None-Match", _manifestETag);
+    if (!_manifestLastModified.isEmpty()) http.addHeader("If-Modified-Since", _manifestLastModified);
+    const char* headers[] = { "ETag", "Last-Modified", "Transfer-Encoding" };
+    http.collectHeaders(headers, 3);
+
+    int code = http.GET();
+    if (code == HTTP_CODE_NOT_MODIFIED) {
+        _stats.notModified++;
+        http.end();
+        return false;
+    }
+    if (code != HTTP_CODE_OK) {
+        _logger.logf("Update manifest request failed: %d.\n", code);
+        http.end();
+        return false;
+    }
+    if (http.header("Transfer-Encoding").equalsIgnoreCase("chunked")) { // The stream is read as it is, without decoding
+        _logger.log("Chunked update manifest refused.\n");
+        http.end();
+        return false;
+    }
+    JsonDocument manifest;
+    DeserializationError error = deserializeJson(manifest, http.getStream());
+    _manifestETag = http.header("ETag");
+    _manifestLastModified = http.header("Last-Modified");
+    http.end();
+
+    const char* version = manifest["version"] | "";
+    const char* url = manifest["url"] | "";
+    if (error || version[0] == '\0' || url[0] == '\0') {
+        _logger.log("Invalid update manifest.\n");
+        return false;
+    }
+    _availableVersion = version;
+    if (_availableVersion == _currentVersion) {
+        return false;
+    }
+    if (Update.isRunning()) {
+        _manifestETag = ""; // An upload is in progress: check again next time
+        _manifestLastModified = "";
+        return false;
+    }
+
+    _imageUrl = resolveUrl(url);
+    _expectedSHA256 = manifest["sha256"] | "";
+    _expectedSHA256.toLowerCase();
+    _size = manifest["size"] | 0;
+    _offset = 0;
+    _imageETag = "";
+    _retries = 0;
+    uint32_t maxSize = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+    if (_size >= maxSize || !Update.begin(maxSize)) { // As for uploads: until Update.end(true), abandoning never installs
+        Update.printError(Serial);
+        fail(1, "Firmware update failed to start.");
+        return false;
+    }
+    _hash.begin();
+    _stats.downloads++;
+    _logger.logf("Firmware %s available (running %s), downloading %s.\n", version, _currentVersion.c_str(), _imageUrl.c_str());
+    emit(EVENT_OTA_AVAILABLE, _size);
+    emit(EVENT_OTA_START);
+    return openImage();
+}
+
+/**
+ * @brief Requests the image from the current offset. A server ignoring the Range (200 instead 
+ * of 206), or whose image changed (If-Range), sends the whole image: the download restarts.
+ */
+bool OTAPull::openImage() {
+    _http.setTimeout(_timeout);
+    _http.setReuse(false);
+    if (!_http.begin(_client, _imageUrl)) {
+        fail(7, "Invalid firmware URL.");
+        return false;
+    }
+    if (_offset > 0) {
+        _http.addHeader("Range", "bytes=" + String(_offset) + "-");
+        if (!_imageETag.isEmpty()) _http.addHeader("If-Range", _imageETag);
+    }
+    const char* headers[] = { "ETag", "Content-Range", "Transfer-Encoding" };
+    _http.collectHeaders(headers, 3);
+
+    int code = _http.GET();
+    if ((code == HTTP_CODE_OK || code == HTTP_CODE_PARTIAL_CONTENT) && _http.header("Transfer-Encoding").equalsIgnoreCase("chunked")) {
+        _http.end(); // The chunk sizes would be written into the image, and its size is unknown
+        fail(9, "Chunked firmware download refused.");
+        return false;
+    }
+    if (code == HTTP_CODE_PARTIAL_CONTENT && _offset > 0) {
+        String range = _http.header("Content-Range"); // bytes <first>-<last>/<size>
+        if ((uint32_t)range.substring(6).toInt() != _offset) {
+            _http.end();
+            scheduleRetry("unexpected Content-Range");
+            return false;
+        }
+        int slash = range.indexOf('/');
+        if (_size == 0 && slash > 0) _size = range.substring(slash + 1).toInt();
+        _stats.resumes++;
+        _logger.logf("Firmware download resumed at %lu bytes.\n", (unsigned long)_offset);
+    } else if (code == HTTP_CODE_OK) {
+        if (_offset > 0) {
+            _stats.restarts++;
+            _logger.log("Firmware download restarted from the start.\n");
+            Update.end(); // Abandons the bytes written, begins again
+            uint32_t maxSize = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+            if (!Update.begin(maxSize)) {
+                _http.end();
+                fail(1, "Firmware update failed to restart.");
+                return false;
+            }
+            _offset = 0;
+            _hash.begin();
+        }
+        if (_size == 0 && _http.getSize() > 0) _size = _http.getSize();
+    } else {
+        _http.end();
+        scheduleRetry(code < 0 ? HTTPClient::errorToString(code).c_str() : "unexpected response");
+        return false;
+    }
+    _imageETag = _http.header("ETag");
+
+    uint32_t maxSize = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+    if (_size == 0 || _size >= maxSize) {
+        _http.end();
+        fail(8, "Unknown or too large firmware size.");
+        return false;
+    }
+    _lastData = millis();
+    _state = OTA_PULL_DOWNLOADING;
+    return true;
+}
+
+/**
+ * @brief Writes the bytes received to Update, OTA_PULL_BUFFER_SIZE at a time and for a 
+ * bounded time, so that the other components keep running during the download.
+ */
+void OTAPull::download() {
+    WiFiClient* stream = _http.getStreamPtr();
+    unsigned long start = millis();
+    while (stream != nullptr && _offset < _size && millis() - start < 20) {
+        size_t available = stream->available();
+        if (available == 0) {
+            break;
+        }
+        size_t length = available < sizeof(_buffer) ? available : sizeof(_buffer);
+        if (length > _size - _offset) length = _size - _offset;
+        length = stream->readBytes(_buffer, length);
+        _hash.add(_buffer, length);
+        if (Update.write(_buffer, length) != length) {
+            Update.printError(Serial);
+            _http.end();
+            fail(4, "Firmware write failed.");
+            return;
+        }
+        _offset += length;
+        _lastData = millis();
+        emit(EVENT_OTA_PROGRESS, _offset);
+    }
+
+    if (_offset >= _size) {
+        finish();
+    } else if (stream == nullptr || (!_http.connected() && stream->available() == 0)) {
+        _http.end();
+        scheduleRetry("connection closed");
+    } else if (millis() - _lastData > _timeout) {
+        _http.end();
+        scheduleRetry("download stalled");
+    }
+}
+
+void OTAPull::finish() {
+    _http.end();
+    _hash.end();
+    char sha256[65];
+    const uint8_t* hash = (const uint8_t*)_hash.hash();
+    for (int i = 0; i < 32; i++) {
+        sprintf(sha256 + 2 * i, "%02x", hash[i]);
+    }
+    if (!_expectedSHA256.isEmpty() && _expectedSHA256 != sha256) {
+        fail(5, "Firmware SHA-256 mismatch.");
+        return;
+    }
+    if (!Update.end(true)) { // Verifies the signature if a key is installed (OTA::setSigningKey())
+        Update.printError(Serial);
+        fail(6, "Firmware update failed.");
+        return;
+    }
+    _state = OTA_PULL_IDLE;
+    _currentVersion = _availableVersion;
+    _logger.logf("Firmware %s installed (SHA-256 %s).\n", _availableVersion.c_str(), sha256);
+    emit(EVENT_OTA_SUCCESS, _size);
+    if (_rebootOnUpdate) {
+        delay(500);
+        ESP.restart();
+    }
+}
+
+/**
+ * @brief Keeps the bytes written and waits before resuming, doubling the wait at each attempt.
+ */
+void OTAPull::scheduleRetry(const char* reason) {
+    if (++_retries > _maxRetries) {
+        fail(7, "Firmware download failed.");
+        return;
+    }
+    _logger.logf("Firmware download interrupted at %lu bytes (%s), attempt %u of %u.\n", 
+        (unsigned long)_offset, reason, _retries, _maxRetries);
+    _retryAt = millis();
+    _state = OTA_PULL_RETRY_WAIT;
+}
+
+/**
+ * @brief Abandons the update. The manifest validators are cleared, so the next check 
+ * fetches the manifest again and retries the version.
+ */
+void OTAPull::fail(int32_t code, const char* reason) {
+    if (Update.isRunning()) {
+        Update.end(); // Abandons the update; the boot partition is not switched
+    }
+    _state = OTA_PULL_IDLE;
+    _stats.failures++;
+    _manifestETag = "";
+    _manifestLastModified = "";
+    _logger.logf("%s\n", reason);
+    emit(EVENT_OTA_FAILED, code);
+}
+
+/**
+ * @brief Resolves the image URL of the manifest: absolute, relative to the host ("/..."), 
+ * or relative to the directory of the manifest.
+ */
+String OTAPull::resolveUrl(const String& url) const {
+    if (url.indexOf("://") >= 0) {
+        return url;
+    }
+    int scheme = _manifestUrl.indexOf("://");
+    int hostEnd = _manifestUrl.indexOf('/', scheme < 0 ? 0 : scheme + 3);
+    if (url.startsWith("/")) {
+        return (hostEnd < 0 ? _manifestUrl : _manifestUrl.substring(0, hostEnd)) + url;
+    }
+    int directoryEnd = _manifestUrl.lastIndexOf('/');
+    if (directoryEnd < hostEnd || hostEnd < 0) {
+        return (hostEnd < 0 ? _manifestUrl : _manifestUrl.substring(0, hostEnd)) + "/" + url;
+    }
+    return _manifestUrl.substring(0, directoryEnd + 1) + url;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file OTAPull.h
+ * @brief Pull-based firmware updates from an HTTP update server.
+ *
+ * The device periodically fetches a small JSON manifest announcing the current firmware
+ * version. Polling is cheap: the manifest's ETag and Last-Modified are sent back, and an
+ * unchanged manifest costs a 304 response. When the announced version differs from the
+ * running one, the image is streamed into Update from loop(), a bounded buffer at a time,
+ * and an interrupted download is resumed with a Range request.
+ */
+#ifndef OTA_PULL_H
+#define OTA_PULL_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <ESP8266HTTPClient.h>
+#include <Updater.h>
+#include <BearSSLHelpers.h>
+#include "Logger/LogSink.h"
+#include "EventBus/EventBus.h"
+
+#ifndef OTA_PULL_BUFFER_SIZE
+#define OTA_PULL_BUFFER_SIZE 1024   ///< Bytes read from the network and written to flash at a time.
+#endif
+
+/**
+ * @brief State of a pull update.
+ */
+enum OTAPullState : uint8_t {
+    OTA_PULL_IDLE,          ///< Waiting for the next manifest check.
+    OTA_PULL_DOWNLOADING,   ///< Streaming the image into Update.
+    OTA_PULL_RETRY_WAIT     ///< Download interrupted, waiting before resuming it.
+};
+
+/**
+ * @brief Counters of the pull updates since boot.
+ */
+struct OTAPullStats {
+    uint32_t checks = 0;        ///< Manifest requests.
+    uint32_t notModified = 0;   ///< Manifest requests answered 304 Not Modified.
+    uint32_t downloads = 0;     ///< Image downloads started.
+    uint32_t resumes = 0;       ///< Downloads resumed with a Range request.
+    uint32_t restarts = 0;      ///< Resumes refused by the server (200 instead of 206), restarted from the start.
+    uint32_t failures = 0;      ///< Updates abandoned.
+};
+
+class OTAPull {
+public:
+    /**
+     * @brief Constructs an OTAPull object.
+     * 
+     * @param logger Pointer to the Logger instance.
+     */
+    OTAPull(Logger* logger = nullptr);
+
+    /**
+     * @brief Enables the checks; the first one is made as soon as WiFi is connected.
+     * 
+     * No check is made until setCurrentVersion() has been called.
+     */
+    void begin();
+
+    /**
+     * @brief Checks the manifest when due, and streams the image while a download runs.
+     */
+    void loop();
+
+    /**
+     * @brief Fetches the manifest now, and starts the download if it announces a new version.
+     * 
+     * Blocks for at most the timeout.
+     * 
+     * @return True if a download started; false too if the current version is not set.
+     */
+    bool check();
+
+    /**
+     * @brief Sets the URL of the manifest, e.g. the "entryPointUrl" of the configuration.
+     * 
+     * The manifest is a JSON object: `{"version": "1.4.0", "url": "firmware-1.4.0.bin", "size": 412736, "sha256": "..."}`. 
+     * `url` may be relative to the manifest; `size` and `sha256` are optional.
+     */
+    void setManifestUrl(const String& url){ _manifestUrl = url; }
+    void setCurrentVersion(const String& version){ _currentVersion = version; } ///< Version of the running firmware, required; a manifest announcing another one triggers the update.
+    void setInterval(unsigned long value){ _interval = value; }             ///< Interval of the manifest checks in ms (default: 3600000), spread by ±12.5% of jitter.
+    void setTimeout(uint16_t value){ _timeout = value; }                    ///< Timeout of the requests and of a stalled download in ms (default: 5000).
+    void setMaxRetries(uint8_t value){ _maxRetries = value; }               ///< Resume attempts of an interrupted download before it is abandoned (default: 5).
+    void setRetryDelay(unsigned long value){ _retryDelay = value; }         ///< Delay before the first resume attempt in ms, doubled at each attempt (default: 5000).
+    void setRebootOnUpdate(bool value){ _rebootOnUpdate = value; }          ///< Reboots once the update is installed (default: true).
+
+    /**
+     * @brief Sets the event bus receiving the update events (EVENT_SOURCE_OTA).
+     * 
+     * @param eventBus Pointer to the EventBus, nullptr to emit no events.
+     */
+    void setEventBus(EventBus* eventBus){ _eventBus = eventBus; }
+
+    OTAPullState getState() const { return _state; }                        ///< State of the pull update.
+    const OTAPullStats& getStats() const { return _stats; }                 ///< Counters since boot.
+    const String& getAvailableVersion() const { return _availableVersion; } ///< Version announced by the manifest, empty if none.
+    uint32_t getOffset() const { return _offset; }                          ///< Bytes of the image written so far.
+    uint32_t getSize() const { return _size; }                              ///< Size of the image being downloaded.
+
+private:
+    ComponentLogger _logger;                ///< Logger instance.
+    EventBus* _eventBus = nullptr;          ///< Event bus receiving the update events.
+
+    String _manifestUrl;                    ///< URL of the manifest.
+    String _currentVersion;                 ///< Version of the running firmware.
+    String _manifestETag;                   ///< ETag of the last manifest, sent as If-None-Match.
+    String _manifestLastModified;           ///< Last-Modified of the last manifest, sent as If-Modified-Since.
+    unsigned long _interval = 3600000;      ///< Interval of the manifest checks, in ms.
+    uint16_t _timeout = 5000;               ///< Timeout of the requests, in ms.
+    uint8_t _maxRetries = 5;                ///< Resume attempts before abandoning.
+    unsigned long _retryDelay = 5000;       ///< Delay before the first resume attempt, in ms.
+    bool _rebootOnUpdate = true;            ///< Reboot once installed.
+
+    OTAPullState _state = OTA_PULL_IDLE;    ///< State of the pull update.
+    OTAPullStats _stats;                    ///< Counters since boot.
+    unsigned long _lastCheck = 0;           ///< millis() of the last manifest check.
+    unsigned long _checkDelay = 0;          ///< Delay until the next check, with jitter.
+    bool _scheduled = false;                ///< begin() was called.
+
+    String _availableVersion;               ///< Version announced by the manifest.
+    String _imageUrl;                       ///< Absolute URL of the image.
+    String _imageETag;                      ///< ETag of the image, sent as If-Range when resuming.
+    String _expectedSHA256;                 ///< SHA-256 announced by the manifest, empty if none.
+    uint32_t _size = 0;                     ///< Size of the image, 0 until known.
+    uint32_t _offset = 0;                   ///< Bytes of the image written.
+    uint8_t _retries = 0;                   ///< Resume attempts of the current download.
+    unsigned long _retryAt = 0;             ///< millis() at which the wait before resuming started.
+    unsigned long _lastData = 0;            ///< millis() of the last bytes received.
+
+    WiFiClient _client;                     ///< Connection of the image download.
+    HTTPClient _http;                       ///< Request of the image download, kept open across loop() calls.
+    BearSSL::HashSHA256 _hash;              ///< SHA-256 of the bytes written.
+    uint8_t _buffer[OTA_PULL_BUFFER_SIZE];  ///< Bytes read from the network, before being written to flash.
+
+    bool openImage();
+    void download();
+    void finish();
+    void scheduleRetry(const char* reason);
+    void fail(int32_t code, const char* reason);
+    String resolveUrl(const String& url) const;
+
+    /**
+     * @brief Emits an event, if an event bus is set.
+     */
+    void emit(EventType type, int32_t value = 0){ if (_eventBus != nullptr) _eventBus->emit(EVENT_SOURCE_OTA, type, value); }
+};
+
+#endif
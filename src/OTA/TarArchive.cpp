@@ -0,0 +1,443 @@
+/**
+ * @file TarArchive.cpp
+ * @brief Implementation of the TarWriter and TarReader classes.
+ *
+ * TarWriter keeps its buffer aligned on blocks: headers and padding complete a block, and
+ * the buffer is a whole number of blocks, so a header always fits once the buffer is
+ * flushed. TarReader gathers each header block in _header, whatever the chunking of the
+ * input; the content of the files is handed to the data handler straight from the input.
+ */
+#include "OTA/TarArchive.h"
+#include <string.h>
+
+static_assert(TAR_WRITER_BUFFER_SIZE % TAR_BLOCK_SIZE == 0, "TAR_WRITER_BUFFER_SIZE must be a multiple of TAR_BLOCK_SIZE");
+
+// Offsets and sizes of the fields of a ustar header
+static const size_t nameField = 0, nameSize = 100;
+static const size_t modeField = 100;
+static const size_t uidField = 108;
+static const size_t gidField = 116;
+static const size_t sizeField = 124, sizeSize = 12;
+static const size_t mtimeField = 136;
+static const size_t checksumField = 148, checksumSize = 8;
+static const size_t typeField = 156;
+static const size_t magicField = 257;
+static const size_t versionField = 263;
+static const size_t prefixField = 345, prefixSize = 155;
+
+/**
+ * @brief Writes value as size - 1 octal digits and a terminator.
+ */
+static void writeOctal(uint8_t* field, size_t size, uint32_t value) {
+    field[size - 1] = 0;
+    for (size_t i = size - 1; i > 0; i--) {
+        field[i - 1] = '0' + (value & 7);
+        value >>= 3;
+    }
+}
+
+/**
+ * @brief Reads an octal field, ended by a NUL or a space; returns false if invalid or larger
+ * than 32 bits (base-256 sizes are not supported).
+ */
+static bool readOctal(const uint8_t* field, size_t size, uint32_t& value) {
+    size_t i = 0;
+    while (i < size && field[i] == ' ') i++;
+    uint64_t result = 0;
+    for (; i < size && field[i] != 0 && field[i] != ' '; i++) {
+        if (field[i] < '0' || field[i] > '7') return false;
+        result = (result << 3) | (field[i] - '0');
+        if (result > 0xFFFFFFFF) return false;
+    }
+    value = (uint32_t)result;
+    return true;
+}
+
+static uint32_t checksum(const uint8_t* header) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+        sum += (i >= checksumField && i < checksumField + checksumSize) ? ' ' : header[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Copies a name of length bytes into longName; returns false if too long.
+ */
+static bool setLongName(char* longName, const uint8_t* name, size_t length) {
+    if (length >= TAR_NAME_SIZE) return false;
+    memcpy(longName, name, length);
+    longName[length] = 0;
+    return true;
+}
+
+static size_t fieldLength(const uint8_t* field, size_t size) {
+    const void* end = memchr(field, 0, size);
+    return end != nullptr ? (const uint8_t*)end - field : size;
+}
+
+void TarWriter::begin(Sink sink) {
+    _sink = sink;
+    _fill = 0;
+    _files = 0;
+    _directories = 0;
+    _output = 0;
+    _error = TAR_OK;
+}
+
+bool TarWriter::addDirectory(const char* name, uint32_t mtime) {
+    if (!addHeader(name, TAR_ENTRY_DIRECTORY, 0, mtime)) {
+        return false;
+    }
+    _directories++;
+    return true;
+}
+
+bool TarWriter::addFile(const char* name, uint32_t size, uint32_t mtime, Source source) {
+    if (!addHeader(name, TAR_ENTRY_FILE, size, mtime)) {
+        return false;
+    }
+    uint32_t remaining = size;
+    while (remaining > 0) {
+        if (_fill == TAR_WRITER_BUFFER_SIZE && !flush()) {
+            return false;
+        }
+        size_t count = TAR_WRITER_BUFFER_SIZE - _fill;
+        if (count > remaining) count = remaining;
+        size_t read = source(_buffer + _fill, count);
+        if (read == 0 || read > count) {
+            return fail(TAR_ERROR_SOURCE);
+        }
+        _fill += read;
+        remaining -= read;
+    }
+    pad();
+    _files++;
+    return true;
+}
+
+bool TarWriter::end() {
+    if (_error != TAR_OK && _error != TAR_ERROR_NAME) {
+        return false;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (_fill == TAR_WRITER_BUFFER_SIZE && !flush()) {
+            return false;
+        }
+        memset(_buffer + _fill, 0, TAR_BLOCK_SIZE);
+        _fill += TAR_BLOCK_SIZE;
+    }
+    return flush();
+}
+
+/**
+ * @brief Adds the header block of an entry; a name longer than the name field is split at
+ * a '/' into the prefix field.
+ */
+bool TarWriter::addHeader(const char* name, TarEntryType type, uint32_t size, uint32_t mtime) {
+    if (_error != TAR_OK && _error != TAR_ERROR_NAME) {
+        return false;
+    }
+    size_t length = strlen(name);
+    if (length == 0) {
+        return fail(TAR_ERROR_NAME);
+    }
+    size_t total = length + (type == TAR_ENTRY_DIRECTORY ? 1 : 0); // Directory names end with '/'
+    size_t split = 0;
+    if (total > nameSize) {
+        split = length;
+        while (split > 0 && (name[split - 1] != '/' || split - 1 > prefixSize || total - split > nameSize)) {
+            split--;
+        }
+        if (split == 0) {
+            return fail(TAR_ERROR_NAME);
+        }
+    }
+    if (_fill == TAR_WRITER_BUFFER_SIZE && !flush()) {
+        return false;
+    }
+
+    uint8_t* header = _buffer + _fill;
+    memset(header, 0, TAR_BLOCK_SIZE);
+    if (split > 0) {
+        memcpy(header + prefixField, name, split - 1);
+    }
+    memcpy(header + nameField, name + split, length - split);
+    if (type == TAR_ENTRY_DIRECTORY) {
+        header[nameField + length - split] = '/';
+    }
+    writeOctal(header + modeField, 8, type == TAR_ENTRY_DIRECTORY ? 0755 : 0644);
+    writeOctal(header + uidField, 8, 0);
+    writeOctal(header + gidField, 8, 0);
+    writeOctal(header + sizeField, sizeSize, size);
+    writeOctal(header + mtimeField, 12, mtime);
+    header[typeField] = type == TAR_ENTRY_DIRECTORY ? '5' : '0';
+    memcpy(header + magicField, "ustar", 6);
+    memcpy(header + versionField, "00", 2);
+    writeOctal(header + checksumField, 7, checksum(header));
+    header[checksumField + 7] = ' ';
+    _fill += TAR_BLOCK_SIZE;
+    return true;
+}
+
+/**
+ * @brief Completes the last block of a file with zeros.
+ */
+void TarWriter::pad() {
+    size_t partial = _fill % TAR_BLOCK_SIZE;
+    if (partial > 0) {
+        memset(_buffer + _fill, 0, TAR_BLOCK_SIZE - partial);
+        _fill += TAR_BLOCK_SIZE - partial;
+    }
+}
+
+bool TarWriter::flush() {
+    if (_fill == 0) {
+        return true;
+    }
+    size_t fill = _fill;
+    _fill = 0;
+    _output += fill;
+    return _sink(_buffer, fill) ? true : fail(TAR_ERROR_OUTPUT);
+}
+
+bool TarWriter::fail(TarError error) {
+    _error = error;
+    return false;
+}
+
+void TarReader::begin(EntryHandler onEntry, DataHandler onData, EntryHandler onEnd) {
+    _onEntry = onEntry;
+    _onData = onData;
+    _onEnd = onEnd;
+    _headerLength = 0;
+    _entry = TarEntry();
+    _remaining = 0;
+    _skipping = false;
+    _extendedType = 0;
+    _longName[0] = 0;
+    _zeroBlocks = 0;
+    _files = 0;
+    _directories = 0;
+    _skipped = 0;
+    _input = 0;
+    _state = STATE_HEADER;
+    _error = TAR_OK;
+}
+
+bool TarReader::write(const uint8_t* data, size_t length) {
+    if (_state == STATE_ERROR) {
+        return false;
+    }
+    _input += length;
+    while (length > 0 && _state != STATE_DONE) {
+        size_t count;
+        switch (_state) {
+        case STATE_HEADER:
+            count = TAR_BLOCK_SIZE - _headerLength;
+            if (count > length) count = length;
+            memcpy(_header + _headerLength, data, count);
+            _headerLength += count;
+            if (_headerLength == TAR_BLOCK_SIZE) {
+                _headerLength = 0;
+                if (!parseHeader()) {
+                    return false;
+                }
+            }
+            break;
+        case STATE_DATA:
+            count = _remaining < length ? _remaining : length;
+            if (_extendedType != 0) {
+                memcpy(_extended + _entry.size - _remaining, data, count);
+            } else if (!_skipping && !_onData(data, count)) {
+                return fail(TAR_ERROR_OUTPUT);
+            }
+            _remaining -= count;
+            if (_remaining == 0 && !endEntry()) {
+                return false;
+            }
+            break;
+        case STATE_PADDING:
+            count = _remaining < length ? _remaining : length;
+            _remaining -= count;
+            if (_remaining == 0) {
+                _state = STATE_HEADER;
+            }
+            break;
+        default:
+            return false;
+        }
+        data += count;
+        length -= count;
+    }
+    return true; // Bytes after the end of the archive (record padding) are ignored
+}
+
+bool TarReader::end() {
+    if (_state == STATE_ERROR) {
+        return false;
+    }
+    if (_state == STATE_DONE || (_state == STATE_HEADER && _headerLength == 0)) {
+        _state = STATE_DONE;
+        return true;
+    }
+    return fail(TAR_ERROR_TRUNCATED);
+}
+
+/**
+ * @brief Checks a header block and starts its entry; two zero blocks end the archive.
+ */
+bool TarReader::parseHeader() {
+    bool zero = true;
+    for (size_t i = 0; i < TAR_BLOCK_SIZE && zero; i++) {
+        zero = _header[i] == 0;
+    }
+    if (zero) {
+        if (++_zeroBlocks == 2) {
+            _state = STATE_DONE;
+        }
+        return true;
+    }
+    _zeroBlocks = 0;
+
+    uint32_t stored;
+    if (!readOctal(_header + checksumField, checksumSize, stored) || stored != checksum(_header)) {
+        return fail(TAR_ERROR_HEADER);
+    }
+    _entry = TarEntry();
+    if (!readOctal(_header + sizeField, sizeSize, _entry.size)) {
+        return fail(TAR_ERROR_HEADER);
+    }
+    readOctal(_header + mtimeField, 12, _entry.mtime);
+    char type = _header[typeField];
+    if (type == 'L' || type == 'x') {
+        if (_entry.size > TAR_BLOCK_SIZE) {
+            return fail(TAR_ERROR_HEADER);
+        }
+        _extendedType = type; // Received into _extended, applied to the next entry
+        _skipping = true;
+        _remaining = _entry.size;
+        _state = STATE_DATA;
+        return _remaining > 0 ? true : endEntry();
+    }
+
+    // Full name: prefix '/' name, or the name of an extended header
+    char raw[TAR_NAME_SIZE - 1];
+    size_t rawLength = 0;
+    if (_longName[0] != 0) {
+        rawLength = strlen(_longName);
+        memcpy(raw, _longName, rawLength);
+        _longName[0] = 0;
+    } else {
+        if (memcmp(_header + magicField, "ustar", 5) == 0) {
+            rawLength = fieldLength(_header + prefixField, prefixSize);
+            memcpy(raw, _header + prefixField, rawLength);
+            if (rawLength > 0) raw[rawLength++] = '/';
+        }
+        size_t nameLength = fieldLength(_header + nameField, nameSize);
+        memcpy(raw + rawLength, _header + nameField, nameLength);
+        rawLength += nameLength;
+    }
+
+    if (type == '0' || type == '7' || type == 0) {
+        _entry.type = rawLength > 0 && raw[rawLength - 1] == '/' ? TAR_ENTRY_DIRECTORY : TAR_ENTRY_FILE;
+    } else if (type == '5') {
+        _entry.type = TAR_ENTRY_DIRECTORY;
+    } else {
+        _entry.type = TAR_ENTRY_OTHER;
+    }
+
+    // Relative name: empty and "." components dropped, ".." rejected
+    size_t length = 0;
+    for (size_t start = 0; start < rawLength;) {
+        const char* slash = (const char*)memchr(raw + start, '/', rawLength - start);
+        size_t end = slash != nullptr ? slash - raw : rawLength;
+        size_t component = end - start;
+        if (component == 2 && raw[start] == '.' && raw[start + 1] == '.') {
+            return fail(TAR_ERROR_NAME);
+        }
+        if (component > 0 && !(component == 1 && raw[start] == '.')) {
+            if (length > 0) _entry.name[length++] = '/';
+            memcpy(_entry.name + length, raw + start, component);
+            length += component;
+        }
+        start = end + 1;
+    }
+    _entry.name[length] = 0;
+
+    _skipping = true;
+    if (_entry.type == TAR_ENTRY_OTHER) {
+        _skipped++;
+    } else if (length == 0) {
+        if (_entry.type == TAR_ENTRY_FILE) {
+            return fail(TAR_ERROR_NAME);
+        }
+        // The directory of the archive itself ("./")
+    } else {
+        if (_entry.type == TAR_ENTRY_DIRECTORY) {
+            _directories++;
+        }
+        if (!_onEntry(_entry)) {
+            return fail(TAR_ERROR_OUTPUT);
+        }
+        _skipping = _entry.type != TAR_ENTRY_FILE;
+    }
+    _remaining = _entry.size;
+    _state = STATE_DATA;
+    return _remaining > 0 ? true : endEntry();
+}
+
+/**
+ * @brief Reads the name of the next entry from a GNU long name or a pax header (records
+ * "length key=value\n"); other pax keys are ignored.
+ */
+bool TarReader::parseExtended() {
+    size_t length = _entry.size;
+    if (_extendedType == 'L') {
+        return setLongName(_longName, _extended, fieldLength(_extended, length)) ? true : fail(TAR_ERROR_NAME);
+    }
+    for (size_t start = 0; start < length;) {
+        size_t recordLength = 0;
+        size_t i = start;
+        while (i < length && _extended[i] >= '0' && _extended[i] <= '9') {
+            recordLength = recordLength * 10 + (_extended[i++] - '0');
+        }
+        size_t end = start + recordLength;
+        if (i == start || i >= length || _extended[i] != ' ' || end > length || end <= i + 1 || _extended[end - 1] != '\n') {
+            return fail(TAR_ERROR_HEADER);
+        }
+        const uint8_t* key = _extended + i + 1;
+        if (end - (i + 1) > 5 && memcmp(key, "path=", 5) == 0 && !setLongName(_longName, key + 5, end - 1 - (i + 6))) {
+            return fail(TAR_ERROR_NAME);
+        }
+        start = end;
+    }
+    return true;
+}
+
+/**
+ * @brief Ends the content of an entry and skips its padding.
+ */
+bool TarReader::endEntry() {
+    if (_extendedType != 0) {
+        bool parsed = parseExtended();
+        _extendedType = 0;
+        if (!parsed) {
+            return false;
+        }
+    } else if (!_skipping) {
+        _files++;
+        if (_onEnd && !_onEnd(_entry)) {
+            return fail(TAR_ERROR_OUTPUT);
+        }
+    }
+    _remaining = (TAR_BLOCK_SIZE - _entry.size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+    _state = _remaining > 0 ? STATE_PADDING : STATE_HEADER;
+    return true;
+}
+
+bool TarReader::fail(TarError error) {
+    _state = STATE_ERROR;
+    _error = error;
+    return false;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file TarArchive.h
+ * @brief Streaming writer and reader of tar (ustar) archives.
+ *
+ * TarWriter produces an archive of entries added one at a time: the content of each file
+ * is read from a source straight into a buffer of TAR_WRITER_BUFFER_SIZE bytes, which is
+ * handed to a sink each time it fills up, so a directory of any size is packed in fixed
+ * memory, without staging the archive.
+ *
+ * TarReader parses an archive fed in chunks of any size, as they arrive from the network:
+ * the start of each entry (name, type, size) and then its content are handed to the
+ * handlers as they are received, without copying file content. Memory is fixed: the header
+ * block being received and the current entry.
+ *
+ * TarWriter writes names of the ustar format: up to 100 bytes, or up to 255 with a prefix
+ * split at a '/'. TarReader also reads longer names from GNU long name ('L') and pax ('x')
+ * headers of up to TAR_BLOCK_SIZE bytes, makes names relative (leading '/' and "./" are
+ * removed) and rejects a name with a ".." component, so an archive cannot write outside
+ * the directory it is extracted into. Entries other than files and directories (links,
+ * devices, global pax headers) are skipped with their content.
+ *
+ * Depends only on the C++ standard library.
+ */
+#ifndef TAR_ARCHIVE_H
+#define TAR_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+#define TAR_BLOCK_SIZE 512      ///< Size of the blocks of an archive, in bytes.
+#define TAR_NAME_SIZE 257       ///< Longest name of an entry (prefix, '/' and name), with its terminator.
+
+#ifndef TAR_WRITER_BUFFER_SIZE
+#define TAR_WRITER_BUFFER_SIZE 2048   ///< Output buffer of TarWriter, in bytes; a multiple of TAR_BLOCK_SIZE.
+#endif
+
+/**
+ * @brief Error of a TarWriter or TarReader.
+ */
+enum TarError : uint8_t {
+    TAR_OK,                 ///< No error.
+    TAR_ERROR_NAME,         ///< Name too long, or with a ".." component.
+    TAR_ERROR_HEADER,       ///< Header block with a wrong checksum or an invalid field, or extended header too large.
+    TAR_ERROR_SOURCE,       ///< The source of a file ended before its size (TarWriter).
+    TAR_ERROR_TRUNCATED,    ///< The archive ended inside an entry (TarReader).
+    TAR_ERROR_OUTPUT        ///< The sink or a handler refused the data.
+};
+
+/**
+ * @brief Type of an entry.
+ */
+enum TarEntryType : uint8_t {
+    TAR_ENTRY_FILE,         ///< Regular file.
+    TAR_ENTRY_DIRECTORY,    ///< Directory; its name does not end with '/'.
+    TAR_ENTRY_OTHER         ///< Link, device or extended header: skipped by TarReader.
+};
+
+/**
+ * @brief Entry of an archive, as received by TarReader.
+ */
+struct TarEntry {
+    char name[TAR_NAME_SIZE] = "";        ///< Relative name.
+    TarEntryType type = TAR_ENTRY_FILE;   ///< Type.
+    uint32_t size = 0;                    ///< Size of the content, 0 for directories.
+    uint32_t mtime = 0;                   ///< Modification time, in seconds since 1970.
+};
+
+class TarWriter {
+public:
+    /**
+     * @brief Receives the archive in order, a buffer at a time; returns false to stop with
+     * TAR_ERROR_OUTPUT.
+     */
+    typedef std::function<bool(const uint8_t* data, size_t length)> Sink;
+
+    /**
+     * @brief Reads the next bytes of a file into data, up to length; returns the number of
+     * bytes read, 0 at the end.
+     */
+    typedef std::function<size_t(uint8_t* data, size_t length)> Source;
+
+    TarWriter() = default;
+
+    TarWriter(const TarWriter&) = delete;
+    TarWriter& operator=(const TarWriter&) = delete;
+
+    /**
+     * @brief Starts a new archive.
+     *
+     * @param sink Receiver of the archive.
+     */
+    void begin(Sink sink);
+
+    /**
+     * @brief Adds a directory.
+     *
+     * @param name Relative name, without trailing '/'.
+     * @param mtime Modification time, in seconds since 1970.
+     * @return False on error, see getError(), as for addFile().
+     */
+    bool addDirectory(const char* name, uint32_t mtime = 0);
+
+    /**
+     * @brief Adds a file, reading its content from source.
+     *
+     * @param name Relative name.
+     * @param size Size of the content; source must provide exactly this many bytes.
+     * @param mtime Modification time, in seconds since 1970.
+     * @param source Reader of the content.
+     * @return False on error, see getError(). A name too long (TAR_ERROR_NAME) leaves the
+     * entry out, and the archive can go on.
+     */
+    bool addFile(const char* name, uint32_t size, uint32_t mtime, Source source);
+
+    /**
+     * @brief Ends the archive (two zero blocks) and hands the rest of the buffer to the sink.
+     *
+     * @return False on error, see getError().
+     */
+    bool end();
+
+    TarError getError() const { return _error; }         ///< Error that stopped the archive, TAR_OK if none.
+    uint32_t getFiles() const { return _files; }         ///< Files added.
+    uint32_t getDirectories() const { return _directories; } ///< Directories added.
+    uint32_t getOutputSize() const { return _output; }   ///< Bytes handed to the sink.
+
+private:
+    bool addHeader(const char* name, TarEntryType type, uint32_t size, uint32_t mtime);
+    void pad();
+    bool flush();
+    bool fail(TarError error);
+
+    Sink _sink;                                    ///< Receiver of the archive.
+    uint8_t _buffer[TAR_WRITER_BUFFER_SIZE];       ///< Output not yet handed to the sink.
+    size_t _fill = 0;                              ///< Bytes in _buffer.
+    uint32_t _files = 0;                           ///< Files added.
+    uint32_t _directories = 0;                     ///< Directories added.
+    uint32_t _output = 0;                          ///< Bytes handed to the sink.
+    TarError _error = TAR_OK;                      ///< Error that stopped the archive.
+};
+
+class TarReader {
+public:
+    /**
+     * @brief Receives the start of a file or directory entry; returns false to stop with
+     * TAR_ERROR_OUTPUT.
+     */
+    typedef std::function<bool(const TarEntry& entry)> EntryHandler;
+
+    /**
+     * @brief Receives the content of the current file, in order; returns false to stop with
+     * TAR_ERROR_OUTPUT.
+     */
+    typedef std::function<bool(const uint8_t* data, size_t length)> DataHandler;
+
+    TarReader() = default;
+
+    TarReader(const TarReader&) = delete;
+    TarReader& operator=(const TarReader&) = delete;
+
+    /**
+     * @brief Starts a new archive.
+     *
+     * @param onEntry Receiver of the entries.
+     * @param onData Receiver of the content of the files.
+     * @param onEnd Receiver of the end of each file, once its content has been received;
+     * nullptr if not needed.
+     */
+    void begin(EntryHandler onEntry, DataHandler onData, EntryHandler onEnd = nullptr);
+
+    /**
+     * @brief Parses a chunk of the archive.
+     *
+     * @param data Archive bytes.
+     * @param length Number of bytes.
+     * @return False on error, see getError().
+     */
+    bool write(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Ends the archive.
+     *
+     * @return True if the archive ended between entries.
+     */
+    bool end();
+
+    TarError getError() const { return _error; }         ///< Error that stopped the archive, TAR_OK if none.
+    const TarEntry& getEntry() const { return _entry; }  ///< Current (or last) entry.
+    uint32_t getFiles() const { return _files; }         ///< Files received completely.
+    uint32_t getDirectories() const { return _directories; } ///< Directories received.
+    uint32_t getSkipped() const { return _skipped; }     ///< Entries of other types skipped.
+    uint32_t getInputSize() const { return _input; }     ///< Archive bytes received.
+
+private:
+    enum State : uint8_t { STATE_HEADER, STATE_DATA, STATE_PADDING, STATE_DONE, STATE_ERROR };
+
+    bool parseHeader();
+    bool parseExtended();
+    bool endEntry();
+    bool fail(TarError error);
+
+    EntryHandler _onEntry;                         ///< Receiver of the entries.
+    DataHandler _onData;                           ///< Receiver of the content of the files.
+    EntryHandler _onEnd;                           ///< Receiver of the end of the files.
+
+    uint8_t _header[TAR_BLOCK_SIZE];               ///< Header block being received.
+    size_t _headerLength = 0;                      ///< Bytes of _header received.
+    TarEntry _entry;                               ///< Current entry.
+    uint32_t _remaining = 0;                       ///< Bytes left in the content or padding of the entry.
+    bool _skipping = false;                        ///< The content of the entry is not handed to onData.
+    char _extendedType = 0;                        ///< Type of the extended header being received ('L' or 'x'), 0 if none.
+    uint8_t _extended[TAR_BLOCK_SIZE];             ///< Content of the extended header.
+    char _longName[TAR_NAME_SIZE] = "";            ///< Name of the next entry, from an extended header; empty if none.
+    uint8_t _zeroBlocks = 0;                       ///< Consecutive zero blocks received.
+    uint32_t _files = 0;                           ///< Files received.
+    uint32_t _directories = 0;                     ///< Directories received.
+    uint32_t _skipped = 0;                         ///< Entries skipped.
+    uint32_t _input = 0;                           ///< Archive bytes received.
+
+    State _state = STATE_HEADER;                   ///< Position in the archive.
+    TarError _error = TAR_OK;                      ///< Error that stopped the archive.
+};
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file Scheduler.cpp
+ * @brief Implementation of the Scheduler class.
+ */
+#include "Scheduler/Scheduler.h"
+#include <limits.h>
+
+Scheduler::Scheduler(Logger* logger) : _logger(logger) {}
+
+int8_t Scheduler::addTask(const char* name, std::function<void()> callback, unsigned long interval, uint8_t priority, uint32_t budget) {
+    return add(name, callback, interval, priority, budget, true);
+}
+
+int8_t Scheduler::addEventTask(const char* name, std::function<void()> callback, uint8_t priority, uint32_t budget) {
+    return add(name, callback, 0, priority, budget, false);
+}
+
+int8_t Scheduler::add(const char* name, std::function<void()> callback, unsigned long interval, uint8_t priority, uint32_t budget, bool periodic) {
+    if (_count >= SCHEDULER_MAX_TASKS || !callback) {
+        _logger.logf("Scheduler: task '%s' not registered.\n", name);
+        return -1;
+    }
+    Task& task = _tasks[_count];
+    task.name = name;
+    task.callback = callback;
+    task.interval = interval;
+    task.lastRun = millis() - interval; // Due on the first pass
+    task.budget = budget;
+    task.priority = priority;
+    task.periodic = periodic;
+    task.enabled = true;
+    task.notified = false;
+    task.stats = SchedulerTaskStats();
+    return _count++;
+}
+
+void Scheduler::notify(int8_t id) {
+    if (id >= 0 && id < _count) {
+        _tasks[id].notified = true;
+    }
+}
+
+void Scheduler::setInterval(int8_t id, unsigned long value) {
+    if (id >= 0 && id < _count) {
+        _tasks[id].interval = value;
+    }
+}
+
+void Scheduler::setEnabled(int8_t id, bool value) {
+    if (id >= 0 && id < _count) {
+        _tasks[id].enabled = value;
+    }
+}
+
+/**
+ * @brief Runs every task due at the start of the pass once, the highest priority first and, 
+ * among equal priorities, the most overdue first. A task running on every pass (interval 0) 
+ * thus delays the others by at most its own runtime, and cannot starve them.
+ */
+void Scheduler::loop() {
+    unsigned long now = millis();
+    uint8_t due[SCHEDULER_MAX_TASKS];
+    unsigned long lateness[SCHEDULER_MAX_TASKS];
+    uint8_t dueCount = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        Task& task = _tasks[i];
+        if (!task.enabled) {
+            continue;
+        }
+        unsigned long elapsed = now - task.lastRun;
+        if (!task.notified && !(task.periodic && elapsed >= task.interval)) {
+            continue;
+        }
+        unsigned long late = task.notified ? ULONG_MAX : elapsed - task.interval;
+        uint8_t position = dueCount++; // Insertion in run order
+        while (position > 0) {
+            const Task& previous = _tasks[due[position - 1]];
+            if (previous.priority > task.priority || (previous.priority == task.priority && lateness[position - 1] >= late)) {
+                break;
+            }
+            due[position] = due[position - 1];
+            lateness[position] = lateness[position - 1];
+            position--;
+        }
+        due[position] = i;
+        lateness[position] = late;
+    }
+
+    for (uint8_t i = 0; i < dueCount; i++) {
+        if (_tasks[due[i]].enabled) { // Not suspended by a task run before it
+            run(_tasks[due[i]], now);
+        }
+    }
+    if (dueCount == 0) {
+        idle(now);
+    }
+
+    if (_statsInterval > 0 && now - _lastStats >= _statsInterval) {
+        _lastStats = now;
+        logStats();
+    }
+}
+
+void Scheduler::run(Task& task, unsigned long now) {
+    task.notified = false;
+    task.lastRun = now;
+    uint32_t start = micros();
+    task.callback();
+    uint32_t elapsed = micros() - start;
+
+    task.stats.runs++;
+    task.stats.totalMicros += elapsed;
+    if (elapsed > task.stats.maxMicros) task.stats.maxMicros = elapsed;
+    if (task.budget > 0 && elapsed > task.budget) task.stats.overruns++;
+}
+
+/**
+ * @brief Yields, or sleeps until the next periodic task is due, within the maximum idle delay.
+ */
+void Scheduler::idle(unsigned long now) {
+    unsigned long wait = 0;
+    if (_idleMode == SCHEDULER_IDLE_DELAY) {
+        wait = _maxIdle;
+        for (uint8_t i = 0; i < _count; i++) {
+            const Task& task = _tasks[i];
+            if (task.enabled && task.periodic) {
+                unsigned long remaining = task.interval - (now - task.lastRun); // Not due, so elapsed < interval
+                if (remaining < wait) wait = remaining;
+            }
+        }
+    }
+    uint32_t start = micros();
+    delay(wait);
+    _idleMicros += micros() - start;
+}
+
+void Scheduler::logStats() {
+    if (!_logger.enabled()) {
+        return;
+    }
+    for (uint8_t i = 0; i < _count; i++) {
+        const Task& task = _tasks[i];
+        unsigned long average = task.stats.runs > 0 ? (unsigned long)(task.stats.totalMicros / task.stats.runs) : 0;
+        _logger.logf("Task %-12s runs %lu, avg %lu us, max %lu us, overruns %lu\n", task.name,
+            (unsigned long)task.stats.runs, average, (unsigned long)task.stats.maxMicros, (unsigned long)task.stats.overruns);
+    }
+    _logger.logf("Idle %lu ms\n", (unsigned long)(_idleMicros / 1000));
+}
+
+void Scheduler::resetStats() {
+    for (uint8_t i = 0; i < _count; i++) {
+        _tasks[i].stats = SchedulerTaskStats();
+    }
+    _idleMicros = 0;
+}
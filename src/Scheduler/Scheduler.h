@@ -0,0 +1,145 @@
+/**
+ * @file Scheduler.h
+ * @brief Cooperative scheduler of the periodic and event-driven tasks of the application.
+ * 
+ * Components register their loop() as tasks with their own interval, priority and time 
+ * budget, instead of being called on every pass of the main loop. Each call to 
+ * Scheduler::loop() runs every due task once, by priority; when no task is due, the 
+ * remaining time is handed to the system, which can then sleep.
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include <functional>
+#include "Logger/LogSink.h"
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 12   ///< Number of task slots.
+#endif
+
+/**
+ * @brief Priority of a task: within a pass, the due tasks of higher priority run first.
+ */
+enum SchedulerPriority : uint8_t {
+    SCHEDULER_PRIORITY_LOW = 0,     ///< Housekeeping, statistics.
+    SCHEDULER_PRIORITY_NORMAL = 1,  ///< Most component loops.
+    SCHEDULER_PRIORITY_HIGH = 2     ///< Latency-sensitive work, e.g. serving HTTP requests.
+};
+
+/**
+ * @brief What the scheduler does when no task is due.
+ */
+enum SchedulerIdleMode : uint8_t {
+    SCHEDULER_IDLE_YIELD,  ///< delay(0): yields to the system and returns at once.
+    SCHEDULER_IDLE_DELAY   ///< delay() until the next task is due, so the modem (or light) sleep of the SDK can engage.
+};
+
+/**
+ * @brief Runtime metrics of a task.
+ */
+struct SchedulerTaskStats {
+    uint32_t runs = 0;          ///< Number of runs.
+    uint32_t overruns = 0;      ///< Runs that exceeded the budget of the task.
+    uint64_t totalMicros = 0;   ///< Total runtime, in µs.
+    uint32_t maxMicros = 0;     ///< Longest run, in µs.
+};
+
+class Scheduler {
+public:
+    /**
+     * @brief Constructs a Scheduler object.
+     * 
+     * @param logger Pointer to the Logger instance, used by logStats().
+     */
+    Scheduler(Logger* logger = nullptr);
+
+    /**
+     * @brief Registers a periodic task.
+     * 
+     * @param name Name of the task, for the statistics (not copied).
+     * @param callback Work of the task, e.g. `[&]() { mqtt.loop(); }`.
+     * @param interval Minimum time between two runs in ms; 0 runs the task on every pass.
+     * @param priority SchedulerPriority.
+     * @param budget Expected maximum runtime in µs; longer runs are counted as overruns. 0 disables the check.
+     * @return The task identifier, or -1 if all the slots are taken.
+     */
+    int8_t addTask(const char* name, std::function<void()> callback, unsigned long interval, uint8_t priority = SCHEDULER_PRIORITY_NORMAL, uint32_t budget = 0);
+
+    /**
+     * @brief Registers a task that only runs when notified.
+     * 
+     * @see addTask() for the parameters.
+     * @return The task identifier, or -1 if all the slots are taken.
+     */
+    int8_t addEventTask(const char* name, std::function<void()> callback, uint8_t priority = SCHEDULER_PRIORITY_NORMAL, uint32_t budget = 0);
+
+    /**
+     * @brief Makes a task due on the next pass, whatever its interval.
+     * 
+     * Only sets a flag, so it can be called from a callback or an interrupt handler.
+     * 
+     * @param id Task identifier.
+     */
+    void notify(int8_t id);
+
+    /**
+     * @brief Runs every due task once, the highest priority first, or idles when none is due.
+     * 
+     * To be called from the sketch's loop(), instead of the loop() of each component.
+     */
+    void loop();
+
+    void setInterval(int8_t id, unsigned long value);                   ///< Changes the interval of a task, in ms.
+    void setEnabled(int8_t id, bool value);                             ///< Suspends or resumes a task.
+    void setIdleMode(SchedulerIdleMode value){ _idleMode = value; }     ///< Idle behavior (default: SCHEDULER_IDLE_YIELD).
+    void setMaxIdle(unsigned long value){ _maxIdle = value; }           ///< Longest idle delay in ms, bounds the latency of notify() (default: 10).
+    void setStatsInterval(unsigned long value){ _statsInterval = value; } ///< Interval of logStats() in ms, 0 disables it (default: 0).
+
+    /**
+     * @brief Logs the runtime metrics of every task through the logger.
+     */
+    void logStats();
+
+    /**
+     * @brief Resets the runtime metrics of every task.
+     */
+    void resetStats();
+
+    size_t size() const { return _count; }                                               ///< Number of registered tasks.
+    const char* getName(int8_t id) const { return _tasks[id].name; }                     ///< Name of a task.
+    const SchedulerTaskStats& getStats(int8_t id) const { return _tasks[id].stats; }     ///< Runtime metrics of a task.
+    uint64_t getIdleMicros() const { return _idleMicros; }                               ///< Time spent idle, in µs.
+
+private:
+    /**
+     * @brief A registered task.
+     */
+    struct Task {
+        const char* name;                ///< Name of the task.
+        std::function<void()> callback;  ///< Work of the task.
+        unsigned long interval;          ///< Minimum time between two runs, in ms.
+        unsigned long lastRun;           ///< millis() of the last run.
+        uint32_t budget;                 ///< Expected maximum runtime, in µs.
+        uint8_t priority;                ///< SchedulerPriority.
+        bool periodic;                   ///< Runs on its interval, not only when notified.
+        bool enabled;                    ///< Considered by the scheduler.
+        volatile bool notified;          ///< Due on the next pass.
+        SchedulerTaskStats stats;        ///< Runtime metrics.
+    };
+
+    int8_t add(const char* name, std::function<void()> callback, unsigned long interval, uint8_t priority, uint32_t budget, bool periodic);
+    void run(Task& task, unsigned long now);
+    void idle(unsigned long now);
+
+    ComponentLogger _logger;                 ///< Logger instance.
+    Task _tasks[SCHEDULER_MAX_TASKS];        ///< Task slots.
+    uint8_t _count = 0;                      ///< Number of registered tasks.
+    SchedulerIdleMode _idleMode = SCHEDULER_IDLE_YIELD; ///< Idle behavior.
+    unsigned long _maxIdle = 10;             ///< Longest idle delay, in ms.
+    unsigned long _statsInterval = 0;        ///< Interval of logStats(), in ms.
+    unsigned long _lastStats = 0;            ///< millis() of the last logStats().
+    uint64_t _idleMicros = 0;                ///< Time spent idle, in µs.
+};
+
+#endif
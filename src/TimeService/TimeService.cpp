@@ -0,0 +1,136 @@
+/**
+ * @file TimeService.cpp
+ * @brief Implementation of the TimeService class.
+ */
+#include "TimeService/TimeService.h"
+#include <ESP8266WiFi.h>  // WiFi.hostByName()
+#include <coredecls.h>  // settimeofday_cb()
+#include <limits.h>
+
+#define NTP_PORT 123
+#define NTP_PACKET_SIZE 48
+#define NTP_PROBE_TIMEOUT 2000000ULL   // µs
+#define NTP_UNIX_EPOCH_DELTA 2208988800ULL // Seconds from 1900-01-01 to 1970-01-01
+
+bool TimeService::_synced = false;
+uint64_t TimeService::_epochOffset = 0;
+
+TimeService::TimeService(Logger* logger) : _logger(logger) {}
+
+void TimeService::begin() {
+    settimeofday_cb([this]() { onTimeSet(); });
+}
+
+void TimeService::loop() {
+    if (_probePending) {
+        receiveProbe();
+    } else if (_synced && _probeInterval > 0 && (_probeNeeded || millis() - _lastProbe >= _probeInterval)) {
+        sendProbe();
+    }
+}
+
+void TimeService::onTimeSet() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    uint64_t monotonic = monotonicMicros();
+    uint64_t epoch = (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+
+    if (_synced) {
+        // Compare the clock we derived from the monotonic one with the freshly synchronized time
+        _lastCorrection = (int64_t)(epoch - (monotonic + _epochOffset));
+        uint64_t elapsed = monotonic - _lastSyncMonotonic;
+        if (elapsed > 0) {
+            _drift = (float)((double)_lastCorrection * 1e6 / (double)elapsed);
+        }
+    }
+    _epochOffset = epoch - monotonic;
+    _lastSyncMonotonic = monotonic;
+    _lastSyncTime = tv.tv_sec;
+    _syncCount++;
+    _synced = true;
+
+    _logger.logf("Time synchronized (#%u), correction %lld us, drift %.1f ppm.\n", _syncCount, (long long)_lastCorrection, _drift);
+}
+
+TimeSyncState TimeService::getState() const {
+    if (!_synced) {
+        return TIME_NOT_SYNCED;
+    }
+    return getLastSyncAge() > _staleTimeout ? TIME_STALE : TIME_SYNCED;
+}
+
+unsigned long TimeService::getLastSyncAge() const {
+    return _synced ? (unsigned long)((monotonicMicros() - _lastSyncMonotonic) / 1000) : ULONG_MAX;
+}
+
+/**
+ * @brief Converts a 64-bit NTP timestamp (seconds since 1900, 32-bit fraction) to Unix microseconds.
+ */
+static uint64_t ntpToEpochMicros(const uint8_t* data) {
+    uint32_t seconds = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+    uint32_t fraction = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 8) | data[7];
+    return (uint64_t)(seconds - NTP_UNIX_EPOCH_DELTA) * 1000000ULL + (((uint64_t)fraction * 1000000ULL) >> 32);
+}
+
+void TimeService::sendProbe() {
+    uint8_t packet[NTP_PACKET_SIZE] = { 0 };
+    packet[0] = 0x23; // LI = 0, version = 4, mode = 3 (client)
+
+    _lastProbe = millis();
+    _probeNeeded = false;
+    if (!resolveServer()) {
+        _logger.logf("NTP probe: cannot resolve %s.\n", _timeServer);
+        return;
+    }
+    _udp.begin(0); // Any local port
+    if (!_udp.beginPacket(_serverIP, NTP_PORT)) {
+        _udp.stop();
+        return;
+    }
+    _udp.write(packet, sizeof(packet));
+    _probeSent = monotonicMicros();
+    if (!_udp.endPacket()) {
+        _udp.stop();
+        return;
+    }
+    _probePending = true;
+}
+
+bool TimeService::resolveServer() {
+    if (_serverResolved) {
+        return true;
+    }
+    if (!_serverIP.fromString(_timeServer) && !WiFi.hostByName(_timeServer, _serverIP)) {
+        return false;
+    }
+    _serverResolved = true;
+    return true;
+}
+
+void TimeService::receiveProbe() {
+    uint64_t now = monotonicMicros();
+    if (_udp.parsePacket() < NTP_PACKET_SIZE) {
+        if (now - _probeSent > NTP_PROBE_TIMEOUT) {
+            _logger.log("NTP probe timed out.\n");
+            _probePending = false;
+            _serverResolved = false; // The server may have moved (pool rotation), resolve again on the next probe
+            _udp.stop();
+        }
+        return;
+    }
+
+    uint8_t packet[NTP_PACKET_SIZE];
+    _udp.read(packet, sizeof(packet));
+    _probePending = false;
+    _udp.stop();
+
+    // t1/t4: local send/receive times, t2/t3: server receive/transmit times
+    int64_t t1 = (int64_t)(_probeSent + _epochOffset);
+    int64_t t4 = (int64_t)(now + _epochOffset);
+    int64_t t2 = (int64_t)ntpToEpochMicros(packet + 32);
+    int64_t t3 = (int64_t)ntpToEpochMicros(packet + 40);
+    _rtt = (int32_t)((t4 - t1) - (t3 - t2));
+    _offset = ((t2 - t1) + (t3 - t4)) / 2;
+
+    _logger.logf("NTP probe: RTT %ld us, offset %lld us.\n", (long)_rtt, (long long)_offset);
+}
@@ -0,0 +1,125 @@
+/**
+ * @file TimeService.h
+ * @brief NTP synchronization status, drift tracking and a cheap monotonic clock.
+ * 
+ * The time itself is synchronized by the core's SNTP client (configTime(), called by 
+ * WiFiManager::begin()). This class observes the synchronizations, measures the drift of 
+ * the local clock between them, probes the round-trip time and offset against the time 
+ * server, and provides 64-bit microsecond clocks that never need getLocalTime().
+ */
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "Logger/LogSink.h"
+
+/**
+ * @brief Synchronization state of the system clock.
+ */
+enum TimeSyncState {
+    TIME_NOT_SYNCED,  ///< The clock has never been synchronized since boot.
+    TIME_SYNCED,      ///< The clock was synchronized recently.
+    TIME_STALE        ///< The last synchronization is older than the stale timeout.
+};
+
+class TimeService {
+public:
+    /**
+     * @brief Constructs a TimeService object.
+     * 
+     * @param logger Pointer to the Logger instance.
+     */
+    TimeService(Logger* logger = nullptr);
+
+    /**
+     * @brief Starts observing the SNTP synchronizations.
+     */
+    void begin();
+
+    /**
+     * @brief Sends and collects the round-trip probes, without blocking.
+     */
+    void loop();
+
+    void setTimeServer(const char* value){ _timeServer = value; _serverResolved = false; } ///< Server to probe, default = pool.ntp.org.
+    void setProbeInterval(unsigned long value){ _probeInterval = value; }   ///< Interval of the RTT probes in ms, 0 disables them (default: 3600000).
+    void setStaleTimeout(unsigned long value){ _staleTimeout = value; }     ///< Age after which a synchronization is stale, in ms (default: 3 hours).
+
+    /**
+     * @brief Microseconds since boot, 64-bit and monotonic, unaffected by the millis()/micros() rollover.
+     */
+    static uint64_t monotonicMicros() { return micros64(); }
+
+    /**
+     * @brief Microseconds since the Unix epoch, derived from the monotonic clock.
+     * 
+     * Costs an addition, no system call and no getLocalTime(). The clock is global, as is 
+     * the system clock, so no reference to the instance is needed.
+     * 
+     * @return The current time, or 0 if the clock was never synchronized.
+     */
+    static uint64_t epochMicros() { return _synced ? monotonicMicros() + _epochOffset : 0; }
+
+    /**
+     * @brief Tells whether the clock was synchronized at least once since boot.
+     */
+    static bool isSynced() { return _synced; }
+
+    TimeSyncState getState() const;
+    uint32_t getSyncCount() const { return _syncCount; }                 ///< Number of synchronizations since boot.
+    time_t getLastSyncTime() const { return _lastSyncTime; }             ///< Unix time of the last synchronization.
+    unsigned long getLastSyncAge() const;                                ///< Time since the last synchronization in ms, ULONG_MAX if never.
+    int64_t getLastCorrection() const { return _lastCorrection; }        ///< Step applied to the clock at the last synchronization, in µs.
+    float getDrift() const { return _drift; }                            ///< Measured drift of the local clock, in ppm (positive: local clock slow).
+    int32_t getRoundTripTime() const { return _rtt; }                    ///< Round-trip time of the last probe in µs, -1 if none succeeded.
+    int64_t getOffset() const { return _offset; }                        ///< Offset of the server clock relative to the local one at the last probe, in µs.
+
+private:
+    /**
+     * @brief Records a synchronization of the system clock; called by the SNTP client.
+     */
+    void onTimeSet();
+
+    /**
+     * @brief Sends an SNTP request used to measure the round-trip time and the offset.
+     */
+    void sendProbe();
+
+    /**
+     * @brief Collects the answer to the pending probe, if any.
+     */
+    void receiveProbe();
+
+    /**
+     * @brief Resolves the time server once and reuses the address, so probes do not repeat the DNS lookup.
+     */
+    bool resolveServer();
+
+    ComponentLogger _logger;                ///< Logger.
+    WiFiUDP _udp;                           ///< Socket of the RTT probes.
+
+    const char* _timeServer = "pool.ntp.org"; ///< Server to probe.
+    IPAddress _serverIP;                    ///< Cached address of the time server.
+    bool _serverResolved = false;           ///< _serverIP holds the address of _timeServer.
+    unsigned long _probeInterval = 3600000; ///< Interval of the RTT probes, in ms.
+    unsigned long _staleTimeout = 10800000; ///< Age after which a synchronization is stale, in ms.
+
+    static bool _synced;                    ///< The clock was synchronized at least once.
+    static uint64_t _epochOffset;           ///< Epoch microseconds minus monotonic microseconds.
+
+    uint32_t _syncCount = 0;                ///< Number of synchronizations.
+    time_t _lastSyncTime = 0;               ///< Unix time of the last synchronization.
+    uint64_t _lastSyncMonotonic = 0;        ///< Monotonic time of the last synchronization, in µs.
+    int64_t _lastCorrection = 0;            ///< Step applied at the last synchronization, in µs.
+    float _drift = 0;                       ///< Measured drift, in ppm.
+
+    bool _probePending = false;             ///< A probe was sent and its answer is awaited.
+    bool _probeNeeded = true;               ///< A probe is due as soon as the clock is synchronized.
+    uint64_t _probeSent = 0;                ///< Monotonic time the pending probe was sent, in µs.
+    unsigned long _lastProbe = 0;           ///< millis() of the last probe.
+    int32_t _rtt = -1;                      ///< Round-trip time of the last probe, in µs.
+    int64_t _offset = 0;                    ///< Server minus local clock at the last probe, in µs.
+};
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file NetworkSelector.cpp
+ * @brief Implementation of the NetworkSelector class.
+ */
+#include "WiFiManager/NetworkSelector.h"
+#include <string.h>
+
+bool NetworkSelector::addNetwork(const char* ssid, const char* password, int priority) {
+    if (ssid == nullptr || ssid[0] == '\0') {
+        return false;
+    }
+    WiFiCredentials* entry = const_cast<WiFiCredentials*>(find(ssid));
+    if (entry == nullptr) {
+        if (_count >= WIFI_MANAGER_MAX_NETWORKS) {
+            return false;
+        }
+        entry = &_networks[_count++];
+    }
+    entry->ssid = ssid;
+    entry->password = password != nullptr ? password : "";
+    entry->priority = priority;
+    return true;
+}
+
+const WiFiCredentials* NetworkSelector::find(const char* ssid) const {
+    for (size_t i = 0; i < _count; i++) {
+        if (strcmp(_networks[i].ssid, ssid) == 0) {
+            return &_networks[i];
+        }
+    }
+    return nullptr;
+}
+
+size_t NetworkSelector::rank(const ScannedNetwork* networks, size_t count, NetworkCandidate* candidates, size_t maxCandidates) const {
+    size_t seen = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < _count; i++) {
+        const WiFiCredentials& credentials = _networks[i];
+        const ScannedNetwork* network = nullptr;
+        for (size_t j = 0; j < count; j++) {
+            if (strcmp(networks[j].ssid, credentials.ssid) == 0) {
+                network = &networks[j];
+                break;
+            }
+        }
+
+        NetworkCandidate candidate = { &credentials, network, network != nullptr ? score(credentials, network->rssi) : credentials.priority };
+
+        // Insertion sort: seen networks by score in [0, seen), unseen by priority in [seen, total)
+        size_t begin = network != nullptr ? 0 : seen;
+        size_t end = network != nullptr ? seen : total;
+        size_t pos = begin;
+        while (pos < end && candidates[pos].score >= candidate.score) pos++;
+        if (pos >= maxCandidates) continue;
+
+        size_t last = total < maxCandidates ? total : maxCandidates - 1;
+        memmove(&candidates[pos + 1], &candidates[pos], (last - pos) * sizeof(NetworkCandidate));
+        candidates[pos] = candidate;
+        if (total < maxCandidates) total++;
+        if (network != nullptr && seen < maxCandidates) seen++;
+    }
+    return total;
+}
+
+bool NetworkSelector::isSignalWeak(int rssi, unsigned long now) {
+    if (rssi >= _roamThreshold) {
+        _weak = false;
+        return false;
+    }
+    if (!_weak) {
+        _weak = true;
+        _weakSince = now;
+    }
+    return now - _weakSince >= _roamDelay;
+}
+
+bool NetworkSelector::findRoamTarget(const char* currentSsid, const uint8_t* currentBssid, int currentRssi, 
+                                     const ScannedNetwork* networks, size_t count, NetworkCandidate& target) const {
+    const WiFiCredentials* current = find(currentSsid);
+    int currentScore = current != nullptr ? score(*current, currentRssi) : currentRssi;
+
+    NetworkCandidate candidates[WIFI_MANAGER_MAX_NETWORKS];
+    size_t n = rank(networks, count, candidates, WIFI_MANAGER_MAX_NETWORKS);
+    for (size_t i = 0; i < n && candidates[i].network != nullptr; i++) {
+        if (memcmp(candidates[i].network->bssid, currentBssid, sizeof(candidates[i].network->bssid)) == 0) {
+            continue; // Already associated with this access point
+        }
+        if (candidates[i].score >= currentScore + _roamHysteresis) {
+            target = candidates[i];
+            return true;
+        }
+        return false; // Candidates are sorted, no other one can do better
+    }
+    return false;
+}
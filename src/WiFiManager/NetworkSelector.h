@@ -0,0 +1,148 @@
+/**
+ * @file NetworkSelector.h
+ * @brief Selection of the Wi-Fi network to connect or roam to.
+ * 
+ * Ranks the configured credentials against the networks seen in the last scan and 
+ * decides when a sustained weak signal justifies roaming. The class has no Arduino 
+ * dependencies and receives time as a parameter, so it can be driven by a simulated 
+ * radio environment off-device.
+ */
+#ifndef NETWORK_SELECTOR_H
+#define NETWORK_SELECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef WIFI_MANAGER_MAX_NETWORKS
+#define WIFI_MANAGER_MAX_NETWORKS 8   ///< Maximum number of configured networks.
+#endif
+
+/**
+ * @brief A network seen during the last scan.
+ */
+struct ScannedNetwork {
+    char ssid[33];       ///< Network SSID, null-terminated.
+    uint8_t bssid[6];    ///< BSSID of the strongest access point of this network.
+    int8_t rssi;         ///< Signal strength in dBm.
+    uint8_t channel;     ///< Wi-Fi channel.
+    uint8_t encryption;  ///< Encryption type, as returned by WiFi.encryptionType().
+};
+
+/**
+ * @brief Credentials of a configured network.
+ */
+struct WiFiCredentials {
+    const char* ssid;    ///< Network SSID.
+    const char* password;///< Network password.
+    int priority;        ///< Higher values are preferred.
+};
+
+/**
+ * @brief A configured network, ranked for connection.
+ */
+struct NetworkCandidate {
+    const WiFiCredentials* credentials; ///< Credentials to connect with.
+    const ScannedNetwork* network;      ///< Scan entry, or nullptr if the network was not seen.
+    int score;                          ///< Score, higher is better.
+};
+
+class NetworkSelector {
+public:
+    /**
+     * @brief Adds a network to the credential list.
+     * 
+     * A network with an SSID already in the list replaces the existing entry.
+     * 
+     * @param ssid Network SSID. The pointer is stored, the string must outlive the selector.
+     * @param password Network password. The pointer is stored as well.
+     * @param priority Higher values are preferred.
+     * @return False if the list is full or the SSID is empty.
+     */
+    bool addNetwork(const char* ssid, const char* password, int priority = 0);
+
+    /**
+     * @brief Removes all networks from the credential list.
+     */
+    void clear() { _count = 0; }
+
+    /**
+     * @brief Returns the number of configured networks.
+     */
+    size_t size() const { return _count; }
+
+    /**
+     * @brief Finds the credentials of a network.
+     * 
+     * @param ssid Network SSID.
+     * @return The credentials, or nullptr if the network is not configured.
+     */
+    const WiFiCredentials* find(const char* ssid) const;
+
+    /**
+     * @brief Scores a configured network at a given signal strength.
+     * 
+     * @return rssi + priority * priority weight.
+     */
+    int score(const WiFiCredentials& credentials, int rssi) const { return rssi + credentials.priority * _priorityWeight; }
+
+    /**
+     * @brief Ranks the configured networks for a connection attempt.
+     * 
+     * Networks seen in the scan come first, by descending score. Configured networks that 
+     * were not seen (hidden, or the scan is stale) follow by descending priority.
+     * 
+     * @param networks Networks seen during the last scan.
+     * @param count Number of scanned networks.
+     * @param candidates Output array.
+     * @param maxCandidates Capacity of the output array.
+     * @return Number of candidates written.
+     */
+    size_t rank(const ScannedNetwork* networks, size_t count, NetworkCandidate* candidates, size_t maxCandidates) const;
+
+    /**
+     * @brief Tracks the signal of the current connection.
+     * 
+     * @param rssi Current signal strength in dBm.
+     * @param now Current time in milliseconds.
+     * @return True once the signal has stayed below the roaming threshold for the roaming delay.
+     */
+    bool isSignalWeak(int rssi, unsigned long now);
+
+    /**
+     * @brief Restarts the weak signal tracking, e.g. after a (re)connection.
+     */
+    void resetSignal() { _weakSince = 0; _weak = false; }
+
+    /**
+     * @brief Picks a network to roam to.
+     * 
+     * @param currentSsid SSID of the current connection.
+     * @param currentBssid BSSID of the current access point.
+     * @param currentRssi Signal strength of the current connection.
+     * @param networks Networks seen during the last scan.
+     * @param count Number of scanned networks.
+     * @param target Receives the best candidate.
+     * @return True if a different access point scores better than the current one by the hysteresis.
+     */
+    bool findRoamTarget(const char* currentSsid, const uint8_t* currentBssid, int currentRssi, 
+                        const ScannedNetwork* networks, size_t count, NetworkCandidate& target) const;
+
+    void setPriorityWeight(int value){ _priorityWeight = value; }
+    void setRoamThreshold(int value){ _roamThreshold = value; }
+    void setRoamDelay(unsigned long value){ _roamDelay = value; }
+    void setRoamHysteresis(int value){ _roamHysteresis = value; }
+
+private:
+    WiFiCredentials _networks[WIFI_MANAGER_MAX_NETWORKS]; ///< Configured networks.
+    size_t _count = 0;                 ///< Number of configured networks.
+
+    int _priorityWeight = 10;          ///< Score bonus per priority level, in dB.
+    int _roamThreshold = -75;          ///< RSSI below which the signal is considered weak, in dBm.
+    unsigned long _roamDelay = 30000;  ///< How long the signal must stay weak before roaming, in ms.
+    int _roamHysteresis = 8;           ///< Minimum score gain to roam, in dB.
+
+    bool _weak = false;                ///< The signal is currently below the threshold.
+    unsigned long _weakSince = 0;      ///< Time the signal dropped below the threshold.
+};
+
+#endif
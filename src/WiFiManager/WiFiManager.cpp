@@ -1,5 +1,7 @@
 
 #include "WiFiManager/WiFiManager.h"
+#include "HeapProfiler/HeapProfiler.h"
+#include <limits.h>
 
 WiFiManager::WiFiManager(HTTPServerManager& serverManager, Logger* logger) 
 : _serverManager(serverManager), 
@@ -14,28 +16,41 @@ void WiFiManager::begin() {
   // configTime() is core ESP8266-specific function
   configTime(_timeZone, _timeServer); 
 
+  // Credentials are supplied on every boot, so do not rewrite them to flash on each WiFi.begin()
+  WiFi.persistent(false);
+
   if(!firstConnectToAP()) { // switch mode 
     _operationMode=SETTINGS;;   
   }
   else { // Connected to WIFI, do DateTime 
     _operationMode=NORMAL;
-    //if (_logger != nullptr) _logger->logf("Date Now is %s\n", Logger::timeToString().c_str());
+    //_logger.logf("Date Now is %s\n", Logger::timeToString().c_str());
   }
 
   registerEndpoints();
 }
 
 void WiFiManager::loop(){
+  pollScan();
+
   unsigned long currentTime = millis();
-  if(_operationMode==SETTINGS && currentTime - _lastTime > 60000) {
+  if(_operationMode==SETTINGS && !_retryPending && currentTime - _lastTime > _retryInterval) {
     _lastTime = currentTime;
+    _retryPending = true;
+    startScan(); // Rank the configured networks by what is around before retrying
+  }
+  if(_operationMode==SETTINGS && _retryPending && !_scanRunning) {
+    _retryPending = false;
     if(reConnecToAP()){
       reboot();
     }
   }
   if(_operationMode==NORMAL && !reConnecToAP()) { // switch mode
     _operationMode=SETTINGS;
-    reportStep(-4);// errorLED.setMode(BLINK); 
+    emit(EVENT_WIFI_LOST);
+  }
+  if(_operationMode==NORMAL && _roaming) {
+    checkRoaming();
   }
   if(_operationMode==SETTINGS){
     createAP();
@@ -51,7 +66,7 @@ bool WiFiManager::firstConnectToAP() {
 
 bool WiFiManager::reConnecToAP() {
   if (WiFi.status() != WL_CONNECTED) {  // Check if Wi-Fi is disconnected
-    if (_logger != nullptr) _logger->log("WiFi disconnected.\n");
+    _logger.log("WiFi disconnected.\n");
     
     WiFi.disconnect();  // Ensure a clean start for reconnection
     return this->connectToAP();
@@ -60,77 +75,342 @@ bool WiFiManager::reConnecToAP() {
 }
 
 bool WiFiManager::connectToAP() {
-    if (strlen(_SSID) == 0 || strlen(_password) == 0) {
-        if (_logger != nullptr) _logger->log("WiFi credentials are missing.\n");
-        reportStep(-1);
+    if (strlen(_SSID) > 0 && _networks.find(_SSID) == nullptr) {
+        _networks.addNetwork(_SSID, _password);
+    }
+
+    // An old scan may name an access point that has moved to another channel or gone away: 
+    // rank by priority only, and let the SDK find the access point by SSID
+    size_t scanCount = getScanAge() <= WIFI_MANAGER_SCAN_MAX_AGE ? _scanCount : 0;
+    NetworkCandidate candidates[WIFI_MANAGER_MAX_NETWORKS];
+    size_t count = _networks.rank(_scanResults, scanCount, candidates, WIFI_MANAGER_MAX_NETWORKS);
+    if (count == 0) {
+        _logger.log("WiFi credentials are missing.\n");
+        emit(EVENT_WIFI_NO_CREDENTIALS);
+        return false;
+    }
+
+    emit(EVENT_WIFI_CONNECTING);
+    for (size_t i = 0; i < count; i++) {
+        if (connectToNetwork(candidates[i])) {
+            return true;
+        }
+    }
+    _logger.log("Failed to connect to WiFi.\n");
+    emit(EVENT_WIFI_CONNECT_FAILED);
+    return false;
+}
+
+bool WiFiManager::connectToNetwork(const NetworkCandidate& candidate) {
+    const WiFiCredentials& credentials = *candidate.credentials;
+    _logger.log("Connecting to WiFi.\n");
+    _logger.logf("SSID: %s\n", credentials.ssid);
+
+    unsigned long startTime = millis();
+    _lastConnectFast = _fastConnect && fastConnectToAP(credentials, candidate.network);
+    if (!_lastConnectFast && !fullConnectToAP(credentials, candidate.network)) {
         return false;
     }
+    _lastConnectDuration = millis() - startTime;
+    _networks.resetSignal();
+    emit(EVENT_WIFI_CONNECTED, _lastConnectDuration);
+    saveConnectionCache(credentials.ssid);
+
+    _logger.logf("Connected to WiFi in %lu ms (%s)! IP Address: %s\n", _lastConnectDuration, _lastConnectFast ? "fast" : "full", WiFi.localIP().toString().c_str());
+    return true;
+}
 
-    if (_logger != nullptr) _logger->log("Connecting to WiFi.\n");
-    if (_logger != nullptr) _logger->logf("SSID: %s\n", _SSID);
+bool WiFiManager::fastConnectToAP(const WiFiCredentials& credentials, const ScannedNetwork* network) {
+    if (!loadConnectionCache(credentials.ssid)) {
+        return false;
+    }
+    if (network != nullptr && memcmp(network->bssid, _cache.bssid, sizeof(_cache.bssid)) != 0) {
+        return false; // The scan found a stronger access point than the cached one
+    }
 
-    reportStep(1);
-    WiFi.begin(_SSID, _password);
+    // Skip DHCP by reusing the last lease and skip the channel scan by targeting the known BSSID
+    WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway), IPAddress(_cache.subnet), IPAddress(_cache.dns));
+    WiFi.begin(credentials.ssid, credentials.password, _cache.channel, _cache.bssid);
 
     unsigned long startTime = millis();
     while (WiFi.status() != WL_CONNECTED) {
-        reportStep(2);
-        if (millis() - startTime > 10000) {            
-            if (_logger != nullptr) _logger->log("Failed to connect to WiFi.\n");
-            reportStep(-2);
+        if (millis() - startTime > _fastConnectTimeout) {
+            _logger.log("Fast connect failed, falling back to full scan.\n");
+            clearConnectionCache();
+            WiFi.disconnect();
+            WiFi.config(0U, 0U, 0U); // Re-enable DHCP
             return false;
         }
-        delay(200);
-        reportStep(3);
-        delay(100);
-        if (_logger != nullptr) _logger->log(".");        
+        delay(10);
     }
-    if (_logger != nullptr) _logger->log("\n");
-    reportStep(4); 
+    return true;
+}
 
-    if (_logger != nullptr) _logger->logf("Connected to WiFi! IP Address: %s\n", WiFi.localIP().toString().c_str());
+bool WiFiManager::fullConnectToAP(const WiFiCredentials& credentials, const ScannedNetwork* network) {
+    WiFi.config(0U, 0U, 0U); // Re-enable DHCP: an earlier fast connect left the cached lease as a static address
+    if (network != nullptr) { // Seen in the last scan, target its strongest access point
+        WiFi.begin(credentials.ssid, credentials.password, network->channel, network->bssid);
+    } else {
+        WiFi.begin(credentials.ssid, credentials.password);
+    }
+
+    unsigned long startTime = millis();
+    while (WiFi.status() != WL_CONNECTED) {
+        if (millis() - startTime > 10000) {            
+            _logger.logf("\nFailed to connect to %s.\n", credentials.ssid);
+            WiFi.disconnect();
+            return false;
+        }
+        delay(300);
+        emit(EVENT_WIFI_CONNECT_PROGRESS, millis() - startTime);
+        _logger.log(".");        
+    }
+    _logger.log("\n");
     return true;
 }
 
+void WiFiManager::checkRoaming() {
+    unsigned long now = millis();
+    if (_roamPending) {
+        if (_scanRunning) {
+            return;
+        }
+        _roamPending = false;
+        _networks.resetSignal();
+
+        NetworkCandidate target;
+        String ssid = WiFi.SSID();
+        if (_networks.findRoamTarget(ssid.c_str(), WiFi.BSSID(), WiFi.RSSI(), _scanResults, _scanCount, target)) {
+            _logger.logf("Roaming from %s (%d dBm) to %s (%d dBm).\n", ssid.c_str(), WiFi.RSSI(), target.credentials->ssid, target.network->rssi);
+            emit(EVENT_WIFI_ROAMING, target.network->rssi);
+            WiFi.disconnect();
+            connectToNetwork(target); // On failure the next loop() reconnects to the best available network
+        }
+        return;
+    }
+
+    if (now - _lastSignalCheck < 1000) {
+        return;
+    }
+    _lastSignalCheck = now;
+    if (_networks.isSignalWeak(WiFi.RSSI(), now)) {
+        _logger.logf("Weak WiFi signal (%d dBm), looking for a better access point.\n", WiFi.RSSI());
+        _roamPending = true;
+        startScan();
+    }
+}
+
+void WiFiManager::addNetwork(const char* ssid, const char* password, int priority) {
+    if (!_networks.addNetwork(ssid, password, priority)) {
+        _logger.logf("Cannot add WiFi network '%s'.\n", ssid != nullptr ? ssid : "");
+    }
+}
+
+/**
+ * Expects an array of objects with fields "ssid", "password" and optional "priority", 
+ * e.g. the "wifi.networks" array of the configuration file. The strings are referenced, 
+ * not copied, so the JSON document must outlive the WiFiManager.
+ */
+void WiFiManager::addNetworks(JsonArrayConst networks) {
+    for (JsonVariantConst network : networks) {
+        addNetwork(network["ssid"] | "", network["password"] | "", network["priority"] | 0);
+    }
+}
+
+/**
+ * @brief Computes a CRC32 (IEEE 802.3, reflected) checksum.
+ */
+static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+    crc = ~crc;
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static const time_t clockSetTime = 1577836800; // 2020-01-01, the clock starts at 1970 until synchronized
+
+static uint32_t cacheChecksum(const WiFiConnectionCache& cache) {
+    return crc32((const uint8_t*)&cache + sizeof(cache.crc), sizeof(cache) - sizeof(cache.crc));
+}
+
+bool WiFiManager::loadConnectionCache(const char* ssid) {
+    if (!ESP.rtcUserMemoryRead(WIFI_MANAGER_RTC_OFFSET, (uint32_t*)&_cache, sizeof(_cache))) {
+        return false;
+    }
+    if (_cache.crc != cacheChecksum(_cache) 
+        || _cache.ssidHash != crc32((const uint8_t*)ssid, strlen(ssid))
+        || _cache.channel == 0
+        || _cache.ip == 0) {
+        return false;
+    }
+
+    // The lease is reused without DHCP: renew it after a number of reuses, or once too old 
+    // if the clock tells its age (it is usually not set yet after a deep sleep)
+    if (_cache.reuses >= WIFI_MANAGER_LEASE_MAX_REUSES) {
+        return false;
+    }
+    time_t now = time(nullptr);
+    return _cache.leasedAt == 0 || now < clockSetTime
+        || (uint32_t)now - _cache.leasedAt < WIFI_MANAGER_LEASE_MAX_AGE;
+}
+
+void WiFiManager::saveConnectionCache(const char* ssid) {
+    if (_lastConnectFast) { // Same lease, not renewed by DHCP: keep its age
+        _cache.reuses++;
+        _cache.crc = cacheChecksum(_cache);
+        ESP.rtcUserMemoryWrite(WIFI_MANAGER_RTC_OFFSET, (uint32_t*)&_cache, sizeof(_cache));
+        return;
+    }
+    memset(&_cache, 0, sizeof(_cache));
+    _cache.ssidHash = crc32((const uint8_t*)ssid, strlen(ssid));
+    memcpy(_cache.bssid, WiFi.BSSID(), sizeof(_cache.bssid));
+    _cache.channel = WiFi.channel();
+    _cache.ip = WiFi.localIP();
+    _cache.gateway = WiFi.gatewayIP();
+    _cache.subnet = WiFi.subnetMask();
+    _cache.dns = WiFi.dnsIP();
+    time_t now = time(nullptr);
+    _cache.leasedAt = now >= clockSetTime ? (uint32_t)now : 0;
+    _cache.crc = cacheChecksum(_cache);
+    ESP.rtcUserMemoryWrite(WIFI_MANAGER_RTC_OFFSET, (uint32_t*)&_cache, sizeof(_cache));
+}
+
+void WiFiManager::clearConnectionCache() {
+    memset(&_cache, 0, sizeof(_cache));
+    ESP.rtcUserMemoryWrite(WIFI_MANAGER_RTC_OFFSET, (uint32_t*)&_cache, sizeof(_cache));
+}
+
 void WiFiManager::createAP() {
   if(!_APstarted){
-    if (_logger != nullptr) _logger->logf("Creating AP with SSID: %s\n", _apSSID);
+    _logger.logf("Creating AP with SSID: %s\n", _apSSID);
 
     _APstarted = WiFi.softAP(_apSSID, _apPassword);
     
-    if (_logger != nullptr) _logger->logf("AP IP Address: : %s\n", WiFi.softAPIP().toString().c_str());
+    _logger.logf("AP IP Address: : %s\n", WiFi.softAPIP().toString().c_str());
   }
 }
 
 void WiFiManager::reboot() {
     // Reboot the ESP8266
-    if (_logger != nullptr) _logger->log("Rebooting...\n");
+    _logger.log("Rebooting...\n");
     ESP.restart();  // This will reset the ESP8266
 }
 
-void WiFiManager::addReportStepHook(std::function<void(int)> func) {
-  _reportStepsHooks.push_back(func);
+void WiFiManager::registerEndpoints() {
+    _serverManager.registerPage("/api/nearby-ap", HTTP_GET, [this](ESP8266WebServer& server) { handleScanAPs(server); });
 }
 
-void WiFiManager::reportStep(int step){
-  for (auto& hook : _reportStepsHooks) {
-    if (hook) {
-        hook(step);
+void WiFiManager::startScan() {
+    if (_scanRunning) {
+        return; // Share the scan in flight
     }
-  }
+    WiFi.scanNetworks(true); // Asynchronous, collected in pollScan()
+    _scanRunning = true;
 }
 
-void WiFiManager::registerEndpoints() {
-    _serverManager.registerPage("/api/nearby-ap", HTTP_GET, [this](ESP8266WebServer& server) { handleScanAPs(server); });
+void WiFiManager::pollScan() {
+    HEAP_SCOPE(HEAP_TAG_WIFI);
+    if (!_scanRunning) {
+        return;
+    }
+    int n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING) {
+        return;
+    }
+    _scanRunning = false;
+    if (n < 0) { // WIFI_SCAN_FAILED
+        _logger.log("WiFi scan failed.\n");
+        return;
+    }
+
+    _scanCount = 0;
+    for (int i = 0; i < n; ++i) {
+        String ssid = WiFi.SSID(i);
+        if (ssid.isEmpty()) {
+            continue; // Hidden network
+        }
+        int8_t rssi = WiFi.RSSI(i);
+
+        // Deduplicate by SSID, keeping the strongest access point
+        size_t pos = 0;
+        while (pos < _scanCount && strcmp(_scanResults[pos].ssid, ssid.c_str()) != 0) pos++;
+        if (pos < _scanCount) {
+            if (_scanResults[pos].rssi >= rssi) continue;
+            memmove(&_scanResults[pos], &_scanResults[pos + 1], (_scanCount - pos - 1) * sizeof(ScannedNetwork));
+            _scanCount--;
+        }
+
+        // Insert sorted by RSSI, strongest first; weakest entry falls off when full
+        pos = 0;
+        while (pos < _scanCount && _scanResults[pos].rssi >= rssi) pos++;
+        if (pos >= WIFI_MANAGER_MAX_SCAN_RESULTS) continue;
+        size_t tail = (_scanCount < WIFI_MANAGER_MAX_SCAN_RESULTS ? _scanCount : WIFI_MANAGER_MAX_SCAN_RESULTS - 1) - pos;
+        memmove(&_scanResults[pos + 1], &_scanResults[pos], tail * sizeof(ScannedNetwork));
+        if (_scanCount < WIFI_MANAGER_MAX_SCAN_RESULTS) _scanCount++;
+
+        ScannedNetwork& network = _scanResults[pos];
+        strncpy(network.ssid, ssid.c_str(), sizeof(network.ssid) - 1);
+        network.ssid[sizeof(network.ssid) - 1] = '\0';
+        memcpy(network.bssid, WiFi.BSSID(i), sizeof(network.bssid));
+        network.rssi = rssi;
+        network.channel = WiFi.channel(i);
+        network.encryption = WiFi.encryptionType(i);
+    }
+    WiFi.scanDelete(); // Free the SDK's result list
+
+    _scanValid = true;
+    _scanTime = millis();
+}
+
+unsigned long WiFiManager::getScanAge() const {
+    return _scanValid ? millis() - _scanTime : ULONG_MAX;
 }
 
+/**
+ * @brief Returns a short name of an encryption type as reported by WiFi.encryptionType().
+ */
+static const char* encryptionName(uint8_t type) {
+    switch (type) {
+        case ENC_TYPE_NONE: return "open";
+        case ENC_TYPE_WEP:  return "wep";
+        case ENC_TYPE_TKIP: return "wpa";
+        case ENC_TYPE_CCMP: return "wpa2";
+        case ENC_TYPE_AUTO: return "wpa/wpa2";
+        default:            return "unknown";
+    }
+}
+
+/**
+ * Responds immediately with the cached results of the last scan. When the results are 
+ * older than the TTL a new asynchronous scan is started (or the one in flight is shared), 
+ * and the response has "scanning": true so that the client can poll again.
+ */
 void WiFiManager::handleScanAPs(ESP8266WebServer& server) {
-    int n = WiFi.scanNetworks();  // Perform Wi-Fi scan
-    String response = "[";
-    for (int i = 0; i < n; ++i) {
-        response += "\"" + WiFi.SSID(i) + "\"";
-        if (i < n - 1) response += ",";
+    HEAP_SCOPE(HEAP_TAG_WIFI);
+    unsigned long age = getScanAge();
+    if (age > _scanTTL) {
+        startScan();
     }
-    response += "]";
+
+    JsonDocument doc;
+    doc["status"] = "ok";
+    doc["scanning"] = _scanRunning;
+    doc["age"] = _scanValid ? age : 0;
+    JsonArray networks = doc["networks"].to<JsonArray>();
+    for (size_t i = 0; i < _scanCount; ++i) {
+        JsonObject network = networks.add<JsonObject>();
+        network["ssid"] = (const char*)_scanResults[i].ssid;
+        network["rssi"] = _scanResults[i].rssi;
+        network["channel"] = _scanResults[i].channel;
+        network["encryption"] = encryptionName(_scanResults[i].encryption);
+    }
+
+    String response;
+    response.reserve(measureJson(doc) + 1);
+    serializeJson(doc, response);
     server.send(200, "application/json", response);
 }
\ No newline at end of file
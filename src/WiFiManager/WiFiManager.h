@@ -15,7 +15,9 @@
 #include <vector>
 #include "ConfigurationManager/ConfigurationManager.h"
 #include "HTTPServerManager/HTTPServerManager.h"
-#include "Logger/Logger.h"
+#include "Logger/LogSink.h"
+#include "EventBus/EventBus.h"
+#include "WiFiManager/NetworkSelector.h"
 
 /**
  * @brief Enumeration for different Wi-Fi operation modes.
@@ -26,6 +28,45 @@ enum OperationMode {
     SETTINGS   ///< Configuration mode (AP mode)
 };
 
+#ifndef WIFI_MANAGER_MAX_SCAN_RESULTS
+#define WIFI_MANAGER_MAX_SCAN_RESULTS 16   ///< Maximum number of distinct networks kept from a scan.
+#endif
+
+#ifndef WIFI_MANAGER_SCAN_MAX_AGE
+#define WIFI_MANAGER_SCAN_MAX_AGE 120000   ///< Age (in ms) after which the scan results no longer target a connection: connect by SSID only.
+#endif
+
+#ifndef WIFI_MANAGER_RTC_OFFSET
+#define WIFI_MANAGER_RTC_OFFSET 32   ///< Offset (in 4-byte blocks) of the connection cache in RTC user memory; the core uses the first 32 blocks for OTA.
+#endif
+
+#ifndef WIFI_MANAGER_LEASE_MAX_AGE
+#define WIFI_MANAGER_LEASE_MAX_AGE 3600   ///< Age (in s) after which a cached IP lease is renewed by DHCP, when the clock is set.
+#endif
+
+#ifndef WIFI_MANAGER_LEASE_MAX_REUSES
+#define WIFI_MANAGER_LEASE_MAX_REUSES 16  ///< Fast reconnects reusing a cached IP lease before it is renewed by DHCP.
+#endif
+
+/**
+ * @brief Last good connection parameters, kept in RTC user memory.
+ * 
+ * RTC user memory survives deep sleep and soft resets (but not power loss), which 
+ * allows a directed reconnect without a channel scan and without DHCP.
+ */
+struct WiFiConnectionCache {
+    uint32_t crc;        ///< CRC32 over all following fields.
+    uint32_t ssidHash;   ///< CRC32 of the SSID the cache belongs to.
+    uint8_t bssid[6];    ///< BSSID of the access point.
+    uint8_t channel;     ///< Wi-Fi channel of the access point.
+    uint8_t reuses;      ///< Fast reconnects made with this lease since DHCP granted it.
+    uint32_t ip;         ///< Leased IP address.
+    uint32_t gateway;    ///< Gateway address.
+    uint32_t subnet;     ///< Subnet mask.
+    uint32_t dns;        ///< DNS server address.
+    uint32_t leasedAt;   ///< Epoch time (s) DHCP granted the lease, 0 if the clock was not set.
+};
+
 class WiFiManager {
 public:
     /**
@@ -54,6 +95,107 @@ public:
     void setTimeServer(const char* value){_timeServer = value; };
     void setTimeZone(const char* value){    _timeZone = value; };
 
+    /**
+     * @brief Adds a network to the prioritized credential list.
+     * 
+     * The credentials set with setSSID()/setPassword() are added with priority 0 on the 
+     * first connection attempt, unless the same SSID is already in the list.
+     * 
+     * @param ssid Network SSID. The pointer is stored, the string must outlive the WiFiManager.
+     * @param password Network password (empty for open networks).
+     * @param priority Higher values are preferred; each level is worth 10 dB of RSSI by default.
+     */
+    void addNetwork(const char* ssid, const char* password, int priority = 0);
+
+    /**
+     * @brief Adds the networks of a JSON array to the prioritized credential list.
+     * 
+     * @param networks Array of {"ssid", "password", "priority"} objects, e.g. config.getArray("wifi.networks").
+     */
+    void addNetworks(JsonArrayConst networks);
+
+    /**
+     * @brief Enables or disables proactive roaming on a sustained weak signal (default: enabled).
+     */
+    void setRoaming(bool value){ _roaming = value; }
+
+    /**
+     * @brief Sets the RSSI below which the signal is considered weak (default: -75 dBm).
+     */
+    void setRoamThreshold(int value){ _networks.setRoamThreshold(value); }
+
+    /**
+     * @brief Sets how long the signal must stay weak before looking for a better network (default: 30000 ms).
+     */
+    void setRoamDelay(unsigned long value){ _networks.setRoamDelay(value); }
+
+    /**
+     * @brief Sets by how many dB a network must score better than the current one to roam (default: 8 dB).
+     */
+    void setRoamHysteresis(int value){ _networks.setRoamHysteresis(value); }
+
+    /**
+     * @brief Sets the interval of the reconnection attempts in SETTINGS mode (default: 60000 ms).
+     */
+    void setRetryInterval(unsigned long value){ _retryInterval = value; }
+
+    /**
+     * @brief Enables or disables the fast reconnect using the cached BSSID, channel and IP lease.
+     * 
+     * @param value True to try a directed fast connect first (default), false to always do a full scan and DHCP.
+     */
+    void setFastConnect(bool value){ _fastConnect = value; }
+
+    /**
+     * @brief Returns the duration of the last successful connection, from WiFi.begin() to connected.
+     * 
+     * @return Duration in milliseconds.
+     */
+    unsigned long getLastConnectDuration() const { return _lastConnectDuration; }
+
+    /**
+     * @brief Tells whether the last successful connection used the cached parameters.
+     * 
+     * @return True if the fast connect succeeded, false if a full scan and DHCP were needed.
+     */
+    bool isLastConnectFast() const { return _lastConnectFast; }
+
+    /**
+     * @brief Sets how long scan results are considered fresh.
+     * 
+     * @param value Time to live in milliseconds (default 30000).
+     */
+    void setScanTTL(unsigned long value){ _scanTTL = value; }
+
+    /**
+     * @brief Starts an asynchronous scan of nearby networks, unless one is already running.
+     * 
+     * Results are collected by loop() and are available through getScanResults().
+     */
+    void startScan();
+
+    /**
+     * @brief Tells whether an asynchronous scan is in progress.
+     */
+    bool isScanning() const { return _scanRunning; }
+
+    /**
+     * @brief Returns the networks seen during the last completed scan.
+     * 
+     * Networks are deduplicated by SSID (strongest access point kept) and sorted by RSSI, strongest first.
+     * 
+     * @param count Receives the number of entries.
+     * @return Pointer to the first entry.
+     */
+    const ScannedNetwork* getScanResults(size_t& count) const { count = _scanCount; return _scanResults; }
+
+    /**
+     * @brief Returns the age of the last completed scan.
+     * 
+     * @return Age in milliseconds, or ULONG_MAX if no scan has completed yet.
+     */
+    unsigned long getScanAge() const;
+
     /**
      * @brief Attempts to connect to a Wi-Fi access point for the first time.
      * 
@@ -69,7 +211,10 @@ public:
     bool reConnecToAP();
     
     /**
-     * @brief Connects to a Wi-Fi access point using stored credentials.
+     * @brief Connects to the best available network of the credential list.
+     * 
+     * Networks seen in the last scan are tried first, by descending score (RSSI plus 
+     * priority bonus), then the networks that were not seen, by descending priority.
      * 
      * @return True if successfully connected, false otherwise.
      */
@@ -81,23 +226,21 @@ public:
     void createAP();
 
     /**
-     * @brief Reboots the ESP8266.
+     * @brief Invalidates the cached connection parameters, forcing a full scan and DHCP on next connect.
      */
-    void reboot();
-    
+    void clearConnectionCache();
+
     /**
-     * @brief Adds a function hook to report connection steps.
-     * 
-     * @param func Callback function for reporting steps.
+     * @brief Reboots the ESP8266.
      */
-    void addReportStepHook(std::function<void(int)> func);
+    void reboot();
     
     /**
-     * @brief Reports a connection step to all registered hooks.
+     * @brief Sets the event bus receiving the connection events (EVENT_SOURCE_WIFI).
      * 
-     * @param step Step identifier.
+     * @param eventBus Pointer to the EventBus, nullptr to emit no events.
      */
-    void reportStep(int step);
+    void setEventBus(EventBus* eventBus){ _eventBus = eventBus; }
 
     /**
      * @brief Registers HTTP endpoints for Wi-Fi management.
@@ -112,12 +255,59 @@ public:
     void handleScanAPs(ESP8266WebServer& server);
 
 private:    
+    /**
+     * @brief Connects to one candidate network, trying the fast connect first.
+     * 
+     * @return True if connected, false otherwise.
+     */
+    bool connectToNetwork(const NetworkCandidate& candidate);
+
+    /**
+     * @brief Tries a directed connect using the cached BSSID, channel and IP lease.
+     * 
+     * @param credentials Network to connect to.
+     * @param network Scan entry of the network, or nullptr if it was not seen.
+     * @return True if connected, false if the cache is missing or stale, or the connect timed out.
+     */
+    bool fastConnectToAP(const WiFiCredentials& credentials, const ScannedNetwork* network);
+
+    /**
+     * @brief Connects with DHCP, directed to the scanned access point if the network was seen.
+     * 
+     * @param credentials Network to connect to.
+     * @param network Scan entry of the network, or nullptr for a full channel scan.
+     * @return True if connected, false otherwise.
+     */
+    bool fullConnectToAP(const WiFiCredentials& credentials, const ScannedNetwork* network);
+
+    /**
+     * @brief Tracks the signal strength and roams to a better access point when it stays weak.
+     */
+    void checkRoaming();
+
+    /**
+     * @brief Collects the results of a completed asynchronous scan.
+     */
+    void pollScan();
+
+    /**
+     * @brief Loads the connection cache from RTC memory and validates it against an SSID.
+     * 
+     * @return True if a valid cache entry for the SSID was found.
+     */
+    bool loadConnectionCache(const char* ssid);
+
+    /**
+     * @brief Stores the parameters of the current connection into RTC memory.
+     */
+    void saveConnectionCache(const char* ssid);
+
     HTTPServerManager& _serverManager;  ///< Reference to the HTTP server manager.
-    Logger* _logger;                    ///< Pointer to the logger.
+    ComponentLogger _logger;            ///< Logger.
 
-    const char* _SSID;                  ///< Wi-Fi SSID.
-    const char* _password;              ///< Wi-Fi password.
-    const char* _hostname;              ///< Device hostname.
+    const char* _SSID = "";             ///< Wi-Fi SSID.
+    const char* _password = "";         ///< Wi-Fi password.
+    const char* _hostname = "";         ///< Device hostname.
 
     // In case the microcontroller is to act as Access Point (AP), below are attributes to hold credentials
     const char* _apSSID;                ///< AP mode SSID.
@@ -129,8 +319,33 @@ private:
 
     OperationMode _operationMode;       ///< Current operation mode.
     unsigned long _lastTime = 0;        ///< Time tracking variable.
+    unsigned long _retryInterval = 60000; ///< Interval of the reconnection attempts in SETTINGS mode, in ms.
+    bool _retryPending = false;         ///< A reconnection attempt waits for the scan to complete.
 
-    std::vector<std::function<void(int)>> _reportStepsHooks;  ///< List of hooks.
+    NetworkSelector _networks;          ///< Prioritized credential list.
+    bool _roaming = true;               ///< Roam proactively on a sustained weak signal.
+    bool _roamPending = false;          ///< A roaming decision waits for the scan to complete.
+    unsigned long _lastSignalCheck = 0; ///< millis() of the last signal strength sample.
+
+    WiFiConnectionCache _cache;         ///< Last good connection parameters.
+    bool _fastConnect = true;           ///< Try the cached parameters before a full scan.
+    unsigned long _fastConnectTimeout = 1500; ///< Timeout of the fast connect attempt, in ms.
+    unsigned long _lastConnectDuration = 0;   ///< Duration of the last successful connect, in ms.
+    bool _lastConnectFast = false;      ///< Whether the last successful connect was a fast one.
+
+    ScannedNetwork _scanResults[WIFI_MANAGER_MAX_SCAN_RESULTS]; ///< Results of the last completed scan.
+    size_t _scanCount = 0;              ///< Number of valid entries in _scanResults.
+    bool _scanRunning = false;          ///< An asynchronous scan is in progress.
+    bool _scanValid = false;            ///< At least one scan has completed.
+    unsigned long _scanTime = 0;        ///< millis() when the last scan completed.
+    unsigned long _scanTTL = 30000;     ///< Time to live of the scan results, in ms.
+
+    EventBus* _eventBus = nullptr;      ///< Event bus receiving the connection events.
+
+    /**
+     * @brief Emits a connection event, if an event bus is set.
+     */
+    void emit(EventType type, int32_t value = 0){ if (_eventBus != nullptr) _eventBus->emit(EVENT_SOURCE_WIFI, type, value); }
 };
 
 #endif
\ No newline at end of file
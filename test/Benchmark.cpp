@@ -0,0 +1,474 @@
+/**
+ * @file Benchmark.cpp
+ * @brief Host benchmark of the framework paths that build without the device.
+ *
+ * Measures MqttManager::publish() sent and queued, the dispatch of topics through the
+ * TopicTrie, EventBus emission, file uploads and archive extraction through
+ * FileUploadSession (the path of OTA::handleFileUpload() and /api/archive), against the
+ * stand-ins of test/host. Over loopback sockets, it measures the web server: static files,
+ * /api/* latency, WebSocket fan-out, and file and firmware uploads through the handlers of
+ * OTA, including the upload time saved by compression. Prints one JSON document, with the commit, for tracking per commit:
+ *
+ *   iot_benchmark [--quick] [--output FILE]
+ *
+ * --quick divides the iterations by 20 (used by ctest). Loopback has no WiFi: the HTTP
+ * numbers are the cost of the handlers and of the server stand-in on the development
+ * machine, to compare between commits; tools/benchmark.py measures a device.
+ */
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include "LoopbackHttp.h"
+#include "SinkBroker.h"
+#include <Updater.h>
+#include <WebSocketsServer.h>
+#include "EventBus/EventBus.h"
+#include "Metrics/LatencyHistogram.h"
+#include "MqttManager/MqttManager.h"
+#include "MqttManager/TopicTrie.h"
+#include "OTA/FileUploadSession.h"
+#include "OTA/OTA.h"
+#include "OTA/TarArchive.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+unsigned scale = 1; ///< Divisor of the iterations.
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * @brief Formats a JSON object of a benchmark: rate, and latency percentiles if sampled.
+ */
+std::string result(const char* name, const char* unit, double count, double seconds, const LatencyHistogram* latency = nullptr) {
+    char text[384];
+    int length = snprintf(text, sizeof(text), "    \"%s\": {\"count\": %.0f, \"seconds\": %.6f, \"%s_per_second\": %.1f",
+        name, count, seconds, unit, seconds > 0 ? count / seconds : 0);
+    if (latency != nullptr && latency->count() > 0) {
+        length += snprintf(text + length, sizeof(text) - length, ", \"p50_us\": %u, \"p99_us\": %u, \"max_us\": %u",
+            (unsigned)latency->percentile(50), (unsigned)latency->percentile(99), (unsigned)latency->max());
+    }
+    snprintf(text + length, sizeof(text) - length, "}");
+    return text;
+}
+
+void configure(MqttManager& mqtt) {
+    mqtt.setServer("10.0.0.2");
+    mqtt.setPort(1883);
+    mqtt.setClientId("bench");
+    mqtt.setUsername(nullptr);
+    mqtt.setPassword(nullptr);
+    mqtt.setTopicPrefix("Bench", "Device1");
+    mqtt.begin();
+}
+
+std::string benchPublishSent() {
+    SinkBroker broker;
+    MqttManager mqtt(nullptr);
+    configure(mqtt);
+    WiFi.setStatus(WL_CONNECTED);
+    for (int i = 0; i < 10 && mqtt.getState() != MQTT_STATE_CONNECTED; i++) {
+        mqtt.loop();
+    }
+    const int count = 200000 / scale;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        mqtt.publish("sensor/temperature", 21.5 + (i & 7), 1);
+    }
+    double seconds = secondsSince(start);
+    return result("mqtt_publish_sent", "messages", broker.getPublishes(), seconds, &mqtt.getPublishLatency());
+}
+
+std::string benchPublishQueued() {
+    SinkBroker broker;
+    MqttManager mqtt(nullptr);
+    configure(mqtt);
+    WiFi.setStatus(WL_DISCONNECTED);
+    static const char* topics[] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+    const int count = 200000 / scale;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        mqtt.publish(topics[i & 7], (long)i, MQTT_PUBLISH_LATEST); // Coalesced in the queue
+    }
+    double seconds = secondsSince(start);
+    WiFi.setStatus(WL_CONNECTED);
+    return result("mqtt_publish_queued", "messages", count, seconds, &mqtt.getPublishLatency());
+}
+
+std::string benchTopicMatch() {
+    TopicTrie trie;
+    const char* filters[] = { "Bench/Device1/cmd/#", "Bench/Device1/cmd/relay/+", "Bench/+/status",
+        "Bench/Device1/config/set", "Bench/Device1/ota/+/url", "Bench/#", "other/#", "+/+/cmd/led" };
+    for (uint16_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+        trie.insert(filters[i], i);
+    }
+    const char* topics[] = { "Bench/Device1/cmd/relay/3", "Bench/Device2/status", "Bench/Device1/telemetry", "Bench/Device1/cmd/led" };
+    const int count = 1000000 / scale;
+    uint32_t matches = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        const char* topic = topics[i & 3];
+        trie.match(topic, strlen(topic), [&](uint16_t) { matches++; });
+    }
+    double seconds = secondsSince(start);
+    return result(matches > 0 ? "topic_trie_match" : "topic_trie_match_error", "topics", count, seconds);
+}
+
+std::string benchEventBus() {
+    EventBus bus;
+    uint32_t received = 0;
+    EventHandler handler = [](const Event&, void* context) { (*static_cast<uint32_t*>(context))++; };
+    bus.subscribe(handler, &received);
+    bus.subscribe(handler, &received, EVENT_SOURCE_OTA);
+    bus.subscribe(handler, &received, EVENT_SOURCE_ANY, true);
+    const int count = 1000000 / scale;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        bus.emit(EVENT_SOURCE_OTA, EVENT_OTA_PROGRESS, i);
+        if ((i & 15) == 15) bus.loop();
+    }
+    bus.loop();
+    double seconds = secondsSince(start);
+    return result("event_bus_emit", "events", count, seconds);
+}
+
+/**
+ * @brief Uploads content in chunks of the size of a TCP segment, as the web server hands them.
+ */
+bool upload(const char* path, const std::vector<uint8_t>& content) {
+    FileUploadSession session(path);
+    if (!session.begin(false)) return false;
+    for (size_t offset = 0; offset < content.size(); offset += 1460) {
+        size_t length = content.size() - offset < 1460 ? content.size() - offset : 1460;
+        if (!session.write(content.data() + offset, length)) return false;
+    }
+    return session.end();
+}
+
+std::string benchFileUpload() {
+    std::vector<uint8_t> content(256 * 1024);
+    for (size_t i = 0; i < content.size(); i++) content[i] = (uint8_t)(i * 31 + (i >> 9));
+    const int count = 200 / scale;
+    LatencyHistogram latency;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        auto fileStart = Clock::now();
+        if (!upload("/bench.bin", content)) return result("file_upload_error", "bytes", 0, 0);
+        latency.record((uint32_t)(secondsSince(fileStart) * 1e6));
+    }
+    double seconds = secondsSince(start);
+    LittleFS.remove("/bench.bin");
+    return result("file_upload", "bytes", (double)count * content.size(), seconds, &latency);
+}
+
+std::string benchArchiveExtract() {
+    std::vector<uint8_t> archive;
+    TarWriter writer;
+    writer.begin([&](const uint8_t* data, size_t length) { archive.insert(archive.end(), data, data + length); return true; });
+    writer.addDirectory("bench");
+    for (int i = 0; i < 64; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "bench/file%02d.txt", i);
+        uint32_t size = 1024 + 256 * (i % 16), remaining = size;
+        writer.addFile(name, size, 0, [&](uint8_t* data, size_t length) {
+            size_t chunk = remaining < length ? remaining : length;
+            memset(data, 'a' + (remaining & 15), chunk);
+            remaining -= chunk;
+            return chunk;
+        });
+    }
+    writer.end();
+
+    const int count = 100 / scale;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        FileUploadSession* session = nullptr;
+        TarReader reader;
+        reader.begin(
+            [&](const TarEntry& entry) {
+                if (entry.type == TAR_ENTRY_DIRECTORY) {
+                    LittleFS.mkdir(String("/") + entry.name);
+                    return true;
+                }
+                session = new FileUploadSession(String("/") + entry.name);
+                return session->begin(false);
+            },
+            [&](const uint8_t* data, size_t length) { return session->write(data, length); },
+            [&](const TarEntry&) { bool stored = session->end(); delete session; session = nullptr; return stored; });
+        for (size_t offset = 0; offset < archive.size(); offset += 1460) {
+            reader.write(archive.data() + offset, archive.size() - offset < 1460 ? archive.size() - offset : 1460);
+        }
+        reader.end();
+        delete session;
+    }
+    double seconds = secondsSince(start);
+    return result("archive_extract", "bytes", (double)count * archive.size(), seconds);
+}
+
+/**
+ * @brief Bytes of a firmware-like image: runs of instruction-like words repeated with
+ * variations, between tables of pseudo-random data. It compresses to about three
+ * quarters, as firmware images do.
+ */
+std::string firmwareImage(size_t size) {
+    std::string image(size, '\0');
+    uint32_t state = 0x12345678;
+    for (size_t i = 0; i < size; i += 4) {
+        state = state * 1664525 + 1013904223;
+        uint32_t word = (i / 2048) % 3 == 2 ? state : (uint32_t)(0x4000u | ((state >> 24) & 0x3F) << 8 | (i >> 4 & 0xFF));
+        memcpy(&image[i], &word, size - i < 4 ? size - i : 4);
+    }
+    image[0] = (char)0xE9;
+    return image;
+}
+
+/**
+ * @brief gzip of data with the 4 KB window of the device, as tools/compress.py makes it.
+ */
+std::string gzip(const std::string& data) {
+    z_stream stream = {};
+    deflateInit2(&stream, 9, Z_DEFLATED, 16 + 12, 8, Z_DEFAULT_STRATEGY);
+    std::string output(deflateBound(&stream, data.size()) + 64, '\0');
+    stream.next_in = (Bytef*)data.data();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef*)&output[0];
+    stream.avail_out = output.size();
+    deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+/**
+ * @brief The web server with the OTA handlers, served over loopback.
+ */
+struct Device {
+    HTTPServerManager manager;
+    OTA ota { manager };
+    uint16_t port = 0;
+
+    Device() {
+        manager.begin();
+        ota.begin();
+        port = WiFiServer::hostPort(80);
+    }
+
+    LoopbackHttp::Response send(const LoopbackHttp::Request& request) {
+        return LoopbackHttp::request(port, request, [this]() { manager.loop(); ota.loop(); });
+    }
+
+    LoopbackHttp::Response get(const std::string& target) {
+        LoopbackHttp::Request request;
+        request.target = target;
+        return send(request);
+    }
+};
+
+void store(const char* path, const std::string& content) {
+    File file = LittleFS.open(path, "w");
+    file.write((const uint8_t*)content.data(), content.size());
+    file.close();
+}
+
+/**
+ * @brief Requests a 4 KB static file, one connection per request as browsers mostly do
+ * with the device: requests per second, with the latency percentiles.
+ */
+std::string benchStaticFile() {
+    std::string page(4096, 'x');
+    store("/public_html/bench.html", page);
+    Device device;
+    const int count = 2000 / scale;
+    LatencyHistogram latency;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        auto requestStart = Clock::now();
+        LoopbackHttp::Response response = device.get("/bench.html");
+        if (response.code != 200 || response.body.size() != page.size()) return result("http_static_file_error", "requests", 0, 0);
+        latency.record((uint32_t)(secondsSince(requestStart) * 1e6));
+    }
+    double seconds = secondsSince(start);
+    LittleFS.remove("/public_html/bench.html");
+    return result("http_static_file", "requests", count, seconds, &latency);
+}
+
+/**
+ * @brief Requests an /api/ endpoint: requests per second, with the latency percentiles.
+ */
+std::string benchApi(const char* name, const char* target) {
+    for (int i = 0; i < 32; i++) {
+        store(("/bench/file" + std::to_string(i) + ".txt").c_str(), std::string(100 + i, 'a'));
+    }
+    Device device;
+    const int count = 1000 / scale;
+    LatencyHistogram latency;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        auto requestStart = Clock::now();
+        if (device.get(target).code != 200) return result((std::string(name) + "_error").c_str(), "requests", 0, 0);
+        latency.record((uint32_t)(secondsSince(requestStart) * 1e6));
+    }
+    double seconds = secondsSince(start);
+    return result(name, "requests", count, seconds, &latency);
+}
+
+/**
+ * @brief Broadcasts a reading to the most WebSocket clients the server takes: messages
+ * delivered per second, each framed for each client.
+ */
+std::string benchWebSocketFanout() {
+    Device device;
+    WebSocketsServer* webSocket = WebSocketsServer::find(81);
+    int clients = 0;
+    while (webSocket != nullptr && webSocket->hostConnect() >= 0) clients++;
+    String message = "{\"temperature\":21.5,\"humidity\":48.2,\"pressure\":1013.2,\"time\":1760000000}";
+    const int count = 200000 / scale;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        device.manager.broadcastWebSocketMessage(message);
+    }
+    double seconds = secondsSince(start);
+    if (clients == 0 || webSocket->hostFrames(0) != (uint32_t)count) return result("websocket_fanout_error", "messages", 0, 0);
+    return result("websocket_fanout", "messages", (double)count * clients, seconds);
+}
+
+/**
+ * @brief Uploads a 256 KB file through OTA::handleFileUpload(): throughput and per-upload time.
+ */
+std::string benchHttpFileUpload() {
+    Device device;
+    std::string content = firmwareImage(256 * 1024);
+    LoopbackHttp::Request request = LoopbackHttp::upload("/api/upload?directory=/bench", "upload.bin", content);
+    const int count = 100 / scale;
+    LatencyHistogram latency;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        auto uploadStart = Clock::now();
+        if (device.send(request).code != 200) return result("http_file_upload_error", "bytes", 0, 0);
+        latency.record((uint32_t)(secondsSince(uploadStart) * 1e6));
+    }
+    double seconds = secondsSince(start);
+    LittleFS.remove("/bench/upload.bin");
+    return result("http_file_upload", "bytes", (double)count * content.size(), seconds, &latency);
+}
+
+/**
+ * @brief Uploads a 400 KB firmware through OTA::handleFirmwareUpload(), hashed and installed
+ * into the Update stand-in: throughput and per-upload time. The clock is frozen, so that
+ * the delay before the reboot does not count.
+ */
+std::string benchFirmwareUpload() {
+    HostClock::setManual(true);
+    Update.reset();
+    Device device;
+    std::string image = firmwareImage(400 * 1024);
+    LoopbackHttp::Request request = LoopbackHttp::upload("/api/firmware", "firmware.bin", image);
+    const int count = 40 / scale;
+    LatencyHistogram latency;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        auto uploadStart = Clock::now();
+        if (device.send(request).code != 200 || Update.getInstalls() != (uint32_t)i + 1) break;
+        latency.record((uint32_t)(secondsSince(uploadStart) * 1e6));
+    }
+    double seconds = secondsSince(start);
+    HostClock::setManual(false);
+    if (latency.count() != (uint32_t)count) return result("http_firmware_upload_error", "bytes", 0, 0);
+    return result("http_firmware_upload", "bytes", (double)count * image.size(), seconds, &latency);
+}
+
+/**
+ * @brief Uploads a 400 KB image through OTA::handleFileUpload() over loopback, raw then
+ * compressed with inflate=1. Loopback has no WiFi bottleneck: the upload time is the
+ * device time measured here plus the transfer time of the bytes sent at linkRate, the
+ * order of an upload to an ESP8266, and the reduction compares the two uploads.
+ */
+std::string benchUploadGzip() {
+    const double linkRate = 100 * 1024;
+    Device device;
+
+    std::string image = firmwareImage(400 * 1024);
+    std::string compressed = gzip(image);
+    const int count = 20 / scale;
+    double seconds[2] = { 0, 0 };
+    for (int i = 0; i < count; i++) {
+        for (int compress = 0; compress < 2; compress++) {
+            LoopbackHttp::Request request = compress
+                ? LoopbackHttp::upload("/api/upload?directory=/bench&inflate=1", "image.bin.gz", compressed)
+                : LoopbackHttp::upload("/api/upload?directory=/bench", "image.bin", image);
+            auto start = Clock::now();
+            LoopbackHttp::Response response = device.send(request);
+            seconds[compress] += secondsSince(start);
+            if (response.code != 200 || device.ota.getUploadStats().storedBytes != image.size()) {
+                return result("upload_gzip_error", "bytes", 0, 0);
+            }
+        }
+    }
+    LittleFS.remove("/bench/image.bin");
+
+    double raw = seconds[0] / count + image.size() / linkRate;
+    double gzipped = seconds[1] / count + compressed.size() / linkRate;
+    char text[384];
+    snprintf(text, sizeof(text), "    \"upload_gzip\": {\"count\": %d, \"bytes\": %zu, \"gzip_bytes\": %zu, "
+        "\"device_seconds\": %.6f, \"gzip_device_seconds\": %.6f, \"link_bytes_per_second\": %.0f, "
+        "\"upload_seconds\": %.3f, \"gzip_upload_seconds\": %.3f, \"reduction\": %.3f}",
+        count, image.size(), compressed.size(), seconds[0] / count, seconds[1] / count, linkRate, raw, gzipped, 1 - gzipped / raw);
+    return text;
+}
+
+std::string commit() {
+    std::string hash;
+    FILE* pipe = popen("git -C \"" IOT_SOURCE_DIR "\" rev-parse --short HEAD 2>/dev/null", "r");
+    if (pipe != nullptr) {
+        char line[64];
+        if (fgets(line, sizeof(line), pipe) != nullptr) hash.assign(line, strcspn(line, "\n"));
+        pclose(pipe);
+    }
+    return hash;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) scale = 20;
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) output = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--quick] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    Serial.quiet(true);
+    LittleFS.begin();
+    LittleFS.format();
+
+    std::vector<std::string> results = {
+        benchPublishSent(), benchPublishQueued(), benchTopicMatch(), benchEventBus(),
+        benchFileUpload(), benchArchiveExtract(), benchStaticFile(), benchApi("http_api_metrics", "/api/metrics"),
+        benchApi("http_api_files", "/api/files?path=/bench"), benchWebSocketFanout(), benchHttpFileUpload(),
+        benchFirmwareUpload(), benchUploadGzip()
+    };
+    std::string json = "{\n  \"commit\": \"" + commit() + "\",\n  \"quick\": " + (scale > 1 ? "true" : "false") + ",\n  \"results\": {\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        json += results[i] + (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json += "  }\n}\n";
+
+    FILE* file = output != nullptr ? fopen(output, "w") : stdout;
+    if (file == nullptr) {
+        perror(output);
+        return 1;
+    }
+    fputs(json.c_str(), file);
+    if (file != stdout) fclose(file);
+    return json.find("_error") == std::string::npos ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file ConfigurationManagerTest.cpp
+ * @brief Tests of the ConfigurationManager: loading the configuration file, reading values
+ * by path, and its read and save endpoints over loopback.
+ */
+#include <gtest/gtest.h>
+#include <string>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include "LoopbackHttp.h"
+#include "ConfigurationManager/ConfigurationManager.h"
+
+namespace {
+
+const std::string configuration =
+    "{\"wifi\":{\"ssid\":\"home\",\"networks\":[{\"ssid\":\"home\"},{\"ssid\":\"office\"}]},\"mqtt\":{\"port\":1884}}";
+
+class ConfigurationManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Serial.quiet(true);
+        ASSERT_TRUE(LittleFS.begin());
+        LittleFS.format();
+        File file = LittleFS.open("/config.json", "w");
+        file.write((const uint8_t*)configuration.data(), configuration.size());
+        file.close();
+        manager.begin();
+        config.begin();
+        port = WiFiServer::hostPort(80);
+    }
+
+    void TearDown() override {
+        Serial.quiet(false);
+    }
+
+    LoopbackHttp::Response send(const LoopbackHttp::Request& request) {
+        return LoopbackHttp::request(port, request, [this]() { manager.loop(); });
+    }
+
+    HTTPServerManager manager;
+    ConfigurationManager config { "config", manager, nullptr };
+    uint16_t port = 0;
+};
+
+TEST_F(ConfigurationManagerTest, ReadsValuesByPath) {
+    ASSERT_TRUE(config.loadConfig());
+    EXPECT_STREQ("home", config.getValue("wifi.ssid", ""));
+    EXPECT_EQ(1884, config.getValue("mqtt.port", 1883));
+    EXPECT_EQ(1883, config.getValue("mqtt.keepAlive", 1883));
+    EXPECT_STREQ("none", config.getValue("wifi.ssid.name", "none"));
+    EXPECT_EQ(2u, config.getArray("wifi.networks").size());
+}
+
+TEST_F(ConfigurationManagerTest, ServesTheLoadedConfiguration) {
+    ASSERT_TRUE(config.loadConfig());
+    LoopbackHttp::Response response = LoopbackHttp::get(port, "/api/config/read", [this]() { manager.loop(); });
+    EXPECT_EQ(200, response.code);
+    EXPECT_EQ("application/json", response.header("Content-Type"));
+    EXPECT_EQ(configuration, response.body);
+}
+
+TEST_F(ConfigurationManagerTest, SavesAPostedConfiguration) {
+    LoopbackHttp::Request request;
+    request.method = "POST";
+    request.target = "/api/config/save";
+    request.headers.push_back({ "Content-Type", "text/plain" });
+    request.body = "{\"mqtt\":{\"port\":8883}}";
+    LoopbackHttp::Response response = send(request);
+    EXPECT_EQ(200, response.code);
+    EXPECT_EQ(8883, config.getValue("mqtt.port", 0));
+
+    ConfigurationManager reloaded("config", manager, nullptr);
+    ASSERT_TRUE(reloaded.loadConfig());
+    EXPECT_EQ(8883, reloaded.getValue("mqtt.port", 0));
+    EXPECT_STREQ("", reloaded.getValue("wifi.ssid", ""));
+}
+
+TEST_F(ConfigurationManagerTest, RejectsAnInvalidConfiguration) {
+    ASSERT_TRUE(config.loadConfig());
+    LoopbackHttp::Request request;
+    request.method = "POST";
+    request.target = "/api/config/save";
+    request.headers.push_back({ "Content-Type", "text/plain" });
+    request.body = "{\"mqtt\":";
+    EXPECT_EQ(500, send(request).code);
+    EXPECT_EQ(1884, config.getValue("mqtt.port", 0));
+}
+
+} // namespace
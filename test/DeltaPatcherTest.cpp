@@ -0,0 +1,223 @@
+/**
+ * @file DeltaPatcherTest.cpp
+ * @brief Round trips of firmware images through tools/delta_patch.py and the DeltaPatcher,
+ * compressed patches through the GzipInflater as on the device, and malformed patches.
+ */
+#include <gtest/gtest.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "OTA/DeltaPatcher.h"
+#include "OTA/GzipInflater.h"
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+/**
+ * @brief Output of a DeltaPatcher applying a patch, fed in chunks of the given size.
+ */
+struct Applied {
+    bool ok;
+    DeltaPatcherError error;
+    Bytes output;
+};
+
+Applied applyPatch(const Bytes& base, const Bytes& patch, size_t chunk = 1460, bool inflate = false, DeltaPatcher::BaseCheck baseCheck = nullptr) {
+    Applied result = { false, DELTA_OK, {} };
+    DeltaPatcher patcher;
+    patcher.begin(
+        [&](uint32_t offset, uint8_t* data, size_t length) {
+            if (offset + length > base.size()) return false;
+            memcpy(data, base.data() + offset, length);
+            return true;
+        },
+        [&](const uint8_t* data, size_t length) {
+            result.output.insert(result.output.end(), data, data + length);
+            return true;
+        },
+        baseCheck);
+    GzipInflater inflater(4096); // OTA_DELTA_WINDOW_SIZE
+    if (inflate) {
+        EXPECT_TRUE(inflater.begin([&](const uint8_t* data, size_t length) { return patcher.write(data, length); }));
+    }
+    bool written = true;
+    for (size_t offset = 0; written && offset < patch.size(); offset += chunk) {
+        size_t length = std::min(chunk, patch.size() - offset);
+        written = inflate ? inflater.write(patch.data() + offset, length) : patcher.write(patch.data() + offset, length);
+    }
+    result.ok = written && (!inflate || inflater.end()) && patcher.end();
+    result.error = patcher.getError();
+    return result;
+}
+
+void putU32(Bytes& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+/**
+ * @brief A patch in the format of tools/delta_patch.py, with zero hashes.
+ */
+struct PatchBuilder {
+    Bytes bytes;
+
+    PatchBuilder(uint32_t baseSize, uint32_t newSize) {
+        const char magic[] = "IOTDIFF1";
+        bytes.insert(bytes.end(), magic, magic + 8);
+        putU32(bytes, baseSize);
+        putU32(bytes, newSize);
+        bytes.resize(DELTA_PATCHER_HEADER_SIZE, 0); // MD5 and SHA-256
+    }
+
+    PatchBuilder& record(const Bytes& diff, const Bytes& extra, int32_t seek) {
+        putU32(bytes, diff.size());
+        putU32(bytes, extra.size());
+        putU32(bytes, (uint32_t)seek);
+        bytes.insert(bytes.end(), diff.begin(), diff.end());
+        bytes.insert(bytes.end(), extra.begin(), extra.end());
+        return *this;
+    }
+};
+
+/**
+ * @brief A base image and a new version of it: code inserted, moved and removed, and
+ * addresses shifted, as between two builds of a sketch.
+ */
+void images(Bytes& base, Bytes& next) {
+    std::mt19937 random(7);
+    base.resize(48 * 1024);
+    for (size_t i = 0; i < base.size(); i += 4) {
+        uint32_t word = random() % 8 == 0 ? 0x40200000 + (random() % 0x8000) * 4 : random(); // Some code addresses
+        memcpy(&base[i], &word, 4);
+    }
+    next.assign(base.begin(), base.begin() + 9000);
+    for (int i = 0; i < 700; i++) next.push_back((uint8_t)random());             // New function
+    for (size_t i = 9000; i < 30000; i += 4) {                                    // Shifted code
+        uint32_t word;
+        memcpy(&word, &base[i], 4);
+        if ((word & 0xFFF00000) == 0x40200000) word += 0x2C0;
+        next.insert(next.end(), (uint8_t*)&word, (uint8_t*)&word + 4);
+    }
+    next.insert(next.end(), base.begin() + 36000, base.end());                    // Removed block
+    next.insert(next.end(), base.begin() + 30000, base.begin() + 31000);          // Moved block
+}
+
+bool writeFile(const std::string& path, const Bytes& data) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && written;
+}
+
+Bytes readFile(const std::string& path) {
+    Bytes data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return data;
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) data.insert(data.end(), buffer, buffer + length);
+    fclose(file);
+    return data;
+}
+
+/**
+ * @brief Makes a patch with tools/delta_patch.py; empty if Python is not available.
+ */
+Bytes makePatch(const Bytes& base, const Bytes& next, bool raw) {
+    char directory[] = "/tmp/delta_patch_XXXXXX";
+    if (mkdtemp(directory) == nullptr) return Bytes();
+    std::string dir = directory;
+    Bytes patch;
+    if (writeFile(dir + "/old.bin", base) && writeFile(dir + "/new.bin", next)) {
+        std::string command = "python3 \"" IOT_SOURCE_DIR "/tools/delta_patch.py\" diff " + dir + "/old.bin " + dir + "/new.bin " +
+            dir + "/update.patch --base-size " + std::to_string(base.size()) + (raw ? " --raw" : "") + " 2>/dev/null";
+        if (system(command.c_str()) == 0) patch = readFile(dir + "/update.patch");
+    }
+    std::string cleanup = "rm -rf " + dir;
+    (void)system(cleanup.c_str());
+    return patch;
+}
+
+TEST(DeltaPatcherTest, RebuildsTheImageFromAToolPatch) {
+    Bytes base, next;
+    images(base, next);
+    Bytes patch = makePatch(base, next, true);
+    if (patch.empty()) GTEST_SKIP() << "python3 tools/delta_patch.py not available";
+    ASSERT_TRUE(DeltaPatcher::isPatch(patch.data(), patch.size()));
+
+    for (size_t chunk : { (size_t)1, (size_t)7, (size_t)64, (size_t)1460, patch.size() }) {
+        Applied result = applyPatch(base, patch, chunk);
+        ASSERT_TRUE(result.ok) << "chunk " << chunk << " error " << result.error;
+        ASSERT_TRUE(result.output == next) << "chunk " << chunk;
+    }
+}
+
+TEST(DeltaPatcherTest, RebuildsTheImageFromACompressedToolPatch) {
+    Bytes base, next;
+    images(base, next);
+    Bytes patch = makePatch(base, next, false);
+    if (patch.empty()) GTEST_SKIP() << "python3 tools/delta_patch.py not available";
+    ASSERT_TRUE(GzipInflater::isGzip(patch.data(), patch.size()));
+    EXPECT_LT(patch.size(), next.size() / 4); // Mostly zero diff bytes
+
+    Applied result = applyPatch(base, patch, 1460, true);
+    ASSERT_TRUE(result.ok) << result.error;
+    EXPECT_TRUE(result.output == next);
+}
+
+TEST(DeltaPatcherTest, ReportsTheHeaderToTheBaseCheck) {
+    Bytes base(100, 1);
+    PatchBuilder patch(100, 10);
+    patch.record(Bytes(10, 0), Bytes(), 0);
+    uint32_t checkedSize = 0;
+    Applied refused = applyPatch(base, patch.bytes, 3, false, [&](const DeltaPatcher& patcher) {
+        checkedSize = patcher.getBaseSize();
+        return false;
+    });
+    EXPECT_FALSE(refused.ok);
+    EXPECT_EQ(DELTA_ERROR_BASE, refused.error);
+    EXPECT_EQ(100u, checkedSize);
+    EXPECT_TRUE(refused.output.empty()); // Nothing produced before the check
+
+    Applied accepted = applyPatch(base, patch.bytes, 3, false, [](const DeltaPatcher&) { return true; });
+    EXPECT_TRUE(accepted.ok);
+    EXPECT_EQ(Bytes(10, 1), accepted.output);
+}
+
+TEST(DeltaPatcherTest, AddsDiffBytesAndSeeksInTheBase) {
+    Bytes base = { 10, 20, 30, 40, 50, 60 };
+    PatchBuilder patch(6, 7);
+    patch.record({ 1, 1 }, { 99 }, 2)        // 11 21, extra 99, skip 30 40
+         .record({ 0, 0xFF }, {}, -4)        // 50 59, back to 30
+         .record({ 0, 0 }, {}, 0);           // 30 40
+    Applied result = applyPatch(base, patch.bytes, 1);
+    ASSERT_TRUE(result.ok) << result.error;
+    EXPECT_EQ(Bytes({ 11, 21, 99, 50, 59, 30, 40 }), result.output);
+}
+
+TEST(DeltaPatcherTest, RejectsMalformedPatches) {
+    Bytes base(64, 5);
+
+    Bytes notPatch = PatchBuilder(64, 8).bytes;
+    notPatch[0] = 'X';
+    EXPECT_EQ(DELTA_ERROR_HEADER, applyPatch(base, notPatch).error);
+
+    PatchBuilder outside(64, 8);
+    outside.record({}, {}, 100).record(Bytes(8, 0), {}, 0); // Seeks past the base
+    EXPECT_EQ(DELTA_ERROR_DATA, applyPatch(base, outside.bytes).error);
+
+    PatchBuilder tooLong(64, 8);
+    tooLong.record(Bytes(16, 0), {}, 0); // More than the new size
+    EXPECT_EQ(DELTA_ERROR_DATA, applyPatch(base, tooLong.bytes).error);
+
+    PatchBuilder truncated(64, 8);
+    truncated.record(Bytes(4, 0), {}, 0);
+    Applied result = applyPatch(base, truncated.bytes);
+    EXPECT_FALSE(result.ok);
+    EXPECT_EQ(DELTA_ERROR_TRUNCATED, result.error);
+}
+
+} // namespace
@@ -0,0 +1,139 @@
+/**
+ * @file EventBusTest.cpp
+ * @brief Tests of the EventBus: synchronous and deferred dispatch, source filters, coalescing, 
+ * and the bound of loop().
+ */
+#include <gtest/gtest.h>
+#include <vector>
+#include "EventBus/EventBus.h"
+
+namespace {
+
+struct Recorder {
+    std::vector<Event> events;
+
+    static void handle(const Event& event, void* context) {
+        static_cast<Recorder*>(context)->events.push_back(event);
+    }
+};
+
+TEST(EventBusTest, CallsSynchronousHandlersFromEmit) {
+    EventBus bus;
+    Recorder recorder;
+    ASSERT_TRUE(bus.subscribe(Recorder::handle, &recorder));
+    bus.emit(EVENT_SOURCE_WIFI, EVENT_WIFI_CONNECTED, 1200);
+    ASSERT_EQ(1u, recorder.events.size());
+    EXPECT_EQ(EVENT_SOURCE_WIFI, recorder.events[0].source);
+    EXPECT_EQ(EVENT_WIFI_CONNECTED, recorder.events[0].type);
+    EXPECT_EQ(1200, recorder.events[0].value);
+    EXPECT_EQ(0u, bus.pending());
+}
+
+TEST(EventBusTest, FiltersBySource) {
+    EventBus bus;
+    Recorder recorder;
+    bus.subscribe(Recorder::handle, &recorder, EVENT_SOURCE_MQTT);
+    bus.emit(EVENT_SOURCE_WIFI, EVENT_WIFI_CONNECTED);
+    bus.emit(EVENT_SOURCE_MQTT, EVENT_MQTT_CONNECTED);
+    ASSERT_EQ(1u, recorder.events.size());
+    EXPECT_EQ(EVENT_MQTT_CONNECTED, recorder.events[0].type);
+}
+
+TEST(EventBusTest, DefersHandlersToLoop) {
+    EventBus bus;
+    Recorder recorder;
+    bus.subscribe(Recorder::handle, &recorder, EVENT_SOURCE_ANY, true);
+    bus.emit(EVENT_SOURCE_OTA, EVENT_OTA_START);
+    bus.emit(EVENT_SOURCE_OTA, EVENT_OTA_SUCCESS, 4096);
+    EXPECT_TRUE(recorder.events.empty());
+    EXPECT_EQ(2u, bus.pending());
+    bus.loop();
+    ASSERT_EQ(2u, recorder.events.size());
+    EXPECT_EQ(EVENT_OTA_START, recorder.events[0].type);
+    EXPECT_EQ(EVENT_OTA_SUCCESS, recorder.events[1].type);
+    EXPECT_EQ(0u, bus.pending());
+}
+
+TEST(EventBusTest, CoalescesRepeatedEvents) {
+    EventBus bus;
+    Recorder recorder;
+    bus.subscribe(Recorder::handle, &recorder, EVENT_SOURCE_ANY, true);
+    for (int32_t received = 1024; received <= 8192; received += 1024) {
+        bus.emit(EVENT_SOURCE_OTA, EVENT_OTA_PROGRESS, received);
+    }
+    EXPECT_EQ(1u, bus.pending());
+    bus.loop();
+    ASSERT_EQ(1u, recorder.events.size());
+    EXPECT_EQ(8192, recorder.events[0].value);
+}
+
+TEST(EventBusTest, CoalescesOnlyWithTheLastQueuedEvent) {
+    EventBus bus;
+    Recorder recorder;
+    bus.subscribe(Recorder::handle, &recorder, EVENT_SOURCE_ANY, true);
+    bus.emit(EVENT_SOURCE_OTA, EVENT_OTA_PROGRESS, 1);
+    bus.emit(EVENT_SOURCE_MQTT, EVENT_MQTT_CONNECTED);
+    bus.emit(EVENT_SOURCE_OTA, EVENT_OTA_PROGRESS, 2);
+    EXPECT_EQ(3u, bus.pending());
+}
+
+/**
+ * @brief Deferred handler emitting an event of its own on every call.
+ */
+struct Echo {
+    EventBus* bus;
+    int calls = 0;
+
+    static void handle(const Event& event, void* context) {
+        Echo* echo = static_cast<Echo*>(context);
+        echo->calls++;
+        echo->bus->emit(EVENT_SOURCE_APP, (EventType)(EVENT_APP + echo->calls % 2)); // Not coalesced
+    }
+};
+
+TEST(EventBusTest, LoopDispatchesOnlyTheEventsQueuedWhenItStarts) {
+    EventBus bus;
+    Echo echo = { &bus };
+    bus.subscribe(Echo::handle, &echo, EVENT_SOURCE_ANY, true);
+    bus.emit(EVENT_SOURCE_APP, EVENT_APP);
+    bus.emit(EVENT_SOURCE_OTA, EVENT_OTA_START);
+    bus.loop(); // Would never return if the re-emitted events were dispatched too
+    EXPECT_EQ(2, echo.calls);
+    EXPECT_EQ(2u, bus.pending());
+    bus.loop();
+    EXPECT_EQ(4, echo.calls);
+}
+
+TEST(EventBusTest, DropsEventsWhenTheQueueIsFull) {
+    EventBus bus;
+    Recorder recorder;
+    bus.subscribe(Recorder::handle, &recorder, EVENT_SOURCE_ANY, true);
+    for (int i = 0; i < EVENT_BUS_QUEUE_SIZE + 3; i++) {
+        bus.emit(EVENT_SOURCE_APP, (EventType)(EVENT_APP + i));
+    }
+    EXPECT_EQ((size_t)EVENT_BUS_QUEUE_SIZE, bus.pending());
+    EXPECT_EQ(3u, bus.getDropped());
+}
+
+TEST(EventBusTest, UnsubscribesByHandlerAndContext) {
+    EventBus bus;
+    Recorder first, second;
+    bus.subscribe(Recorder::handle, &first);
+    bus.subscribe(Recorder::handle, &second);
+    EXPECT_TRUE(bus.unsubscribe(Recorder::handle, &first));
+    EXPECT_FALSE(bus.unsubscribe(Recorder::handle, &first));
+    bus.emit(EVENT_SOURCE_APP, EVENT_APP);
+    EXPECT_TRUE(first.events.empty());
+    EXPECT_EQ(1u, second.events.size());
+}
+
+TEST(EventBusTest, RefusesHandlersBeyondTheSlots) {
+    EventBus bus;
+    Recorder recorders[EVENT_BUS_MAX_HANDLERS + 1];
+    for (int i = 0; i < EVENT_BUS_MAX_HANDLERS; i++) {
+        EXPECT_TRUE(bus.subscribe(Recorder::handle, &recorders[i]));
+    }
+    EXPECT_FALSE(bus.subscribe(Recorder::handle, &recorders[EVENT_BUS_MAX_HANDLERS]));
+}
+
+} // namespace
@@ -0,0 +1,158 @@
+/**
+ * @file FakeBroker.cpp
+ * @brief Implementation of the FakeBroker test double.
+ */
+#include "FakeBroker.h"
+#include <WiFiClient.h>
+
+FakeBroker::FakeBroker() {
+    WiFiClient::setNetwork(this);
+}
+
+FakeBroker::~FakeBroker() {
+    WiFiClient::setNetwork(nullptr);
+}
+
+int FakeBroker::connect(IPAddress, uint16_t) {
+    _connects++;
+    _connectTimes.push_back(millis());
+    _fromClient.clear();
+    _toClient.clear();
+    if (!_reachable) {
+        delay(_connectDelay); // The TCP connect timeout
+        _connected = false;
+        return 0;
+    }
+    _connected = true;
+    return 1;
+}
+
+int FakeBroker::connect(const char* host, uint16_t port) {
+    return connect(IPAddress(), port);
+}
+
+size_t FakeBroker::write(const uint8_t* buffer, size_t size) {
+    if (!_connected) {
+        return 0;
+    }
+    _fromClient.insert(_fromClient.end(), buffer, buffer + size);
+    while (_fromClient.size() >= 2) { // Parse the whole packets
+        size_t position = 1;
+        uint32_t length = 0;
+        uint8_t shift = 0;
+        uint8_t b;
+        do {
+            if (position >= _fromClient.size()) return size;
+            b = _fromClient[position++];
+            length |= (uint32_t)(b & 0x7F) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        if (_fromClient.size() < position + length) {
+            return size;
+        }
+        std::vector<uint8_t> packet(_fromClient.begin(), _fromClient.begin() + position + length);
+        _fromClient.erase(_fromClient.begin(), _fromClient.begin() + position + length);
+        handle(packet, position);
+    }
+    return size;
+}
+
+int FakeBroker::read() {
+    if (_toClient.empty()) {
+        return -1;
+    }
+    uint8_t b = _toClient.front();
+    _toClient.pop_front();
+    return b;
+}
+
+int FakeBroker::read(uint8_t* buffer, size_t size) {
+    size_t count = 0;
+    while (count < size && !_toClient.empty()) {
+        buffer[count++] = _toClient.front();
+        _toClient.pop_front();
+    }
+    return (int)count;
+}
+
+void FakeBroker::deliver(const std::string& topic, const std::string& payload, uint8_t qos, uint16_t packetId) {
+    std::vector<uint8_t> body = { (uint8_t)(topic.size() >> 8), (uint8_t)topic.size() };
+    body.insert(body.end(), topic.begin(), topic.end());
+    if (qos > 0) {
+        body.push_back(packetId >> 8);
+        body.push_back(packetId & 0xFF);
+    }
+    body.insert(body.end(), payload.begin(), payload.end());
+    send(0x30 | (qos << 1), body);
+}
+
+void FakeBroker::acknowledge(uint16_t packetId) {
+    send(0x40, { (uint8_t)(packetId >> 8), (uint8_t)packetId });
+}
+
+void FakeBroker::handle(const std::vector<uint8_t>& packet, size_t bodyStart) {
+    uint8_t type = packet[0] & 0xF0;
+    const uint8_t* body = packet.data() + bodyStart;
+    size_t length = packet.size() - bodyStart;
+    switch (type) {
+    case 0x10: // CONNECT
+        send(0x20, { 0, _connackCode });
+        if (_connackCode != 0) _connected = false;
+        break;
+    case 0x30: { // PUBLISH
+        Publish publish;
+        uint16_t topicLength = (body[0] << 8) | body[1];
+        publish.topic.assign((const char*)body + 2, topicLength);
+        publish.qos = (packet[0] >> 1) & 0x03;
+        publish.duplicate = (packet[0] & 0x08) != 0;
+        publish.retained = (packet[0] & 0x01) != 0;
+        size_t position = 2 + topicLength;
+        publish.packetId = 0;
+        if (publish.qos > 0) {
+            publish.packetId = (body[position] << 8) | body[position + 1];
+            position += 2;
+        }
+        publish.payload.assign((const char*)body + position, length - position);
+        _published.push_back(publish);
+        if (publish.qos > 0 && _autoAck) acknowledge(publish.packetId);
+        break;
+    }
+    case 0x40: // PUBACK
+        _pubacks++;
+        break;
+    case 0x80: { // SUBSCRIBE
+        size_t position = 2;
+        std::vector<uint8_t> granted;
+        while (position + 2 <= length) {
+            uint16_t filterLength = (body[position] << 8) | body[position + 1];
+            _subscriptions.push_back(std::string((const char*)body + position + 2, filterLength));
+            position += 2 + filterLength;
+            granted.push_back(body[position++]);
+        }
+        std::vector<uint8_t> suback = { body[0], body[1] };
+        suback.insert(suback.end(), granted.begin(), granted.end());
+        send(0x90, suback);
+        break;
+    }
+    case 0xA0: // UNSUBSCRIBE
+        send(0xB0, { body[0], body[1] });
+        break;
+    case 0xC0: // PINGREQ
+        send(0xD0, {});
+        break;
+    case 0xE0: // DISCONNECT
+        _connected = false;
+        break;
+    }
+}
+
+void FakeBroker::send(uint8_t header, const std::vector<uint8_t>& body) {
+    _toClient.push_back(header);
+    size_t remaining = body.size();
+    do {
+        uint8_t digit = remaining & 0x7F;
+        remaining >>= 7;
+        _toClient.push_back(remaining > 0 ? (digit | 0x80) : digit);
+    } while (remaining > 0);
+    _toClient.insert(_toClient.end(), body.begin(), body.end());
+}
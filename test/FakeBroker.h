@@ -0,0 +1,96 @@
+/**
+ * @file FakeBroker.h
+ * @brief MQTT broker played on the other side of a Client, for the MqttManager tests.
+ *
+ * Installed as the network of WiFiClient, it accepts or refuses the TCP connections,
+ * answers CONNECT, SUBSCRIBE and PINGREQ, records the PUBLISH packets it receives
+ * (acknowledging QoS 1 ones unless told not to), and delivers messages to the client.
+ * Packets written by the client are parsed whole; packets to the client are queued and
+ * read by PubSubClient from loop().
+ */
+#ifndef FAKE_BROKER_H
+#define FAKE_BROKER_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+class FakeBroker : public Client {
+public:
+    /**
+     * @brief A PUBLISH packet received from the client.
+     */
+    struct Publish {
+        std::string topic;
+        std::string payload;
+        uint8_t qos;
+        bool duplicate;
+        bool retained;
+        uint16_t packetId;
+    };
+
+    FakeBroker();
+    ~FakeBroker();
+
+    void setReachable(bool value) { _reachable = value; }            ///< TCP connections are accepted.
+    void setConnectDelay(unsigned long ms) { _connectDelay = ms; }  ///< Time a refused connection takes (manual clock).
+    void setConnackCode(uint8_t value) { _connackCode = value; }    ///< Return code of the CONNACK, 0 to accept.
+    void setAutoAck(bool value) { _autoAck = value; }                ///< Acknowledge QoS 1 PUBLISH packets.
+
+    /**
+     * @brief Queues a PUBLISH to the client.
+     */
+    void deliver(const std::string& topic, const std::string& payload, uint8_t qos = 0, uint16_t packetId = 1);
+
+    /**
+     * @brief Queues a PUBACK to the client.
+     */
+    void acknowledge(uint16_t packetId);
+
+    /**
+     * @brief Closes the connection from the broker side.
+     */
+    void drop() { _connected = false; _toClient.clear(); }
+
+    uint32_t getConnects() const { return _connects; }               ///< TCP connection attempts.
+    const std::vector<unsigned long>& getConnectTimes() const { return _connectTimes; } ///< millis() of each attempt.
+    const std::vector<Publish>& getPublished() const { return _published; }
+    const std::vector<std::string>& getSubscriptions() const { return _subscriptions; }
+    uint32_t getPubacks() const { return _pubacks; }                 ///< PUBACK packets received from the client.
+    void clear() { _published.clear(); _subscriptions.clear(); _pubacks = 0; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override { return (int)_toClient.size(); }
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override { return _toClient.empty() ? -1 : _toClient.front(); }
+    void flush() override {}
+    void stop() override { _connected = false; _toClient.clear(); _fromClient.clear(); }
+    uint8_t connected() override { return _connected || !_toClient.empty(); }
+    operator bool() override { return _connected; }
+
+private:
+    void handle(const std::vector<uint8_t>& packet, size_t bodyStart);
+    void send(uint8_t header, const std::vector<uint8_t>& body);
+
+    bool _reachable = true;
+    unsigned long _connectDelay = 0;
+    uint8_t _connackCode = 0;
+    bool _autoAck = true;
+    bool _connected = false;
+    uint32_t _connects = 0;
+    std::vector<unsigned long> _connectTimes;
+    std::vector<uint8_t> _fromClient;   ///< Bytes written by the client, not yet a whole packet.
+    std::deque<uint8_t> _toClient;      ///< Bytes to be read by the client.
+    std::vector<Publish> _published;
+    std::vector<std::string> _subscriptions;
+    uint32_t _pubacks = 0;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file FileSystemIndexTest.cpp
+ * @brief Tests of the FileSystemIndex: pages of a listing, and the index kept in step with
+ * the directories LittleFS removes when they are left empty.
+ */
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <LittleFS.h>
+#include "OTA/FileSystemIndex.h"
+
+namespace {
+
+class FileSystemIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(LittleFS.begin());
+        LittleFS.format();
+    }
+
+    static void write(const char* path) {
+        File file = LittleFS.open(path, "w");
+        ASSERT_TRUE(file);
+        file.print("data");
+        file.close();
+    }
+
+    static std::vector<std::string> list(FileSystemIndex& index, FileIndexQuery query = FileIndexQuery()) {
+        std::vector<std::string> paths;
+        index.list(query, [&](const String& path, bool, uint32_t) { paths.push_back(path.c_str()); });
+        return paths;
+    }
+};
+
+TEST_F(FileSystemIndexTest, PagesCarryTheTotalAndWhetherMoreFollow) {
+    LittleFS.mkdir("/logs");
+    for (int i = 0; i < 5; i++) {
+        write(("/logs/" + std::to_string(i) + ".csv").c_str());
+    }
+    FileSystemIndex index;
+    FileIndexQuery query;
+    query.path = "/logs";
+    query.limit = 2;
+    query.offset = 2;
+    std::vector<std::string> paths;
+    FileIndexPage page = index.list(query, [&](const String& path, bool, uint32_t) { paths.push_back(path.c_str()); });
+    EXPECT_EQ(std::vector<std::string>({ "/logs/2.csv", "/logs/3.csv" }), paths);
+    EXPECT_EQ(2u, page.listed);
+    EXPECT_EQ(5, page.total);
+    EXPECT_TRUE(page.more);
+    EXPECT_TRUE(index.isIndexed());
+}
+
+TEST_F(FileSystemIndexTest, RemovingTheLastFileDropsTheEmptyParents) {
+    LittleFS.mkdir("/www");
+    LittleFS.mkdir("/www/css");
+    write("/www/css/site.css");
+    write("/index.html");
+    FileSystemIndex index;
+    EXPECT_EQ(4u, list(index).size());
+
+    ASSERT_TRUE(LittleFS.remove("/www/css/site.css"));
+    index.removed("/www/css/site.css");
+    EXPECT_FALSE(LittleFS.exists("/www"));
+    EXPECT_EQ(std::vector<std::string>({ "/index.html" }), list(index));
+    EXPECT_EQ(1u, index.getBuilds()); // Updated in place
+}
+
+TEST_F(FileSystemIndexTest, RemovingAFileKeepsAParentThatStillExists) {
+    LittleFS.mkdir("/logs");
+    write("/logs/a.csv");
+    write("/logs/b.csv");
+    FileSystemIndex index;
+    list(index);
+
+    ASSERT_TRUE(LittleFS.remove("/logs/a.csv"));
+    index.removed("/logs/a.csv");
+    EXPECT_EQ(std::vector<std::string>({ "/logs", "/logs/b.csv" }), list(index));
+}
+
+} // namespace
@@ -0,0 +1,63 @@
+/**
+ * @file FileUploadSessionTest.cpp
+ * @brief Tests of the FileUploadSession: the target is only replaced by a complete upload.
+ */
+#include <gtest/gtest.h>
+#include <string>
+#include <LittleFS.h>
+#include "OTA/FileUploadSession.h"
+
+namespace {
+
+class FileUploadSessionTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(LittleFS.begin());
+        LittleFS.format();
+    }
+
+    static std::string content(const char* path) {
+        File file = LittleFS.open(path, "r");
+        std::string text;
+        while (file && file.available()) text += (char)file.read();
+        return text;
+    }
+
+    static bool store(const char* path, const std::string& text) {
+        FileUploadSession session(path);
+        return session.begin(false) && session.write((const uint8_t*)text.data(), text.size()) && session.end();
+    }
+};
+
+TEST_F(FileUploadSessionTest, ReplacesThePreviousVersion) {
+    ASSERT_TRUE(store("/config.json", "{\"version\":1}"));
+    ASSERT_TRUE(store("/config.json", "{\"version\":2}"));
+    EXPECT_EQ("{\"version\":2}", content("/config.json"));
+    EXPECT_FALSE(LittleFS.exists("/" OTA_UPLOAD_TEMP_NAME));
+}
+
+TEST_F(FileUploadSessionTest, KeepsThePreviousVersionWhenTheRenameFails) {
+    ASSERT_TRUE(store("/config.json", "{\"version\":1}"));
+    LittleFS.setRenameFailures(1);
+    FileUploadSession session("/config.json");
+    ASSERT_TRUE(session.begin(false));
+    ASSERT_TRUE(session.write((const uint8_t*)"{\"version\":2}", 13));
+    EXPECT_FALSE(session.end());
+    EXPECT_EQ(FILE_UPLOAD_ERROR_RENAME, session.getError());
+    session.abort();
+    EXPECT_EQ("{\"version\":1}", content("/config.json"));
+    EXPECT_FALSE(LittleFS.exists("/" OTA_UPLOAD_TEMP_NAME));
+}
+
+TEST_F(FileUploadSessionTest, AbortedUploadLeavesTheTargetUntouched) {
+    ASSERT_TRUE(store("/config.json", "{\"version\":1}"));
+    {
+        FileUploadSession session("/config.json");
+        ASSERT_TRUE(session.begin(false));
+        ASSERT_TRUE(session.write((const uint8_t*)"{\"vers", 6));
+    } // Destroyed without end(), as by a dropped connection
+    EXPECT_EQ("{\"version\":1}", content("/config.json"));
+    EXPECT_FALSE(LittleFS.exists("/" OTA_UPLOAD_TEMP_NAME));
+}
+
+} // namespace
@@ -0,0 +1,234 @@
+/**
+ * @file GzipInflaterTest.cpp
+ * @brief Tests of the GzipInflater against zlib: byte-exact output for every block type,
+ * header field, window and chunking, and corrupted streams that must fail cleanly.
+ */
+#include <gtest/gtest.h>
+#include <random>
+#include <string.h>
+#include <vector>
+#include <zlib.h>
+#include "OTA/GzipInflater.h"
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+/**
+ * @brief Gzip stream of data made by zlib; with a header, its optional fields are set.
+ */
+Bytes compress(const Bytes& data, int windowBits, int level = 9, int strategy = Z_DEFAULT_STRATEGY, bool header = false) {
+    z_stream stream = {};
+    EXPECT_EQ(Z_OK, deflateInit2(&stream, level, Z_DEFLATED, 16 + windowBits, 8, strategy));
+    gz_header fields = {};
+    uint8_t extra[] = { 'I', 'o', 4, 0, 1, 2, 3, 4 };
+    if (header) {
+        fields.extra = extra;
+        fields.extra_len = sizeof(extra);
+        fields.name = (Bytef*)"datalog.csv";
+        fields.comment = (Bytef*)"host test";
+        fields.hcrc = 1;
+        EXPECT_EQ(Z_OK, deflateSetHeader(&stream, &fields));
+    }
+    Bytes output(deflateBound(&stream, data.size()) + 64);
+    stream.next_in = const_cast<Bytef*>(data.data());
+    stream.avail_in = data.size();
+    stream.next_out = output.data();
+    stream.avail_out = output.size();
+    EXPECT_EQ(Z_STREAM_END, deflate(&stream, Z_FINISH));
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+/**
+ * @brief Output of zlib for a gzip stream, and whether zlib accepted it.
+ */
+bool zlibInflate(const Bytes& input, Bytes& output) {
+    z_stream stream = {};
+    if (inflateInit2(&stream, 16 + 15) != Z_OK) return false;
+    stream.next_in = const_cast<Bytef*>(input.data());
+    stream.avail_in = input.size();
+    uint8_t buffer[4096];
+    int status;
+    do {
+        stream.next_out = buffer;
+        stream.avail_out = sizeof(buffer);
+        status = inflate(&stream, Z_NO_FLUSH);
+        output.insert(output.end(), buffer, buffer + sizeof(buffer) - stream.avail_out);
+    } while (status == Z_OK);
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+/**
+ * @brief Result of a GzipInflater fed in chunks of the given sizes, cycled.
+ */
+struct Inflated {
+    bool ok;
+    GzipInflaterError error;
+    Bytes output;
+};
+
+Inflated inflate(const Bytes& input, size_t windowSize, const std::vector<size_t>& chunks = { 1460 }) {
+    Inflated result = { false, GZIP_OK, {} };
+    GzipInflater inflater(windowSize);
+    if (!inflater.begin([&](const uint8_t* data, size_t length) {
+            result.output.insert(result.output.end(), data, data + length);
+            return true;
+        })) {
+        result.error = inflater.getError();
+        return result;
+    }
+    bool written = true;
+    for (size_t offset = 0, i = 0; written && offset < input.size(); i++) {
+        size_t length = std::min(chunks[i % chunks.size()], input.size() - offset);
+        written = inflater.write(input.data() + offset, length);
+        offset += length;
+    }
+    result.ok = written && inflater.end();
+    result.error = inflater.getError();
+    return result;
+}
+
+/**
+ * @brief Data mixing runs, repeated phrases (near and far) and noise, as in logs and web files.
+ */
+Bytes sample(std::mt19937& random, size_t size) {
+    static const char* const phrases[] = { "<div class=\"row\">", "\"temperature\":", ",21.5,", "GET /api/files HTTP/1.1\r\n", "\n" };
+    Bytes data;
+    while (data.size() < size) {
+        switch (random() % 4) {
+        case 0:
+            data.insert(data.end(), random() % 300, (uint8_t)random());
+            break;
+        case 1: {
+            const char* phrase = phrases[random() % 5];
+            data.insert(data.end(), phrase, phrase + strlen(phrase));
+            break;
+        }
+        case 2:
+            if (!data.empty()) {
+                size_t start = random() % data.size();
+                size_t length = std::min<size_t>(3 + random() % 200, data.size() - start);
+                Bytes copy(data.begin() + start, data.begin() + start + length);
+                data.insert(data.end(), copy.begin(), copy.end());
+            }
+            break;
+        default:
+            for (uint32_t n = random() % 64; n > 0; n--) data.push_back((uint8_t)random());
+        }
+    }
+    data.resize(size);
+    return data;
+}
+
+TEST(GzipInflaterTest, DefaultWindowIsFourKilobytes) {
+    EXPECT_EQ(4096, GZIP_INFLATER_WINDOW_SIZE);
+}
+
+TEST(GzipInflaterTest, InflatesEveryBlockTypeByteExact) {
+    std::mt19937 random(1);
+    Bytes data = sample(random, 50000);
+    struct { int level; int strategy; } cases[] = {
+        { 0, Z_DEFAULT_STRATEGY },   // Stored blocks
+        { 9, Z_FIXED },              // Fixed Huffman codes
+        { 9, Z_DEFAULT_STRATEGY },   // Dynamic Huffman codes
+        { 1, Z_HUFFMAN_ONLY },       // Literals only
+        { 6, Z_RLE },                // Distance 1 matches
+    };
+    for (const auto& c : cases) {
+        Inflated result = inflate(compress(data, 12, c.level, c.strategy), 4096);
+        EXPECT_TRUE(result.ok) << "level " << c.level << " strategy " << c.strategy << " error " << result.error;
+        EXPECT_TRUE(result.output == data) << "level " << c.level << " strategy " << c.strategy;
+    }
+}
+
+TEST(GzipInflaterTest, SkipsOptionalHeaderFields) {
+    std::mt19937 random(2);
+    Bytes data = sample(random, 3000);
+    Inflated result = inflate(compress(data, 12, 9, Z_DEFAULT_STRATEGY, true), 4096, { 1 });
+    EXPECT_TRUE(result.ok) << result.error;
+    EXPECT_TRUE(result.output == data);
+}
+
+TEST(GzipInflaterTest, InflatesEmptyInput) {
+    Inflated result = inflate(compress(Bytes(), 12), 4096);
+    EXPECT_TRUE(result.ok);
+    EXPECT_TRUE(result.output.empty());
+}
+
+TEST(GzipInflaterTest, RejectsBackReferencesBeyondTheWindow) {
+    std::mt19937 random(3);
+    Bytes block(8192);
+    for (uint8_t& b : block) b = (uint8_t)random();
+    Bytes data(block);
+    data.insert(data.end(), block.begin(), block.end()); // Matches 8 KB back
+    Bytes stream = compress(data, 15);
+
+    Inflated small = inflate(stream, 4096);
+    EXPECT_FALSE(small.ok);
+    EXPECT_EQ(GZIP_ERROR_DISTANCE, small.error);
+
+    Inflated large = inflate(stream, 32768);
+    EXPECT_TRUE(large.ok);
+    EXPECT_TRUE(large.output == data);
+}
+
+TEST(GzipInflaterTest, ReportsTruncatedAndCorruptTrailers) {
+    std::mt19937 random(4);
+    Bytes data = sample(random, 10000);
+    Bytes stream = compress(data, 12);
+
+    Bytes truncated(stream.begin(), stream.end() - 3);
+    EXPECT_EQ(GZIP_ERROR_TRUNCATED, inflate(truncated, 4096).error);
+
+    Bytes corrupt(stream);
+    corrupt[corrupt.size() - 8] ^= 0x01; // CRC-32
+    Inflated result = inflate(corrupt, 4096);
+    EXPECT_FALSE(result.ok);
+    EXPECT_EQ(GZIP_ERROR_CHECKSUM, result.error);
+
+    Bytes notGzip(stream);
+    notGzip[0] = 'P';
+    EXPECT_EQ(GZIP_ERROR_HEADER, inflate(notGzip, 4096).error);
+}
+
+TEST(GzipInflaterTest, MatchesZlibOnRandomStreamsAndChunks) {
+    std::mt19937 random(5);
+    for (int i = 0; i < 300; i++) {
+        Bytes data = sample(random, random() % 40000);
+        int windowBits = 9 + random() % 4;
+        int level = random() % 10;
+        Bytes stream = compress(data, windowBits, level, random() % 4 == 0 ? Z_FIXED : Z_DEFAULT_STRATEGY, random() % 2);
+        std::vector<size_t> chunks = { 1 + random() % 3000, 1 + random() % 7, 1 + random() % 600 };
+        Inflated result = inflate(stream, 4096, chunks);
+        ASSERT_TRUE(result.ok) << "iteration " << i << " error " << result.error;
+        ASSERT_TRUE(result.output == data) << "iteration " << i;
+    }
+}
+
+TEST(GzipInflaterTest, CorruptedStreamsFailOrMatchZlib) {
+    std::mt19937 random(6);
+    int rejected = 0;
+    for (int i = 0; i < 2000; i++) {
+        Bytes stream = compress(sample(random, 500 + random() % 8000), 12, 1 + random() % 9);
+        for (uint32_t n = 1 + random() % 4; n > 0; n--) {
+            size_t at = 10 + random() % (stream.size() - 10); // Past the fixed header
+            stream[at] ^= (uint8_t)(1 + random() % 255);
+        }
+        Inflated result = inflate(stream, 32768, { 1 + random() % 1500 });
+        Bytes expected;
+        bool accepted = zlibInflate(stream, expected);
+        if (result.ok) {
+            ASSERT_TRUE(accepted) << "iteration " << i;
+            ASSERT_TRUE(result.output == expected) << "iteration " << i;
+        } else {
+            EXPECT_NE(GZIP_OK, result.error);
+            rejected++;
+        }
+    }
+    EXPECT_GT(rejected, 1900);
+}
+
+} // namespace
@@ -0,0 +1,175 @@
+/**
+ * @file HTTPServerManagerTest.cpp
+ * @brief Tests of the HTTPServerManager over loopback: static files with their ranges,
+ * registered pages, the metrics and the WebSocket broadcasts.
+ */
+#include <gtest/gtest.h>
+#include <string>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <WebSocketsServer.h>
+#include "LoopbackHttp.h"
+#include "HTTPServerManager/HTTPServerManager.h"
+
+namespace {
+
+const std::string page = "<html><body>0123456789abcdefghij</body></html>";
+
+class HTTPServerManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(LittleFS.begin());
+        LittleFS.format();
+        store("/public_html/index.html", page);
+        manager.begin();
+        port = WiFiServer::hostPort(80);
+        ASSERT_NE(0, port);
+    }
+
+    static void store(const char* path, const std::string& content) {
+        File file = LittleFS.open(path, "w");
+        file.write((const uint8_t*)content.data(), content.size());
+        file.close();
+    }
+
+    LoopbackHttp::Response get(const std::string& target, const std::vector<std::pair<std::string, std::string>>& headers = {}, const char* method = "GET") {
+        LoopbackHttp::Request request;
+        request.method = method;
+        request.target = target;
+        request.headers = headers;
+        return LoopbackHttp::request(port, request, [this]() { manager.loop(); });
+    }
+
+    HTTPServerManager manager;
+    uint16_t port = 0;
+};
+
+TEST_F(HTTPServerManagerTest, ServesStaticFilesWithTheirType) {
+    LoopbackHttp::Response response = get("/");
+    EXPECT_EQ(200, response.code);
+    EXPECT_EQ("text/html", response.header("Content-Type"));
+    EXPECT_EQ("bytes", response.header("Accept-Ranges"));
+    EXPECT_FALSE(response.header("ETag").empty());
+    EXPECT_TRUE(response.complete);
+    EXPECT_EQ(page, response.body);
+
+    EXPECT_EQ(404, get("/missing.css").code);
+}
+
+TEST_F(HTTPServerManagerTest, StreamsFilesLargerThanTheBuffer) {
+    std::string script(20000, 'x');
+    for (size_t i = 0; i < script.size(); i++) script[i] = (char)('a' + i % 26);
+    store("/public_html/app.js", script);
+    ASSERT_TRUE(manager.setStreamBufferSize(512));
+    LoopbackHttp::Response response = get("/app.js");
+    EXPECT_EQ(200, response.code);
+    EXPECT_EQ("application/javascript", response.header("Content-Type"));
+    EXPECT_EQ(script, response.body);
+}
+
+TEST_F(HTTPServerManagerTest, AnswersRangesWithPartialContent) {
+    LoopbackHttp::Response response = get("/index.html", { { "Range", "bytes=12-21" } });
+    EXPECT_EQ(206, response.code);
+    EXPECT_EQ("bytes 12-21/" + std::to_string(page.size()), response.header("Content-Range"));
+    EXPECT_EQ(page.substr(12, 10), response.body);
+
+    response = get("/index.html", { { "Range", "bytes=-7" } });
+    EXPECT_EQ(206, response.code);
+    EXPECT_EQ(page.substr(page.size() - 7), response.body);
+
+    response = get("/index.html", { { "Range", "bytes=40-" } });
+    EXPECT_EQ(206, response.code);
+    EXPECT_EQ(page.substr(40), response.body);
+}
+
+TEST_F(HTTPServerManagerTest, SendsTheWholeFileWhenIfRangeDoesNotMatch) {
+    std::string etag = get("/index.html").header("ETag");
+    LoopbackHttp::Response response = get("/index.html", { { "Range", "bytes=12-" }, { "If-Range", etag } });
+    EXPECT_EQ(206, response.code);
+
+    response = get("/index.html", { { "Range", "bytes=12-" }, { "If-Range", "\"stale\"" } });
+    EXPECT_EQ(200, response.code);
+    EXPECT_EQ(page, response.body);
+}
+
+TEST_F(HTTPServerManagerTest, RejectsARangeStartingPastTheEnd) {
+    LoopbackHttp::Response response = get("/index.html", { { "Range", "bytes=1000-" } });
+    EXPECT_EQ(416, response.code);
+    EXPECT_EQ("bytes */" + std::to_string(page.size()), response.header("Content-Range"));
+}
+
+TEST_F(HTTPServerManagerTest, IgnoresAMalformedRange) {
+    LoopbackHttp::Response response = get("/index.html", { { "Range", "bytes=5-3" } });
+    EXPECT_EQ(200, response.code);
+    EXPECT_TRUE(response.header("Content-Range").empty());
+    EXPECT_EQ(page, response.body);
+
+    response = get("/index.html", { { "Range", "bytes=x-" } });
+    EXPECT_EQ(200, response.code);
+    EXPECT_EQ(page, response.body);
+
+    response = get("/index.html", { { "Range", "bytes=-0" } });
+    EXPECT_EQ(416, response.code);
+}
+
+TEST_F(HTTPServerManagerTest, AnswersHeadWithoutBody) {
+    LoopbackHttp::Response response = get("/index.html", {}, "HEAD");
+    EXPECT_EQ(200, response.code);
+    EXPECT_EQ(std::to_string(page.size()), response.header("Content-Length"));
+    EXPECT_TRUE(response.body.empty());
+}
+
+TEST_F(HTTPServerManagerTest, RoutesRegisteredPagesWithTheirArguments) {
+    manager.registerPage("/api/echo", HTTP_GET, [](ESP8266WebServer& server) {
+        server.send(200, "text/plain", server.arg("text"));
+    });
+    LoopbackHttp::Response response = get("/api/echo?text=hello%20world");
+    EXPECT_EQ(200, response.code);
+    EXPECT_EQ("hello world", response.body);
+
+    EXPECT_EQ(404, get("/api/echo?text=x", {}, "DELETE").code); // Other methods fall to the static files
+}
+
+TEST_F(HTTPServerManagerTest, ReportsTheRequestMetrics) {
+    get("/index.html");
+    get("/index.html", { { "Range", "bytes=0-9" } });
+    manager.addMetricsProvider("custom", [](JsonObject section) { section["value"] = 42; });
+
+    LoopbackHttp::Response response = get("/api/metrics?reset=1");
+    ASSERT_EQ(200, response.code);
+    JsonDocument metrics;
+    ASSERT_FALSE(deserializeJson(metrics, response.body));
+    EXPECT_EQ(2, metrics["files"]["count"].as<int>());
+    EXPECT_EQ(1, metrics["files"]["ranges"].as<int>());
+    EXPECT_EQ(page.size() + 10, metrics["files"]["bytes"].as<size_t>());
+    EXPECT_EQ(42, metrics["custom"]["value"].as<int>());
+
+    ASSERT_FALSE(deserializeJson(metrics, get("/api/metrics").body));
+    EXPECT_EQ(0, metrics["files"]["count"].as<int>());
+}
+
+TEST_F(HTTPServerManagerTest, BroadcastsToTheWebSocketClients) {
+    WebSocketsServer* webSocket = WebSocketsServer::find(81);
+    ASSERT_NE(nullptr, webSocket);
+    int first = webSocket->hostConnect();
+    int second = webSocket->hostConnect();
+    ASSERT_GE(first, 0);
+    ASSERT_GE(second, 0);
+
+    manager.broadcastWebSocketMessage("{\"temperature\":21.5}");
+    EXPECT_EQ("{\"temperature\":21.5}", webSocket->hostLastText(first));
+    EXPECT_EQ("{\"temperature\":21.5}", webSocket->hostLastText(second));
+
+    webSocket->hostReceive(first, "ping");
+    EXPECT_EQ("Message received: ping", webSocket->hostLastText(first));
+    EXPECT_EQ(1u, webSocket->hostFrames(second));
+
+    webSocket->hostDisconnect(second);
+    JsonDocument metrics;
+    ASSERT_FALSE(deserializeJson(metrics, get("/api/metrics").body));
+    EXPECT_EQ(1, metrics["websocket"]["count"].as<int>());
+    EXPECT_EQ(2 * 20, metrics["websocket"]["bytes"].as<int>());
+    EXPECT_EQ(1, metrics["websocket"]["clients"].as<int>());
+}
+
+} // namespace
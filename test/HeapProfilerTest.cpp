@@ -0,0 +1,230 @@
+/**
+ * @file HeapProfilerTest.cpp
+ * @brief Leak and fragmentation tests of the framework in the simulated heap, and tests of
+ * the heap accounting of HEAP_SCOPE.
+ *
+ * The components are built with IOT_HEAP_PROFILER, so their HEAP_SCOPE markers record into
+ * HeapProfiler, and ESP.getFreeHeap() reports on the arena of HostHeap.
+ */
+#include <gtest/gtest.h>
+#include <vector>
+#include <ESP8266WiFi.h>
+#include <HostHeap.h>
+#include <LittleFS.h>
+#include "SinkBroker.h"
+#include "HeapProfiler/HeapProfiler.h"
+#include "MqttManager/MqttManager.h"
+#include "OTA/FileUploadSession.h"
+#include "OTA/TarArchive.h"
+
+namespace {
+
+/**
+ * @brief Keeps the test allocations observable: the compiler may otherwise elide a new
+ * whose block is never used.
+ */
+void* volatile sink;
+
+char* allocate(size_t size) {
+    char* block = new char[size];
+    sink = block;
+    return block;
+}
+
+class HeapProfilerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(LittleFS.begin());
+        LittleFS.format();
+        HeapProfiler::resetStats();
+    }
+
+    /**
+     * @brief Uploads content in chunks of the size of a TCP segment, as the web server hands them.
+     */
+    static bool upload(const char* path, const std::vector<uint8_t>& content) {
+        FileUploadSession session(path);
+        if (!session.begin(false)) return false;
+        for (size_t offset = 0; offset < content.size(); offset += 1460) {
+            size_t length = content.size() - offset < 1460 ? content.size() - offset : 1460;
+            if (!session.write(content.data() + offset, length)) return false;
+        }
+        return session.end();
+    }
+};
+
+TEST_F(HeapProfilerTest, ScopeAttributesRetainedHeapToItsTag) {
+    HostHeapScope heap;
+    ASSERT_TRUE(heap.isStarted());
+    char* leaked = nullptr;
+    {
+        HEAP_SCOPE_AT(HEAP_TAG_APP, 0);
+        leaked = allocate(256);
+    }
+    {
+        HEAP_SCOPE_AT(HEAP_TAG_APP, 0);
+        char* temporary = allocate(512);
+        delete[] temporary;
+    }
+    const HeapTagStats& stats = HeapProfiler::getStats(HEAP_TAG_APP);
+    EXPECT_EQ(2u, stats.scopes);
+    EXPECT_GE(stats.retained, 256);       // The block and its header
+    EXPECT_LE(stats.retained, 256 + 16);
+    EXPECT_EQ(stats.retained, stats.maxRetained);
+    EXPECT_EQ(0u, HeapProfiler::getStats(HEAP_TAG_HTTP).scopes);
+    delete[] leaked;
+}
+
+TEST_F(HeapProfilerTest, SnapshotReportsTheArenaAndTheLowestFreeHeap) {
+    HostHeapScope heap;
+    ASSERT_TRUE(heap.isStarted());
+    HeapProfiler::resetStats();
+    uint32_t start = HostHeap::getFree();
+    char* block = allocate(4096);
+    HeapSnapshot during = HeapProfiler::snapshot();
+    delete[] block;
+    HeapSnapshot after = HeapProfiler::snapshot();
+
+    EXPECT_LT(during.free, start - 4000);
+    EXPECT_EQ(start, after.free);
+    EXPECT_EQ(HostHeap::getMaxFreeBlock(), after.maxBlock);
+    EXPECT_EQ(HostHeap::getFragmentation(), after.fragmentation);
+    EXPECT_EQ(during.free, HeapProfiler::getMinFree());
+    EXPECT_TRUE(HeapProfiler::isTracking());
+}
+
+TEST_F(HeapProfilerTest, MqttSessionsDoNotLeak) {
+    HostClock::setManual(true);
+    WiFi.setStatus(WL_CONNECTED);
+    WiFi.clearHosts();
+    HostHeapScope heap;
+    ASSERT_TRUE(heap.isStarted());
+    {
+        SinkBroker broker;
+        MqttManager mqtt(nullptr);
+        mqtt.setServer("10.0.0.2");
+        mqtt.setPort(1883);
+        mqtt.setClientId("device");
+        mqtt.setUsername(nullptr);
+        mqtt.setPassword(nullptr);
+        mqtt.setTopicPrefix("Test", "Device1");
+        mqtt.begin();
+
+        uint32_t warm = 0;
+        for (int round = 0; round < 5; round++) {
+            for (int i = 0; i < 10 && mqtt.getState() != MQTT_STATE_CONNECTED; i++) {
+                mqtt.loop();
+                HostClock::advance(100000);
+            }
+            ASSERT_EQ(MQTT_STATE_CONNECTED, mqtt.getState());
+            for (int i = 0; i < 50; i++) {
+                mqtt.publish("temperature", 21.5 + i, 1);
+            }
+            WiFi.setStatus(WL_DISCONNECTED); // Queued, then drained on reconnection
+            mqtt.loop();
+            for (int i = 0; i < 20; i++) {
+                mqtt.publish("count", (long)i);
+            }
+            WiFi.setStatus(WL_CONNECTED);
+            for (int i = 0; i < 100; i++) {
+                mqtt.loop();
+                HostClock::advance(100000);
+            }
+            if (round == 0) {
+                warm = HostHeap::getFree(); // Buffers allocated on the first connection
+            } else {
+                EXPECT_EQ(warm, HostHeap::getFree()) << "round " << round;
+            }
+        }
+        const HeapTagStats& stats = HeapProfiler::getStats(HEAP_TAG_MQTT);
+        EXPECT_GT(stats.scopes, 0u);
+        EXPECT_LE(stats.maxRetained, 0);
+    }
+    HostClock::setManual(false);
+}
+
+TEST_F(HeapProfilerTest, RepeatedUploadsReturnTheHeap) {
+    std::vector<uint8_t> content(16 * 1024);
+    for (size_t i = 0; i < content.size(); i++) content[i] = (uint8_t)(i * 31);
+    HostHeapScope heap;
+    ASSERT_TRUE(heap.isStarted());
+    uint32_t free = HostHeap::getFree();
+    uint32_t maxBlock = HostHeap::getMaxFreeBlock();
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(upload("/upload.bin", content));
+    }
+    EXPECT_EQ(free, HostHeap::getFree());
+    EXPECT_EQ(maxBlock, HostHeap::getMaxFreeBlock());
+    EXPECT_EQ(0u, HostHeap::getFailures());
+}
+
+TEST_F(HeapProfilerTest, RepeatedArchiveExtractionsReturnTheHeap) {
+    std::vector<uint8_t> archive;
+    TarWriter writer;
+    writer.begin([&](const uint8_t* data, size_t length) { archive.insert(archive.end(), data, data + length); return true; });
+    writer.addDirectory("www");
+    for (int i = 0; i < 8; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "www/file%d.txt", i);
+        uint32_t remaining = 700 + 300 * i;
+        writer.addFile(name, remaining, 0, [&](uint8_t* data, size_t length) {
+            size_t chunk = remaining < length ? remaining : length;
+            memset(data, 'a' + i, chunk);
+            remaining -= chunk;
+            return chunk;
+        });
+    }
+    writer.end();
+
+    HostHeapScope heap;
+    ASSERT_TRUE(heap.isStarted());
+    uint32_t free = 0;
+    for (int round = 0; round < 5; round++) {
+        FileUploadSession* session = nullptr;
+        TarReader reader;
+        reader.begin(
+            [&](const TarEntry& entry) {
+                if (entry.type == TAR_ENTRY_DIRECTORY) {
+                    LittleFS.mkdir(String("/") + entry.name); // Already there after the first round
+                    return true;
+                }
+                session = new FileUploadSession(String("/") + entry.name);
+                return session->begin(false);
+            },
+            [&](const uint8_t* data, size_t length) { return session->write(data, length); },
+            [&](const TarEntry&) { bool stored = session->end(); delete session; session = nullptr; return stored; });
+        for (size_t offset = 0; offset < archive.size(); offset += 1460) {
+            ASSERT_TRUE(reader.write(archive.data() + offset, archive.size() - offset < 1460 ? archive.size() - offset : 1460));
+        }
+        ASSERT_TRUE(reader.end());
+        if (round == 0) {
+            free = HostHeap::getFree();
+        } else {
+            EXPECT_EQ(free, HostHeap::getFree()) << "round " << round;
+        }
+    }
+}
+
+TEST_F(HeapProfilerTest, UploadNextToLongLivedBlockKeepsLargestBlock) {
+    std::vector<uint8_t> content(8 * 1024);
+    HostHeapScope heap;
+    ASSERT_TRUE(heap.isStarted());
+    char* before = allocate(1024);
+    char* longLived = allocate(64);  // Splits the arena if freed blocks cannot be merged back
+    delete[] before;
+    uint32_t free = HostHeap::getFree();
+    uint32_t maxBlock = HostHeap::getMaxFreeBlock();
+    EXPECT_LT(maxBlock, free);        // The hole left by the first block
+    EXPECT_GT(HostHeap::getFragmentation(), 0);
+
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(upload("/upload.bin", content));
+    }
+    EXPECT_EQ(free, HostHeap::getFree());
+    EXPECT_EQ(maxBlock, HostHeap::getMaxFreeBlock());
+    delete[] longLived;
+    EXPECT_EQ(HostHeap::getFree(), HostHeap::getMaxFreeBlock());
+    EXPECT_EQ(0, HostHeap::getFragmentation());
+}
+
+} // namespace
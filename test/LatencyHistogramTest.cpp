@@ -0,0 +1,70 @@
+/**
+ * @file LatencyHistogramTest.cpp
+ * @brief Tests of the LatencyHistogram percentiles.
+ */
+#include <gtest/gtest.h>
+#include "Metrics/LatencyHistogram.h"
+
+namespace {
+
+TEST(LatencyHistogramTest, IsEmptyAtStart) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0u, histogram.percentile(50));
+    EXPECT_EQ(0u, histogram.average());
+}
+
+TEST(LatencyHistogramTest, KeepsCountTotalAndMax) {
+    LatencyHistogram histogram;
+    histogram.record(100);
+    histogram.record(300);
+    histogram.record(0);
+    EXPECT_EQ(3u, histogram.count());
+    EXPECT_EQ(400u, histogram.total());
+    EXPECT_EQ(300u, histogram.max());
+    EXPECT_EQ(133u, histogram.average());
+}
+
+TEST(LatencyHistogramTest, ResolvesPercentilesWithinAFactorOfTwo) {
+    LatencyHistogram histogram;
+    for (uint32_t micros = 1; micros <= 1000; micros++) {
+        histogram.record(micros);
+    }
+    uint32_t median = histogram.percentile(50);
+    EXPECT_GE(median, 500u);
+    EXPECT_LT(median, 1000u);
+    uint32_t p99 = histogram.percentile(99);
+    EXPECT_GE(p99, 990u);
+    EXPECT_LE(p99, 1000u);   // Clamped to the maximum
+    EXPECT_EQ(1000u, histogram.percentile(100));
+}
+
+TEST(LatencyHistogramTest, PercentilesAreMonotonic) {
+    LatencyHistogram histogram;
+    for (uint32_t micros = 1; micros < 5000000; micros = micros * 3 + 7) {
+        histogram.record(micros);
+    }
+    uint32_t previous = 0;
+    for (uint8_t percent = 0; percent <= 100; percent += 5) {
+        uint32_t value = histogram.percentile(percent);
+        EXPECT_GE(value, previous) << "percentile " << (int)percent;
+        previous = value;
+    }
+}
+
+TEST(LatencyHistogramTest, CountsLongDurationsInTheLastBucket) {
+    LatencyHistogram histogram;
+    histogram.record(60000000);
+    EXPECT_EQ(60000000u, histogram.percentile(50));
+}
+
+TEST(LatencyHistogramTest, ResetClearsTheSamples) {
+    LatencyHistogram histogram;
+    histogram.record(42);
+    histogram.reset();
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0u, histogram.max());
+    EXPECT_EQ(0u, histogram.percentile(99));
+}
+
+} // namespace
@@ -0,0 +1,265 @@
+/**
+ * @file LoopbackHttp.cpp
+ * @brief Implementation of the loopback HTTP client and server of the tests.
+ */
+#include "LoopbackHttp.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+
+namespace {
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return text;
+}
+
+std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    size_t last = text.find_last_not_of(" \t\r");
+    return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+}
+
+bool sendAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t count = send(fd, data, length, MSG_NOSIGNAL);
+        if (count <= 0) return false;
+        data += count;
+        length -= count;
+    }
+    return true;
+}
+
+int connectLoopback(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Splits the status line and headers from the body of a raw response or request.
+ * @return Header lines, empty if the header block is not complete.
+ */
+std::vector<std::string> headerLines(const std::string& raw, size_t& bodyStart) {
+    std::vector<std::string> lines;
+    size_t end = raw.find("\r\n\r\n");
+    if (end == std::string::npos) return lines;
+    bodyStart = end + 4;
+    size_t start = 0;
+    while (start < end) {
+        size_t next = raw.find("\r\n", start);
+        if (next == std::string::npos || next > end) next = end;
+        lines.push_back(raw.substr(start, next - start));
+        start = next + 2;
+    }
+    return lines;
+}
+
+void parseHeader(const std::string& line, std::map<std::string, std::string>& headers) {
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) headers[lowercase(line.substr(0, colon))] = trim(line.substr(colon + 1));
+}
+
+/**
+ * @brief Decodes a chunked body; false if the last chunk has not arrived.
+ */
+bool decodeChunked(const std::string& raw, std::string& body) {
+    body.clear();
+    size_t position = 0;
+    while (true) {
+        size_t lineEnd = raw.find("\r\n", position);
+        if (lineEnd == std::string::npos) return false;
+        size_t size = strtoul(raw.substr(position, lineEnd - position).c_str(), nullptr, 16);
+        position = lineEnd + 2;
+        if (size == 0) return true;
+        if (position + size > raw.size()) return false;
+        body.append(raw, position, size);
+        position += size + 2;
+    }
+}
+
+LoopbackHttp::Response parseResponse(const std::string& raw) {
+    LoopbackHttp::Response response;
+    size_t bodyStart = 0;
+    std::vector<std::string> lines = headerLines(raw, bodyStart);
+    if (lines.empty() || lines[0].compare(0, 7, "HTTP/1.") != 0) return response;
+    response.code = atoi(lines[0].c_str() + 9);
+    for (size_t i = 1; i < lines.size(); i++) parseHeader(lines[i], response.headers);
+    std::string rest = raw.substr(bodyStart);
+    if (lowercase(response.header("transfer-encoding")) == "chunked") {
+        response.complete = decodeChunked(rest, response.body);
+    } else if (!response.header("content-length").empty()) {
+        size_t length = strtoul(response.header("content-length").c_str(), nullptr, 10);
+        response.complete = rest.size() >= length;
+        response.body = rest.substr(0, length);
+    } else {
+        response.body = rest;
+        response.complete = true; // Until the connection closes
+    }
+    return response;
+}
+
+} // namespace
+
+namespace LoopbackHttp {
+
+std::string Response::header(const std::string& name) const {
+    auto header = headers.find(lowercase(name));
+    return header != headers.end() ? header->second : std::string();
+}
+
+Response request(uint16_t port, const Request& request, const std::function<void()>& pump, unsigned long timeout) {
+    std::atomic<bool> done{false};
+    std::string raw;
+    std::thread client([&]() {
+        int fd = connectLoopback(port);
+        if (fd < 0) {
+            done = true;
+            return;
+        }
+        std::string head = request.method + " " + request.target + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n";
+        for (const auto& header : request.headers) head += header.first + ": " + header.second + "\r\n";
+        if (!request.body.empty() || request.method == "POST") head += "Content-Length: " + std::to_string(request.body.size()) + "\r\n";
+        head += "\r\n";
+        size_t bodyLength = std::min(request.cutAfter, request.body.size());
+        if (sendAll(fd, head.data(), head.size()) && sendAll(fd, request.body.data(), bodyLength) && bodyLength < request.body.size()) {
+            shutdown(fd, SHUT_WR); // Connection dropped in the middle of the body
+        }
+        char buffer[8192];
+        while (true) {
+            pollfd descriptor = { fd, POLLIN, 0 };
+            if (poll(&descriptor, 1, (int)timeout) <= 0) break;
+            ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+            if (count <= 0) break;
+            raw.append(buffer, count);
+        }
+        close(fd);
+        done = true;
+    });
+    auto start = std::chrono::steady_clock::now();
+    while (!done && std::chrono::steady_clock::now() - start < std::chrono::milliseconds(timeout)) {
+        pump();
+        std::this_thread::yield();
+    }
+    while (!done) { // Timed out: the client gives up on its own
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    client.join();
+    return parseResponse(raw);
+}
+
+Response get(uint16_t port, const std::string& target, const std::function<void()>& pump, const std::string& method) {
+    Request request;
+    request.method = method;
+    request.target = target;
+    return LoopbackHttp::request(port, request, pump);
+}
+
+Request upload(const std::string& target, const std::string& filename, const std::string& content) {
+    static const std::string boundary = "----LoopbackHttpBoundary7MA4YWxkTrZu0gW";
+    Request request;
+    request.method = "POST";
+    request.target = target;
+    request.headers.push_back({ "Content-Type", "multipart/form-data; boundary=" + boundary });
+    request.body = "--" + boundary + "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"" + filename
+        + "\"\r\nContent-Type: application/octet-stream\r\n\r\n" + content + "\r\n--" + boundary + "--\r\n";
+    return request;
+}
+
+} // namespace LoopbackHttp
+
+std::string LoopbackServer::Request::header(const std::string& name) const {
+    auto header = headers.find(lowercase(name));
+    return header != headers.end() ? header->second : std::string();
+}
+
+LoopbackServer::LoopbackServer(Handler handler) : _handler(handler) {
+    _listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(_listener, (sockaddr*)&address, sizeof(address)) == 0 && listen(_listener, 8) == 0
+        && getsockname(_listener, (sockaddr*)&address, &length) == 0) {
+        _port = ntohs(address.sin_port);
+    }
+    _thread = std::thread([this]() { run(); });
+}
+
+LoopbackServer::~LoopbackServer() {
+    _stop = true;
+    _thread.join();
+    close(_listener);
+}
+
+std::string LoopbackServer::url(const std::string& path) const {
+    return "http://127.0.0.1:" + std::to_string(_port) + path;
+}
+
+std::vector<LoopbackServer::Request> LoopbackServer::requests() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _requests;
+}
+
+std::string LoopbackServer::response(int code, const std::string& body, const std::vector<std::pair<std::string, std::string>>& headers) {
+    std::string reason = code == 200 ? "OK" : code == 206 ? "Partial Content" : code == 304 ? "Not Modified" : code == 404 ? "Not Found" : "Status";
+    std::string raw = "HTTP/1.1 " + std::to_string(code) + " " + reason + "\r\n";
+    for (const auto& header : headers) raw += header.first + ": " + header.second + "\r\n";
+    if (code != 304) raw += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    return raw + "Connection: close\r\n\r\n" + body;
+}
+
+void LoopbackServer::run() {
+    while (!_stop) {
+        pollfd descriptor = { _listener, POLLIN, 0 };
+        if (poll(&descriptor, 1, 20) <= 0) continue;
+        int fd = accept(_listener, nullptr, nullptr);
+        if (fd >= 0) serve(fd);
+    }
+}
+
+void LoopbackServer::serve(int fd) {
+    std::string raw;
+    size_t bodyStart = 0;
+    std::vector<std::string> lines;
+    char buffer[4096];
+    while (lines.empty() && !_stop) {
+        pollfd descriptor = { fd, POLLIN, 0 };
+        if (poll(&descriptor, 1, 20) == 0) continue;
+        ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+        if (count <= 0) break;
+        raw.append(buffer, count);
+        lines = headerLines(raw, bodyStart);
+    }
+    if (!lines.empty()) {
+        Request request;
+        size_t space = lines[0].find(' ');
+        request.method = lines[0].substr(0, space);
+        request.target = lines[0].substr(space + 1, lines[0].find(' ', space + 1) - space - 1);
+        for (size_t i = 1; i < lines.size(); i++) parseHeader(lines[i], request.headers);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _requests.push_back(request);
+        }
+        std::string response = _handler(request);
+        size_t length = std::min(response.size(), _dropAfter.exchange(std::string::npos));
+        sendAll(fd, response.data(), length);
+    }
+    shutdown(fd, SHUT_WR);
+    while (recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {} // Unread bytes would reset the connection
+    close(fd);
+}
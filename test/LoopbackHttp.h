@@ -0,0 +1,123 @@
+/**
+ * @file LoopbackHttp.h
+ * @brief HTTP client and server over loopback sockets, for the tests of the web handlers
+ * and of the pull updates.
+ *
+ * LoopbackHttp::request() plays a browser or a script: it sends a request to a server of
+ * the stand-ins from its own thread, while the test thread runs the component's loop()
+ * (which calls handleClient()) until the response is complete. LoopbackServer plays an
+ * update server on its own thread: each request is answered by a handler of the test,
+ * whose response can be cut, as by a dropped connection.
+ */
+#ifndef LOOPBACK_HTTP_H
+#define LOOPBACK_HTTP_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace LoopbackHttp {
+
+/**
+ * @brief A request of the client.
+ */
+struct Request {
+    std::string method = "GET";
+    std::string target = "/";                                   ///< Path and query string.
+    std::vector<std::pair<std::string, std::string>> headers;   ///< Headers besides Host, Connection and Content-Length.
+    std::string body;
+    size_t cutAfter = std::string::npos;                        ///< Bytes of the body sent before the connection is shut down.
+};
+
+/**
+ * @brief A response received by the client; the body is decoded if chunked.
+ */
+struct Response {
+    int code = 0;                                   ///< Status, 0 if no response arrived.
+    std::map<std::string, std::string> headers;     ///< Headers, by lowercase name.
+    std::string body;
+    bool complete = false;                          ///< The whole body arrived.
+
+    std::string header(const std::string& name) const;
+};
+
+/**
+ * @brief Sends a request to a loopback port and waits for the response, calling pump on
+ * the calling thread until it is complete, or for at most timeout ms.
+ */
+Response request(uint16_t port, const Request& request, const std::function<void()>& pump, unsigned long timeout = 10000);
+
+/**
+ * @brief Shorthand for a request without body.
+ */
+Response get(uint16_t port, const std::string& target, const std::function<void()>& pump, const std::string& method = "GET");
+
+/**
+ * @brief multipart/form-data request of a file, as sent by a browser form.
+ */
+Request upload(const std::string& target, const std::string& filename, const std::string& content);
+
+} // namespace LoopbackHttp
+
+/**
+ * @brief HTTP server on a loopback port, answering each request with a handler of the test.
+ */
+class LoopbackServer {
+public:
+    /**
+     * @brief A request received, with the header names in lowercase.
+     */
+    struct Request {
+        std::string method;
+        std::string target;
+        std::map<std::string, std::string> headers;
+
+        std::string header(const std::string& name) const;
+    };
+
+    /**
+     * @brief Response to a request: raw bytes of the status line, headers and body.
+     * The connection is closed after it.
+     */
+    typedef std::function<std::string(const Request&)> Handler;
+
+    explicit LoopbackServer(Handler handler);
+    ~LoopbackServer();
+    LoopbackServer(const LoopbackServer&) = delete;
+    LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+    uint16_t port() const { return _port; }
+    std::string url(const std::string& path) const;   ///< http://127.0.0.1:port/path.
+
+    /**
+     * @brief Cuts the next response after a number of bytes, as a dropped connection.
+     */
+    void dropAfter(size_t bytes) { _dropAfter = bytes; }
+
+    std::vector<Request> requests() const;   ///< Requests received so far.
+
+    /**
+     * @brief Builds a response; Content-Length is added from the body.
+     */
+    static std::string response(int code, const std::string& body, const std::vector<std::pair<std::string, std::string>>& headers = {});
+
+private:
+    void run();
+    void serve(int fd);
+
+    Handler _handler;
+    int _listener = -1;
+    uint16_t _port = 0;
+    std::atomic<bool> _stop{false};
+    std::atomic<size_t> _dropAfter{std::string::npos};
+    mutable std::mutex _mutex;
+    std::vector<Request> _requests;
+    std::thread _thread;
+};
+
+#endif
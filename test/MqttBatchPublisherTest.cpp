@@ -0,0 +1,121 @@
+/**
+ * @file MqttBatchPublisherTest.cpp
+ * @brief Tests of the MqttBatchPublisher: batch size while connected and while queued.
+ */
+#include <gtest/gtest.h>
+#include <ESP8266WiFi.h>
+#include "FakeBroker.h"
+#include "MqttManager/MqttBatchPublisher.h"
+
+namespace {
+
+class MqttBatchPublisherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        HostClock::setManual(true);
+        WiFi.setStatus(WL_CONNECTED);
+        mqtt.setServer("10.0.0.2");
+        mqtt.setPort(1883);
+        mqtt.setClientId("device");
+        mqtt.setUsername(nullptr);
+        mqtt.setPassword(nullptr);
+        mqtt.setTopicPrefix("Test", "Device1");
+        mqtt.begin();
+        batch.setTimestamp(false);
+    }
+
+    void TearDown() override {
+        HostClock::setManual(false);
+    }
+
+    void run(unsigned long duration, unsigned long step = 10) {
+        for (unsigned long elapsed = 0; elapsed < duration; elapsed += step) {
+            mqtt.loop();
+            HostClock::advance(step * 1000ULL);
+        }
+    }
+
+    /**
+     * @brief Adds count readings "sensorNN": 1234.
+     */
+    void addReadings(int count) {
+        for (int i = 0; i < count; i++) {
+            char name[12];
+            snprintf(name, sizeof(name), "sensor%02d", i);
+            EXPECT_TRUE(batch.add(name, 1234L));
+        }
+    }
+
+    FakeBroker broker;
+    MqttManager mqtt { nullptr };
+    MqttBatchPublisher batch { mqtt, "metrics" };
+};
+
+TEST_F(MqttBatchPublisherTest, FillsTheClientBufferWhileConnected) {
+    run(100);
+    ASSERT_EQ(MQTT_STATE_CONNECTED, mqtt.getState());
+    addReadings(12); // 12 * 16 bytes: more than a queue slot, less than the client's buffer
+    EXPECT_TRUE(batch.flush());
+    ASSERT_EQ(1u, broker.getPublished().size());
+    EXPECT_GT(broker.getPublished()[0].payload.size(), (size_t)MQTT_MANAGER_PAYLOAD_SIZE);
+    EXPECT_EQ(0u, batch.getDropped());
+}
+
+TEST_F(MqttBatchPublisherTest, LimitsQueuedBatchesToAQueueSlot) {
+    broker.setReachable(false);
+    run(100);
+    addReadings(12);
+    batch.flush();
+    EXPECT_EQ(0u, batch.getDropped());
+    EXPECT_EQ(2u, mqtt.getQueue().size()); // Split in two batches that fit the queue
+    broker.setReachable(true);
+    run(5000);
+    ASSERT_EQ(2u, broker.getPublished().size());
+    for (const FakeBroker::Publish& publish : broker.getPublished()) {
+        EXPECT_LE(publish.payload.size(), (size_t)MQTT_MANAGER_PAYLOAD_SIZE);
+        EXPECT_EQ('{', publish.payload.front());
+        EXPECT_EQ('}', publish.payload.back());
+    }
+    EXPECT_EQ(12u, batch.getReadings());
+}
+
+TEST_F(MqttBatchPublisherTest, LimitsBatchesToTheClientBuffer) {
+    mqtt.setBufferSize(128);
+    run(100);
+    addReadings(12);
+    batch.flush();
+    EXPECT_EQ(0u, batch.getDropped());
+    ASSERT_EQ(2u, broker.getPublished().size());
+    EXPECT_LE(broker.getPublished()[0].payload.size(), 128u - 5 - 2 - strlen("Test/Device1/metrics"));
+}
+
+TEST_F(MqttBatchPublisherTest, EscapesJsonKeys) {
+    run(100);
+    EXPECT_TRUE(batch.add("room \"A\"\\1", 1L));
+    EXPECT_TRUE(batch.add("line\n", 2L));
+    EXPECT_TRUE(batch.flush());
+    ASSERT_EQ(1u, broker.getPublished().size());
+    EXPECT_EQ("{\"room \\\"A\\\"\\\\1\":1,\"line\\u000a\":2}", broker.getPublished()[0].payload);
+}
+
+TEST_F(MqttBatchPublisherTest, WritesIntegersOutsideTheInt32Range) {
+    MqttBatchPublisher packed(mqtt, "packed", MQTT_BATCH_MSGPACK);
+    packed.setTimestamp(false);
+    run(100);
+    long large = sizeof(long) > 4 ? (long)(-9223372036854775807LL - 1) : -2147483647L - 1;
+    EXPECT_TRUE(batch.add("large", large));
+    EXPECT_TRUE(batch.flush());
+    EXPECT_TRUE(packed.add("large", large));
+    EXPECT_TRUE(packed.flush());
+
+    ASSERT_EQ(2u, broker.getPublished().size());
+    EXPECT_EQ("{\"large\":" + std::to_string(large) + "}", broker.getPublished()[0].payload);
+    const std::string& payload = broker.getPublished()[1].payload;
+    size_t value = 3 + 1 + 5; // map16, fixstr "large"
+    ASSERT_GT(payload.size(), value);
+    EXPECT_EQ(sizeof(long) > 4 ? 0xD3 : 0xD2, (uint8_t)payload[value]);
+    EXPECT_EQ(value + 1 + sizeof(long), payload.size());
+    EXPECT_EQ(0x80, (uint8_t)payload[value + 1]);
+}
+
+} // namespace
@@ -0,0 +1,120 @@
+/**
+ * @file MqttInflightTest.cpp
+ * @brief Tests of the MqttInflightWindow: packet identifiers, the in-flight log replayed 
+ * at boot and its compaction.
+ */
+#include <gtest/gtest.h>
+#include <LittleFS.h>
+#include "MqttManager/MqttInflight.h"
+
+namespace {
+
+const char* logPath = "/mqtt.inflight";
+
+class MqttInflightTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(LittleFS.begin());
+        LittleFS.format();
+    }
+
+    static uint16_t add(MqttInflightWindow& window, const char* topic, const char* payload) {
+        MqttInflightEntry* entry = window.add(topic, (const uint8_t*)payload, strlen(payload), MQTT_PUBLISH_QOS1);
+        return entry != nullptr ? entry->packetId : 0;
+    }
+
+    static size_t logSize() {
+        File file = LittleFS.open(logPath, "r");
+        return file ? file.size() : 0;
+    }
+};
+
+TEST_F(MqttInflightTest, AssignsUniqueNonZeroIdentifiers) {
+    MqttInflightWindow window;
+    uint16_t first = add(window, "a", "1");
+    uint16_t second = add(window, "b", "2");
+    EXPECT_NE(0, first);
+    EXPECT_NE(first, second);
+    EXPECT_TRUE(window.acknowledge(first));
+    EXPECT_FALSE(window.acknowledge(first)); // Late duplicate PUBACK
+    EXPECT_EQ(1u, window.size());
+}
+
+TEST_F(MqttInflightTest, RestoresUnacknowledgedMessagesFromTheLog) {
+    {
+        MqttInflightWindow window;
+        ASSERT_TRUE(window.setLogFile(logPath));
+        add(window, "a", "1");
+        uint16_t acknowledged = add(window, "b", "2");
+        add(window, "c", "3");
+        window.acknowledge(acknowledged);
+    }
+    MqttInflightWindow window;
+    ASSERT_TRUE(window.setLogFile(logPath));
+    EXPECT_EQ(2u, window.size());
+    EXPECT_EQ(2u, window.getStats().restored);
+    EXPECT_STREQ("a", window.at(0)->message.topic);
+    EXPECT_TRUE(window.at(0)->sent);
+    EXPECT_EQ(nullptr, window.at(1)); // Slots are replayed as they were
+    EXPECT_STREQ("c", window.at(2)->message.topic);
+}
+
+TEST_F(MqttInflightTest, CompactsTheLogThroughATemporaryFile) {
+    MqttInflightWindow window;
+    ASSERT_TRUE(window.setLogFile(logPath));
+    add(window, "kept", "1");
+    size_t largest = 0;
+    for (int i = 0; i < 200; i++) {
+        window.acknowledge(add(window, "cycled", "x"));
+        largest = std::max(largest, logSize());
+    }
+    EXPECT_LE(largest, MQTT_MANAGER_INFLIGHT_LOG_SIZE + 2 * sizeof(MqttMessage));
+    EXPECT_LT(logSize(), (size_t)MQTT_MANAGER_INFLIGHT_LOG_SIZE);
+    EXPECT_FALSE(LittleFS.exists("/mqtt.inflight.tmp"));
+
+    add(window, "after", "2"); // The compacted log is appended to
+    MqttInflightWindow restored;
+    ASSERT_TRUE(restored.setLogFile(logPath));
+    EXPECT_EQ(2u, restored.size());
+    EXPECT_STREQ("kept", restored.at(0)->message.topic);
+    EXPECT_STREQ("after", restored.at(1)->message.topic);
+}
+
+TEST_F(MqttInflightTest, KeepsThePreviousLogWhenTheCompactionFails) {
+    {
+        MqttInflightWindow window;
+        ASSERT_TRUE(window.setLogFile(logPath));
+        add(window, "a", "1");
+        add(window, "b", "2");
+    }
+    LittleFS.setRenameFailures(1);
+    {
+        MqttInflightWindow window;
+        ASSERT_TRUE(window.setLogFile(logPath)); // Replays, then fails to replace the log
+        EXPECT_EQ(2u, window.size());
+        EXPECT_FALSE(LittleFS.exists("/mqtt.inflight.tmp"));
+        window.acknowledge(window.at(0)->packetId);
+    }
+    MqttInflightWindow window;
+    ASSERT_TRUE(window.setLogFile(logPath));
+    ASSERT_EQ(1u, window.size());
+    EXPECT_STREQ("b", window.at(1)->message.topic);
+}
+
+TEST_F(MqttInflightTest, IgnoresACompactionInterruptedByAReset) {
+    {
+        MqttInflightWindow window;
+        ASSERT_TRUE(window.setLogFile(logPath));
+        add(window, "a", "1");
+    }
+    File partial = LittleFS.open("/mqtt.inflight.tmp", "w"); // Reset while writing the new log
+    partial.write((const uint8_t*)"\xA1", 1);
+    partial.close();
+    MqttInflightWindow window;
+    ASSERT_TRUE(window.setLogFile(logPath));
+    ASSERT_EQ(1u, window.size());
+    EXPECT_STREQ("a", window.at(0)->message.topic);
+    EXPECT_FALSE(LittleFS.exists("/mqtt.inflight.tmp"));
+}
+
+} // namespace
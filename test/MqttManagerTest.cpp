@@ -0,0 +1,223 @@
+/**
+ * @file MqttManagerTest.cpp
+ * @brief Tests of the MqttManager against a fake broker: reconnection backoff, DNS caching, 
+ * publishing, the outbound queue and the dispatch of incoming messages.
+ */
+#include <gtest/gtest.h>
+#include <limits.h>
+#include <ESP8266WiFi.h>
+#include "FakeBroker.h"
+#include "MqttManager/MqttManager.h"
+
+namespace {
+
+class MqttManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        HostClock::setManual(true);
+        randomSeed(42);
+        WiFi.setStatus(WL_CONNECTED);
+        WiFi.clearHosts();
+        WiFi.addHost("broker.test", IPAddress(10, 0, 0, 2));
+        WiFi.resetLookups();
+        mqtt.setServer("broker.test");
+        mqtt.setPort(1883);
+        mqtt.setClientId("device");
+        mqtt.setUsername(nullptr);
+        mqtt.setPassword(nullptr);
+        mqtt.setTopicPrefix("Test", "Device1");
+        mqtt.begin();
+    }
+
+    void TearDown() override {
+        HostClock::setManual(false);
+    }
+
+    /**
+     * @brief Calls loop() every step ms for a duration.
+     */
+    void run(unsigned long duration, unsigned long step = 10) {
+        for (unsigned long elapsed = 0; elapsed < duration; elapsed += step) {
+            mqtt.loop();
+            HostClock::advance(step * 1000ULL);
+        }
+    }
+
+    FakeBroker broker;
+    MqttManager mqtt { nullptr };
+};
+
+TEST_F(MqttManagerTest, ConnectsAndPublishes) {
+    run(100);
+    ASSERT_EQ(MQTT_STATE_CONNECTED, mqtt.getState());
+    EXPECT_EQ(1u, mqtt.getConnectionStats().successes);
+    EXPECT_TRUE(mqtt.publish("status", "online"));
+    ASSERT_EQ(1u, broker.getPublished().size());
+    EXPECT_EQ("Test/Device1/status", broker.getPublished()[0].topic);
+    EXPECT_EQ("online", broker.getPublished()[0].payload);
+}
+
+TEST_F(MqttManagerTest, BacksOffExponentiallyWithJitter) {
+    broker.setReachable(false);
+    mqtt.setReconnectBackoff(1000, 16000);
+    run(120000);
+
+    const std::vector<unsigned long>& times = broker.getConnectTimes();
+    ASSERT_GE(times.size(), 8u);
+    unsigned long base = 1000;
+    for (size_t i = 1; i < times.size(); i++) {
+        unsigned long gap = times[i] - times[i - 1];
+        EXPECT_GE(gap, base - base / 4) << "attempt " << i;
+        EXPECT_LE(gap, base + base / 4 + 10) << "attempt " << i;   // One loop() step late at most
+        if (base < 16000) base *= 2;
+    }
+    // 1 + 2 + 4 + 8 s, then every 16 s: about 7 more attempts in the remaining 105 s
+    EXPECT_LE(times.size(), 14u);
+    EXPECT_EQ(times.size(), mqtt.getConnectionStats().consecutiveFailures);
+}
+
+TEST_F(MqttManagerTest, SpreadsTheAttemptsOfAFleet) {
+    broker.setReachable(false);
+    mqtt.setReconnectBackoff(8000, 8000);
+    run(200000);
+    const std::vector<unsigned long>& times = broker.getConnectTimes();
+    ASSERT_GE(times.size(), 10u);
+    unsigned long shortest = ULONG_MAX, longest = 0;
+    for (size_t i = 1; i < times.size(); i++) {
+        shortest = std::min(shortest, times[i] - times[i - 1]);
+        longest = std::max(longest, times[i] - times[i - 1]);
+    }
+    EXPECT_GE(shortest, 6000u);
+    EXPECT_LE(longest, 10010u);
+    EXPECT_GT(longest - shortest, 1000u);   // Jittered, not a fixed period
+}
+
+TEST_F(MqttManagerTest, DoesNotBlockEveryLoopWhileTheBrokerIsDown) {
+    broker.setReachable(false);
+    broker.setConnectDelay(2000);   // Every refused attempt waits for the connect timeout
+    run(60000);
+    // Without backoff, every loop() would wait 2 s: 30 attempts in a minute
+    EXPECT_LE(broker.getConnects(), 8u);
+}
+
+TEST_F(MqttManagerTest, ResolvesTheBrokerOnceEveryThreeFailures) {
+    broker.setReachable(false);
+    mqtt.setReconnectBackoff(100, 100);
+    run(1200);
+    uint32_t attempts = broker.getConnects();
+    ASSERT_GE(attempts, 9u);
+    EXPECT_EQ((attempts + 2) / 3, WiFi.getLookups());
+}
+
+TEST_F(MqttManagerTest, CountsDnsFailures) {
+    WiFi.clearHosts();
+    run(5000);
+    EXPECT_EQ(0u, broker.getConnects());
+    EXPECT_GE(mqtt.getConnectionStats().dnsFailures, 2u);
+    EXPECT_EQ(MQTT_STATE_DISCONNECTED, mqtt.getState());
+}
+
+TEST_F(MqttManagerTest, ResetsTheBackoffOnceConnected) {
+    broker.setReachable(false);
+    mqtt.setReconnectBackoff(1000, 60000);
+    run(40000);
+    EXPECT_GT(mqtt.getConnectionStats().retryDelay, 8000u);
+
+    broker.setReachable(true);
+    run(70000);
+    ASSERT_EQ(MQTT_STATE_CONNECTED, mqtt.getState());
+    EXPECT_EQ(0u, mqtt.getConnectionStats().consecutiveFailures);
+    EXPECT_EQ(0u, mqtt.getConnectionStats().retryDelay);
+
+    uint32_t connects = broker.getConnects();
+    broker.drop();
+    run(20);   // A lost connection is retried right away
+    EXPECT_EQ(connects + 1, broker.getConnects());
+    EXPECT_EQ(MQTT_STATE_CONNECTED, mqtt.getState());
+}
+
+TEST_F(MqttManagerTest, WaitsForWiFi) {
+    WiFi.setStatus(WL_DISCONNECTED);
+    run(5000);
+    EXPECT_EQ(0u, broker.getConnects());
+    WiFi.setStatus(WL_CONNECTED);
+    run(20);
+    EXPECT_EQ(MQTT_STATE_CONNECTED, mqtt.getState());
+}
+
+TEST_F(MqttManagerTest, QueuesWhileDisconnectedAndDrainsAfterwards) {
+    broker.setReachable(false);
+    run(100);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_TRUE(mqtt.publish("count", i));
+    }
+    EXPECT_EQ(5u, mqtt.getQueue().size());
+    broker.setReachable(true);
+    run(3000);
+    ASSERT_EQ(5u, broker.getPublished().size());
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(std::to_string(i), broker.getPublished()[i].payload);
+    }
+    EXPECT_TRUE(mqtt.getQueue().isEmpty());
+}
+
+TEST_F(MqttManagerTest, HandlersPublishingKeepTheIncomingMessageValid) {
+    std::vector<std::string> seen;
+    auto record = [&](const char* topic, const uint8_t* payload, size_t length) {
+        seen.push_back(std::string(topic) + "=" + std::string((const char*)payload, length));
+    };
+    mqtt.subscribe("cmd/+", [&](const char* topic, const uint8_t* payload, size_t length) {
+        record(topic, payload, length);
+        mqtt.publish("status/long/enough/to/cover/the/incoming/topic", "overwritten-buffer-contents");
+        mqtt.subscribe("cmd/late", record); // Changes the trie and the vector during the dispatch
+        record(topic, payload, length);
+    });
+    mqtt.subscribe("cmd/#", record);
+    run(100);
+    ASSERT_EQ(MQTT_STATE_CONNECTED, mqtt.getState());
+
+    broker.deliver("Test/Device1/cmd/relay", "on");
+    run(100);
+    ASSERT_EQ(3u, seen.size());
+    for (const std::string& entry : seen) {
+        EXPECT_EQ("cmd/relay=on", entry);
+    }
+    ASSERT_EQ(1u, broker.getPublished().size());
+    EXPECT_EQ("overwritten-buffer-contents", broker.getPublished()[0].payload);
+    ASSERT_EQ(3u, broker.getSubscriptions().size());
+    EXPECT_EQ("Test/Device1/cmd/late", broker.getSubscriptions()[2]);
+}
+
+TEST_F(MqttManagerTest, UnsubscribingFromAHandlerSkipsTheRemovedHandler) {
+    int first = 0, second = 0;
+    mqtt.subscribe("cmd/x", [&](const char*, const uint8_t*, size_t) {
+        first++;
+        mqtt.unsubscribe("cmd/#");
+    });
+    mqtt.subscribe("cmd/#", [&](const char*, const uint8_t*, size_t) { second++; });
+    run(100);
+    broker.deliver("Test/Device1/cmd/x", "1");
+    broker.deliver("Test/Device1/cmd/x", "2");
+    run(100);
+    EXPECT_EQ(2, first);
+    EXPECT_EQ(0, second);
+}
+
+TEST_F(MqttManagerTest, ReusesTheSlotsOfRemovedSubscriptions) {
+    int received = 0;
+    run(100);
+    for (int i = 0; i < 50; i++) {
+        EXPECT_TRUE(mqtt.subscribe("cmd/x", [&](const char*, const uint8_t*, size_t) { received++; }));
+        EXPECT_TRUE(mqtt.unsubscribe("cmd/x"));
+    }
+    EXPECT_EQ(1u, mqtt.getSubscriptionSlots());
+
+    mqtt.subscribe("cmd/y", [&](const char*, const uint8_t*, size_t) { received += 10; });
+    EXPECT_EQ(1u, mqtt.getSubscriptionSlots());
+    broker.deliver("Test/Device1/cmd/x", "1");
+    broker.deliver("Test/Device1/cmd/y", "1");
+    run(2000); // One packet per loop: the acknowledgements of the subscriptions come first
+    EXPECT_EQ(10, received);
+}
+
+} // namespace
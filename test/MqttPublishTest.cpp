@@ -0,0 +1,81 @@
+/**
+ * @file MqttPublishTest.cpp
+ * @brief Allocation count and cost of MqttManager::publish(), sent and queued.
+ *
+ * The broker is a sink that allocates nothing, so that every allocation counted by the
+ * host heap while publishing comes from the framework or PubSubClient.
+ */
+#include <gtest/gtest.h>
+#include <chrono>
+#include <ESP8266WiFi.h>
+#include <HostHeap.h>
+#include "SinkBroker.h"
+#include "MqttManager/MqttManager.h"
+
+namespace {
+
+class MqttPublishTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        HostClock::setManual(true);
+        WiFi.setStatus(WL_CONNECTED);
+        WiFi.clearHosts();
+        mqtt.setServer("10.0.0.2");
+        mqtt.setPort(1883);
+        mqtt.setClientId("device");
+        mqtt.setUsername(nullptr);
+        mqtt.setPassword(nullptr);
+        mqtt.setTopicPrefix("Test", "Device1");
+        mqtt.begin();
+    }
+
+    void TearDown() override {
+        HostClock::setManual(false);
+    }
+
+    /**
+     * @brief Publishes count times with every zero-allocation overload, in a simulated heap.
+     * @return Allocations made, and the mean time of a publish in ns.
+     */
+    std::pair<uint32_t, double> publishMany(int count) {
+        static const uint8_t binary[4] = { 1, 2, 3, 4 };
+        HostHeapScope heap;
+        EXPECT_TRUE(heap.isStarted());
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            mqtt.publish("sensor/raw", 10, binary, sizeof(binary));
+            mqtt.publish("status", "online");
+            mqtt.publish("count", (long)i);
+            mqtt.publish("uptime", (unsigned long)i);
+            mqtt.publish("temperature", 21.5 + i, 1);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return { HostHeap::getAllocations(),
+                 std::chrono::duration<double, std::nano>(elapsed).count() / (count * 5) };
+    }
+
+    SinkBroker broker;
+    MqttManager mqtt { nullptr };
+};
+
+TEST_F(MqttPublishTest, SendsWithoutAllocating) {
+    for (int i = 0; i < 10 && mqtt.getState() != MQTT_STATE_CONNECTED; i++) {
+        mqtt.loop();
+    }
+    ASSERT_EQ(MQTT_STATE_CONNECTED, mqtt.getState());
+    auto result = publishMany(1000);
+    EXPECT_EQ(0u, result.first);
+    EXPECT_EQ(5000u, broker.getPublishes());
+    RecordProperty("ns_per_publish", std::to_string(result.second));
+}
+
+TEST_F(MqttPublishTest, QueuesWithoutAllocating) {
+    WiFi.setStatus(WL_DISCONNECTED);
+    auto result = publishMany(1000); // Fills the queue, then drops: neither allocates
+    EXPECT_EQ(0u, result.first);
+    EXPECT_EQ(0u, broker.getPublishes());
+    EXPECT_FALSE(mqtt.getQueue().isEmpty());
+    RecordProperty("ns_per_publish", std::to_string(result.second));
+}
+
+} // namespace
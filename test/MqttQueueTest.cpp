@@ -0,0 +1,223 @@
+/**
+ * @file MqttQueueTest.cpp
+ * @brief Tests of the MqttQueue: order, "latest value" coalescing, spilling to LittleFS 
+ * and the batched writes of the spill file header.
+ */
+#include <gtest/gtest.h>
+#include <LittleFS.h>
+#include "MqttManager/MqttQueue.h"
+
+namespace {
+
+const char* spillPath = "/mqtt.queue";
+
+class MqttQueueTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        HostClock::setManual(true);
+        ASSERT_TRUE(LittleFS.begin());
+        LittleFS.format();
+    }
+
+    void TearDown() override {
+        HostClock::setManual(false);
+    }
+
+    static bool push(MqttQueue& queue, const char* topic, const char* payload, uint8_t flags = MQTT_PUBLISH_DEFAULT) {
+        return queue.push(topic, (const uint8_t*)payload, strlen(payload), flags);
+    }
+
+    static std::string pop(MqttQueue& queue) {
+        const MqttMessage* message = queue.front();
+        if (message == nullptr) {
+            return "";
+        }
+        std::string text = std::string(message->topic) + "=" + std::string((const char*)message->payload, message->length);
+        queue.pop();
+        return text;
+    }
+
+    /**
+     * @brief Fills the RAM slots with messages of distinct topics.
+     */
+    static void fill(MqttQueue& queue) {
+        for (int i = 0; i < MQTT_MANAGER_QUEUE_SIZE; i++) {
+            std::string topic = "ram/" + std::to_string(i);
+            ASSERT_TRUE(push(queue, topic.c_str(), "x"));
+        }
+    }
+
+    /**
+     * @brief Count of spilled records in the header as written on the file.
+     */
+    static int spilledOnFile() {
+        File file = LittleFS.open(spillPath, "r");
+        uint8_t header[12];
+        if (!file || file.read(header, sizeof(header)) != sizeof(header)) {
+            return -1;
+        }
+        return header[8] | (header[9] << 8);
+    }
+};
+
+TEST_F(MqttQueueTest, DeliversInOrder) {
+    MqttQueue queue;
+    push(queue, "a", "1");
+    push(queue, "b", "2");
+    push(queue, "a", "3");
+    EXPECT_EQ(3u, queue.size());
+    EXPECT_EQ("a=1", pop(queue));
+    EXPECT_EQ("b=2", pop(queue));
+    EXPECT_EQ("a=3", pop(queue));
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_EQ(nullptr, queue.front());
+}
+
+TEST_F(MqttQueueTest, CoalescesLatestValues) {
+    MqttQueue queue;
+    push(queue, "temp", "20", MQTT_PUBLISH_LATEST);
+    push(queue, "log", "boot");
+    push(queue, "temp", "21", MQTT_PUBLISH_LATEST);
+    EXPECT_EQ(2u, queue.size());
+    EXPECT_EQ(1u, queue.getCoalesced());
+    EXPECT_EQ("temp=21", pop(queue));
+    EXPECT_EQ("log=boot", pop(queue));
+}
+
+TEST_F(MqttQueueTest, RejectsOversizedMessagesAndAFullQueue) {
+    MqttQueue queue;
+    std::string topic(MQTT_MANAGER_TOPIC_SIZE, 't');
+    EXPECT_FALSE(push(queue, topic.c_str(), "x"));
+    std::string payload(MQTT_MANAGER_PAYLOAD_SIZE + 1, 'p');
+    EXPECT_FALSE(push(queue, "t", payload.c_str()));
+    fill(queue);
+    EXPECT_FALSE(push(queue, "t", "x"));
+    EXPECT_EQ(3u, queue.getDropped());
+}
+
+TEST_F(MqttQueueTest, SpillsInOrderOnceTheSlotsAreFull) {
+    MqttQueue queue;
+    ASSERT_TRUE(queue.setSpillFile(spillPath, 8));
+    fill(queue);
+    for (int i = 0; i < 8; i++) {
+        EXPECT_TRUE(push(queue, "spilled", std::to_string(i).c_str()));
+    }
+    EXPECT_FALSE(push(queue, "spilled", "full"));
+    EXPECT_EQ(MQTT_MANAGER_QUEUE_SIZE + 8u, queue.size());
+
+    for (int i = 0; i < MQTT_MANAGER_QUEUE_SIZE; i++) {
+        EXPECT_EQ("ram/" + std::to_string(i) + "=x", pop(queue));
+        if (i == 0) {
+            EXPECT_FALSE(push(queue, "after", "y"));   // The file is full: not taking the freed slot, ahead of it
+        }
+    }
+    ASSERT_NE(nullptr, queue.front());         // Moves the oldest spilled message to RAM
+    EXPECT_TRUE(push(queue, "after", "y"));
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ("spilled=" + std::to_string(i), pop(queue));
+    }
+    EXPECT_EQ("after=y", pop(queue));
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST_F(MqttQueueTest, WritesTheSpillHeaderAtMostOncePerInterval) {
+    MqttQueue queue;
+    ASSERT_TRUE(queue.setSpillFile(spillPath, 16));
+    fill(queue);
+    for (int i = 0; i < 5; i++) {
+        push(queue, "spilled", "z");
+        HostClock::advance(100000);
+    }
+    EXPECT_EQ(0, spilledOnFile());   // Within the interval of the header written by setSpillFile()
+    queue.sync();
+    EXPECT_EQ(0, spilledOnFile());
+
+    HostClock::advance(MQTT_MANAGER_SPILL_SYNC_INTERVAL * 1000ULL);
+    queue.sync();
+    EXPECT_EQ(5, spilledOnFile());
+
+    push(queue, "spilled", "z");
+    EXPECT_EQ(5, spilledOnFile());
+    queue.sync(true);
+    EXPECT_EQ(6, spilledOnFile());
+}
+
+TEST_F(MqttQueueTest, WritesTheSpillHeaderOnceDrained) {
+    MqttQueue queue;
+    ASSERT_TRUE(queue.setSpillFile(spillPath, 16));
+    fill(queue);
+    HostClock::advance(MQTT_MANAGER_SPILL_SYNC_INTERVAL * 1000ULL);
+    push(queue, "spilled", "z");
+    EXPECT_EQ(1, spilledOnFile());
+    while (!queue.isEmpty()) {
+        pop(queue);
+    }
+    EXPECT_EQ(0, spilledOnFile());
+}
+
+TEST_F(MqttQueueTest, ResumesSpilledMessagesAfterAReboot) {
+    {
+        MqttQueue queue;
+        ASSERT_TRUE(queue.setSpillFile(spillPath, 8));
+        fill(queue);
+        push(queue, "spilled", "1");
+        push(queue, "spilled", "2");
+        queue.sync(true);
+    }
+    MqttQueue queue;
+    ASSERT_TRUE(queue.setSpillFile(spillPath, 8));
+    EXPECT_EQ(2u, queue.size());
+    EXPECT_EQ("spilled=1", pop(queue));
+    EXPECT_EQ("spilled=2", pop(queue));
+}
+
+TEST_F(MqttQueueTest, StartsOverWithAnotherCapacity) {
+    {
+        MqttQueue queue;
+        ASSERT_TRUE(queue.setSpillFile(spillPath, 8));
+        fill(queue);
+        push(queue, "spilled", "1");
+        queue.sync(true);
+    }
+    MqttQueue queue;
+    ASSERT_TRUE(queue.setSpillFile(spillPath, 4));
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST_F(MqttQueueTest, CoalescesLatestValuesInTheSpillFile) {
+    MqttQueue queue;
+    ASSERT_TRUE(queue.setSpillFile(spillPath, 8));
+    fill(queue);
+    push(queue, "temp", "20", MQTT_PUBLISH_LATEST);
+    push(queue, "log", "a");
+    push(queue, "temp", "21", MQTT_PUBLISH_LATEST);
+    push(queue, "temp", "22", MQTT_PUBLISH_LATEST);
+    push(queue, "temp", "plain");   // Not flagged: queued
+    EXPECT_EQ(MQTT_MANAGER_QUEUE_SIZE + 3u, queue.size());
+    EXPECT_EQ(2u, queue.getCoalesced());
+
+    for (int i = 0; i < MQTT_MANAGER_QUEUE_SIZE; i++) {
+        pop(queue);
+    }
+    EXPECT_EQ("temp=22", pop(queue));
+    EXPECT_EQ("log=a", pop(queue));
+    EXPECT_EQ("temp=plain", pop(queue));
+}
+
+TEST_F(MqttQueueTest, CoalescesLatestValuesResumedFromTheSpillFile) {
+    {
+        MqttQueue queue;
+        ASSERT_TRUE(queue.setSpillFile(spillPath, 8));
+        fill(queue);
+        push(queue, "temp", "20", MQTT_PUBLISH_LATEST);
+        queue.sync(true);
+    }
+    MqttQueue queue;
+    ASSERT_TRUE(queue.setSpillFile(spillPath, 8));
+    push(queue, "temp", "21", MQTT_PUBLISH_LATEST);
+    EXPECT_EQ(1u, queue.getCoalesced());
+    EXPECT_EQ(1u, queue.size());
+    EXPECT_EQ("temp=21", pop(queue));
+}
+
+} // namespace
@@ -0,0 +1,231 @@
+/**
+ * @file NetworkSelectorTest.cpp
+ * @brief Tests of the NetworkSelector: ranking, weak signal tracking, and roaming in a 
+ * simulated radio environment.
+ */
+#include <gtest/gtest.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "WiFiManager/NetworkSelector.h"
+
+namespace {
+
+ScannedNetwork network(const char* ssid, uint8_t id, int8_t rssi, uint8_t channel = 1) {
+    ScannedNetwork result = {};
+    strncpy(result.ssid, ssid, sizeof(result.ssid) - 1);
+    memset(result.bssid, id, sizeof(result.bssid));
+    result.rssi = rssi;
+    result.channel = channel;
+    return result;
+}
+
+/**
+ * @brief Access points whose signal, as seen by the device, changes with time.
+ */
+class SimulatedRadio {
+public:
+    typedef int (*Signal)(unsigned long now);
+
+    void add(const char* ssid, uint8_t id, Signal signal) { _accessPoints.push_back({ ssid, id, signal }); }
+
+    int rssi(uint8_t id, unsigned long now) const {
+        for (const AccessPoint& accessPoint : _accessPoints) {
+            if (accessPoint.id == id) return accessPoint.signal(now);
+        }
+        return -100;
+    }
+
+    /**
+     * @brief Scans as WiFiManager does: one entry per SSID, its strongest access point.
+     */
+    std::vector<ScannedNetwork> scan(unsigned long now) const {
+        std::vector<ScannedNetwork> networks;
+        for (const AccessPoint& accessPoint : _accessPoints) {
+            int rssi = accessPoint.signal(now);
+            if (rssi <= -95) continue;   // Out of range
+            bool merged = false;
+            for (ScannedNetwork& seen : networks) {
+                if (strcmp(seen.ssid, accessPoint.ssid) == 0) {
+                    if (rssi > seen.rssi) seen = network(accessPoint.ssid, accessPoint.id, rssi);
+                    merged = true;
+                }
+            }
+            if (!merged) networks.push_back(network(accessPoint.ssid, accessPoint.id, rssi));
+        }
+        return networks;
+    }
+
+private:
+    struct AccessPoint {
+        const char* ssid;
+        uint8_t id;
+        Signal signal;
+    };
+    std::vector<AccessPoint> _accessPoints;
+};
+
+struct Roam {
+    unsigned long time;
+    uint8_t from;
+    uint8_t to;
+};
+
+/**
+ * @brief Runs the roaming loop of WiFiManager (signal sampled every second, scan and roam 
+ * once weak) from an access point for a duration, and returns the roams made.
+ */
+std::vector<Roam> simulate(NetworkSelector& selector, const SimulatedRadio& radio, const char* ssid, uint8_t id, unsigned long duration) {
+    std::vector<Roam> roams;
+    uint8_t bssid[6];
+    memset(bssid, id, sizeof(bssid));
+    selector.resetSignal();
+    for (unsigned long now = 1000; now <= duration; now += 1000) {
+        int rssi = radio.rssi(bssid[0], now);
+        if (!selector.isSignalWeak(rssi, now)) continue;
+        selector.resetSignal();
+        std::vector<ScannedNetwork> networks = radio.scan(now);
+        NetworkCandidate target;
+        if (selector.findRoamTarget(ssid, bssid, rssi, networks.data(), networks.size(), target)) {
+            roams.push_back({ now, bssid[0], target.network->bssid[0] });
+            memcpy(bssid, target.network->bssid, sizeof(bssid));
+            ssid = target.credentials->ssid;
+        }
+    }
+    return roams;
+}
+
+// Walking away from access point 1 towards access point 2, 1 dB every 2.5 s
+int leaving(unsigned long now) { return -45 - (int)(now / 2500); }
+int approaching(unsigned long now) { return -85 + (int)(now / 2500); }
+// Two access points of equal average strength, with a fluctuating signal
+int noisyA(unsigned long now) { return -78 + (int)(4 * sin(now / 3000.0)); }
+int noisyB(unsigned long now) { return -76 + (int)(4 * cos(now / 3000.0)); }
+
+TEST(NetworkSelectorTest, RanksSeenNetworksByScoreThenUnseenByPriority) {
+    NetworkSelector selector;
+    selector.addNetwork("home", "pw", 0);
+    selector.addNetwork("office", "pw", 1);
+    selector.addNetwork("hidden", "pw", 5);
+    selector.addNetwork("backup", "pw", 2);
+    ScannedNetwork networks[] = { network("office", 2, -80), network("home", 1, -60), network("guest", 3, -40) };
+
+    NetworkCandidate candidates[WIFI_MANAGER_MAX_NETWORKS];
+    size_t count = selector.rank(networks, 3, candidates, WIFI_MANAGER_MAX_NETWORKS);
+    ASSERT_EQ(4u, count);
+    EXPECT_STREQ("home", candidates[0].credentials->ssid);     // -60
+    EXPECT_STREQ("office", candidates[1].credentials->ssid);   // -80 + 10
+    EXPECT_STREQ("hidden", candidates[2].credentials->ssid);   // Unseen, priority 5
+    EXPECT_EQ(nullptr, candidates[2].network);
+    EXPECT_STREQ("backup", candidates[3].credentials->ssid);
+}
+
+TEST(NetworkSelectorTest, PriorityOutweighsAWeakerSignal) {
+    NetworkSelector selector;
+    selector.addNetwork("home", "pw", 0);
+    selector.addNetwork("office", "pw", 2);
+    ScannedNetwork networks[] = { network("home", 1, -55), network("office", 2, -70) };
+    NetworkCandidate candidates[2];
+    ASSERT_EQ(2u, selector.rank(networks, 2, candidates, 2));
+    EXPECT_STREQ("office", candidates[0].credentials->ssid);   // -70 + 20 > -55
+}
+
+TEST(NetworkSelectorTest, KeepsTheBestCandidatesWhenTheOutputIsShort) {
+    NetworkSelector selector;
+    selector.addNetwork("a", "pw");
+    selector.addNetwork("b", "pw");
+    selector.addNetwork("c", "pw");
+    ScannedNetwork networks[] = { network("a", 1, -80), network("b", 2, -50), network("c", 3, -65) };
+    NetworkCandidate candidates[2];
+    ASSERT_EQ(2u, selector.rank(networks, 3, candidates, 2));
+    EXPECT_STREQ("b", candidates[0].credentials->ssid);
+    EXPECT_STREQ("c", candidates[1].credentials->ssid);
+}
+
+TEST(NetworkSelectorTest, ReplacesNetworksWithTheSameSsid) {
+    NetworkSelector selector;
+    EXPECT_TRUE(selector.addNetwork("home", "old", 0));
+    EXPECT_TRUE(selector.addNetwork("home", "new", 3));
+    EXPECT_FALSE(selector.addNetwork("", "pw"));
+    ASSERT_EQ(1u, selector.size());
+    EXPECT_STREQ("new", selector.find("home")->password);
+    EXPECT_EQ(3, selector.find("home")->priority);
+    EXPECT_EQ(nullptr, selector.find("office"));
+}
+
+TEST(NetworkSelectorTest, RefusesNetworksBeyondTheList) {
+    NetworkSelector selector;
+    static char names[WIFI_MANAGER_MAX_NETWORKS + 1][8];
+    for (int i = 0; i <= WIFI_MANAGER_MAX_NETWORKS; i++) {
+        snprintf(names[i], sizeof(names[i]), "net%d", i);
+        EXPECT_EQ(i < WIFI_MANAGER_MAX_NETWORKS, selector.addNetwork(names[i], "pw"));
+    }
+}
+
+TEST(NetworkSelectorTest, ReportsAWeakSignalOnlyOnceItLasts) {
+    NetworkSelector selector;
+    selector.setRoamThreshold(-75);
+    selector.setRoamDelay(10000);
+    EXPECT_FALSE(selector.isSignalWeak(-80, 1000));
+    EXPECT_FALSE(selector.isSignalWeak(-80, 10999));
+    EXPECT_TRUE(selector.isSignalWeak(-80, 11000));
+    EXPECT_FALSE(selector.isSignalWeak(-70, 12000));   // Recovered: the delay starts over
+    EXPECT_FALSE(selector.isSignalWeak(-80, 13000));
+    EXPECT_FALSE(selector.isSignalWeak(-80, 22999));
+    EXPECT_TRUE(selector.isSignalWeak(-80, 23000));
+}
+
+TEST(NetworkSelectorTest, RoamsOnceWhenWalkingToAnotherAccessPoint) {
+    NetworkSelector selector;
+    selector.addNetwork("home", "pw");
+    SimulatedRadio radio;
+    radio.add("home", 1, leaving);
+    radio.add("home", 2, approaching);
+
+    std::vector<Roam> roams = simulate(selector, radio, "home", 1, 200000);
+    ASSERT_EQ(1u, roams.size());
+    EXPECT_EQ(1, roams[0].from);
+    EXPECT_EQ(2, roams[0].to);
+    // Below -75 dBm from the 78 s sample, roaming after the 30 s delay
+    EXPECT_EQ(108000u, roams[0].time);
+}
+
+TEST(NetworkSelectorTest, DoesNotRoamBetweenAccessPointsOfSimilarStrength) {
+    NetworkSelector selector;
+    selector.addNetwork("home", "pw");
+    selector.setRoamDelay(5000);
+    SimulatedRadio radio;
+    radio.add("home", 1, noisyA);
+    radio.add("home", 2, noisyB);
+
+    std::vector<Roam> roams = simulate(selector, radio, "home", 1, 600000);
+    EXPECT_TRUE(roams.empty()) << roams.size() << " roams, first at " << (roams.empty() ? 0 : roams[0].time) << " ms";
+}
+
+TEST(NetworkSelectorTest, RoamsToAPreferredNetwork) {
+    NetworkSelector selector;
+    selector.addNetwork("guest", "pw", 0);
+    selector.addNetwork("home", "pw", 1);
+    selector.setRoamDelay(5000);
+    SimulatedRadio radio;
+    radio.add("guest", 1, [](unsigned long) { return -80; });
+    radio.add("home", 2, [](unsigned long) { return -82; });   // Weaker, but priority 1: -72
+
+    std::vector<Roam> roams = simulate(selector, radio, "guest", 1, 20000);
+    ASSERT_EQ(1u, roams.size());
+    EXPECT_EQ(2, roams[0].to);
+    EXPECT_EQ(5000u + 1000u, roams[0].time);   // Weak from the first sample at 1 s
+}
+
+TEST(NetworkSelectorTest, StaysWhenNoOtherAccessPointIsInRange) {
+    NetworkSelector selector;
+    selector.addNetwork("home", "pw");
+    selector.setRoamDelay(5000);
+    SimulatedRadio radio;
+    radio.add("home", 1, [](unsigned long) { return -88; });
+    radio.add("home", 2, [](unsigned long) { return -99; });   // Out of range
+
+    EXPECT_TRUE(simulate(selector, radio, "home", 1, 60000).empty());
+}
+
+} // namespace
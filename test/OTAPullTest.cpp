@@ -0,0 +1,184 @@
+/**
+ * @file OTAPullTest.cpp
+ * @brief Tests of the pull updates against an update server over loopback: manifest checks
+ * with their validators, the download of the image into Update, its resume after a dropped
+ * connection, and the rejected downloads.
+ */
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ESP8266WiFi.h>
+#include <Updater.h>
+#include "HostCrypto.h"
+#include "LoopbackHttp.h"
+#include "OTA/OTAPull.h"
+
+namespace {
+
+std::string firmwareImage(size_t size) {
+    std::string image(size, '\0');
+    for (size_t i = 0; i < size; i++) image[i] = (char)(i * 31 + i / 251);
+    image[0] = (char)0xE9; // Magic byte checked by Update
+    return image;
+}
+
+class OTAPullTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        HostClock::setManual(true);
+        Serial.quiet(true);
+        WiFi.reset();
+        WiFi.setStatus(WL_CONNECTED);
+        Update.reset();
+        pull.setManifestUrl(server.url("/firmware/manifest.json").c_str());
+        pull.setCurrentVersion("1.0.0");
+        pull.setRebootOnUpdate(false);
+        pull.setRetryDelay(1000);
+        pull.begin();
+    }
+
+    void TearDown() override {
+        HostClock::setManual(false);
+        Serial.quiet(false);
+    }
+
+    std::string manifest(const std::string& version, const std::string& sha256 = "") const {
+        std::string json = "{\"version\":\"" + version + "\",\"url\":\"firmware.bin\",\"size\":" + std::to_string(image.size());
+        return json + (sha256.empty() ? "" : ",\"sha256\":\"" + sha256 + "\"") + "}";
+    }
+
+    /**
+     * @brief Runs loop() until the update is idle again, or for at most 5 s; the device clock
+     * advances 1 ms per call, while the server answers in real time.
+     */
+    void run() {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        do {
+            pull.loop();
+            HostClock::advance(1000);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        } while (pull.getState() != OTA_PULL_IDLE && std::chrono::steady_clock::now() < deadline);
+    }
+
+    /**
+     * @brief Answers as tools/update_server.py: validators on the manifest, and Range with
+     * If-Range on the image.
+     */
+    std::string answer(const LoopbackServer::Request& request) {
+        if (request.target == "/firmware/manifest.json") {
+            if (request.header("If-None-Match") == "\"m1\"") return LoopbackServer::response(304, "");
+            return LoopbackServer::response(200, announced, { { "ETag", "\"m1\"" }, { "Last-Modified", lastModified } });
+        }
+        if (request.target != "/firmware/firmware.bin") {
+            return LoopbackServer::response(404, "");
+        }
+        if (chunked) {
+            return "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n4e20\r\n" + image + "\r\n0\r\n\r\n";
+        }
+        std::string range = request.header("Range");
+        if (range.compare(0, 6, "bytes=") == 0 && request.header("If-Range") == "\"i1\"") {
+            size_t first = strtoul(range.c_str() + 6, nullptr, 10);
+            std::string contentRange = "bytes " + std::to_string(first) + "-" + std::to_string(image.size() - 1) + "/" + std::to_string(image.size());
+            return LoopbackServer::response(206, image.substr(first), { { "ETag", "\"i1\"" }, { "Content-Range", contentRange } });
+        }
+        std::string response = LoopbackServer::response(200, image, { { "ETag", "\"i1\"" } });
+        if (dropAt > 0) server.dropAfter(response.size() - image.size() + dropAt); // Once
+        dropAt = 0;
+        return response;
+    }
+
+    std::string image = firmwareImage(20000);
+    std::string announced = manifest("1.1.0");
+    std::string lastModified = "Mon, 05 Oct 2026 08:00:00 GMT";
+    bool chunked = false;
+    size_t dropAt = 0;   ///< Bytes of the image sent before the connection drops, 0 for none.
+    LoopbackServer server { [this](const LoopbackServer::Request& request) { return answer(request); } };
+    OTAPull pull;
+};
+
+TEST_F(OTAPullTest, InstallsTheAnnouncedVersion) {
+    ASSERT_TRUE(pull.check());
+    EXPECT_EQ("1.1.0", std::string(pull.getAvailableVersion().c_str()));
+    run();
+
+    EXPECT_EQ(OTA_PULL_IDLE, pull.getState());
+    EXPECT_EQ(1u, Update.getInstalls());
+    EXPECT_EQ(std::vector<uint8_t>(image.begin(), image.end()), Update.getImage());
+    EXPECT_EQ(1u, pull.getStats().downloads);
+    EXPECT_EQ(0u, pull.getStats().failures);
+    ASSERT_EQ(2u, server.requests().size());
+    EXPECT_EQ("/firmware/firmware.bin", server.requests()[1].target);
+}
+
+TEST_F(OTAPullTest, IgnoresTheRunningVersion) {
+    announced = manifest("1.0.0");
+    EXPECT_FALSE(pull.check());
+    EXPECT_EQ(0u, Update.getBegins());
+    EXPECT_EQ(1u, server.requests().size());
+}
+
+TEST_F(OTAPullTest, ChecksFromLoopWhenConnected) {
+    WiFi.setStatus(WL_DISCONNECTED);
+    pull.loop();
+    EXPECT_EQ(0u, pull.getStats().checks);
+
+    WiFi.setStatus(WL_CONNECTED);
+    run();
+    EXPECT_EQ(1u, pull.getStats().checks);
+    EXPECT_EQ(1u, Update.getInstalls());
+}
+
+TEST_F(OTAPullTest, SendsTheValidatorsOfTheManifest) {
+    announced = manifest("1.0.0");
+    EXPECT_FALSE(pull.check());
+    EXPECT_FALSE(pull.check());
+
+    std::vector<LoopbackServer::Request> requests = server.requests();
+    ASSERT_EQ(2u, requests.size());
+    EXPECT_EQ("", requests[0].header("If-None-Match"));
+    EXPECT_EQ("\"m1\"", requests[1].header("If-None-Match"));
+    EXPECT_EQ(lastModified, requests[1].header("If-Modified-Since"));
+    EXPECT_EQ(2u, pull.getStats().checks);
+    EXPECT_EQ(1u, pull.getStats().notModified);
+}
+
+TEST_F(OTAPullTest, ResumesADroppedDownloadWithARange) {
+    dropAt = 8000;
+    ASSERT_TRUE(pull.check());
+    run();
+
+    EXPECT_EQ(1u, Update.getInstalls());
+    EXPECT_EQ(std::vector<uint8_t>(image.begin(), image.end()), Update.getImage());
+    EXPECT_EQ(1u, pull.getStats().resumes);
+    EXPECT_EQ(0u, pull.getStats().restarts);
+    std::vector<LoopbackServer::Request> requests = server.requests();
+    ASSERT_EQ(3u, requests.size());
+    EXPECT_EQ("bytes=8000-", requests[2].header("Range"));
+    EXPECT_EQ("\"i1\"", requests[2].header("If-Range"));
+}
+
+TEST_F(OTAPullTest, RejectsAnImageWhoseSha256DoesNotMatch) {
+    announced = manifest("1.1.0", std::string(64, '0'));
+    ASSERT_TRUE(pull.check());
+    run();
+    EXPECT_EQ(0u, Update.getInstalls());
+    EXPECT_EQ(1u, Update.getAborts());
+    EXPECT_EQ(1u, pull.getStats().failures);
+
+    announced = manifest("1.1.0", HostSHA256::hex(image.data(), image.size()));
+    ASSERT_TRUE(pull.check()); // The validators were cleared: the version is tried again
+    run();
+    EXPECT_EQ(1u, Update.getInstalls());
+}
+
+TEST_F(OTAPullTest, RejectsAChunkedImage) {
+    chunked = true;
+    EXPECT_FALSE(pull.check());
+    EXPECT_EQ(OTA_PULL_IDLE, pull.getState());
+    EXPECT_EQ(1u, Update.getAborts());
+    EXPECT_EQ(1u, pull.getStats().failures);
+}
+
+} // namespace
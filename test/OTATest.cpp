@@ -0,0 +1,373 @@
+/**
+ * @file OTATest.cpp
+ * @brief Tests of the OTA endpoints over loopback: file, firmware, session, delta and
+ * archive uploads, including cut and rejected ones, the archive download and the listings.
+ *
+ * The firmware lands in the Update stand-in, which keeps the image installed; the clock is
+ * manual, so that the delay before the reboot passes at once.
+ */
+#include <gtest/gtest.h>
+#include <zlib.h>
+#include <string>
+#include <vector>
+#include <ArduinoJson.h>
+#include <BearSSLHelpers.h>
+#include <HostCrypto.h>
+#include <LittleFS.h>
+#include <Updater.h>
+#include "LoopbackHttp.h"
+#include "OTA/OTA.h"
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+/**
+ * @brief Firmware image: the magic byte, then a pattern.
+ */
+Bytes firmware(size_t size, uint8_t seed = 1) {
+    Bytes image(size);
+    for (size_t i = 0; i < size; i++) image[i] = (uint8_t)(seed + i * 13 + (i >> 7));
+    image[0] = 0xE9;
+    return image;
+}
+
+std::string text(const Bytes& data) {
+    return std::string(data.begin(), data.end());
+}
+
+std::string gzip(const std::string& data, int windowBits = 12) {
+    z_stream stream = {};
+    EXPECT_EQ(Z_OK, deflateInit2(&stream, 9, Z_DEFLATED, 16 + windowBits, 8, Z_DEFAULT_STRATEGY));
+    std::string output(deflateBound(&stream, data.size()) + 64, '\0');
+    stream.next_in = (Bytef*)data.data();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef*)&output[0];
+    stream.avail_out = output.size();
+    EXPECT_EQ(Z_STREAM_END, deflate(&stream, Z_FINISH));
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+Bytes fromHex(const std::string& hex) {
+    Bytes data;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) data.push_back((uint8_t)strtoul(hex.substr(i, 2).c_str(), nullptr, 16));
+    return data;
+}
+
+/**
+ * @brief Public key whose DER holds the RSA algorithm identifier, as far as the stand-in parses keys.
+ */
+const char* const signingKey =
+    "-----BEGIN PUBLIC KEY-----\n"
+    "MCIwDQYJKoZIhvcNAQEBBQADEQAwDgIHAMCbT2A2FwIDAQAB\n"
+    "-----END PUBLIC KEY-----\n";
+
+class OTATest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(LittleFS.begin());
+        LittleFS.format();
+        Update.reset();
+        Serial.quiet(true);
+        HostClock::setManual(true);
+        manager.begin();
+        ota.begin();
+        port = WiFiServer::hostPort(80);
+        ASSERT_NE(0, port);
+        restarts = ESP.getRestarts();
+    }
+
+    void TearDown() override {
+        HostClock::setManual(false);
+        Serial.quiet(false);
+        ESP.setSketch(Bytes());
+    }
+
+    LoopbackHttp::Response send(const LoopbackHttp::Request& request) {
+        return LoopbackHttp::request(port, request, [this]() { manager.loop(); ota.loop(); });
+    }
+
+    LoopbackHttp::Response get(const std::string& target, const char* method = "GET") {
+        LoopbackHttp::Request request;
+        request.method = method;
+        request.target = target;
+        return send(request);
+    }
+
+    LoopbackHttp::Response post(const std::string& target, const std::string& body, const char* type = "application/octet-stream") {
+        LoopbackHttp::Request request;
+        request.method = "POST";
+        request.target = target;
+        request.headers.push_back({ "Content-Type", type });
+        request.body = body;
+        return send(request);
+    }
+
+    static JsonDocument json(const LoopbackHttp::Response& response) {
+        JsonDocument doc;
+        EXPECT_FALSE(deserializeJson(doc, response.body)) << response.body;
+        return doc;
+    }
+
+    static void store(const char* path, const std::string& content) {
+        File file = LittleFS.open(path, "w");
+        file.write((const uint8_t*)content.data(), content.size());
+        file.close();
+    }
+
+    static std::string content(const char* path) {
+        File file = LittleFS.open(path, "r");
+        std::string data;
+        uint8_t buffer[512];
+        int count;
+        while (file && (count = file.read(buffer, sizeof(buffer))) > 0) data.append((const char*)buffer, count);
+        return data;
+    }
+
+    HTTPServerManager manager;
+    OTA ota{ manager };
+    uint16_t port = 0;
+    uint32_t restarts = 0;
+};
+
+TEST_F(OTATest, UploadsAFileIntoADirectory) {
+    std::string csv;
+    for (int i = 0; i < 2000; i++) csv += std::to_string(i) + ",21.5\n";
+    LoopbackHttp::Response response = send(LoopbackHttp::upload("/api/upload?directory=/data", "readings.csv", csv));
+    EXPECT_EQ(200, response.code) << response.body;
+    EXPECT_EQ(csv, content("/data/readings.csv"));
+    EXPECT_EQ(csv.size(), ota.getUploadStats().bytes);
+
+    JsonDocument files = json(get("/api/files?path=/data"));
+    ASSERT_EQ(1u, files["files"].size());
+    EXPECT_EQ("/data/readings.csv", std::string(files["files"][0]["name"].as<const char*>()));
+    EXPECT_EQ(csv.size(), files["files"][0]["size"].as<size_t>());
+}
+
+TEST_F(OTATest, KeepsThePreviousFileWhenTheUploadIsCut) {
+    store("/data/readings.csv", "previous");
+    LoopbackHttp::Request request = LoopbackHttp::upload("/api/upload?directory=/data", "readings.csv", std::string(10000, 'n'));
+    request.cutAfter = 6000;
+    send(request);
+    EXPECT_EQ("previous", content("/data/readings.csv"));
+    EXPECT_FALSE(LittleFS.exists("/data/" OTA_UPLOAD_TEMP_NAME));
+
+    EXPECT_EQ(200, send(LoopbackHttp::upload("/api/upload?directory=/data", "readings.csv", "next")).code); // The next upload is served
+    EXPECT_EQ("next", content("/data/readings.csv"));
+}
+
+TEST_F(OTATest, InflatesCompressedUploads) {
+    std::string page = "<html>" + std::string(3000, 'a') + "</html>";
+    LoopbackHttp::Response response = send(LoopbackHttp::upload("/api/upload?directory=/www&inflate=1", "index.html.gz", gzip(page)));
+    EXPECT_EQ(200, response.code) << response.body;
+    EXPECT_EQ(page, content("/www/index.html"));
+    EXPECT_TRUE(ota.getUploadStats().compressed);
+    EXPECT_EQ(page.size(), ota.getUploadStats().storedBytes);
+}
+
+TEST_F(OTATest, StoresCompressedUploadsAsTheyAreByDefault) {
+    // Made by the gzip tool: back-references reach beyond the 4 KB window of the device
+    std::string log;
+    for (int i = 0; i < 400; i++) log += "sensor " + std::to_string(i * 7919 % 1000) + " reading " + std::to_string(i) + "\n";
+    std::string compressed = gzip(log + log, 15);
+    LoopbackHttp::Response response = send(LoopbackHttp::upload("/api/upload?directory=/logs", "readings.log.gz", compressed));
+    EXPECT_EQ(200, response.code) << response.body;
+    EXPECT_EQ(compressed, content("/logs/readings.log.gz"));
+    EXPECT_FALSE(ota.getUploadStats().compressed);
+
+    response = send(LoopbackHttp::upload("/api/upload?directory=/logs&inflate=1", "readings.log.gz", compressed));
+    EXPECT_EQ(500, response.code);
+    EXPECT_EQ("nok5", std::string(json(response)["status"].as<const char*>()));
+    EXPECT_FALSE(LittleFS.exists("/logs/readings.log"));
+}
+
+TEST_F(OTATest, InstallsAnUploadedFirmwareAndReboots) {
+    Bytes image = firmware(40000);
+    LoopbackHttp::Response response = send(LoopbackHttp::upload("/api/firmware", "firmware.bin", text(image)));
+    ASSERT_EQ(200, response.code) << response.body;
+    EXPECT_EQ(HostSHA256::hex(image.data(), image.size()), json(response)["sha256"].as<const char*>());
+    EXPECT_TRUE(Update.getImage() == image);
+    EXPECT_EQ(restarts + 1, ESP.getRestarts());
+    EXPECT_EQ(image.size(), ota.getFirmwareStats().bytes);
+}
+
+TEST_F(OTATest, RejectsAFirmwareWhoseSha256DoesNotMatch) {
+    Bytes image = firmware(20000);
+    LoopbackHttp::Response response = send(LoopbackHttp::upload("/api/firmware?sha256=" + std::string(64, '0'), "firmware.bin", text(image)));
+    EXPECT_EQ(500, response.code);
+    EXPECT_EQ("nok5", std::string(json(response)["status"].as<const char*>()));
+    EXPECT_EQ(0u, Update.getInstalls());
+    EXPECT_EQ(restarts, ESP.getRestarts());
+
+    response = send(LoopbackHttp::upload("/api/firmware?sha256=" + HostSHA256::hex(image.data(), image.size()), "firmware.bin", text(image)));
+    EXPECT_EQ(200, response.code);
+}
+
+TEST_F(OTATest, AbandonsAFirmwareCutByADroppedConnection) {
+    LoopbackHttp::Request request = LoopbackHttp::upload("/api/firmware", "firmware.bin", text(firmware(30000)));
+    request.cutAfter = 12000;
+    send(request);
+    EXPECT_EQ(0u, Update.getInstalls());
+    EXPECT_FALSE(Update.isRunning());
+    EXPECT_EQ(restarts, ESP.getRestarts());
+}
+
+TEST_F(OTATest, VerifiesTheSignatureOfTheFirmware) {
+    ASSERT_TRUE(ota.setSigningKey(signingKey));
+    Bytes image = firmware(16000);
+    Bytes signature = BearSSL::SigningVerifier::sign(BearSSL::PublicKey(signingKey), image);
+    Bytes signed_ = image;
+    signed_.insert(signed_.end(), signature.begin(), signature.end());
+    Bytes tampered = signed_;
+    tampered[5000] ^= 1;
+
+    LoopbackHttp::Response response = send(LoopbackHttp::upload("/api/firmware", "firmware.bin", text(tampered)));
+    EXPECT_EQ(500, response.code);
+    EXPECT_EQ("nok2", std::string(json(response)["status"].as<const char*>()));
+    EXPECT_EQ(500, send(LoopbackHttp::upload("/api/firmware", "firmware.bin", text(image))).code); // Unsigned
+
+    response = send(LoopbackHttp::upload("/api/firmware", "firmware.bin", text(signed_)));
+    EXPECT_EQ(200, response.code) << response.body;
+    EXPECT_TRUE(Update.getImage() == signed_);
+}
+
+TEST_F(OTATest, ResumesASessionUploadFromTheCommittedOffset) {
+    Bytes image = firmware(OTA_CHUNK_SIZE * 2 + 1000);
+    JsonDocument session = json(post("/api/firmware/session?size=" + std::to_string(image.size()), ""));
+    std::string id = session["session"].as<const char*>();
+    ASSERT_EQ(8u, id.size());
+    EXPECT_EQ(0, session["offset"].as<int>());
+    EXPECT_EQ(OTA_CHUNK_SIZE, session["chunk"].as<int>());
+
+    std::string chunk = "/api/firmware/chunk?session=" + id + "&offset=";
+    EXPECT_EQ(200, post(chunk + "0", text(Bytes(image.begin(), image.begin() + OTA_CHUNK_SIZE))).code);
+
+    LoopbackHttp::Request cut; // The second chunk is cut: nothing of it is written
+    cut.method = "POST";
+    cut.target = chunk + std::to_string(OTA_CHUNK_SIZE);
+    cut.headers.push_back({ "Content-Type", "application/octet-stream" });
+    cut.body = text(Bytes(image.begin() + OTA_CHUNK_SIZE, image.begin() + 2 * OTA_CHUNK_SIZE));
+    cut.cutAfter = 1500;
+    send(cut);
+    EXPECT_EQ(OTA_CHUNK_SIZE, json(get("/api/firmware/session"))["offset"].as<int>());
+
+    EXPECT_EQ(200, post(chunk + "0", text(Bytes(image.begin(), image.begin() + OTA_CHUNK_SIZE))).code); // Sent again: acknowledged
+    EXPECT_EQ(409, post(chunk + std::to_string(2 * OTA_CHUNK_SIZE), "x").code);
+    EXPECT_EQ(200, post(chunk + std::to_string(OTA_CHUNK_SIZE), cut.body).code);
+    LoopbackHttp::Response last = post(chunk + std::to_string(2 * OTA_CHUNK_SIZE), text(Bytes(image.begin() + 2 * OTA_CHUNK_SIZE, image.end())));
+    EXPECT_EQ(200, last.code) << last.body;
+    EXPECT_TRUE(Update.getImage() == image);
+    EXPECT_EQ(restarts + 1, ESP.getRestarts());
+    EXPECT_EQ(404, get("/api/firmware/session").code);
+}
+
+TEST_F(OTATest, AbandonsAnIdleSession) {
+    ASSERT_EQ(200, post("/api/firmware/session?size=10000", "").code);
+    EXPECT_TRUE(Update.isRunning());
+    ota.setSessionTimeout(1000);
+    delay(1000);
+    ota.loop();
+    EXPECT_FALSE(Update.isRunning());
+    EXPECT_EQ(404, get("/api/firmware/session").code);
+}
+
+TEST_F(OTATest, BuildsTheFirmwareFromADeltaPatch) {
+    Bytes base = firmware(12000, 3);
+    Bytes next = base;
+    for (size_t i = 4000; i < 4100; i++) next[i] ^= 0x5A;
+    ESP.setSketch(base);
+
+    Bytes patch = { 'I', 'O', 'T', 'D', 'I', 'F', 'F', '1' };
+    for (uint32_t value : { (uint32_t)base.size(), (uint32_t)next.size() }) {
+        for (int i = 0; i < 4; i++) patch.push_back((uint8_t)(value >> (8 * i)));
+    }
+    Bytes md5 = fromHex(hostMD5(base.data(), base.size()));
+    Bytes sha256 = fromHex(HostSHA256::hex(next.data(), next.size()));
+    patch.insert(patch.end(), md5.begin(), md5.end());
+    patch.insert(patch.end(), sha256.begin(), sha256.end());
+    for (uint32_t value : { (uint32_t)next.size(), 0u, 0u }) { // One record: the whole image as diff bytes
+        for (int i = 0; i < 4; i++) patch.push_back((uint8_t)(value >> (8 * i)));
+    }
+    for (size_t i = 0; i < next.size(); i++) patch.push_back((uint8_t)(next[i] - base[i]));
+
+    LoopbackHttp::Response response = send(LoopbackHttp::upload("/api/firmware/delta", "update.patch", text(patch)));
+    ASSERT_EQ(200, response.code) << response.body;
+    EXPECT_TRUE(Update.getImage() == next);
+    EXPECT_TRUE(ota.getFirmwareStats().delta);
+
+    ESP.setSketch(next); // Running another firmware: the patch is refused before anything is written
+    response = send(LoopbackHttp::upload("/api/firmware/delta", "update.patch", text(patch)));
+    EXPECT_EQ(500, response.code);
+    EXPECT_EQ("nok6", std::string(json(response)["status"].as<const char*>()));
+    EXPECT_EQ(1u, Update.getInstalls());
+}
+
+TEST_F(OTATest, ExtractsAnUploadedArchiveAndDownloadsItBack) {
+    std::string archive;
+    TarWriter writer;
+    writer.begin([&](const uint8_t* data, size_t length) { archive.append((const char*)data, length); return true; });
+    std::string style(5000, 's');
+    std::string script = "console.log('ok');";
+    ASSERT_TRUE(writer.addDirectory("css", 1700000000));
+    size_t offset = 0;
+    ASSERT_TRUE(writer.addFile("css/style.css", style.size(), 1700000000, [&](uint8_t* data, size_t length) {
+        size_t count = std::min(length, style.size() - offset);
+        memcpy(data, style.data() + offset, count);
+        offset += count;
+        return count;
+    }));
+    ASSERT_TRUE(writer.addFile("app.js", script.size(), 1700000000, [&](uint8_t* data, size_t length) {
+        memcpy(data, script.data(), script.size());
+        return std::min(length, script.size());
+    }));
+    ASSERT_TRUE(writer.end());
+
+    LoopbackHttp::Response response = send(LoopbackHttp::upload("/api/archive?directory=/www", "site.tar", archive));
+    ASSERT_EQ(200, response.code) << response.body;
+    EXPECT_EQ(2, json(response)["files"].as<int>());
+    EXPECT_EQ(style, content("/www/css/style.css"));
+    EXPECT_EQ(script, content("/www/app.js"));
+
+    response = get("/api/archive?path=/www");
+    ASSERT_EQ(200, response.code);
+    EXPECT_EQ("chunked", response.header("Transfer-Encoding"));
+    EXPECT_TRUE(response.complete);
+    std::vector<std::string> names;
+    std::string extracted;
+    TarReader reader;
+    reader.begin([&](const TarEntry& entry) { names.push_back(entry.name); return true; },
+                 [&](const uint8_t* data, size_t length) { extracted.append((const char*)data, length); return true; });
+    ASSERT_TRUE(reader.write((const uint8_t*)response.body.data(), response.body.size()));
+    ASSERT_TRUE(reader.end());
+    EXPECT_EQ(std::vector<std::string>({ "app.js", "css", "css/style.css" }), names);
+    EXPECT_EQ(script + style, extracted);
+
+    EXPECT_EQ(404, get("/api/archive?path=/missing").code);
+
+    response = send(LoopbackHttp::upload("/api/archive?directory=/copy&inflate=1", "site.tar.gz", gzip(archive)));
+    ASSERT_EQ(200, response.code) << response.body;
+    EXPECT_EQ(style, content("/copy/css/style.css"));
+    EXPECT_TRUE(ota.getUploadStats().compressed);
+}
+
+TEST_F(OTATest, ListsCreatesAndDeletesEntries) {
+    store("/data/a.txt", "a");
+    store("/data/b.txt", "bb");
+    LoopbackHttp::Response response = post("/api/addDirectory", "{\"parentPath\":\"/data\",\"dirName\":\"logs\"}", "application/json");
+    EXPECT_EQ(200, response.code) << response.body;
+    EXPECT_EQ("[\"a.txt\",\"b.txt\",\"logs\"]", get("/api/directories?path=/data").body);
+
+    EXPECT_EQ(200, get("/api/delete?path=/data/a.txt", "DELETE").code);
+    EXPECT_EQ(404, get("/api/delete?path=/data/a.txt", "DELETE").code);
+    EXPECT_FALSE(LittleFS.exists("/data/a.txt"));
+    EXPECT_EQ("[\"b.txt\",\"logs\"]", get("/api/directories?path=/data").body);
+
+    response = get("/api/download?file=/data/b.txt");
+    EXPECT_EQ(200, response.code);
+    EXPECT_EQ("bb", response.body);
+    EXPECT_EQ(404, get("/api/download?file=/data/a.txt").code);
+}
+
+} // namespace
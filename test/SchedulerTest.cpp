@@ -0,0 +1,96 @@
+/**
+ * @file SchedulerTest.cpp
+ * @brief Tests of the Scheduler: run order, starvation, notifications and idling.
+ */
+#include <gtest/gtest.h>
+#include <string>
+#include "Scheduler/Scheduler.h"
+
+namespace {
+
+class SchedulerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        HostClock::setManual(true);
+    }
+
+    void TearDown() override {
+        HostClock::setManual(false);
+    }
+
+    /**
+     * @brief Calls loop() every ms for a duration.
+     */
+    void run(unsigned long duration) {
+        for (unsigned long elapsed = 0; elapsed < duration; elapsed++) {
+            scheduler.loop();
+            HostClock::advance(1000);
+        }
+    }
+
+    Scheduler scheduler;
+    std::string trace;
+};
+
+TEST_F(SchedulerTest, RunsEveryDueTaskByPriority) {
+    scheduler.addTask("low", [&]() { trace += "L"; }, 10, SCHEDULER_PRIORITY_LOW);
+    scheduler.addTask("normal", [&]() { trace += "N"; }, 10);
+    scheduler.addTask("high", [&]() { trace += "H"; }, 10, SCHEDULER_PRIORITY_HIGH);
+    scheduler.loop();
+    EXPECT_EQ("HNL", trace);
+}
+
+TEST_F(SchedulerTest, ATaskOnEveryPassDoesNotStarveTheOthers) {
+    int8_t busy = scheduler.addTask("busy", [&]() {}, 0, SCHEDULER_PRIORITY_HIGH);
+    int8_t normal = scheduler.addTask("normal", [&]() {}, 10);
+    int8_t low = scheduler.addTask("low", [&]() {}, 100, SCHEDULER_PRIORITY_LOW);
+    run(1000);
+    EXPECT_EQ(1000u, scheduler.getStats(busy).runs);
+    EXPECT_EQ(100u, scheduler.getStats(normal).runs);
+    EXPECT_EQ(10u, scheduler.getStats(low).runs);
+}
+
+TEST_F(SchedulerTest, RunsTheMostOverdueFirstAmongEqualPriorities) {
+    scheduler.addTask("a", [&]() { trace += "a"; }, 10);
+    scheduler.addTask("b", [&]() { trace += "b"; }, 5);
+    scheduler.loop();
+    trace.clear();
+    HostClock::advance(12000); // a is 2 ms late, b 7 ms
+    scheduler.loop();
+    EXPECT_EQ("ba", trace);
+}
+
+TEST_F(SchedulerTest, RunsEventTasksOnlyWhenNotified) {
+    int8_t event = scheduler.addEventTask("event", [&]() { trace += "E"; });
+    scheduler.addTask("periodic", [&]() { trace += "P"; }, 10, SCHEDULER_PRIORITY_HIGH);
+    run(5);
+    EXPECT_EQ("P", trace);
+    scheduler.notify(event);
+    scheduler.loop();
+    EXPECT_EQ("PE", trace); // Notified tasks are the most overdue of their priority
+    scheduler.loop();
+    EXPECT_EQ("PE", trace);
+}
+
+TEST_F(SchedulerTest, SkipsATaskSuspendedEarlierInThePass) {
+    int8_t second = -1;
+    scheduler.addTask("first", [&]() { trace += "1"; scheduler.setEnabled(second, false); }, 10, SCHEDULER_PRIORITY_HIGH);
+    second = scheduler.addTask("second", [&]() { trace += "2"; }, 10);
+    scheduler.loop();
+    EXPECT_EQ("1", trace);
+}
+
+TEST_F(SchedulerTest, IdlesUntilTheNextTaskIsDue) {
+    scheduler.setIdleMode(SCHEDULER_IDLE_DELAY);
+    scheduler.setMaxIdle(50);
+    int8_t task = scheduler.addTask("task", [&]() {}, 20);
+    scheduler.loop(); // Runs the task
+    unsigned long start = millis();
+    scheduler.loop(); // Sleeps until it is due again
+    EXPECT_EQ(20u, millis() - start);
+    scheduler.loop();
+    EXPECT_EQ(2u, scheduler.getStats(task).runs);
+    EXPECT_EQ(20000u, scheduler.getIdleMicros());
+}
+
+} // namespace
@@ -0,0 +1,56 @@
+/**
+ * @file SinkBroker.h
+ * @brief MQTT broker stand-in that accepts everything and allocates nothing.
+ *
+ * Installed as the network of WiFiClient, it accepts the TCP connection, answers the
+ * CONNECT and counts the PUBLISH packets without storing them, so that allocation counts
+ * and timings of the client side are not disturbed by the broker.
+ */
+#ifndef SINK_BROKER_H
+#define SINK_BROKER_H
+
+#include <Client.h>
+#include <WiFiClient.h>
+
+class SinkBroker : public Client {
+public:
+    SinkBroker() { WiFiClient::setNetwork(this); }
+    ~SinkBroker() { WiFiClient::setNetwork(nullptr); }
+
+    int connect(IPAddress, uint16_t) override { _connected = true; return 1; }
+    int connect(const char*, uint16_t) override { _connected = true; return 1; }
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if ((buffer[0] & 0xF0) == 0x10) _pending = 4; // CONNECT: queue the CONNACK
+        if ((buffer[0] & 0xF0) == 0x30) _publishes++;
+        _bytes += size;
+        return size;
+    }
+    using Print::write;
+    int available() override { return _pending; }
+    int read() override {
+        static const uint8_t connack[4] = { 0x20, 2, 0, 0 };
+        return _pending > 0 ? connack[4 - _pending--] : -1;
+    }
+    int read(uint8_t* buffer, size_t size) override {
+        size_t count = 0;
+        for (int b; count < size && (b = read()) >= 0;) buffer[count++] = (uint8_t)b;
+        return (int)count;
+    }
+    int peek() override { return -1; }
+    void flush() override {}
+    void stop() override { _connected = false; }
+    uint8_t connected() override { return _connected; }
+    operator bool() override { return _connected; }
+
+    uint32_t getPublishes() const { return _publishes; } ///< PUBLISH packets received.
+    uint64_t getBytes() const { return _bytes; }         ///< Bytes received.
+
+private:
+    bool _connected = false;
+    int _pending = 0;
+    uint32_t _publishes = 0;
+    uint64_t _bytes = 0;
+};
+
+#endif
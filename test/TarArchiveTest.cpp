@@ -0,0 +1,261 @@
+/**
+ * @file TarArchiveTest.cpp
+ * @brief Round trips of entries through the TarWriter and TarReader in chunks of any size,
+ * archives of Python's tarfile (long names, links), and names and archives that must be
+ * rejected.
+ */
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "OTA/TarArchive.h"
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+/**
+ * @brief Entry of an archive with its content.
+ */
+struct Item {
+    std::string name;
+    TarEntryType type;
+    Bytes content;
+    uint32_t mtime;
+
+    bool operator==(const Item& other) const {
+        return name == other.name && type == other.type && content == other.content && mtime == other.mtime;
+    }
+};
+
+Bytes content(size_t size, uint8_t seed) {
+    Bytes data(size);
+    for (size_t i = 0; i < size; i++) data[i] = (uint8_t)(seed + i * 7 + (i >> 8));
+    return data;
+}
+
+/**
+ * @brief Archive of the items, made by a TarWriter; empty if the writer failed.
+ */
+Bytes pack(const std::vector<Item>& items) {
+    Bytes archive;
+    TarWriter writer;
+    writer.begin([&](const uint8_t* data, size_t length) { archive.insert(archive.end(), data, data + length); return true; });
+    for (const Item& item : items) {
+        if (item.type == TAR_ENTRY_DIRECTORY) {
+            EXPECT_TRUE(writer.addDirectory(item.name.c_str(), item.mtime)) << item.name;
+            continue;
+        }
+        size_t offset = 0;
+        EXPECT_TRUE(writer.addFile(item.name.c_str(), item.content.size(), item.mtime, [&](uint8_t* data, size_t length) {
+            size_t count = std::min(length, item.content.size() - offset);
+            memcpy(data, item.content.data() + offset, count);
+            offset += count;
+            return count;
+        })) << item.name;
+    }
+    if (!writer.end()) return Bytes();
+    EXPECT_EQ(archive.size(), writer.getOutputSize());
+    EXPECT_EQ(0u, archive.size() % TAR_BLOCK_SIZE);
+    return archive;
+}
+
+/**
+ * @brief Entries read by a TarReader fed in chunks of the given size.
+ */
+struct Unpacked {
+    bool ok;
+    TarError error;
+    std::vector<Item> items;
+    uint32_t ended;      ///< Files whose end was received.
+    uint32_t skipped;
+};
+
+Unpacked unpack(const Bytes& archive, size_t chunk) {
+    Unpacked result = { false, TAR_OK, {}, 0, 0 };
+    TarReader reader;
+    reader.begin(
+        [&](const TarEntry& entry) {
+            result.items.push_back({ entry.name, entry.type, {}, entry.mtime });
+            if (entry.type == TAR_ENTRY_DIRECTORY) EXPECT_EQ(0u, entry.size);
+            return true;
+        },
+        [&](const uint8_t* data, size_t length) {
+            result.items.back().content.insert(result.items.back().content.end(), data, data + length);
+            return true;
+        },
+        [&](const TarEntry& entry) {
+            EXPECT_EQ(entry.size, result.items.back().content.size()) << entry.name;
+            result.ended++;
+            return true;
+        });
+    bool written = true;
+    for (size_t offset = 0; written && offset < archive.size(); offset += chunk) {
+        written = reader.write(archive.data() + offset, std::min(chunk, archive.size() - offset));
+    }
+    result.ok = written && reader.end();
+    result.error = reader.getError();
+    result.skipped = reader.getSkipped();
+    return result;
+}
+
+/**
+ * @brief Standard output of a Python script run next to input.tar, holding input; empty if
+ * the script or Python fails.
+ */
+Bytes python(const std::string& script, const Bytes& input = Bytes()) {
+    char directory[] = "/tmp/tar_archive_XXXXXX";
+    if (mkdtemp(directory) == nullptr) return Bytes();
+    std::string dir = directory;
+    Bytes output;
+    FILE* file = fopen((dir + "/input.tar").c_str(), "wb");
+    bool written = file != nullptr && fwrite(input.data(), 1, input.size(), file) == input.size();
+    if (file != nullptr) fclose(file);
+    if (written) {
+        std::string command = "cd " + dir + " && python3 -c '" + script + "' 2>/dev/null";
+        FILE* pipe = popen(command.c_str(), "r");
+        if (pipe != nullptr) {
+            uint8_t buffer[4096];
+            size_t length;
+            while ((length = fread(buffer, 1, sizeof(buffer), pipe)) > 0) output.insert(output.end(), buffer, buffer + length);
+            if (pclose(pipe) != 0) output.clear();
+        }
+    }
+    std::string cleanup = "rm -rf " + dir;
+    (void)system(cleanup.c_str());
+    return output;
+}
+
+std::vector<Item> sampleItems() {
+    std::string longName = "www/assets/" + std::string(90, 'd') + "/" + std::string(60, 'f') + ".js"; // Needs the ustar prefix
+    return {
+        { "www", TAR_ENTRY_DIRECTORY, {}, 1700000000 },
+        { "www/index.html", TAR_ENTRY_FILE, content(1000, 1), 1700000001 },
+        { "www/empty.txt", TAR_ENTRY_FILE, {}, 1700000002 },
+        { "www/block.bin", TAR_ENTRY_FILE, content(TAR_BLOCK_SIZE, 2), 1700000003 },
+        { "www/assets", TAR_ENTRY_DIRECTORY, {}, 1700000004 },
+        { longName, TAR_ENTRY_FILE, content(5000, 3), 1700000005 },
+        { "logs/datalog.csv", TAR_ENTRY_FILE, content(TAR_WRITER_BUFFER_SIZE * 3 + 17, 4), 1700000006 },
+    };
+}
+
+TEST(TarArchiveTest, RoundTripsEntriesInChunksOfAnySize) {
+    std::vector<Item> items = sampleItems();
+    Bytes archive = pack(items);
+    ASSERT_FALSE(archive.empty());
+    for (size_t chunk : { (size_t)1, (size_t)7, (size_t)TAR_BLOCK_SIZE, (size_t)1460, archive.size() }) {
+        Unpacked result = unpack(archive, chunk);
+        ASSERT_TRUE(result.ok) << "chunk " << chunk << " error " << result.error;
+        ASSERT_TRUE(result.items == items) << "chunk " << chunk;
+        EXPECT_EQ(5u, result.ended) << "chunk " << chunk;
+        EXPECT_EQ(0u, result.skipped);
+    }
+}
+
+TEST(TarArchiveTest, PythonTarfileReadsTheArchive) {
+    std::vector<Item> items = sampleItems();
+    Bytes listing = python(
+        "import sys, tarfile, hashlib\n"
+        "for m in tarfile.open(\"input.tar\"):\n"
+        "    data = b\"\" if m.isdir() else tarfile.open(\"input.tar\").extractfile(m).read()\n"
+        "    print(m.name, \"d\" if m.isdir() else \"f\", m.size, m.mtime, hashlib.md5(data).hexdigest())\n",
+        pack(items));
+    if (listing.empty()) GTEST_SKIP() << "python3 not available";
+    std::string text(listing.begin(), listing.end());
+    for (const Item& item : items) {
+        EXPECT_NE(std::string::npos, text.find(item.name + (item.type == TAR_ENTRY_DIRECTORY ? " d 0 " : " f ")
+            + (item.type == TAR_ENTRY_DIRECTORY ? "" : std::to_string(item.content.size()) + " ") + std::to_string(item.mtime)))
+            << item.name;
+    }
+}
+
+TEST(TarArchiveTest, ReadsLongNamesOfPythonTarfileAndSkipsLinks) {
+    std::string name = std::string(120, 'n') + "/" + std::string(100, 'm') + ".txt"; // No ustar split
+    for (const char* format : { "GNU_FORMAT", "PAX_FORMAT" }) {
+        Bytes archive = python(
+            std::string("import io, sys, tarfile\n"
+            "out = io.BytesIO()\n"
+            "t = tarfile.open(fileobj=out, mode=\"w\", format=tarfile.") + format + ")\n"
+            "i = tarfile.TarInfo(\"" + name + "\"); i.size = 3; i.mtime = 1700000000\n"
+            "t.addfile(i, io.BytesIO(b\"abc\"))\n"
+            "l = tarfile.TarInfo(\"link\"); l.type = tarfile.SYMTYPE; l.linkname = \"after.txt\"\n"
+            "t.addfile(l)\n"
+            "i = tarfile.TarInfo(\"./after.txt\"); i.size = 1\n"
+            "t.addfile(i, io.BytesIO(b\"z\"))\n"
+            "t.close()\n"
+            "sys.stdout.buffer.write(out.getvalue())\n");
+        if (archive.empty()) GTEST_SKIP() << "python3 not available";
+        Unpacked result = unpack(archive, 100);
+        ASSERT_TRUE(result.ok) << format << " error " << result.error;
+        ASSERT_EQ(2u, result.items.size()) << format;
+        EXPECT_EQ(name, result.items[0].name) << format;
+        EXPECT_EQ(Bytes({ 'a', 'b', 'c' }), result.items[0].content);
+        EXPECT_EQ(1700000000u, result.items[0].mtime);
+        EXPECT_EQ("after.txt", result.items[1].name) << format; // Relative
+        EXPECT_EQ(1u, result.skipped) << format;
+    }
+}
+
+TEST(TarArchiveTest, WriterRejectsNamesThatDoNotFit) {
+    Bytes archive;
+    TarWriter writer;
+    writer.begin([&](const uint8_t* data, size_t length) { archive.insert(archive.end(), data, data + length); return true; });
+    std::string unsplittable(150, 'x'); // No '/' to split at
+    EXPECT_FALSE(writer.addDirectory(unsplittable.c_str()));
+    EXPECT_EQ(TAR_ERROR_NAME, writer.getError());
+    EXPECT_TRUE(writer.addFile("kept.txt", 2, 0, [](uint8_t* data, size_t) { data[0] = 'o'; data[1] = 'k'; return (size_t)2; }));
+    EXPECT_TRUE(writer.end());
+    EXPECT_EQ(1u, writer.getFiles());
+    EXPECT_EQ(0u, writer.getDirectories());
+
+    Unpacked result = unpack(archive, 1460);
+    ASSERT_TRUE(result.ok);
+    ASSERT_EQ(1u, result.items.size());
+    EXPECT_EQ("kept.txt", result.items[0].name);
+}
+
+TEST(TarArchiveTest, WriterFailsOnAShortSource) {
+    TarWriter writer;
+    writer.begin([](const uint8_t*, size_t) { return true; });
+    EXPECT_FALSE(writer.addFile("short.bin", 1000, 0, [](uint8_t* data, size_t length) {
+        static bool given = false;
+        if (given) return (size_t)0;
+        given = true;
+        memset(data, 1, 10);
+        return (size_t)10;
+    }));
+    EXPECT_EQ(TAR_ERROR_SOURCE, writer.getError());
+}
+
+TEST(TarArchiveTest, ReaderRejectsEscapingNamesAndBrokenArchives) {
+    Bytes escaping = pack({ { "www/../../etc/passwd", TAR_ENTRY_FILE, content(10, 5), 0 } });
+    ASSERT_FALSE(escaping.empty());
+    Unpacked result = unpack(escaping, 1460);
+    EXPECT_FALSE(result.ok);
+    EXPECT_EQ(TAR_ERROR_NAME, result.error);
+    EXPECT_TRUE(result.items.empty());
+
+    Bytes archive = pack(sampleItems());
+    Bytes corrupt(archive);
+    corrupt[TAR_BLOCK_SIZE + 1] ^= 0x20; // Name of the second header: checksum mismatch
+    EXPECT_EQ(TAR_ERROR_HEADER, unpack(corrupt, 1460).error);
+
+    Bytes truncated(archive.begin(), archive.begin() + TAR_BLOCK_SIZE * 3 + 100); // Inside index.html
+    Unpacked cut = unpack(truncated, 1460);
+    EXPECT_FALSE(cut.ok);
+    EXPECT_EQ(TAR_ERROR_TRUNCATED, cut.error);
+}
+
+TEST(TarArchiveTest, ReaderStopsWhenAHandlerRefuses) {
+    Bytes archive = pack(sampleItems());
+    TarReader reader;
+    int entries = 0;
+    reader.begin([&](const TarEntry&) { return ++entries < 2; }, [](const uint8_t*, size_t) { return true; });
+    EXPECT_FALSE(reader.write(archive.data(), archive.size()));
+    EXPECT_EQ(TAR_ERROR_OUTPUT, reader.getError());
+    EXPECT_EQ(2, entries);
+}
+
+} // namespace
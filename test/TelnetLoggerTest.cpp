@@ -0,0 +1,86 @@
+/**
+ * @file TelnetLoggerTest.cpp
+ * @brief Tests of the TelnetLogger: a client connected over loopback receives the log lines,
+ * and a new client takes the place of the previous one.
+ */
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include "Logger/TelnetLogger.h"
+
+namespace {
+
+class TelnetLoggerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Serial.quiet(true);
+        logger.begin();
+        port = WiFiServer::hostPort(23);
+        ASSERT_NE(0, port);
+    }
+
+    void TearDown() override {
+        for (int fd : clients) close(fd);
+        Serial.quiet(false);
+    }
+
+    /**
+     * @brief Connects a client and runs loop() until the logger accepted it.
+     */
+    int connectClient() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        EXPECT_EQ(0, connect(fd, (sockaddr*)&address, sizeof(address)));
+        clients.push_back(fd);
+        for (int i = 0; i < 100; i++) {
+            logger.loop();
+            usleep(1000);
+        }
+        return fd;
+    }
+
+    /**
+     * @brief Reads what arrived on a client within a timeout; stops early at EOF.
+     */
+    static std::string receive(int fd, size_t expected, int timeout = 2000) {
+        std::string text;
+        char buffer[256];
+        while (text.size() < expected) {
+            pollfd descriptor = { fd, POLLIN, 0 };
+            if (poll(&descriptor, 1, timeout) <= 0) break;
+            ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+            if (count <= 0) break;
+            text.append(buffer, count);
+        }
+        return text;
+    }
+
+    TelnetLogger logger;
+    uint16_t port = 0;
+    std::vector<int> clients;
+};
+
+TEST_F(TelnetLoggerTest, SendsTheLogToTheClient) {
+    logger.log("before\n"); // Nobody listens yet
+    int fd = connectClient();
+    logger.log("Connected to WiFi\n");
+    logger.logf("IP Address: %s\n", "192.168.1.100");
+    EXPECT_EQ("Connected to WiFi\nIP Address: 192.168.1.100\n", receive(fd, 43));
+}
+
+TEST_F(TelnetLoggerTest, ReplacesThePreviousClient) {
+    int first = connectClient();
+    int second = connectClient();
+    logger.log("hello\n");
+    EXPECT_EQ("hello\n", receive(second, 6));
+    EXPECT_EQ("", receive(first, 1)); // Closed by the logger
+}
+
+} // namespace
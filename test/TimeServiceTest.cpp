@@ -0,0 +1,120 @@
+/**
+ * @file TimeServiceTest.cpp
+ * @brief Tests of the TimeService round-trip probes against a simulated NTP server.
+ */
+#include <gtest/gtest.h>
+#include <ESP8266WiFi.h>
+#include <coredecls.h>
+#include "TimeService/TimeService.h"
+
+namespace {
+
+const uint64_t ntpEpochDelta = 2208988800ULL;
+
+void writeTimestamp(std::vector<uint8_t>& packet, size_t offset, uint64_t epochMicros) {
+    uint32_t seconds = (uint32_t)(epochMicros / 1000000 + ntpEpochDelta);
+    uint32_t fraction = (uint32_t)(((epochMicros % 1000000) << 32) / 1000000);
+    for (int i = 0; i < 4; i++) {
+        packet[offset + i] = seconds >> (24 - 8 * i);
+        packet[offset + 4 + i] = fraction >> (24 - 8 * i);
+    }
+}
+
+class TimeServiceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        HostClock::setManual(true);
+        WiFi.setStatus(WL_CONNECTED);
+        WiFi.clearHosts();
+        WiFi.addHost("time.test", IPAddress(10, 0, 0, 5));
+        WiFi.resetLookups();
+        WiFiUDP::setResponder([this](IPAddress address, uint16_t port, const std::vector<uint8_t>& request, std::vector<uint8_t>& response) {
+            requests++;
+            EXPECT_EQ(IPAddress(10, 0, 0, 5), address);
+            EXPECT_EQ(123, port);
+            EXPECT_EQ(48u, request.size());
+            if (!answering) {
+                return false;
+            }
+            // The server clock is ahead by serverOffset; it takes serverDelay to answer
+            uint64_t received = TimeService::epochMicros() + serverOffset;
+            response.assign(48, 0);
+            response[0] = 0x24; // Version 4, server
+            writeTimestamp(response, 32, received);
+            writeTimestamp(response, 40, received + serverDelay);
+            return true;
+        });
+        service.setTimeServer("time.test");
+        service.setProbeInterval(1000);
+        service.begin();
+        hostTimeSet();
+    }
+
+    void TearDown() override {
+        WiFiUDP::setResponder(nullptr);
+        settimeofday_cb(nullptr);
+        HostClock::setManual(false);
+    }
+
+    /**
+     * @brief Runs a probe: sent by a first loop(), answered after networkDelay µs.
+     */
+    void probe(uint64_t networkDelay = 20000) {
+        HostClock::advance(1000000);
+        service.loop();
+        HostClock::advance(networkDelay);
+        service.loop();
+    }
+
+    TimeService service;
+    int requests = 0;
+    bool answering = true;
+    int64_t serverOffset = 0;
+    uint64_t serverDelay = 0;
+};
+
+TEST_F(TimeServiceTest, MeasuresRoundTripTimeAndOffset) {
+    serverOffset = 250000;
+    serverDelay = 1000;
+    probe(20000);
+    EXPECT_EQ(1, requests);
+    EXPECT_EQ(19000, service.getRoundTripTime());   // 20 ms less the time spent by the server
+    // The answer was stamped when sent: the server appears ahead by its offset, less the 
+    // half of the round trip not simulated (the request reaches it instantly)
+    EXPECT_NEAR(250000 - 9500, service.getOffset(), 2);
+}
+
+TEST_F(TimeServiceTest, ResolvesTheServerOnceForAllProbes) {
+    for (int i = 0; i < 5; i++) {
+        probe();
+    }
+    EXPECT_EQ(5, requests);
+    EXPECT_EQ(1u, WiFi.getLookups());
+}
+
+TEST_F(TimeServiceTest, ResolvesAgainAfterATimeout) {
+    answering = false;
+    probe(2100000);   // Past the 2 s probe timeout
+    EXPECT_EQ(-1, service.getRoundTripTime());
+    answering = true;
+    probe();
+    EXPECT_EQ(2, requests);
+    EXPECT_EQ(2u, WiFi.getLookups());
+    EXPECT_GT(service.getRoundTripTime(), 0);
+}
+
+TEST_F(TimeServiceTest, SkipsTheProbeWhenTheServerCannotBeResolved) {
+    WiFi.clearHosts();
+    probe();
+    EXPECT_EQ(0, requests);
+    EXPECT_EQ(-1, service.getRoundTripTime());
+}
+
+TEST_F(TimeServiceTest, TakesAddressesWithoutLookup) {
+    service.setTimeServer("10.0.0.5");
+    probe();
+    EXPECT_EQ(1, requests);
+    EXPECT_EQ(0u, WiFi.getLookups());
+}
+
+} // namespace
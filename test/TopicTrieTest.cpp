@@ -0,0 +1,90 @@
+/**
+ * @file TopicTrieTest.cpp
+ * @brief Tests of the TopicTrie: exact levels, wildcards, $-topics and removal.
+ */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string.h>
+#include <vector>
+#include "MqttManager/TopicTrie.h"
+
+namespace {
+
+std::vector<uint16_t> matches(const TopicTrie& trie, const char* topic) {
+    std::vector<uint16_t> ids;
+    trie.match(topic, strlen(topic), [&ids](uint16_t id) { ids.push_back(id); });
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+typedef std::vector<uint16_t> Ids;
+
+TEST(TopicTrieTest, MatchesExactFilters) {
+    TopicTrie trie;
+    trie.insert("home/kitchen/temp", 1);
+    trie.insert("home/kitchen", 2);
+    EXPECT_EQ(Ids({1}), matches(trie, "home/kitchen/temp"));
+    EXPECT_EQ(Ids({2}), matches(trie, "home/kitchen"));
+    EXPECT_EQ(Ids(), matches(trie, "home/kitchen/humidity"));
+    EXPECT_EQ(Ids(), matches(trie, "home"));
+}
+
+TEST(TopicTrieTest, MatchesSingleLevelWildcards) {
+    TopicTrie trie;
+    trie.insert("home/+/temp", 1);
+    trie.insert("+/+", 2);
+    EXPECT_EQ(Ids({1}), matches(trie, "home/garage/temp"));
+    EXPECT_EQ(Ids({2}), matches(trie, "home/garage"));
+    EXPECT_EQ(Ids(), matches(trie, "home/garage/door/temp"));
+    EXPECT_EQ(Ids({2}), matches(trie, "home/"));   // Empty level
+}
+
+TEST(TopicTrieTest, MatchesMultiLevelWildcards) {
+    TopicTrie trie;
+    trie.insert("home/#", 1);
+    trie.insert("#", 2);
+    EXPECT_EQ(Ids({1, 2}), matches(trie, "home/garage/door"));
+    EXPECT_EQ(Ids({1, 2}), matches(trie, "home"));   // "#" also matches the parent level
+    EXPECT_EQ(Ids({2}), matches(trie, "office"));
+}
+
+TEST(TopicTrieTest, WildcardsSkipDollarTopicsAtTheFirstLevel) {
+    TopicTrie trie;
+    trie.insert("#", 1);
+    trie.insert("+/broker/load", 2);
+    trie.insert("$SYS/#", 3);
+    EXPECT_EQ(Ids({3}), matches(trie, "$SYS/broker/load"));
+}
+
+TEST(TopicTrieTest, ReportsEveryOverlappingFilter) {
+    TopicTrie trie;
+    trie.insert("a/b/c", 1);
+    trie.insert("a/+/c", 2);
+    trie.insert("a/#", 3);
+    trie.insert("+/b/+", 4);
+    trie.insert("a/b/c", 5);
+    EXPECT_EQ(Ids({1, 2, 3, 4, 5}), matches(trie, "a/b/c"));
+}
+
+TEST(TopicTrieTest, RemovesFilters) {
+    TopicTrie trie;
+    trie.insert("a/+/c", 1);
+    trie.insert("a/+/c", 2);
+    EXPECT_TRUE(trie.remove("a/+/c", 1));
+    EXPECT_FALSE(trie.remove("a/+/c", 1));
+    EXPECT_FALSE(trie.remove("a/b", 2));
+    EXPECT_EQ(Ids({2}), matches(trie, "a/b/c"));
+    EXPECT_TRUE(trie.remove("a/+/c", 2));
+    EXPECT_EQ(Ids(), matches(trie, "a/b/c"));
+}
+
+TEST(TopicTrieTest, MatchesATopicPrefixGivenByLength) {
+    TopicTrie trie;
+    trie.insert("a/b", 1);
+    const char* topic = "a/b/c";
+    std::vector<uint16_t> ids;
+    trie.match(topic, 3, [&ids](uint16_t id) { ids.push_back(id); });
+    EXPECT_EQ(Ids({1}), ids);
+}
+
+} // namespace
@@ -0,0 +1,175 @@
+/**
+ * @file WiFiManagerTest.cpp
+ * @brief Tests of the WiFiManager against the scripted radio: connection, fast reconnect from
+ * the RTC cache, fallback to the settings access point, roaming and the scan endpoint.
+ */
+#include <gtest/gtest.h>
+#include <ArduinoJson.h>
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include "LoopbackHttp.h"
+#include "WiFiManager/WiFiManager.h"
+
+namespace {
+
+class WiFiManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        HostClock::setManual(true);
+        Serial.quiet(true);
+        WiFi.reset();
+        ESP.clearRtcUserMemory();
+        ASSERT_TRUE(LittleFS.begin());
+        LittleFS.format();
+        manager.begin();
+        wifi.setSSID("home");
+        wifi.setPassword("secret");
+        wifi.setAPSSID("device-setup");
+        wifi.setAPPassword("setup1234");
+        wifi.setTimeZone("EET-2EEST,M3.5.0/3,M10.5.0/4");
+    }
+
+    void TearDown() override {
+        HostClock::setManual(false);
+        Serial.quiet(false);
+    }
+
+    /**
+     * @brief Calls loop() every step ms for a duration.
+     */
+    void run(WiFiManager& manager, unsigned long duration, unsigned long step = 100) {
+        for (unsigned long elapsed = 0; elapsed < duration; elapsed += step) {
+            manager.loop();
+            HostClock::advance(step * 1000ULL);
+        }
+    }
+
+    JsonDocument scan() {
+        LoopbackHttp::Response response = LoopbackHttp::get(WiFiServer::hostPort(80), "/api/nearby-ap", [this]() { manager.loop(); });
+        JsonDocument doc;
+        EXPECT_EQ(200, response.code);
+        EXPECT_FALSE(deserializeJson(doc, response.body));
+        return doc;
+    }
+
+    HTTPServerManager manager;
+    WiFiManager wifi { manager };
+};
+
+TEST_F(WiFiManagerTest, ConnectsAndSetsTheClock) {
+    WiFi.addAccessPoint("home", "secret", 1, 6, -60);
+    wifi.begin();
+
+    ASSERT_EQ(WL_CONNECTED, WiFi.status());
+    EXPECT_FALSE(wifi.isLastConnectFast());
+    EXPECT_FALSE(WiFi.isPersistent());
+    EXPECT_EQ(1u, WiFi.getDhcpRequests());
+    EXPECT_STREQ("EET-2EEST,M3.5.0/3,M10.5.0/4", HostClock::getTimeZone());
+    EXPECT_STREQ("pool.ntp.org", HostClock::getTimeServer());
+    EXPECT_TRUE(WiFi.getSoftAPSSID().empty());
+}
+
+TEST_F(WiFiManagerTest, ReconnectsFastWithTheCachedLease) {
+    WiFi.addAccessPoint("home", "secret", 1, 6, -60);
+    wifi.begin();
+    ASSERT_EQ(WL_CONNECTED, WiFi.status());
+    IPAddress lease = WiFi.localIP();
+    WiFi.disconnect();
+
+    WiFiManager rebooted(manager); // RTC user memory survives the restart
+    rebooted.setSSID("home");
+    rebooted.setPassword("secret");
+    rebooted.begin();
+
+    ASSERT_EQ(WL_CONNECTED, WiFi.status());
+    EXPECT_TRUE(rebooted.isLastConnectFast());
+    const ESP8266WiFiClass::BeginCall& call = WiFi.getBegins().back();
+    EXPECT_TRUE(call.directed);
+    EXPECT_EQ(6, call.channel);
+    EXPECT_TRUE(call.staticIP);
+    EXPECT_EQ(1u, WiFi.getDhcpRequests());
+    EXPECT_EQ(lease, WiFi.localIP());
+}
+
+TEST_F(WiFiManagerTest, FallsBackToAFullConnectWhenTheCachedAccessPointIsGone) {
+    WiFi.addAccessPoint("home", "secret", 1, 6, -60);
+    wifi.begin();
+    WiFi.disconnect();
+    WiFi.removeAccessPoint(1);
+    WiFi.addAccessPoint("home", "secret", 2, 11, -65);
+
+    WiFiManager rebooted(manager);
+    rebooted.setSSID("home");
+    rebooted.setPassword("secret");
+    rebooted.begin();
+
+    ASSERT_EQ(WL_CONNECTED, WiFi.status());
+    EXPECT_FALSE(rebooted.isLastConnectFast());
+    EXPECT_EQ(2, WiFi.BSSID()[5]);
+    EXPECT_EQ(2u, WiFi.getDhcpRequests());
+}
+
+TEST_F(WiFiManagerTest, StartsTheSettingsAccessPointWithoutNetwork) {
+    WiFi.addAccessPoint("home", "other", 1, 6, -60);
+    wifi.begin();
+
+    EXPECT_NE(WL_CONNECTED, WiFi.status());
+    wifi.loop();
+    EXPECT_EQ("device-setup", WiFi.getSoftAPSSID());
+}
+
+TEST_F(WiFiManagerTest, RoamsToAStrongerAccessPoint) {
+    WiFi.addAccessPoint("home", "secret", 1, 6, -60);
+    WiFi.addAccessPoint("home", "secret", 2, 11, -85);
+    wifi.setRoamDelay(3000);
+    wifi.begin();
+    ASSERT_EQ(1, WiFi.BSSID()[5]);
+
+    WiFi.setAccessPointRSSI(1, -85);
+    WiFi.setAccessPointRSSI(2, -55);
+    run(wifi, 10000);
+
+    ASSERT_EQ(WL_CONNECTED, WiFi.status());
+    EXPECT_EQ(2, WiFi.BSSID()[5]);
+    EXPECT_EQ(11, WiFi.channel());
+    EXPECT_EQ(1u, WiFi.getScans());
+}
+
+TEST_F(WiFiManagerTest, ConnectsBySSIDWhenTheScanIsOld) {
+    WiFi.addAccessPoint("home", "secret", 1, 6, -60);
+    wifi.setFastConnect(false);
+    wifi.begin();
+    wifi.startScan();
+    run(wifi, 2500);
+    ASSERT_EQ(1u, WiFi.getScans());
+
+    // The access point moves to another channel long after the scan
+    WiFi.removeAccessPoint(1);
+    WiFi.addAccessPoint("home", "secret", 2, 11, -60);
+    HostClock::advance((WIFI_MANAGER_SCAN_MAX_AGE + 1000) * 1000ULL);
+    wifi.loop();
+
+    ASSERT_EQ(WL_CONNECTED, WiFi.status());
+    EXPECT_FALSE(WiFi.getBegins().back().directed);
+    EXPECT_EQ(2, WiFi.BSSID()[5]);
+}
+
+TEST_F(WiFiManagerTest, AnswersTheScanFromTheCachedResults) {
+    WiFi.addAccessPoint("home", "secret", 1, 6, -60);
+    WiFi.addAccessPoint("cafe", "", 2, 1, -70, ENC_TYPE_NONE);
+    wifi.begin();
+
+    JsonDocument doc = scan();
+    EXPECT_TRUE(doc["scanning"].as<bool>());
+    EXPECT_EQ(0u, doc["networks"].size());
+
+    run(wifi, 2500);
+    doc = scan();
+    EXPECT_FALSE(doc["scanning"].as<bool>());
+    ASSERT_EQ(2u, doc["networks"].size());
+    EXPECT_STREQ("home", doc["networks"][0]["ssid"]);
+    EXPECT_STREQ("open", doc["networks"][1]["encryption"]);
+    EXPECT_EQ(1u, WiFi.getScans()); // Within the TTL: no new scan
+}
+
+} // namespace
@@ -0,0 +1,138 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in of the Arduino core, for the host build of the framework.
+ *
+ * Provides the subset of the ESP8266 Arduino core the host-built components use: the
+ * clocks, String, Print and Stream, Serial (to stdout), the number formatting functions
+ * and ESP, whose heap figures come from HostHeap. The clocks follow the real monotonic
+ * clock, or a manual clock moved by the tests (HostClock).
+ */
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "WString.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define F(string) (string)
+#define PSTR(string) (string)
+
+unsigned long millis();
+unsigned long micros();
+uint64_t micros64();
+void delay(unsigned long ms);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+/**
+ * @brief Starts the SNTP client; on the host, records the time zone and the server (HostClock).
+ */
+void configTime(const char* tz, const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+
+char* ltoa(long value, char* result, int base);
+char* ultoa(unsigned long value, char* result, int base);
+char* dtostrf(double number, signed char width, unsigned char precision, char* result);
+
+/**
+ * @brief Clock of millis(), micros() and delay().
+ */
+class HostClock {
+public:
+    /**
+     * @brief Freezes the clock (true): it then only moves with advance() and delay(). False
+     * returns to the real monotonic clock, from the current value.
+     */
+    static void setManual(bool value);
+
+    /**
+     * @brief Moves the manual clock forward.
+     */
+    static void advance(uint64_t microseconds);
+
+    static bool isManual();
+
+    static const char* getTimeZone();      ///< Time zone given to configTime(), nullptr if not called.
+    static const char* getTimeServer();    ///< First server given to configTime().
+};
+
+/**
+ * @brief Serial port, printing to stdout; quiet() silences it, e.g. in tests and benchmarks.
+ */
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    void quiet(bool value) { _quiet = value; }
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+private:
+    bool _quiet = false;
+};
+
+extern HardwareSerial Serial;
+
+/**
+ * @brief ESP object: heap figures of the simulated heap (HostHeap), reboot requests, the
+ * RTC user memory (kept across restart(), as on the device) and the running sketch, whose
+ * image the tests set for the delta updates.
+ */
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMaxFreeBlockSize();
+    uint8_t getHeapFragmentation();
+    uint32_t getChipId() { return 0x00C0FFEE; }
+    uint32_t random();
+    void restart() { _restarts++; }
+    uint32_t getRestarts() const { return _restarts; }   ///< Host only: restart() calls.
+
+    uint32_t getSketchSize() { return (uint32_t)_sketch.size(); }
+    String getSketchMD5();
+    uint32_t getFreeSketchSpace() { return _freeSketchSpace; }
+    bool flashRead(uint32_t address, uint8_t* data, size_t size);
+    bool flashRead(uint32_t address, uint32_t* data, size_t size) { return flashRead(address, (uint8_t*)data, size); }
+
+    /**
+     * @brief RTC user memory (512 bytes), addressed in 4-byte blocks as in the core.
+     */
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+
+    void setSketch(const std::vector<uint8_t>& image) { _sketch = image; }   ///< Host only: image of the running sketch.
+    void setFreeSketchSpace(uint32_t value) { _freeSketchSpace = value; }   ///< Host only: default 1 MB.
+    void clearRtcUserMemory() { memset(_rtcUserMemory, 0, sizeof(_rtcUserMemory)); }   ///< Host only: as after a power cycle.
+
+private:
+    uint32_t _restarts = 0;
+    std::vector<uint8_t> _sketch;
+    uint32_t _freeSketchSpace = 0x100000;
+    uint8_t _rtcUserMemory[512] = {};
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,565 @@
+/**
+ * @file ArduinoJson.cpp
+ * @brief Implementation of the host stand-in of ArduinoJson: document tree, parser and serializer.
+ */
+#include "ArduinoJson.h"
+#include <errno.h>
+#include <math.h>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+void JsonNode::reset(Type value) {
+    type = value;
+    boolean = false;
+    integer = 0;
+    uinteger = 0;
+    real = 0;
+    text.clear();
+    members.clear();
+    elements.clear();
+}
+
+void JsonNode::copyFrom(const JsonNode& other) {
+    if (this == &other) {
+        return;
+    }
+    reset(other.type);
+    boolean = other.boolean;
+    integer = other.integer;
+    uinteger = other.uinteger;
+    real = other.real;
+    text = other.text;
+    for (const auto& member : other.members) {
+        std::unique_ptr<JsonNode> node(new JsonNode());
+        node->copyFrom(*member.second);
+        members.emplace_back(member.first, std::move(node));
+    }
+    for (const auto& element : other.elements) {
+        std::unique_ptr<JsonNode> node(new JsonNode());
+        node->copyFrom(*element);
+        elements.push_back(std::move(node));
+    }
+}
+
+JsonNode* JsonNode::member(const char* key, bool create) {
+    if (type != Object) {
+        return nullptr;
+    }
+    for (auto& member : members) {
+        if (member.first == key) {
+            return member.second.get();
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+    members.emplace_back(key, std::unique_ptr<JsonNode>(new JsonNode()));
+    return members.back().second.get();
+}
+
+int64_t JsonNode::asInteger() const {
+    return type == Unsigned ? (int64_t)uinteger : type == Float ? (int64_t)real : integer;
+}
+
+double JsonNode::asReal() const {
+    return type == Unsigned ? (double)uinteger : type == Signed ? (double)integer : real;
+}
+
+JsonNode* JsonVariant::resolve(bool create) const {
+    if (_node != nullptr || !create || !_parent) {
+        return _node;
+    }
+    JsonNode* parent = _parent->resolve(true);
+    if (parent == nullptr) {
+        return nullptr;
+    }
+    if (parent->type == JsonNode::Null) {
+        parent->reset(JsonNode::Object);
+    }
+    return parent->member(_key.c_str(), true);
+}
+
+JsonVariant JsonVariant::operator[](const char* key) const {
+    JsonNode* node = resolve(false);
+    JsonNode* member = node != nullptr ? node->member(key, false) : nullptr;
+    if (member != nullptr) {
+        return JsonVariant(member);
+    }
+    JsonVariant missing;
+    missing._parent = std::make_shared<const JsonVariant>(*this);
+    missing._key = key;
+    return missing;
+}
+
+JsonVariant JsonVariant::operator[](int index) const {
+    JsonNode* node = resolve(false);
+    if (node == nullptr || node->type != JsonNode::Array || index < 0 || (size_t)index >= node->elements.size()) {
+        return JsonVariant();
+    }
+    return JsonVariant(node->elements[index].get());
+}
+
+size_t JsonVariant::size() const {
+    JsonNode* node = resolve(false);
+    if (node == nullptr) {
+        return 0;
+    }
+    return node->type == JsonNode::Object ? node->members.size() : node->type == JsonNode::Array ? node->elements.size() : 0;
+}
+
+bool JsonVariant::set(bool value) {
+    JsonNode* node = resolve(true);
+    if (node == nullptr) {
+        return false;
+    }
+    node->reset(JsonNode::Boolean);
+    node->boolean = value;
+    return true;
+}
+
+bool JsonVariant::set(const char* value) {
+    JsonNode* node = resolve(true);
+    if (node == nullptr) {
+        return false;
+    }
+    if (value == nullptr) {
+        node->reset(JsonNode::Null);
+        return true;
+    }
+    std::string copy(value); // The value may be a string of the node itself
+    node->reset(JsonNode::Text);
+    node->text = copy;
+    return true;
+}
+
+bool JsonVariant::set(JsonVariant value) {
+    JsonNode* node = resolve(true);
+    if (node == nullptr) {
+        return false;
+    }
+    JsonNode copy;
+    JsonNode* source = value.resolve(false);
+    if (source != nullptr) {
+        copy.copyFrom(*source);
+    }
+    node->copyFrom(copy);
+    return true;
+}
+
+bool JsonVariant::set(const JsonObject& value) {
+    return set(JsonVariant(value.node()));
+}
+
+bool JsonVariant::set(const JsonArray& value) {
+    return set(JsonVariant(value.node()));
+}
+
+template <> JsonObject JsonVariant::to<JsonObject>() {
+    JsonNode* node = resolve(true);
+    if (node == nullptr) {
+        return JsonObject();
+    }
+    node->reset(JsonNode::Object);
+    return JsonObject(node);
+}
+
+template <> JsonArray JsonVariant::to<JsonArray>() {
+    JsonNode* node = resolve(true);
+    if (node == nullptr) {
+        return JsonArray();
+    }
+    node->reset(JsonNode::Array);
+    return JsonArray(node);
+}
+
+JsonVariant JsonObject::operator[](const char* key) const {
+    return JsonVariant(_node)[key];
+}
+
+JsonVariant JsonArray::operator[](size_t index) const {
+    return JsonVariant(_node)[(int)index];
+}
+
+template <> JsonVariant JsonArray::add<JsonVariant>() {
+    if (_node == nullptr) {
+        return JsonVariant();
+    }
+    _node->elements.emplace_back(new JsonNode());
+    return JsonVariant(_node->elements.back().get());
+}
+
+template <> JsonObject JsonArray::add<JsonObject>() {
+    return add<JsonVariant>().to<JsonObject>();
+}
+
+template <> JsonArray JsonArray::add<JsonArray>() {
+    return add<JsonVariant>().to<JsonArray>();
+}
+
+String JsonConverter<String>::as(const JsonNode* node) {
+    return String(is(node) ? node->text.c_str() : "");
+}
+
+std::string JsonConverter<std::string>::as(const JsonNode* node) {
+    return is(node) ? node->text : std::string();
+}
+
+const char* DeserializationError::c_str() const {
+    static const char* const names[] = { "Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep" };
+    return names[_code];
+}
+
+namespace {
+
+const int maxDepth = 10;   ///< Nesting limit of the library (ARDUINOJSON_DEFAULT_NESTING_LIMIT).
+
+/**
+ * @brief Recursive descent parser over a source of bytes (-1 at the end).
+ */
+class Parser {
+public:
+    explicit Parser(std::function<int()> source) : _source(source) {}
+
+    DeserializationError parse(JsonNode& root) {
+        skipSpace();
+        if (peek() < 0) {
+            return DeserializationError::EmptyInput;
+        }
+        return value(root, 0);
+    }
+
+private:
+    std::function<int()> _source;
+    int _next = -2;   ///< Byte looked ahead, -2 if none.
+
+    int peek() {
+        if (_next == -2) _next = _source();
+        return _next;
+    }
+
+    int get() {
+        int c = peek();
+        _next = -2;
+        return c;
+    }
+
+    void skipSpace() {
+        while (peek() == ' ' || peek() == '\t' || peek() == '\r' || peek() == '\n') get();
+    }
+
+    DeserializationError literal(const char* word) {
+        for (const char* c = word; *c != '\0'; c++) {
+            int b = get();
+            if (b < 0) return DeserializationError::IncompleteInput;
+            if (b != *c) return DeserializationError::InvalidInput;
+        }
+        return DeserializationError::Ok;
+    }
+
+    DeserializationError value(JsonNode& node, int depth) {
+        skipSpace();
+        int c = peek();
+        if (c < 0) return DeserializationError::IncompleteInput;
+        if (c == '{' || c == '[') {
+            if (depth >= maxDepth) return DeserializationError::TooDeep;
+            return c == '{' ? object(node, depth) : array(node, depth);
+        }
+        if (c == '"') {
+            node.reset(JsonNode::Text);
+            return string(node.text);
+        }
+        if (c == 't') { node.reset(JsonNode::Boolean); node.boolean = true; return literal("true"); }
+        if (c == 'f') { node.reset(JsonNode::Boolean); return literal("false"); }
+        if (c == 'n') { node.reset(JsonNode::Null); return literal("null"); }
+        if (c == '-' || (c >= '0' && c <= '9')) return number(node);
+        return DeserializationError::InvalidInput;
+    }
+
+    DeserializationError object(JsonNode& node, int depth) {
+        get();
+        node.reset(JsonNode::Object);
+        skipSpace();
+        if (peek() == '}') { get(); return DeserializationError::Ok; }
+        for (;;) {
+            skipSpace();
+            if (peek() < 0) return DeserializationError::IncompleteInput;
+            if (peek() != '"') return DeserializationError::InvalidInput;
+            std::string key;
+            DeserializationError error = string(key);
+            if (error) return error;
+            skipSpace();
+            int colon = get();
+            if (colon < 0) return DeserializationError::IncompleteInput;
+            if (colon != ':') return DeserializationError::InvalidInput;
+            JsonNode* member = node.member(key.c_str(), false); // A repeated key replaces the value
+            if (member == nullptr) member = node.member(key.c_str(), true);
+            error = value(*member, depth + 1);
+            if (error) return error;
+            skipSpace();
+            int c = get();
+            if (c == '}') return DeserializationError::Ok;
+            if (c < 0) return DeserializationError::IncompleteInput;
+            if (c != ',') return DeserializationError::InvalidInput;
+        }
+    }
+
+    DeserializationError array(JsonNode& node, int depth) {
+        get();
+        node.reset(JsonNode::Array);
+        skipSpace();
+        if (peek() == ']') { get(); return DeserializationError::Ok; }
+        for (;;) {
+            node.elements.emplace_back(new JsonNode());
+            DeserializationError error = value(*node.elements.back(), depth + 1);
+            if (error) return error;
+            skipSpace();
+            int c = get();
+            if (c == ']') return DeserializationError::Ok;
+            if (c < 0) return DeserializationError::IncompleteInput;
+            if (c != ',') return DeserializationError::InvalidInput;
+        }
+    }
+
+    static void appendUtf8(std::string& text, uint32_t code) {
+        if (code < 0x80) {
+            text += (char)code;
+        } else if (code < 0x800) {
+            text += (char)(0xC0 | (code >> 6));
+            text += (char)(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            text += (char)(0xE0 | (code >> 12));
+            text += (char)(0x80 | ((code >> 6) & 0x3F));
+            text += (char)(0x80 | (code & 0x3F));
+        } else {
+            text += (char)(0xF0 | (code >> 18));
+            text += (char)(0x80 | ((code >> 12) & 0x3F));
+            text += (char)(0x80 | ((code >> 6) & 0x3F));
+            text += (char)(0x80 | (code & 0x3F));
+        }
+    }
+
+    DeserializationError hex4(uint32_t& code) {
+        code = 0;
+        for (int i = 0; i < 4; i++) {
+            int c = get();
+            if (c < 0) return DeserializationError::IncompleteInput;
+            int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (digit < 0) return DeserializationError::InvalidInput;
+            code = code * 16 + digit;
+        }
+        return DeserializationError::Ok;
+    }
+
+    DeserializationError string(std::string& text) {
+        get();
+        for (;;) {
+            int c = get();
+            if (c < 0) return DeserializationError::IncompleteInput;
+            if (c == '"') return DeserializationError::Ok;
+            if (c != '\\') { text += (char)c; continue; }
+            c = get();
+            switch (c) {
+            case -1: return DeserializationError::IncompleteInput;
+            case '"': case '\\': case '/': text += (char)c; break;
+            case 'b': text += '\b'; break;
+            case 'f': text += '\f'; break;
+            case 'n': text += '\n'; break;
+            case 'r': text += '\r'; break;
+            case 't': text += '\t'; break;
+            case 'u': {
+                uint32_t code;
+                DeserializationError error = hex4(code);
+                if (error) return error;
+                if (code >= 0xD800 && code < 0xDC00 && peek() == '\\') { // Surrogate pair
+                    get();
+                    if (get() != 'u') return DeserializationError::InvalidInput;
+                    uint32_t low;
+                    error = hex4(low);
+                    if (error) return error;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(text, code);
+                break;
+            }
+            default: return DeserializationError::InvalidInput;
+            }
+        }
+    }
+
+    DeserializationError number(JsonNode& node) {
+        std::string text;
+        while (peek() >= 0 && strchr("+-0123456789.eE", peek()) != nullptr) text += (char)get();
+        char* end = nullptr;
+        if (text.find_first_of(".eE") == std::string::npos) {
+            errno = 0;
+            if (text[0] == '-') {
+                long long value = strtoll(text.c_str(), &end, 10);
+                if (*end == '\0' && errno == 0) { node.reset(JsonNode::Signed); node.integer = value; return DeserializationError::Ok; }
+            } else {
+                unsigned long long value = strtoull(text.c_str(), &end, 10);
+                if (*end == '\0' && errno == 0) {
+                    node.reset(value > (unsigned long long)INT64_MAX ? JsonNode::Unsigned : JsonNode::Signed);
+                    node.integer = (int64_t)value;
+                    node.uinteger = value;
+                    return DeserializationError::Ok;
+                }
+            }
+        }
+        double value = strtod(text.c_str(), &end);
+        if (text.empty() || *end != '\0') return DeserializationError::InvalidInput;
+        node.reset(JsonNode::Float);
+        node.real = value;
+        return DeserializationError::Ok;
+    }
+};
+
+DeserializationError parse(JsonDocument& doc, std::function<int()> source) {
+    doc.clear();
+    Parser parser(source);
+    DeserializationError error = parser.parse(*doc.root());
+    if (error) {
+        doc.clear();
+    }
+    return error;
+}
+
+void escape(std::string& output, const std::string& text) {
+    output += '"';
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"': output += "\\\""; break;
+        case '\\': output += "\\\\"; break;
+        case '\b': output += "\\b"; break;
+        case '\f': output += "\\f"; break;
+        case '\n': output += "\\n"; break;
+        case '\r': output += "\\r"; break;
+        case '\t': output += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                output += code;
+            } else {
+                output += (char)c;
+            }
+        }
+    }
+    output += '"';
+}
+
+void write(std::string& output, const JsonNode* node) {
+    if (node == nullptr) {
+        output += "null";
+        return;
+    }
+    char number[32];
+    switch (node->type) {
+    case JsonNode::Null: output += "null"; break;
+    case JsonNode::Boolean: output += node->boolean ? "true" : "false"; break;
+    case JsonNode::Signed: snprintf(number, sizeof(number), "%lld", (long long)node->integer); output += number; break;
+    case JsonNode::Unsigned: snprintf(number, sizeof(number), "%llu", (unsigned long long)node->uinteger); output += number; break;
+    case JsonNode::Float:
+        if (isnan(node->real) || isinf(node->real)) {
+            output += "null"; // As the library
+        } else {
+            snprintf(number, sizeof(number), "%.9g", node->real);
+            output += number;
+        }
+        break;
+    case JsonNode::Text: escape(output, node->text); break;
+    case JsonNode::Object:
+        output += '{';
+        for (size_t i = 0; i < node->members.size(); i++) {
+            if (i > 0) output += ',';
+            escape(output, node->members[i].first);
+            output += ':';
+            write(output, node->members[i].second.get());
+        }
+        output += '}';
+        break;
+    case JsonNode::Array:
+        output += '[';
+        for (size_t i = 0; i < node->elements.size(); i++) {
+            if (i > 0) output += ',';
+            write(output, node->elements[i].get());
+        }
+        output += ']';
+        break;
+    }
+}
+
+} // namespace
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length) {
+    size_t position = 0;
+    return parse(doc, [&]() { return position < length ? (int)(unsigned char)input[position++] : -1; });
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input) {
+    return deserializeJson(doc, input, input != nullptr ? strlen(input) : 0);
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const String& input) {
+    return deserializeJson(doc, input.c_str(), input.length());
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const std::string& input) {
+    return deserializeJson(doc, input.data(), input.size());
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input) {
+    return parse(doc, [&]() {
+        // Waits for the bytes still in flight, as Stream::timedRead() does
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(input.getTimeout());
+        for (;;) {
+            int c = input.read();
+            if (c >= 0 || std::chrono::steady_clock::now() >= deadline) return c;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+}
+
+size_t serializeJson(JsonVariant source, std::string& output) {
+    output.clear();
+    write(output, source.node());
+    return output.size();
+}
+
+size_t serializeJson(JsonVariant source, String& output) {
+    std::string text;
+    serializeJson(source, text);
+    output = text.c_str();
+    return text.size();
+}
+
+size_t serializeJson(JsonVariant source, Print& output) {
+    std::string text;
+    serializeJson(source, text);
+    return output.write((const uint8_t*)text.data(), text.size());
+}
+
+size_t serializeJson(const JsonDocument& source, String& output) {
+    return serializeJson((JsonVariant)source, output);
+}
+
+size_t serializeJson(const JsonDocument& source, std::string& output) {
+    return serializeJson((JsonVariant)source, output);
+}
+
+size_t serializeJson(const JsonDocument& source, Print& output) {
+    return serializeJson((JsonVariant)source, output);
+}
+
+size_t serializeJson(JsonObject source, String& output) {
+    return serializeJson(JsonVariant(source.node()), output);
+}
+
+size_t measureJson(JsonVariant source) {
+    std::string text;
+    return serializeJson(source, text);
+}
+
+size_t measureJson(const JsonDocument& source) {
+    return measureJson((JsonVariant)source);
+}
@@ -0,0 +1,310 @@
+/**
+ * @file ArduinoJson.h
+ * @brief Host stand-in of the subset of ArduinoJson 7 the framework uses.
+ *
+ * Documents are trees of nodes owned by the JsonDocument; JsonVariant, JsonObject and
+ * JsonArray reference nodes of it. As in the library, looking up a missing member gives a
+ * null variant that creates the member (and its missing parents) when a value is assigned
+ * to it or to() is called. Integers keep 64 bits, strings are always copied.
+ *
+ * The parser accepts standard JSON and stops at the end of the first value; the serializer
+ * writes the minified form. Streams are read a byte at a time, waiting for the bytes of a
+ * network stream for up to its timeout, as the library does.
+ */
+#ifndef HOST_ARDUINO_JSON_H
+#define HOST_ARDUINO_JSON_H
+
+#include <stdint.h>
+#include <string.h>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Arduino.h"
+
+class JsonDocument;
+class JsonObject;
+class JsonArray;
+
+/**
+ * @brief Node of a document: a value, or the members of an object, or the elements of an array.
+ */
+struct JsonNode {
+    enum Type : uint8_t { Null, Boolean, Signed, Unsigned, Float, Text, Object, Array };
+
+    Type type = Null;
+    bool boolean = false;
+    int64_t integer = 0;      ///< Signed value.
+    uint64_t uinteger = 0;    ///< Unsigned value, above INT64_MAX or assigned unsigned.
+    double real = 0;
+    std::string text;
+    std::vector<std::pair<std::string, std::unique_ptr<JsonNode>>> members;
+    std::vector<std::unique_ptr<JsonNode>> elements;
+
+    void reset(Type value);
+    void copyFrom(const JsonNode& other);
+    JsonNode* member(const char* key, bool create);
+    bool isInteger() const { return type == Signed || type == Unsigned; }
+    int64_t asInteger() const;
+    double asReal() const;
+};
+
+/**
+ * @brief Reference to a value of a document, possibly a member still to be created.
+ */
+class JsonVariant {
+public:
+    JsonVariant() {}
+    explicit JsonVariant(JsonNode* node) : _node(node) {}
+
+    JsonVariant operator[](const char* key) const;
+    JsonVariant operator[](const String& key) const { return (*this)[key.c_str()]; }
+    JsonVariant operator[](const std::string& key) const { return (*this)[key.c_str()]; }
+    JsonVariant operator[](int index) const;
+
+    bool isNull() const { JsonNode* node = resolve(false); return node == nullptr || node->type == JsonNode::Null; }
+    size_t size() const;
+
+    template <typename T> bool is() const;
+    template <typename T> T as() const;
+    template <typename T> T to();
+
+    /// Value if the variant holds a T, defaultValue otherwise.
+    template <typename T>
+    typename std::enable_if<!std::is_array<T>::value, T>::type operator|(T defaultValue) const { return is<T>() ? as<T>() : defaultValue; }
+    const char* operator|(const char* defaultValue) const { return is<const char*>() ? as<const char*>() : defaultValue; }
+
+    template <typename T> operator T() const { return as<T>(); }
+
+    bool set(bool value);
+    bool set(const char* value);
+    bool set(const String& value) { return set(value.c_str()); }
+    bool set(const std::string& value) { return set(value.c_str()); }
+    bool set(JsonVariant value);
+    bool set(const JsonObject& value);
+    bool set(const JsonArray& value);
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value, bool>::type set(T value) {
+        JsonNode* node = resolve(true);
+        if (node == nullptr) return false;
+        if (std::is_floating_point<T>::value) { node->reset(JsonNode::Float); node->real = (double)value; }
+        else if (std::is_signed<T>::value) { node->reset(JsonNode::Signed); node->integer = (int64_t)value; }
+        else { node->reset(JsonNode::Unsigned); node->uinteger = (uint64_t)value; }
+        return true;
+    }
+
+    JsonVariant& operator=(const JsonVariant&) = default;   ///< Rebinds the reference, as in the library.
+    template <typename T>
+    JsonVariant& operator=(const T& value) { set(value); return *this; }
+
+    bool operator==(const char* value) const { return is<const char*>() && strcmp(as<const char*>(), value) == 0; }
+    bool operator==(const String& value) const { return *this == value.c_str(); }
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value, bool>::type operator==(T value) const { return as<T>() == value; }
+    template <typename T> bool operator!=(const T& value) const { return !(*this == value); }
+
+    JsonNode* node() const { return resolve(false); }    ///< Host only: node referenced, nullptr if missing.
+    JsonNode* resolve(bool create) const;                  ///< Node referenced, created with its parents if asked.
+
+private:
+    friend class JsonObject;
+    friend class JsonArray;
+    friend class JsonDocument;
+
+    JsonNode* _node = nullptr;                   ///< Node, nullptr while the member is missing.
+    std::shared_ptr<const JsonVariant> _parent;  ///< Object the missing member is created in.
+    std::string _key;                            ///< Name of the missing member.
+};
+
+typedef JsonVariant JsonVariantConst;
+
+/**
+ * @brief Reference to an object of a document; null if the value is not an object.
+ */
+class JsonObject {
+public:
+    JsonObject() {}
+    explicit JsonObject(JsonNode* node) : _node(node != nullptr && node->type == JsonNode::Object ? node : nullptr) {}
+
+    JsonVariant operator[](const char* key) const;
+    JsonVariant operator[](const String& key) const { return (*this)[key.c_str()]; }
+    bool isNull() const { return _node == nullptr; }
+    size_t size() const { return _node != nullptr ? _node->members.size() : 0; }
+    bool containsKey(const char* key) const { return _node != nullptr && _node->member(key, false) != nullptr; }
+    JsonNode* node() const { return _node; }
+
+private:
+    JsonNode* _node = nullptr;
+};
+
+typedef JsonObject JsonObjectConst;
+
+/**
+ * @brief Reference to an array of a document; null if the value is not an array.
+ */
+class JsonArray {
+public:
+    class iterator {
+    public:
+        iterator(JsonNode* node, size_t index) : _node(node), _index(index) {}
+        JsonVariant operator*() const { return JsonVariant(_node->elements[_index].get()); }
+        iterator& operator++() { _index++; return *this; }
+        bool operator!=(const iterator& other) const { return _index != other._index; }
+
+    private:
+        JsonNode* _node;
+        size_t _index;
+    };
+
+    JsonArray() {}
+    explicit JsonArray(JsonNode* node) : _node(node != nullptr && node->type == JsonNode::Array ? node : nullptr) {}
+
+    JsonVariant operator[](size_t index) const;
+    template <typename T> T add();
+    template <typename T> bool add(const T& value) { return add<JsonVariant>().set(value); }
+    bool isNull() const { return _node == nullptr; }
+    size_t size() const { return _node != nullptr ? _node->elements.size() : 0; }
+    iterator begin() const { return iterator(_node, 0); }
+    iterator end() const { return iterator(_node, size()); }
+    JsonNode* node() const { return _node; }
+
+private:
+    JsonNode* _node = nullptr;
+};
+
+typedef JsonArray JsonArrayConst;
+
+template <> JsonVariant JsonArray::add<JsonVariant>();
+template <> JsonObject JsonArray::add<JsonObject>();
+template <> JsonArray JsonArray::add<JsonArray>();
+
+/**
+ * @brief Document: owns the root node.
+ */
+class JsonDocument {
+public:
+    JsonDocument() : _root(new JsonNode()) {}
+    JsonDocument(const JsonDocument& other) : _root(new JsonNode()) { _root->copyFrom(*other._root); }
+    JsonDocument& operator=(const JsonDocument& other) { if (this != &other) _root->copyFrom(*other._root); return *this; }
+
+    JsonVariant operator[](const char* key) { return JsonVariant(_root.get())[key]; }
+    JsonVariant operator[](const String& key) { return (*this)[key.c_str()]; }
+    JsonVariant operator[](int index) { return JsonVariant(_root.get())[index]; }
+    JsonVariant operator[](const char* key) const { return JsonVariant(_root.get())[key]; }
+
+    template <typename T> bool is() const { return JsonVariant(_root.get()).is<T>(); }
+    template <typename T> T as() const { return JsonVariant(_root.get()).as<T>(); }
+    template <typename T> T to() { return JsonVariant(_root.get()).to<T>(); }
+    template <typename T> bool set(const T& value) { _root->reset(JsonNode::Null); return JsonVariant(_root.get()).set(value); }
+    template <typename T> bool add(const T& value) {
+        if (_root->type == JsonNode::Null) _root->reset(JsonNode::Array);
+        return JsonArray(_root.get()).add(value);
+    }
+
+    void clear() { _root->reset(JsonNode::Null); }
+    bool isNull() const { return _root->type == JsonNode::Null; }
+    size_t size() const { return JsonVariant(_root.get()).size(); }
+    operator JsonVariant() const { return JsonVariant(_root.get()); }
+    JsonNode* root() const { return _root.get(); }
+
+private:
+    std::unique_ptr<JsonNode> _root;   ///< Root value; its address stays valid when the document is moved.
+};
+
+/**
+ * @brief Result of deserializeJson().
+ */
+class DeserializationError {
+public:
+    enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+
+    DeserializationError(Code code = Ok) : _code(code) {}
+    explicit operator bool() const { return _code != Ok; }
+    bool operator==(Code code) const { return _code == code; }
+    bool operator!=(Code code) const { return _code != code; }
+    Code code() const { return _code; }
+    const char* c_str() const;
+
+private:
+    Code _code;
+};
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input);
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length);
+DeserializationError deserializeJson(JsonDocument& doc, const String& input);
+DeserializationError deserializeJson(JsonDocument& doc, const std::string& input);
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input);
+
+size_t serializeJson(JsonVariant source, String& output);
+size_t serializeJson(JsonVariant source, std::string& output);
+size_t serializeJson(JsonVariant source, Print& output);
+size_t serializeJson(const JsonDocument& source, String& output);
+size_t serializeJson(const JsonDocument& source, std::string& output);
+size_t serializeJson(const JsonDocument& source, Print& output);
+size_t serializeJson(JsonObject source, String& output);
+size_t measureJson(JsonVariant source);
+size_t measureJson(const JsonDocument& source);
+
+// Conversions
+
+template <typename T>
+struct JsonConverter {
+    static_assert(std::is_arithmetic<T>::value, "unsupported JSON conversion");
+
+    static bool is(const JsonNode* node) {
+        if (node == nullptr) return false;
+        if (std::is_same<T, bool>::value) return node->type == JsonNode::Boolean;
+        if (std::is_floating_point<T>::value) return node->isInteger() || node->type == JsonNode::Float;
+        if (node->type == JsonNode::Unsigned) return node->uinteger <= (uint64_t)std::numeric_limits<T>::max();
+        if (node->type != JsonNode::Signed) return false;
+        return std::is_signed<T>::value ? node->integer >= (int64_t)std::numeric_limits<T>::min() && node->integer <= (int64_t)std::numeric_limits<T>::max()
+                                        : node->integer >= 0 && (uint64_t)node->integer <= (uint64_t)std::numeric_limits<T>::max();
+    }
+    static T as(const JsonNode* node) {
+        if (node == nullptr) return T();
+        if (std::is_same<T, bool>::value) return node->type == JsonNode::Boolean ? node->boolean : (node->isInteger() ? node->asInteger() != 0 : false);
+        if (std::is_floating_point<T>::value) return (T)node->asReal();
+        if (node->type == JsonNode::Float) return (T)node->real;
+        return node->type == JsonNode::Unsigned ? (T)node->uinteger : (T)node->integer;
+    }
+};
+
+template <> struct JsonConverter<const char*> {
+    static bool is(const JsonNode* node) { return node != nullptr && node->type == JsonNode::Text; }
+    static const char* as(const JsonNode* node) { return is(node) ? node->text.c_str() : nullptr; }
+};
+
+template <> struct JsonConverter<String> {
+    static bool is(const JsonNode* node) { return JsonConverter<const char*>::is(node); }
+    static String as(const JsonNode* node);
+};
+
+template <> struct JsonConverter<std::string> {
+    static bool is(const JsonNode* node) { return JsonConverter<const char*>::is(node); }
+    static std::string as(const JsonNode* node);
+};
+
+template <> struct JsonConverter<JsonObject> {
+    static bool is(const JsonNode* node) { return node != nullptr && node->type == JsonNode::Object; }
+    static JsonObject as(JsonNode* node) { return JsonObject(node); }
+};
+
+template <> struct JsonConverter<JsonArray> {
+    static bool is(const JsonNode* node) { return node != nullptr && node->type == JsonNode::Array; }
+    static JsonArray as(JsonNode* node) { return JsonArray(node); }
+};
+
+template <> struct JsonConverter<JsonVariant> {
+    static bool is(const JsonNode* node) { return node != nullptr; }
+    static JsonVariant as(JsonNode* node) { return JsonVariant(node); }
+};
+
+template <typename T> bool JsonVariant::is() const { return JsonConverter<T>::is(resolve(false)); }
+template <typename T> T JsonVariant::as() const { return JsonConverter<T>::as(resolve(false)); }
+
+template <> JsonObject JsonVariant::to<JsonObject>();
+template <> JsonArray JsonVariant::to<JsonArray>();
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * @file BearSSLHelpers.h
+ * @brief Host stand-in of the BearSSL helpers used for the firmware updates.
+ *
+ * HashSHA256 is a real SHA-256. PublicKey parses a PEM public key far enough to tell RSA
+ * from EC keys. The host has no BearSSL, so SigningVerifier checks a host signature instead
+ * of an RSA or ECDSA one: the SHA-256 of the DER key followed by the SHA-256 of the image,
+ * made by sign(), which lets the tests sign images and tamper with them.
+ */
+#ifndef HOST_BEARSSL_HELPERS_H
+#define HOST_BEARSSL_HELPERS_H
+
+#include <vector>
+#include "Updater.h"
+#include "HostCrypto.h"
+
+namespace BearSSL {
+
+class HashSHA256 : public UpdaterHashClass {
+public:
+    void begin() override { _sha.begin(); }
+    void add(const void* data, uint32_t length) override { _sha.add(data, length); }
+    void end() override { _sha.end(_digest); }
+    int len() override { return 32; }
+    const void* hash() override { return _digest; }
+    const unsigned char* oid() override;
+
+private:
+    HostSHA256 _sha;
+    uint8_t _digest[32] = {};
+};
+
+class PublicKey {
+public:
+    PublicKey() {}
+    explicit PublicKey(const char* pemKey) { parse(pemKey); }
+
+    bool parse(const char* pemKey);
+    bool isRSA() const { return _type == RSA; }
+    bool isEC() const { return _type == EC; }
+
+    const std::vector<uint8_t>& getDER() const { return _der; }   ///< Host only: DER of the key.
+
+private:
+    enum Type { NONE, RSA, EC };
+    Type _type = NONE;
+    std::vector<uint8_t> _der;
+};
+
+class SigningVerifier : public UpdaterVerifyClass {
+public:
+    explicit SigningVerifier(PublicKey* key) : _key(key) {}
+
+    uint32_t length() override { return 32; }
+    bool verify(UpdaterHashClass* hash, const void* signature, uint32_t signatureLength) override;
+
+    /**
+     * @brief Host only: signature of an image (without signature) for a key, in the layout
+     * of the core's signing tool: to be appended to the image, followed by its length (4 bytes).
+     */
+    static std::vector<uint8_t> sign(const PublicKey& key, const std::vector<uint8_t>& image);
+
+private:
+    PublicKey* _key;
+};
+
+} // namespace BearSSL
+
+#endif
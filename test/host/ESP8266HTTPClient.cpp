@@ -0,0 +1,151 @@
+/**
+ * @file ESP8266HTTPClient.cpp
+ * @brief Implementation of the host stand-in of HTTPClient.
+ */
+#include "ESP8266HTTPClient.h"
+#include <strings.h>
+#include <chrono>
+
+static uint64_t realMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool HTTPClient::begin(WiFiClient& client, const String& url) {
+    clear();
+    _client = &client;
+    if (!url.startsWith("http://")) {
+        return false;
+    }
+    String rest = url.substring(7);
+    int slash = rest.indexOf('/');
+    String authority = slash >= 0 ? rest.substring(0, slash) : rest;
+    _uri = slash >= 0 ? rest.substring(slash) : String("/");
+    int colon = authority.indexOf(':');
+    _host = colon >= 0 ? authority.substring(0, colon) : authority;
+    _port = colon >= 0 ? (uint16_t)authority.substring(colon + 1).toInt() : 80;
+    return !_host.isEmpty();
+}
+
+void HTTPClient::clear() {
+    _requestHeaders = String();
+    _size = -1;
+}
+
+void HTTPClient::end() {
+    if (_client != nullptr) {
+        _client->stop();
+    }
+    clear();
+}
+
+bool HTTPClient::connected() {
+    return _client != nullptr && (_client->connected() || _client->available() > 0);
+}
+
+void HTTPClient::addHeader(const String& name, const String& value, bool, bool) {
+    _requestHeaders += name + ": " + value + "\r\n";
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    _responseHeaders.clear();
+    for (size_t i = 0; i < headerKeysCount; i++) {
+        _responseHeaders.push_back({ String(headerKeys[i]), String() });
+    }
+}
+
+String HTTPClient::header(const char* name) {
+    for (const auto& header : _responseHeaders) {
+        if (strcasecmp(header.first.c_str(), name) == 0) return header.second;
+    }
+    return String();
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+    for (const auto& header : _responseHeaders) {
+        if (strcasecmp(header.first.c_str(), name) == 0) return !header.second.isEmpty();
+    }
+    return false;
+}
+
+bool HTTPClient::readLine(String& line) {
+    line = String();
+    uint64_t start = realMillis();
+    while (realMillis() - start <= _timeout) {
+        int c = _client->read();
+        if (c < 0) {
+            if (!_client->connected()) return false;
+            _client->waitAvailable(10);
+            continue;
+        }
+        if (c == '\n') {
+            if (line.endsWith("\r")) line.remove(line.length() - 1);
+            return true;
+        }
+        line += (char)c;
+    }
+    return false;
+}
+
+int HTTPClient::GET() {
+    if (_client == nullptr || !_client->connect(_host.c_str(), _port)) {
+        return HTTPC_ERROR_CONNECTION_FAILED;
+    }
+    String request = "GET " + _uri + " HTTP/1.1\r\nHost: " + _host;
+    if (_port != 80) request += ":" + String((unsigned int)_port);
+    request += "\r\nUser-Agent: " + _userAgent + "\r\nConnection: " + (_reuse ? "keep-alive" : "close") + "\r\n";
+    request += "Accept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n";
+    request += _requestHeaders + "\r\n";
+    if (_client->write((const uint8_t*)request.c_str(), request.length()) != request.length()) {
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+
+    for (auto& header : _responseHeaders) {
+        header.second = String();
+    }
+    String line;
+    if (!readLine(line)) {
+        return _client->connected() ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+    }
+    int space = line.indexOf(' ');
+    if (!line.startsWith("HTTP/1.") || space < 0) {
+        return HTTPC_ERROR_NO_HTTP_SERVER;
+    }
+    int code = line.substring(space + 1).toInt();
+    while (true) {
+        if (!readLine(line)) {
+            return HTTPC_ERROR_READ_TIMEOUT;
+        }
+        if (line.isEmpty()) {
+            break;
+        }
+        int colon = line.indexOf(':');
+        if (colon <= 0) continue;
+        String name = line.substring(0, colon);
+        String value = line.substring(colon + 1);
+        value.trim();
+        if (strcasecmp(name.c_str(), "Content-Length") == 0) {
+            _size = value.toInt();
+        }
+        for (auto& header : _responseHeaders) {
+            if (strcasecmp(header.first.c_str(), name.c_str()) == 0) header.second = value;
+        }
+    }
+    return code > 0 ? code : HTTPC_ERROR_NO_HTTP_SERVER;
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_FAILED: return "connection failed";
+        case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+        case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+        case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+        case HTTPC_ERROR_NO_STREAM: return "no stream";
+        case HTTPC_ERROR_NO_HTTP_SERVER: return "no HTTP server";
+        case HTTPC_ERROR_TOO_LESS_RAM: return "not enough ram";
+        case HTTPC_ERROR_ENCODING: return "Transfer-Encoding not supported";
+        case HTTPC_ERROR_STREAM_WRITE: return "Stream write error";
+        case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+        default: return String();
+    }
+}
@@ -0,0 +1,84 @@
+/**
+ * @file ESP8266HTTPClient.h
+ * @brief Host stand-in of the core's HTTPClient, for plain HTTP over a WiFiClient.
+ *
+ * GET() connects, sends the request and reads the status line and headers, waiting for
+ * them up to the timeout; the body is left in the stream for getStream(), which is the
+ * connection itself: as on the device, a chunked body is read with its chunk framing.
+ */
+#ifndef HOST_ESP8266_HTTP_CLIENT_H
+#define HOST_ESP8266_HTTP_CLIENT_H
+
+#include <utility>
+#include <vector>
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_FAILED   (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+typedef enum {
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_CREATED = 201,
+    HTTP_CODE_NO_CONTENT = 204,
+    HTTP_CODE_PARTIAL_CONTENT = 206,
+    HTTP_CODE_MOVED_PERMANENTLY = 301,
+    HTTP_CODE_FOUND = 302,
+    HTTP_CODE_NOT_MODIFIED = 304,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_RANGE_NOT_SATISFIABLE = 416,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+    HTTP_CODE_SERVICE_UNAVAILABLE = 503
+} t_http_codes;
+
+class HTTPClient {
+public:
+    /**
+     * @brief Prepares a request to an http:// URL; https:// is not supported by the stand-in.
+     */
+    bool begin(WiFiClient& client, const String& url);
+    void end();
+    bool connected();
+
+    void setReuse(bool value) { _reuse = value; }
+    void setTimeout(uint16_t value) { _timeout = value; }
+    void setUserAgent(const String& value) { _userAgent = value; }
+    void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const char* name);
+    bool hasHeader(const char* name);
+
+    int GET();
+    int getSize() { return _size; }
+    WiFiClient& getStream() { return *_client; }
+    WiFiClient* getStreamPtr() { return connected() ? _client : nullptr; }
+
+    static String errorToString(int error);
+
+private:
+    void clear();
+    bool readLine(String& line);
+
+    WiFiClient* _client = nullptr;
+    String _host;
+    uint16_t _port = 80;
+    String _uri;
+    bool _reuse = true;
+    uint16_t _timeout = 5000;
+    String _userAgent = "ESP8266HTTPClient";
+    String _requestHeaders;                                  ///< Headers added to the request, as sent.
+    std::vector<std::pair<String, String>> _responseHeaders; ///< Collected headers: name and value, empty if absent.
+    int _size = -1;                                          ///< Content-Length, -1 if unknown.
+};
+
+#endif
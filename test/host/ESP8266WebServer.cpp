@@ -0,0 +1,492 @@
+/**
+ * @file ESP8266WebServer.cpp
+ * @brief Implementation of the host stand-in of ESP8266WebServer.
+ */
+#include "ESP8266WebServer.h"
+#include <strings.h>
+#include <chrono>
+
+static const String emptyString;
+
+/**
+ * @brief Real time in ms: the timeouts of the requests run while the tests freeze millis().
+ */
+static uint64_t realMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ESP8266WebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler) {
+    _routes.push_back({ uri, method, handler, uploadHandler });
+}
+
+void ESP8266WebServer::handleClient() {
+    if (!_hasClient) {
+        if (!_server.hasClient()) {
+            return;
+        }
+        _client = _server.accept();
+        _hasClient = true;
+        _clientStart = realMillis();
+    }
+    if (_client.available() == 0) {
+        if (!_client.connected() || realMillis() - _clientStart > HTTP_MAX_DATA_WAIT) {
+            _client.stop();
+            _hasClient = false;
+        }
+        return; // Request not arrived yet
+    }
+
+    _pending.clear();
+    _args.clear();
+    _headers.clear();
+    _hostHeader = String();
+    _responseHeaders.clear();
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _responded = false;
+    _chunked = false;
+    if (readRequest()) {
+        handleRequest();
+        finishResponse();
+    }
+    _client.stop(); // Connection: close
+    _client = WiFiClient();
+    _hasClient = false;
+}
+
+bool ESP8266WebServer::fill() {
+    uint8_t buffer[2048];
+    uint64_t start = realMillis();
+    while (realMillis() - start <= HTTP_MAX_POST_WAIT) {
+        int count = _client.read(buffer, sizeof(buffer));
+        if (count > 0) {
+            _pending.append((const char*)buffer, count);
+            return true;
+        }
+        if (count < 0 || !_client.connected()) {
+            return false;
+        }
+        _client.waitAvailable(10);
+    }
+    return false;
+}
+
+bool ESP8266WebServer::readLine(String& line) {
+    size_t end;
+    while ((end = _pending.find('\n')) == std::string::npos) {
+        if (!fill()) {
+            return false;
+        }
+    }
+    size_t length = end > 0 && _pending[end - 1] == '\r' ? end - 1 : end;
+    line = String(_pending.substr(0, length).c_str());
+    _pending.erase(0, end + 1);
+    return true;
+}
+
+size_t ESP8266WebServer::readBody(uint8_t* buffer, size_t size) {
+    size_t count = 0;
+    while (count < size) {
+        if (_pending.empty() && !fill()) {
+            break;
+        }
+        size_t part = std::min(size - count, _pending.size());
+        memcpy(buffer + count, _pending.data(), part);
+        _pending.erase(0, part);
+        count += part;
+    }
+    return count;
+}
+
+bool ESP8266WebServer::readRequest() {
+    String line;
+    if (!readLine(line)) {
+        return false;
+    }
+    int space = line.indexOf(' ');
+    int secondSpace = line.indexOf(' ', space + 1);
+    if (space < 0 || secondSpace < 0) {
+        return false;
+    }
+    String method = line.substring(0, space);
+    String url = line.substring(space + 1, secondSpace);
+    static const char* const methods[] = { "", "GET", "HEAD", "POST", "PUT", "PATCH", "DELETE", "OPTIONS" };
+    _method = HTTP_ANY;
+    for (int i = 1; i < 8; i++) {
+        if (method == methods[i]) _method = (HTTPMethod)i;
+    }
+    int query = url.indexOf('?');
+    _uri = query >= 0 ? url.substring(0, query) : url;
+    if (query >= 0) {
+        parseArguments(url.substring(query + 1));
+    }
+
+    String contentType;
+    size_t contentLength = 0;
+    bool complete = false;
+    while (readLine(line)) {
+        if (line.length() == 0) {
+            complete = true;
+            break;
+        }
+        int colon = line.indexOf(':');
+        if (colon <= 0) continue;
+        String name = line.substring(0, colon);
+        String value = line.substring(colon + 1);
+        value.trim();
+        if (strcasecmp(name.c_str(), "Content-Type") == 0) contentType = value;
+        else if (strcasecmp(name.c_str(), "Content-Length") == 0) contentLength = strtoul(value.c_str(), nullptr, 10);
+        else if (strcasecmp(name.c_str(), "Host") == 0) _hostHeader = value;
+        for (const String& collected : _collected) {
+            if (strcasecmp(collected.c_str(), name.c_str()) == 0) {
+                _headers.push_back({ collected, value });
+            }
+        }
+    }
+    if (!complete) {
+        return false; // Headers cut
+    }
+    _route = findRoute(_method);
+    if (_method != HTTP_POST && _method != HTTP_PUT && _method != HTTP_PATCH && _method != HTTP_DELETE) {
+        return true;
+    }
+
+    int boundary = contentType.indexOf("boundary=");
+    if (contentType.startsWith("multipart/form-data") && boundary > 0) {
+        String value = contentType.substring(boundary + 9);
+        if (value.startsWith("\"")) value = value.substring(1, value.indexOf('"', 1));
+        return parseForm(value, contentLength);
+    }
+    if (_route != nullptr && _route->uploadHandler) { // Raw body
+        _raw.status = RAW_START;
+        _raw.totalSize = 0;
+        _raw.currentSize = 0;
+        _route->uploadHandler();
+        _raw.status = RAW_WRITE;
+        while (_raw.totalSize < contentLength) {
+            _raw.currentSize = readBody(_raw.buf, std::min((size_t)HTTP_RAW_BUFLEN, contentLength - _raw.totalSize));
+            _raw.totalSize += _raw.currentSize;
+            if (_raw.currentSize == 0) {
+                _raw.status = RAW_ABORTED;
+                _route->uploadHandler();
+                return false;
+            }
+            _route->uploadHandler();
+        }
+        _raw.status = RAW_END;
+        _route->uploadHandler();
+        return true;
+    }
+    if (contentLength > 0) {
+        std::string body(contentLength, '\0');
+        if (readBody((uint8_t*)&body[0], contentLength) != contentLength) {
+            return false;
+        }
+        if (contentType.startsWith("application/x-www-form-urlencoded")) {
+            parseArguments(String(body.c_str()));
+        } else {
+            _args.push_back({ String("plain"), String(body.c_str()) });
+        }
+    }
+    return true;
+}
+
+bool ESP8266WebServer::parseForm(const String& boundary, size_t contentLength) {
+    String line;
+    String start = "--" + boundary;
+    do {
+        if (!readLine(line)) return false;
+    } while (line != start);
+
+    std::string delimiter = std::string("\r\n--") + boundary.c_str();
+    while (true) {
+        String name, filename, type;
+        bool complete = false;
+        while (readLine(line)) {
+            if (line.length() == 0) {
+                complete = true;
+                break;
+            }
+            if (line.startsWith("Content-Disposition:") || line.startsWith("content-disposition:")) {
+                int nameStart = line.indexOf(" name=\"");
+                if (nameStart >= 0) name = line.substring(nameStart + 7, line.indexOf('"', nameStart + 7));
+                int fileStart = line.indexOf("filename=\"");
+                if (fileStart >= 0) filename = line.substring(fileStart + 10, line.indexOf('"', fileStart + 10));
+            } else if (line.startsWith("Content-Type:") || line.startsWith("content-type:")) {
+                type = line.substring(13);
+                type.trim();
+            }
+        }
+        if (!complete) {
+            return false;
+        }
+
+        if (filename.length() > 0) {
+            _upload.status = UPLOAD_FILE_START;
+            _upload.name = name;
+            _upload.filename = filename;
+            _upload.type = type;
+            _upload.totalSize = 0;
+            _upload.currentSize = 0;
+            _upload.contentLength = contentLength;
+            callUpload();
+            _upload.status = UPLOAD_FILE_WRITE;
+            if (!_client.connected() || !readPart(delimiter, [this](const uint8_t* data, size_t length) { return uploadBlock(data, length); })) {
+                return uploadAborted();
+            }
+            callUpload(); // Last block, possibly empty, as the core does
+            _upload.totalSize += _upload.currentSize;
+            _upload.status = UPLOAD_FILE_END;
+            callUpload();
+        } else {
+            std::string value;
+            if (!readPart(delimiter, [&value](const uint8_t* data, size_t length) { value.append((const char*)data, length); return true; })) {
+                return false;
+            }
+            _args.push_back({ name, String(value.c_str()) });
+        }
+
+        while (_pending.size() < 2) {
+            if (!fill()) return false;
+        }
+        bool last = _pending.compare(0, 2, "--") == 0;
+        _pending.erase(0, 2);
+        if (last) {
+            return true;
+        }
+    }
+}
+
+bool ESP8266WebServer::readPart(const std::string& delimiter, const std::function<bool(const uint8_t*, size_t)>& output) {
+    while (true) {
+        size_t found = _pending.find(delimiter);
+        if (found != std::string::npos) {
+            bool written = output((const uint8_t*)_pending.data(), found);
+            _pending.erase(0, found + delimiter.size());
+            return written;
+        }
+        if (_pending.size() >= delimiter.size()) { // Keeps what may be the start of the delimiter
+            size_t count = _pending.size() - (delimiter.size() - 1);
+            if (!output((const uint8_t*)_pending.data(), count)) {
+                return false;
+            }
+            _pending.erase(0, count);
+        }
+        if (!fill()) {
+            return false;
+        }
+    }
+}
+
+bool ESP8266WebServer::uploadBlock(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        size_t count = std::min(length, HTTP_UPLOAD_BUFLEN - _upload.currentSize);
+        memcpy(_upload.buf + _upload.currentSize, data, count);
+        _upload.currentSize += count;
+        data += count;
+        length -= count;
+        if (_upload.currentSize == HTTP_UPLOAD_BUFLEN) {
+            callUpload();
+            _upload.totalSize += _upload.currentSize;
+            _upload.currentSize = 0;
+            if (!_client.connected()) {
+                return false; // Stopped by the handler
+            }
+        }
+    }
+    return true;
+}
+
+bool ESP8266WebServer::uploadAborted() {
+    _upload.status = UPLOAD_FILE_ABORTED;
+    callUpload();
+    return false;
+}
+
+void ESP8266WebServer::callUpload() {
+    if (_route != nullptr && _route->uploadHandler) {
+        _route->uploadHandler();
+    } else if (_fileUpload) {
+        _fileUpload();
+    }
+}
+
+void ESP8266WebServer::parseArguments(const String& query) {
+    unsigned int start = 0;
+    while (start < query.length()) {
+        int end = query.indexOf('&', start);
+        String pair = end >= 0 ? query.substring(start, end) : query.substring(start);
+        start = end >= 0 ? end + 1 : query.length();
+        if (pair.length() == 0) continue;
+        int equal = pair.indexOf('=');
+        if (equal < 0) {
+            _args.push_back({ urlDecode(pair), String() });
+        } else {
+            _args.push_back({ urlDecode(pair.substring(0, equal)), urlDecode(pair.substring(equal + 1)) });
+        }
+    }
+}
+
+void ESP8266WebServer::handleRequest() {
+    _requests++;
+    if (_route != nullptr) {
+        _route->handler();
+    } else if (_notFound) {
+        _notFound();
+    } else {
+        send(404, "text/plain", String("Not found: ") + _uri);
+    }
+}
+
+void ESP8266WebServer::finishResponse() {
+    if (_chunked) {
+        sendContent("", 0); // Last chunk
+    }
+}
+
+const ESP8266WebServer::Route* ESP8266WebServer::findRoute(HTTPMethod method) const {
+    for (const Route& route : _routes) {
+        if (route.uri == _uri && (route.method == HTTP_ANY || route.method == method)) {
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+const String& ESP8266WebServer::arg(const String& name) const {
+    for (const auto& argument : _args) {
+        if (argument.first == name) return argument.second;
+    }
+    return emptyString;
+}
+
+const String& ESP8266WebServer::arg(int index) const {
+    return index >= 0 && index < (int)_args.size() ? _args[index].second : emptyString;
+}
+
+const String& ESP8266WebServer::argName(int index) const {
+    return index >= 0 && index < (int)_args.size() ? _args[index].first : emptyString;
+}
+
+bool ESP8266WebServer::hasArg(const String& name) const {
+    for (const auto& argument : _args) {
+        if (argument.first == name) return true;
+    }
+    return false;
+}
+
+void ESP8266WebServer::collectHeaders(const char* headerKeys[], size_t count) {
+    _collected.clear();
+    for (size_t i = 0; i < count; i++) {
+        _collected.push_back(String(headerKeys[i]));
+    }
+}
+
+const String& ESP8266WebServer::header(const String& name) const {
+    for (const auto& header : _headers) {
+        if (strcasecmp(header.first.c_str(), name.c_str()) == 0) return header.second;
+    }
+    return emptyString;
+}
+
+const String& ESP8266WebServer::header(int index) const {
+    return index >= 0 && index < (int)_headers.size() ? _headers[index].second : emptyString;
+}
+
+const String& ESP8266WebServer::headerName(int index) const {
+    return index >= 0 && index < (int)_headers.size() ? _headers[index].first : emptyString;
+}
+
+bool ESP8266WebServer::hasHeader(const String& name) const {
+    for (const auto& header : _headers) {
+        if (strcasecmp(header.first.c_str(), name.c_str()) == 0) return true;
+    }
+    return false;
+}
+
+void ESP8266WebServer::sendHeader(const String& name, const String& value, bool first) {
+    if (first) {
+        _responseHeaders.insert(_responseHeaders.begin(), { name, value });
+    } else {
+        _responseHeaders.push_back({ name, value });
+    }
+}
+
+void ESP8266WebServer::send(int code, const char* contentType, const String& content) {
+    size_t length = _contentLength == CONTENT_LENGTH_NOT_SET ? content.length() : _contentLength;
+    String header = "HTTP/1.1 " + String(code) + " " + responseCodeToString(code) + "\r\n";
+    if (contentType != nullptr && contentType[0] != '\0') {
+        header += String("Content-Type: ") + contentType + "\r\n";
+    }
+    if (length == CONTENT_LENGTH_UNKNOWN) {
+        _chunked = true;
+        header += "Transfer-Encoding: chunked\r\n";
+    } else {
+        header += "Content-Length: " + String((unsigned long)length) + "\r\n";
+    }
+    for (const auto& responseHeader : _responseHeaders) {
+        header += responseHeader.first + ": " + responseHeader.second + "\r\n";
+    }
+    header += "Connection: close\r\n\r\n";
+    _client.write((const uint8_t*)header.c_str(), header.length());
+    _responded = true;
+    _responseHeaders.clear();
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    if (content.length() > 0 && _method != HTTP_HEAD) {
+        sendContent(content);
+    }
+}
+
+void ESP8266WebServer::sendContent(const char* content, size_t length) {
+    if (_chunked) {
+        char size[12];
+        snprintf(size, sizeof(size), "%zx\r\n", length);
+        _client.write((const uint8_t*)size, strlen(size));
+    }
+    _client.write((const uint8_t*)content, length);
+    if (_chunked) {
+        _client.write((const uint8_t*)"\r\n", 2);
+        if (length == 0) {
+            _chunked = false;
+        }
+    }
+}
+
+String ESP8266WebServer::urlDecode(const String& text) {
+    String decoded;
+    for (unsigned int i = 0; i < text.length(); i++) {
+        char c = text[i];
+        if (c == '+') {
+            decoded += ' ';
+        } else if (c == '%' && i + 2 < text.length() && isxdigit((unsigned char)text[i + 1]) && isxdigit((unsigned char)text[i + 2])) {
+            char hex[3] = { text[i + 1], text[i + 2], 0 };
+            decoded += (char)strtol(hex, nullptr, 16);
+            i += 2;
+        } else {
+            decoded += c;
+        }
+    }
+    return decoded;
+}
+
+String ESP8266WebServer::responseCodeToString(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 416: return "Range Not Satisfiable";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "";
+    }
+}
@@ -0,0 +1,168 @@
+/**
+ * @file ESP8266WebServer.h
+ * @brief Host stand-in of ESP8266WebServer: the core's HTTP/1.1 server over a WiFiServer.
+ *
+ * Requests are parsed as the core does (Parsing.cpp): the query string and url-encoded
+ * bodies become arguments, other bodies the "plain" argument; multipart/form-data bodies
+ * are streamed, their fields becoming arguments and their file to the upload handler in
+ * HTTP_UPLOAD_BUFLEN blocks (UPLOAD_FILE_START, _WRITE, _END, or _ABORTED if the body is
+ * cut, in which case the request handler is not called); a non-form body sent to a route
+ * with an upload handler is streamed as raw blocks (RAW_START, RAW_WRITE, RAW_END). Only
+ * the headers named by collectHeaders() are kept.
+ *
+ * handleClient() serves one request per connection (Connection: close), reading it while
+ * it arrives; the test clients run on their own threads and the tests call handleClient(),
+ * through the loop() of the component, until their response is complete.
+ */
+#ifndef HOST_ESP8266_WEB_SERVER_H
+#define HOST_ESP8266_WEB_SERVER_H
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Arduino.h"
+#include "FS.h"
+#include "WiFiServer.h"
+
+#ifndef HTTP_UPLOAD_BUFLEN
+#define HTTP_UPLOAD_BUFLEN 2048
+#endif
+
+#ifndef HTTP_RAW_BUFLEN
+#define HTTP_RAW_BUFLEN 4096
+#endif
+
+#define HTTP_MAX_DATA_WAIT 5000   ///< ms to wait for the client to send the request.
+#define HTTP_MAX_POST_WAIT 5000   ///< ms to wait for the body of a request.
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+enum HTTPRawStatus { RAW_START, RAW_WRITE, RAW_END, RAW_ABORTED };
+
+struct HTTPUpload {
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;       ///< Bytes of the file received so far.
+    size_t currentSize;     ///< Bytes in buf.
+    size_t contentLength;   ///< Length of the whole request body.
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+struct HTTPRaw {
+    HTTPRawStatus status;
+    size_t totalSize;
+    size_t currentSize;
+    void* data;
+    uint8_t buf[HTTP_RAW_BUFLEN];
+};
+
+class ESP8266WebServer {
+public:
+    typedef std::function<void()> THandlerFunction;
+
+    explicit ESP8266WebServer(int port = 80) : _server(port) {}
+
+    void begin() { _server.begin(); }
+    void close() { _server.close(); }
+    void stop() { close(); }
+    void handleClient();
+
+    void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler) { on(uri, method, handler, nullptr); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler);
+    void onNotFound(THandlerFunction handler) { _notFound = handler; }
+    void onFileUpload(THandlerFunction handler) { _fileUpload = handler; }
+
+    const String& uri() const { return _uri; }
+    HTTPMethod method() const { return _method; }
+    WiFiClient& client() { return _client; }
+    HTTPUpload& upload() { return _upload; }
+    HTTPRaw& raw() { return _raw; }
+
+    const String& arg(const String& name) const;
+    const String& arg(int index) const;
+    const String& argName(int index) const;
+    int args() const { return (int)_args.size(); }
+    bool hasArg(const String& name) const;
+
+    void collectHeaders(const char* headerKeys[], size_t count);
+    const String& header(const String& name) const;
+    const String& header(int index) const;
+    const String& headerName(int index) const;
+    int headers() const { return (int)_headers.size(); }
+    bool hasHeader(const String& name) const;
+    const String& hostHeader() const { return _hostHeader; }
+
+    void send(int code, const char* contentType = nullptr, const String& content = String(""));
+    void send(int code, const char* contentType, const char* content) { send(code, contentType, String(content)); }
+    void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+    void setContentLength(size_t length) { _contentLength = length; }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content) { sendContent(content, strlen(content)); }
+    void sendContent(const char* content, size_t length);
+
+    static String urlDecode(const String& text);
+    static String responseCodeToString(int code);
+
+    /**
+     * @brief Host only: requests served since the server was constructed.
+     */
+    uint32_t getRequests() const { return _requests; }
+
+private:
+    struct Route {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+        THandlerFunction uploadHandler;
+    };
+    typedef std::vector<std::pair<String, String>> Pairs;
+
+    bool readRequest();
+    bool fill();
+    bool readLine(String& line);
+    size_t readBody(uint8_t* buffer, size_t size);
+    bool parseForm(const String& boundary, size_t contentLength);
+    bool readPart(const std::string& delimiter, const std::function<bool(const uint8_t*, size_t)>& output);
+    bool uploadBlock(const uint8_t* data, size_t length);
+    bool uploadAborted();
+    void parseArguments(const String& query);
+    void callUpload();
+    void handleRequest();
+    void finishResponse();
+    const Route* findRoute(HTTPMethod method) const;
+
+    WiFiServer _server;
+    WiFiClient _client;               ///< Client of the request being served.
+    bool _hasClient = false;          ///< A client was accepted and its request not served yet.
+    uint64_t _clientStart = 0;        ///< Real time the client was accepted at, in ms.
+    std::vector<Route> _routes;
+    THandlerFunction _notFound;
+    THandlerFunction _fileUpload;
+    const Route* _route = nullptr;    ///< Route of the request, nullptr if none matches.
+
+    String _uri;
+    HTTPMethod _method = HTTP_ANY;
+    String _hostHeader;
+    Pairs _args;
+    std::vector<String> _collected;   ///< Names of the request headers kept.
+    Pairs _headers;                   ///< Request headers kept.
+    HTTPUpload _upload;
+    HTTPRaw _raw;
+    std::string _pending;             ///< Bytes read from the client ahead of the parser.
+
+    Pairs _responseHeaders;           ///< Headers added by sendHeader().
+    size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+    bool _responded = false;          ///< Headers of the response sent.
+    bool _chunked = false;            ///< The response uses chunked transfer encoding.
+    uint32_t _requests = 0;
+};
+
+#endif
@@ -0,0 +1,177 @@
+/**
+ * @file ESP8266WiFi.h
+ * @brief Host stand-in of the ESP8266 WiFi object: a scripted station and soft AP.
+ *
+ * The tests set the station status and the host names it resolves; hostByName() counts
+ * the lookups, so that the tests can check which code paths query the DNS.
+ *
+ * For WiFiManager, the tests also declare the access points around (SSID, password, BSSID,
+ * channel, RSSI): scanNetworks() reports them, after a scan duration when asynchronous, and
+ * begin() connects to the strongest matching one (or to the given BSSID and channel) after
+ * a connect delay, as seen by status() on the clock of millis(). DHCP leases come from the
+ * access point; config() with an address skips DHCP, as in the core.
+ */
+#ifndef HOST_ESP8266_WIFI_H
+#define HOST_ESP8266_WIFI_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+#include "WiFiUdp.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_WRONG_PASSWORD = 6,
+    WL_DISCONNECTED = 7
+} wl_status_t;
+
+enum wl_enc_type {
+    ENC_TYPE_WEP = 5,
+    ENC_TYPE_TKIP = 2,
+    ENC_TYPE_CCMP = 4,
+    ENC_TYPE_NONE = 7,
+    ENC_TYPE_AUTO = 8
+};
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+class ESP8266WiFiClass {
+public:
+    /**
+     * @brief Host only: an access point of the scripted radio.
+     */
+    struct AccessPoint {
+        std::string ssid;
+        std::string password;
+        uint8_t bssid[6];
+        int32_t channel;
+        int32_t rssi;
+        uint8_t encryption;
+        IPAddress lease;      ///< Address granted by DHCP.
+    };
+
+    /**
+     * @brief Host only: parameters of a begin() call.
+     */
+    struct BeginCall {
+        std::string ssid;
+        int32_t channel;      ///< 0 for a channel scan.
+        bool directed;        ///< A BSSID was given.
+        uint8_t bssid[6];
+        bool staticIP;        ///< config() had set an address: no DHCP.
+        unsigned long time;   ///< millis() of the call.
+    };
+
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+
+    /**
+     * @brief Resolves a host name, or an address in dotted form, as the core does.
+     * @return 1 on success, 0 if the name is unknown.
+     */
+    int hostByName(const char* name, IPAddress& result);
+    int hostByName(const char* name, IPAddress& result, uint32_t) { return hostByName(name, result); }
+
+    void persistent(bool value) { _persistent = value; }
+    bool hostname(const char* value) { _hostname = value; return true; }
+    String hostname() const { return String(_hostname.c_str()); }
+    bool mode(int value) { _mode = value; return true; }
+    bool disconnect(bool wifiOff = false);
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    wl_status_t begin(const char* ssid, const char* password = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true);
+    bool reconnect() { return _current >= 0; }
+
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t = 0);
+    String SSID();
+    uint8_t* BSSID();
+    String BSSIDstr();
+    int32_t RSSI();
+    int32_t channel();
+
+    int8_t scanNetworks(bool async = false, bool showHidden = false);
+    int8_t scanComplete();
+    void scanDelete();
+    String SSID(uint8_t index);
+    uint8_t* BSSID(uint8_t index);
+    int32_t RSSI(uint8_t index);
+    int32_t channel(uint8_t index);
+    uint8_t encryptionType(uint8_t index);
+
+    bool softAP(const char* ssid, const char* password = nullptr, int channel = 1, int hidden = 0, int maxConnections = 4);
+    IPAddress softAPIP() { return _softAP ? IPAddress(192, 168, 4, 1) : IPAddress(); }
+    bool softAPdisconnect(bool = false) { _softAP = false; return true; }
+
+    void setStatus(wl_status_t value) { _status = value; _pending = -1; }          ///< Host only: station status.
+    void addHost(const char* name, IPAddress address) { _hosts[name] = address; } ///< Host only: name resolved by hostByName().
+    void clearHosts() { _hosts.clear(); }                                         ///< Host only: forgets the names.
+    uint32_t getLookups() const { return _lookups; }                              ///< Host only: hostByName() calls for names.
+    void resetLookups() { _lookups = 0; }
+
+    /**
+     * @brief Host only: declares an access point; the last byte of its BSSID is bssidEnd.
+     */
+    void addAccessPoint(const char* ssid, const char* password, uint8_t bssidEnd, int32_t channel, int32_t rssi, uint8_t encryption = ENC_TYPE_CCMP);
+    void setAccessPointRSSI(uint8_t bssidEnd, int32_t rssi);   ///< Host only: signal of an access point.
+    void removeAccessPoint(uint8_t bssidEnd);                  ///< Host only: the access point goes away.
+
+    /**
+     * @brief Host only: forgets the access points, the calls and the connection; status WL_DISCONNECTED.
+     */
+    void reset();
+
+    void setConnectDelay(unsigned long ms) { _connectDelay = ms; }   ///< Host only: time from begin() to connected (default 100 ms).
+    void setScanDuration(unsigned long ms) { _scanDuration = ms; }   ///< Host only: duration of an asynchronous scan (default 2000 ms).
+    const std::vector<BeginCall>& getBegins() const { return _begins; }  ///< Host only: begin() calls.
+    uint32_t getScans() const { return _scans; }                     ///< Host only: scanNetworks() calls.
+    uint32_t getDhcpRequests() const { return _dhcpRequests; }       ///< Host only: leases requested by DHCP.
+    bool isPersistent() const { return _persistent; }
+    const std::string& getSoftAPSSID() const { return _softAPSSID; } ///< Host only: SSID of the soft AP, empty if not started.
+
+private:
+    int findAccessPoint(const char* ssid, const char* password, int32_t channel, const uint8_t* bssid) const;
+    const AccessPoint* scanned(uint8_t index) const;
+
+    wl_status_t _status = WL_CONNECTED;           ///< Station status.
+    std::map<std::string, IPAddress> _hosts;      ///< Names resolved by hostByName().
+    uint32_t _lookups = 0;                        ///< Lookups of names.
+
+    std::vector<AccessPoint> _accessPoints;       ///< Access points around.
+    std::vector<AccessPoint> _scanResults;        ///< Results of the last scan.
+    bool _scanDone = false;                       ///< A scan completed and was not deleted.
+    bool _scanRunning = false;                    ///< Asynchronous scan in progress.
+    unsigned long _scanStart = 0;                 ///< millis() when the scan started.
+    unsigned long _scanDuration = 2000;           ///< Duration of an asynchronous scan.
+    uint32_t _scans = 0;                          ///< scanNetworks() calls.
+
+    int _pending = -1;                            ///< Access point being connected to, -1 if none.
+    int _current = -1;                            ///< Access point connected to, -1 if none.
+    unsigned long _beginTime = 0;                 ///< millis() of the last begin().
+    unsigned long _connectDelay = 100;            ///< Time from begin() to connected.
+    std::vector<BeginCall> _begins;               ///< begin() calls.
+    bool _persistent = true;
+    std::string _hostname;
+    int _mode = 1;
+
+    IPAddress _staticIP, _staticGateway, _staticSubnet, _staticDns;   ///< Set by config(), 0 for DHCP.
+    IPAddress _ip, _gateway, _subnet, _dns;                           ///< Addresses of the connection.
+    uint32_t _dhcpRequests = 0;                   ///< Leases requested by DHCP.
+
+    bool _softAP = false;
+    std::string _softAPSSID;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file FS.h
+ * @brief Host stand-in of the ESP8266 file system API, backed by a directory of the host.
+ *
+ * Follows the LittleFS behavior the framework relies on: opening a file for writing creates
+ * its missing parent directories, remove() also removes the parent directories it leaves
+ * empty, and rename() replaces an existing target. Directories are listed in name order.
+ *
+ * For the tests, the file system can be limited in size (writes beyond it fail, as on a
+ * full flash) and renames can be made to fail.
+ */
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <memory>
+#include <vector>
+#include "Arduino.h"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FSInfo {
+    size_t totalBytes;
+    size_t usedBytes;
+    size_t blockSize;
+    size_t pageSize;
+    size_t maxOpenFiles;
+    size_t maxPathLength;
+};
+
+class FS;
+
+class File : public Stream {
+public:
+    File() {}
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size);
+    int peek() override;
+    void flush() override;
+
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const { return _impl != nullptr; }
+
+    const char* name() const;
+    const char* fullName() const;
+    bool isFile() const { return _impl != nullptr && !_impl->directory; }
+    bool isDirectory() const { return _impl != nullptr && _impl->directory; }
+    time_t getLastWrite();
+
+private:
+    friend class FS;
+    friend class Dir;
+
+    struct Impl {
+        ~Impl();
+        FILE* file = nullptr;     ///< Open file, nullptr for a directory.
+        FS* fs = nullptr;         ///< File system of the file.
+        String path;              ///< Path in the file system.
+        bool directory = false;   ///< Opened directory.
+        bool writing = false;     ///< Last access was a write: a read must seek first.
+    };
+
+    std::shared_ptr<Impl> _impl;   ///< Shared by the copies, as the core's File.
+};
+
+class Dir {
+public:
+    bool next();
+    String fileName() const;
+    size_t fileSize() const;
+    time_t fileTime() const;
+    bool isFile() const;
+    bool isDirectory() const;
+    File openFile(const char* mode) const;
+    bool rewind() { _index = -1; return true; }
+
+private:
+    friend class FS;
+
+    FS* _fs = nullptr;              ///< File system of the directory.
+    String _path;                   ///< Path of the directory, with a trailing '/'.
+    std::vector<String> _names;     ///< Names of the entries, sorted.
+    int _index = -1;                ///< Current entry.
+};
+
+class FS {
+public:
+    bool begin();
+    void end() {}
+    bool format();
+    bool info(FSInfo& info);
+
+    File open(const char* path, const char* mode);
+    File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    Dir openDir(const char* path);
+    Dir openDir(const String& path) { return openDir(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path) { return remove(path); }
+    bool rmdir(const String& path) { return remove(path.c_str()); }
+
+    /**
+     * @brief Host only: directory holding the file system. begin() without a root creates a
+     * temporary directory, removed when the process exits.
+     */
+    void setRoot(const char* directory) { _root = directory; }
+    const String& getRoot() const { return _root; }
+
+    /**
+     * @brief Host only: size of the file system in bytes, 0 for unlimited (default). Writes
+     * that would exceed it fail.
+     */
+    void setCapacity(size_t bytes) { _capacity = bytes; }
+
+    /**
+     * @brief Host only: makes the next count renames fail.
+     */
+    void setRenameFailures(unsigned count) { _renameFailures = count; }
+
+    /**
+     * @brief Host only: path of the host file of a path of the file system.
+     */
+    String hostPath(const char* path) const;
+
+    /**
+     * @brief Host only: bytes used by the files.
+     */
+    size_t usedBytes();
+
+private:
+    friend class File;
+
+    bool makeParents(const String& path);
+    void removeEmptyParents(const String& path);
+
+    String _root;                ///< Directory of the host holding the file system.
+    size_t _capacity = 0;        ///< Size limit in bytes, 0 if unlimited.
+    unsigned _renameFailures = 0; ///< Renames left to fail.
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::Dir;
+using fs::FSInfo;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif
@@ -0,0 +1,263 @@
+/**
+ * @file HostCore.cpp
+ * @brief Implementation of the host stand-ins of the core: clocks, Serial, formatting, ESP,
+ * WiFi and the SNTP callback.
+ */
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "HostHeap.h"
+#include "HostCrypto.h"
+#include "coredecls.h"
+#include <stdarg.h>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+ESP8266WiFiClass WiFi;
+WiFiUDP::Responder WiFiUDP::_responder;
+
+static bool manualClock = false;
+static uint64_t manualMicros = 0;
+static std::function<void()> timeSetCallback;
+
+static uint64_t realMicros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint64_t micros64() {
+    return manualClock ? manualMicros : realMicros();
+}
+
+unsigned long micros() {
+    return (unsigned long)(uint32_t)micros64();
+}
+
+unsigned long millis() {
+    return (unsigned long)(uint32_t)(micros64() / 1000);
+}
+
+void delay(unsigned long ms) {
+    if (manualClock) {
+        manualMicros += (uint64_t)ms * 1000;
+    } else if (ms > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+void yield() {}
+
+void HostClock::setManual(bool value) {
+    if (value && !manualClock) {
+        manualMicros = realMicros();
+    }
+    manualClock = value;
+}
+
+void HostClock::advance(uint64_t microseconds) {
+    manualMicros += microseconds;
+}
+
+bool HostClock::isManual() {
+    return manualClock;
+}
+
+static std::string configuredTimeZone;
+static std::string configuredTimeServer;
+static bool timeConfigured = false;
+
+void configTime(const char* tz, const char* server1, const char*, const char*) {
+    configuredTimeZone = tz != nullptr ? tz : "";
+    configuredTimeServer = server1 != nullptr ? server1 : "";
+    timeConfigured = true;
+}
+
+const char* HostClock::getTimeZone() {
+    return timeConfigured ? configuredTimeZone.c_str() : nullptr;
+}
+
+const char* HostClock::getTimeServer() {
+    return timeConfigured ? configuredTimeServer.c_str() : nullptr;
+}
+
+static uint32_t randomState = 1;
+
+long random(long max) {
+    if (max <= 0) {
+        return 0;
+    }
+    randomState = randomState * 1103515245 + 12345;
+    return (long)((randomState >> 1) % (uint32_t)max);
+}
+
+long random(long min, long max) {
+    return max > min ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+    randomState = seed != 0 ? seed : 1;
+}
+
+char* ultoa(unsigned long value, char* result, int base) {
+    char digits[sizeof(unsigned long) * 8 + 1];
+    size_t count = 0;
+    do {
+        unsigned digit = value % base;
+        digits[count++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value > 0);
+    for (size_t i = 0; i < count; i++) {
+        result[i] = digits[count - 1 - i];
+    }
+    result[count] = 0;
+    return result;
+}
+
+char* ltoa(long value, char* result, int base) {
+    if (value < 0 && base == 10) {
+        result[0] = '-';
+        ultoa(-(unsigned long)value, result + 1, base);
+        return result;
+    }
+    return ultoa((unsigned long)value, result, base);
+}
+
+char* dtostrf(double number, signed char width, unsigned char precision, char* result) {
+    sprintf(result, "%*.*f", width, precision, number);
+    return result;
+}
+
+String::String(double value, unsigned char decimals) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", decimals, value);
+    _value = text;
+}
+
+void String::trim() {
+    size_t start = _value.find_first_not_of(" \t\r\n");
+    size_t end = _value.find_last_not_of(" \t\r\n");
+    _value = start == std::string::npos ? std::string() : _value.substr(start, end - start + 1);
+}
+
+size_t Print::printf(const char* format, ...) {
+    char text[256];
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(text, sizeof(text), format, arguments);
+    va_end(arguments);
+    return length > 0 ? write((const uint8_t*)text, (size_t)length < sizeof(text) ? length : sizeof(text) - 1) : 0;
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (!_quiet) {
+        fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return HostHeap::getFree();
+}
+
+uint32_t EspClass::getMaxFreeBlockSize() {
+    return HostHeap::getMaxFreeBlock();
+}
+
+uint8_t EspClass::getHeapFragmentation() {
+    return HostHeap::getFragmentation();
+}
+
+uint32_t EspClass::random() {
+    return ((uint32_t)::random(0x10000) << 16) | (uint32_t)::random(0x10000);
+}
+
+String EspClass::getSketchMD5() {
+    return String(hostMD5(_sketch.data(), _sketch.size()).c_str());
+}
+
+bool EspClass::flashRead(uint32_t address, uint8_t* data, size_t size) {
+    if ((size_t)address + size > _sketch.size()) {
+        return false;
+    }
+    memcpy(data, _sketch.data() + address, size);
+    return true;
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset * 4 + size > sizeof(_rtcUserMemory) || size == 0) {
+        return false;
+    }
+    memcpy(data, _rtcUserMemory + offset * 4, size);
+    return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset * 4 + size > sizeof(_rtcUserMemory) || size == 0) {
+        return false;
+    }
+    memcpy(_rtcUserMemory + offset * 4, data, size);
+    return true;
+}
+
+int ESP8266WiFiClass::hostByName(const char* name, IPAddress& result) {
+    if (result.fromString(name)) {
+        return 1;
+    }
+    _lookups++;
+    auto host = _hosts.find(name);
+    if (host == _hosts.end()) {
+        return 0;
+    }
+    result = host->second;
+    return 1;
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port) {
+    IPAddress address;
+    if (!WiFi.hostByName(host, address)) {
+        return 0;
+    }
+    return beginPacket(address, port);
+}
+
+int WiFiUDP::beginPacket(IPAddress address, uint16_t port) {
+    _address = address;
+    _port = port;
+    _request.clear();
+    return 1;
+}
+
+int WiFiUDP::endPacket() {
+    if (!_open || WiFi.status() != WL_CONNECTED) {
+        return 0;
+    }
+    std::vector<uint8_t> response;
+    if (_responder && _responder(_address, _port, _request, response)) {
+        _response = response;
+        _position = 0;
+    }
+    _request.clear();
+    return 1;
+}
+
+int WiFiUDP::read(uint8_t* buffer, size_t size) {
+    size_t count = std::min(size, _response.size() - _position);
+    memcpy(buffer, _response.data() + _position, count);
+    _position += count;
+    return (int)count;
+}
+
+void settimeofday_cb(const std::function<void()>& callback) {
+    timeSetCallback = callback;
+}
+
+void hostTimeSet() {
+    if (timeSetCallback) {
+        timeSetCallback();
+    }
+}
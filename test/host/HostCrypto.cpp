@@ -0,0 +1,159 @@
+/**
+ * @file HostCrypto.cpp
+ * @brief Implementation of the SHA-256 and MD5 of the host stand-ins.
+ */
+#include "HostCrypto.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+const uint32_t sha256Constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t rotateRight(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+inline uint32_t rotateLeft(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+std::string toHex(const uint8_t* data, size_t length) {
+    std::string text;
+    char digits[3];
+    for (size_t i = 0; i < length; i++) {
+        snprintf(digits, sizeof(digits), "%02x", data[i]);
+        text += digits;
+    }
+    return text;
+}
+
+} // namespace
+
+void HostSHA256::begin() {
+    static const uint32_t initial[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy(_state, initial, sizeof(_state));
+    _buffered = 0;
+    _length = 0;
+}
+
+void HostSHA256::block(const uint8_t* data) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)data[4 * i] << 24 | (uint32_t)data[4 * i + 1] << 16 | (uint32_t)data[4 * i + 2] << 8 | data[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3], e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25)) + ((e & f) ^ (~e & g)) + sha256Constants[i] + w[i];
+        uint32_t t2 = (rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+    }
+    _state[0] += a; _state[1] += b; _state[2] += c; _state[3] += d;
+    _state[4] += e; _state[5] += f; _state[6] += g; _state[7] += h;
+}
+
+void HostSHA256::add(const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    _length += length;
+    while (length > 0) {
+        size_t count = 64 - _buffered < length ? 64 - _buffered : length;
+        memcpy(_buffer + _buffered, bytes, count);
+        _buffered += count;
+        bytes += count;
+        length -= count;
+        if (_buffered == 64) {
+            block(_buffer);
+            _buffered = 0;
+        }
+    }
+}
+
+void HostSHA256::end(uint8_t digest[32]) {
+    uint64_t bits = _length * 8;
+    uint8_t padding = 0x80;
+    add(&padding, 1);
+    padding = 0;
+    while (_buffered != 56) add(&padding, 1);
+    uint8_t length[8];
+    for (int i = 0; i < 8; i++) length[i] = (uint8_t)(bits >> (56 - 8 * i));
+    add(length, 8);
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = _state[i] >> 24;
+        digest[4 * i + 1] = _state[i] >> 16;
+        digest[4 * i + 2] = _state[i] >> 8;
+        digest[4 * i + 3] = _state[i];
+    }
+}
+
+std::string HostSHA256::hex(const void* data, size_t length) {
+    HostSHA256 hash;
+    uint8_t digest[32];
+    hash.add(data, length);
+    hash.end(digest);
+    return toHex(digest, sizeof(digest));
+}
+
+std::string hostMD5(const void* data, size_t length) {
+    static const uint32_t constants[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+    static const int shifts[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+    std::string message((const char*)data, length);
+    message += (char)0x80;
+    while (message.size() % 64 != 56) message += (char)0;
+    uint64_t bits = (uint64_t)length * 8;
+    for (int i = 0; i < 8; i++) message += (char)(bits >> (8 * i));
+
+    uint32_t state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    for (size_t offset = 0; offset < message.size(); offset += 64) {
+        const uint8_t* block = (const uint8_t*)message.data() + offset;
+        uint32_t m[16];
+        for (int i = 0; i < 16; i++) {
+            m[i] = block[4 * i] | (uint32_t)block[4 * i + 1] << 8 | (uint32_t)block[4 * i + 2] << 16 | (uint32_t)block[4 * i + 3] << 24;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        for (int i = 0; i < 64; i++) {
+            uint32_t f;
+            int g;
+            if (i < 16) { f = (b & c) | (~b & d); g = i; }
+            else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) % 16; }
+            else if (i < 48) { f = b ^ c ^ d; g = (3 * i + 5) % 16; }
+            else { f = c ^ (b | ~d); g = (7 * i) % 16; }
+            uint32_t next = d;
+            d = c;
+            c = b;
+            b = b + rotateLeft(a + f + constants[i] + m[g], shifts[i]);
+            a = next;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    }
+    uint8_t digest[16];
+    for (int i = 0; i < 16; i++) digest[i] = (uint8_t)(state[i / 4] >> (8 * (i % 4)));
+    return toHex(digest, sizeof(digest));
+}
@@ -0,0 +1,38 @@
+/**
+ * @file HostCrypto.h
+ * @brief SHA-256 and MD5 of the host stand-ins: BearSSL::HashSHA256 and ESP.getSketchMD5().
+ */
+#ifndef HOST_CRYPTO_H
+#define HOST_CRYPTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief Incremental SHA-256 (FIPS 180-4).
+ */
+class HostSHA256 {
+public:
+    HostSHA256() { begin(); }
+    void begin();
+    void add(const void* data, size_t length);
+    void end(uint8_t digest[32]);
+
+    static std::string hex(const void* data, size_t length);   ///< Hex SHA-256 of a buffer.
+
+private:
+    void block(const uint8_t* data);
+
+    uint32_t _state[8];
+    uint8_t _buffer[64];
+    size_t _buffered = 0;
+    uint64_t _length = 0;
+};
+
+/**
+ * @brief MD5 (RFC 1321) of a buffer, as 32 hex digits.
+ */
+std::string hostMD5(const void* data, size_t length);
+
+#endif
@@ -0,0 +1,216 @@
+/**
+ * @file HostHeap.cpp
+ * @brief Implementation of the simulated heap, and the operator new and delete serving it.
+ *
+ * The arena is a sequence of blocks, each starting with a Header; free neighbors are
+ * merged when a block is freed. Arenas left with blocks in use by end() are retired, not
+ * released, so that those blocks can still be freed.
+ */
+#include "HostHeap.h"
+#include <math.h>
+#include <stdlib.h>
+#include <new>
+
+namespace {
+
+struct Header {
+    uint32_t size;   ///< Size of the block, header included.
+    uint32_t used;   ///< The block is allocated.
+};
+
+const size_t alignment = sizeof(Header);
+const size_t maxRetired = 32;
+
+struct Arena {
+    uint8_t* start = nullptr;   ///< First block.
+    size_t size = 0;            ///< Bytes of the arena.
+    uint32_t used = 0;          ///< Blocks in use.
+};
+
+Arena current;                   ///< Arena serving operator new, if active.
+Arena retired[maxRetired];       ///< Arenas with blocks still in use.
+bool active = false;             ///< operator new is served from current.
+uint32_t allocations = 0;        ///< Allocations served since begin().
+uint32_t failures = 0;           ///< Allocations that did not fit.
+
+Header* first(const Arena& arena) { return (Header*)arena.start; }
+Header* next(const Arena& arena, Header* block) {
+    uint8_t* following = (uint8_t*)block + block->size;
+    return following < arena.start + arena.size ? (Header*)following : nullptr;
+}
+
+bool contains(const Arena& arena, void* block) {
+    return arena.start != nullptr && (uint8_t*)block > arena.start && (uint8_t*)block < arena.start + arena.size;
+}
+
+bool release(Arena& arena, void* block) {
+    if (!contains(arena, block)) {
+        return false;
+    }
+    Header* header = (Header*)block - 1;
+    header->used = 0;
+    arena.used--;
+    for (Header* b = first(arena); b != nullptr; b = next(arena, b)) { // Merge free neighbors
+        Header* following;
+        while (!b->used && (following = next(arena, b)) != nullptr && !following->used) {
+            b->size += following->size;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool HostHeap::begin(size_t size) {
+    if (active) {
+        return false;
+    }
+    if (current.start != nullptr) {
+        end();
+    }
+    size -= size % alignment;
+    current.start = (uint8_t*)malloc(size);
+    if (current.start == nullptr) {
+        return false;
+    }
+    current.size = size;
+    current.used = 0;
+    Header* block = first(current);
+    block->size = size;
+    block->used = 0;
+    allocations = 0;
+    failures = 0;
+    active = true;
+    return true;
+}
+
+void HostHeap::end() {
+    active = false;
+    if (current.start == nullptr) {
+        return;
+    }
+    if (current.used == 0) {
+        free(current.start);
+    } else {
+        for (Arena& arena : retired) { // Blocks still in use: keep the arena for their delete
+            if (arena.start == nullptr) {
+                arena = current;
+                break;
+            }
+        }
+    }
+    current = Arena();
+}
+
+bool HostHeap::isActive() {
+    return active;
+}
+
+void* HostHeap::allocate(size_t size) {
+    if (current.start == nullptr) {
+        return nullptr;
+    }
+    size_t needed = sizeof(Header) + (size + alignment - 1) / alignment * alignment;
+    for (Header* block = first(current); block != nullptr; block = next(current, block)) {
+        if (block->used || block->size < needed) {
+            continue;
+        }
+        if (block->size - needed >= 2 * sizeof(Header)) { // Split
+            Header* rest = (Header*)((uint8_t*)block + needed);
+            rest->size = block->size - needed;
+            rest->used = 0;
+            block->size = needed;
+        }
+        block->used = 1;
+        current.used++;
+        allocations++;
+        return block + 1;
+    }
+    failures++;
+    return nullptr;
+}
+
+bool HostHeap::release(void* block) {
+    if (::release(current, block)) {
+        return true;
+    }
+    for (Arena& arena : retired) {
+        if (::release(arena, block)) {
+            if (arena.used == 0) {
+                free(arena.start);
+                arena = Arena();
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t HostHeap::getFree() {
+    uint32_t total = 0;
+    for (Header* block = first(current); current.start != nullptr && block != nullptr; block = next(current, block)) {
+        if (!block->used) total += block->size - sizeof(Header);
+    }
+    return total;
+}
+
+uint32_t HostHeap::getMaxFreeBlock() {
+    uint32_t largest = 0;
+    for (Header* block = first(current); current.start != nullptr && block != nullptr; block = next(current, block)) {
+        if (!block->used && block->size - sizeof(Header) > largest) largest = block->size - sizeof(Header);
+    }
+    return largest;
+}
+
+uint8_t HostHeap::getFragmentation() {
+    double total = 0;
+    double squares = 0;
+    for (Header* block = first(current); current.start != nullptr && block != nullptr; block = next(current, block)) {
+        if (!block->used) {
+            double size = block->size - sizeof(Header);
+            total += size;
+            squares += size * size;
+        }
+    }
+    return total > 0 ? (uint8_t)(100 - sqrt(squares) * 100 / total) : 0;
+}
+
+uint32_t HostHeap::getAllocations() {
+    return allocations;
+}
+
+uint32_t HostHeap::getFailures() {
+    return failures;
+}
+
+static void* allocate(size_t size) {
+    if (active) {
+        return HostHeap::allocate(size != 0 ? size : 1);
+    }
+    return malloc(size != 0 ? size : 1);
+}
+
+void* operator new(size_t size) {
+    void* block = allocate(size);
+    if (block == nullptr) throw std::bad_alloc();
+    return block;
+}
+
+void* operator new[](size_t size) {
+    void* block = allocate(size);
+    if (block == nullptr) throw std::bad_alloc();
+    return block;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* block) noexcept {
+    if (block != nullptr && !HostHeap::release(block)) free(block);
+}
+
+void operator delete[](void* block) noexcept { operator delete(block); }
+void operator delete(void* block, size_t) noexcept { operator delete(block); }
+void operator delete[](void* block, size_t) noexcept { operator delete(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { operator delete(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { operator delete(block); }
@@ -0,0 +1,60 @@
+/**
+ * @file HostHeap.h
+ * @brief Simulated ESP8266 heap of the host build.
+ *
+ * Between begin() and end(), every operator new of the process is served from a fixed
+ * arena by a first-fit allocator with 8-byte headers, as umm_malloc does on the ESP8266,
+ * and ESP.getFreeHeap(), getMaxFreeBlockSize() and getHeapFragmentation() report on this
+ * arena with the formulas of the core. Blocks of the arena freed after end() go back to
+ * it; other allocations use malloc(). This lets host tests measure leaks (free heap
+ * before and after) and fragmentation (largest block) of framework code in a heap of the
+ * size of the device.
+ */
+#ifndef HOST_HEAP_H
+#define HOST_HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef HOST_HEAP_SIZE
+#define HOST_HEAP_SIZE 40960   ///< Default size of the arena: the free heap of a typical sketch.
+#endif
+
+class HostHeap {
+public:
+    /**
+     * @brief Starts serving operator new from a new, empty arena of size bytes.
+     * @return False if an arena is still in use (blocks not freed) or memory is lacking.
+     */
+    static bool begin(size_t size = HOST_HEAP_SIZE);
+
+    /**
+     * @brief Stops serving operator new from the arena; releases the arena once empty.
+     */
+    static void end();
+
+    static bool isActive();              ///< operator new is served from the arena.
+    static uint32_t getFree();           ///< Free bytes of the arena, headers excluded.
+    static uint32_t getMaxFreeBlock();   ///< Largest allocatable block of the arena.
+    static uint8_t getFragmentation();   ///< 100 - 100 * sqrt(sum of free block sizes squared) / free, as the core.
+    static uint32_t getAllocations();    ///< operator new calls served from the arena since begin().
+    static uint32_t getFailures();       ///< operator new calls the arena could not serve.
+
+    static void* allocate(size_t size);  ///< Allocation in the arena, nullptr if none fits.
+    static bool release(void* block);    ///< Frees a block; false if not in the arena.
+};
+
+/**
+ * @brief Serves operator new from a new arena for the lifetime of the object.
+ */
+class HostHeapScope {
+public:
+    HostHeapScope(size_t size = HOST_HEAP_SIZE) { _started = HostHeap::begin(size); }
+    ~HostHeapScope() { if (_started) HostHeap::end(); }
+    bool isStarted() const { return _started; }
+
+private:
+    bool _started;
+};
+
+#endif
@@ -0,0 +1,441 @@
+/**
+ * @file HostNetwork.cpp
+ * @brief Implementation of the host stand-ins of WiFiClient and WiFiServer over loopback sockets.
+ */
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+#include "ESP8266WiFi.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <map>
+
+Client* WiFiClient::_network = nullptr;
+
+static std::map<uint16_t, uint16_t> serverPorts; ///< Device port to loopback port of the servers begun.
+
+/**
+ * Closing a socket with unread bytes makes the system reset the connection, which can
+ * discard a response the peer has not read yet (e.g. a server rejecting an upload while
+ * its body still arrives). As lwIP does, the connection is shut down for writing first,
+ * and the bytes still arriving are drained until the peer closes or goes quiet.
+ */
+void WiFiClient::Socket::close() {
+    if (fd < 0) {
+        return;
+    }
+    shutdown(fd, SHUT_WR);
+    uint8_t buffer[4096];
+    for (int i = 0; i < 200; i++) { // At most 1 s of body still arriving
+        pollfd descriptor = { fd, POLLIN, 0 };
+        if (poll(&descriptor, 1, 20) <= 0 || recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) <= 0) {
+            break;
+        }
+    }
+    ::close(fd);
+    fd = -1;
+}
+
+WiFiClient::WiFiClient(int socket) : _socket(std::make_shared<Socket>(socket)) {
+    timeval timeout = { 5, 0 }; // A peer that stopped reading fails the writes instead of blocking the test
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    if (_network != nullptr) {
+        return _network->connect(ip, port);
+    }
+    stop();
+    if (ip[0] != 127) {
+        return 0; // No network beyond the host
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = (uint32_t)ip; // First byte in the low bits: network order
+    if (::connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        ::close(fd);
+        return 0;
+    }
+    *this = WiFiClient(fd);
+    return 1;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    if (_network != nullptr) {
+        return _network->connect(host, port);
+    }
+    IPAddress address;
+    if (!WiFi.hostByName(host, address)) {
+        return 0;
+    }
+    return connect(address, port);
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    if (!_socket) {
+        return _network != nullptr ? _network->write(buffer, size) : 0;
+    }
+    size_t written = 0;
+    while (written < size && _socket->fd >= 0) {
+        ssize_t count = send(_socket->fd, buffer + written, size - written, MSG_NOSIGNAL);
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR) continue;
+            break;
+        }
+        written += count;
+    }
+    return written;
+}
+
+int WiFiClient::available() {
+    if (!_socket) {
+        return _network != nullptr ? _network->available() : 0;
+    }
+    int count = 0;
+    if (_socket->fd < 0 || ioctl(_socket->fd, FIONREAD, &count) != 0) {
+        return 0;
+    }
+    return count;
+}
+
+int WiFiClient::read() {
+    uint8_t b;
+    if (!_socket) {
+        return _network != nullptr ? _network->read() : -1;
+    }
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    if (!_socket) {
+        return _network != nullptr ? _network->read(buffer, size) : -1;
+    }
+    if (_socket->fd < 0) {
+        return -1;
+    }
+    ssize_t count = recv(_socket->fd, buffer, size, MSG_DONTWAIT);
+    return count > 0 ? (int)count : (count == 0 ? 0 : (errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1));
+}
+
+int WiFiClient::peek() {
+    if (!_socket) {
+        return _network != nullptr ? _network->peek() : -1;
+    }
+    uint8_t b;
+    return _socket->fd >= 0 && recv(_socket->fd, &b, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? b : -1;
+}
+
+void WiFiClient::stop() {
+    if (!_socket) {
+        if (_network != nullptr) _network->stop();
+        return;
+    }
+    _socket->close();
+}
+
+uint8_t WiFiClient::connected() {
+    if (!_socket) {
+        return _network != nullptr ? _network->connected() : 0;
+    }
+    if (_socket->fd < 0) {
+        return 0;
+    }
+    uint8_t b;
+    ssize_t count = recv(_socket->fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (count > 0) {
+        return 1; // As in the core: connected while bytes remain to be read
+    }
+    return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : 0;
+}
+
+void WiFiClient::setNoDelay(bool value) {
+    int flag = value ? 1 : 0;
+    if (_socket && _socket->fd >= 0) {
+        setsockopt(_socket->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+}
+
+bool WiFiClient::waitAvailable(unsigned long timeout) {
+    if (!_socket) {
+        return available() > 0;
+    }
+    if (_socket->fd < 0) {
+        return false;
+    }
+    pollfd descriptor = { _socket->fd, POLLIN, 0 };
+    return poll(&descriptor, 1, (int)timeout) > 0 && available() > 0;
+}
+
+void WiFiServer::begin() {
+    close();
+    _listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listener < 0) {
+        return;
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = 0; // Any free port, see hostPort()
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(_listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(_listener, 8) != 0
+        || getsockname(_listener, (sockaddr*)&address, &length) != 0) {
+        ::close(_listener);
+        _listener = -1;
+        return;
+    }
+    fcntl(_listener, F_SETFL, fcntl(_listener, F_GETFL) | O_NONBLOCK);
+    _localPort = ntohs(address.sin_port);
+    serverPorts[_port] = _localPort;
+}
+
+void WiFiServer::close() {
+    if (_pending >= 0) {
+        ::close(_pending);
+        _pending = -1;
+    }
+    if (_listener >= 0) {
+        ::close(_listener);
+        _listener = -1;
+        if (serverPorts[_port] == _localPort) serverPorts.erase(_port);
+    }
+    _localPort = 0;
+}
+
+bool WiFiServer::hasClient() {
+    if (_pending < 0 && _listener >= 0) {
+        _pending = ::accept(_listener, nullptr, nullptr);
+    }
+    return _pending >= 0;
+}
+
+WiFiClient WiFiServer::accept() {
+    if (!hasClient()) {
+        return WiFiClient();
+    }
+    WiFiClient client(_pending);
+    _pending = -1;
+    client.setNoDelay(_noDelay);
+    return client;
+}
+
+uint16_t WiFiServer::hostPort(uint16_t port) {
+    auto server = serverPorts.find(port);
+    return server != serverPorts.end() ? server->second : 0;
+}
+
+wl_status_t ESP8266WiFiClass::status() {
+    if (_pending >= 0 && millis() - _beginTime >= _connectDelay) {
+        _current = _pending;
+        _pending = -1;
+        _status = WL_CONNECTED;
+        if (_staticIP.isSet()) {
+            _ip = _staticIP;
+            _gateway = _staticGateway;
+            _subnet = _staticSubnet;
+            _dns = _staticDns;
+        } else {
+            _dhcpRequests++;
+            const IPAddress& lease = _accessPoints[_current].lease;
+            _ip = lease;
+            _gateway = IPAddress(lease[0], lease[1], lease[2], 1);
+            _subnet = IPAddress(255, 255, 255, 0);
+            _dns = _gateway;
+        }
+    }
+    return _status;
+}
+
+bool ESP8266WiFiClass::disconnect(bool) {
+    _pending = -1;
+    _current = -1;
+    _status = WL_DISCONNECTED;
+    _ip = _gateway = _subnet = _dns = IPAddress();
+    return true;
+}
+
+bool ESP8266WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress) {
+    _staticIP = local; // 0 enables DHCP again
+    _staticGateway = gateway;
+    _staticSubnet = subnet;
+    _staticDns = dns1;
+    return true;
+}
+
+int ESP8266WiFiClass::findAccessPoint(const char* ssid, const char* password, int32_t channel, const uint8_t* bssid) const {
+    int found = -1;
+    for (size_t i = 0; i < _accessPoints.size(); i++) {
+        const AccessPoint& accessPoint = _accessPoints[i];
+        if (accessPoint.ssid != ssid || (bssid != nullptr && memcmp(accessPoint.bssid, bssid, 6) != 0) 
+            || (channel != 0 && accessPoint.channel != channel)) {
+            continue;
+        }
+        if (accessPoint.password != (password != nullptr ? password : "")) {
+            return -2;
+        }
+        if (found < 0 || accessPoint.rssi > _accessPoints[found].rssi) {
+            found = (int)i;
+        }
+    }
+    return found;
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char* ssid, const char* password, int32_t channel, const uint8_t* bssid, bool) {
+    BeginCall call;
+    call.ssid = ssid != nullptr ? ssid : "";
+    call.channel = channel;
+    call.directed = bssid != nullptr;
+    memcpy(call.bssid, bssid != nullptr ? bssid : (const uint8_t*)"\0\0\0\0\0\0", 6);
+    call.staticIP = _staticIP.isSet();
+    call.time = millis();
+    _begins.push_back(call);
+
+    _current = -1;
+    _beginTime = millis();
+    int found = findAccessPoint(call.ssid.c_str(), password, channel, bssid);
+    _pending = found >= 0 ? found : -1;
+    _status = found >= 0 ? WL_DISCONNECTED : (found == -2 ? WL_WRONG_PASSWORD : WL_NO_SSID_AVAIL);
+    return _status;
+}
+
+IPAddress ESP8266WiFiClass::localIP() { return status() == WL_CONNECTED ? _ip : IPAddress(); }
+IPAddress ESP8266WiFiClass::gatewayIP() { return status() == WL_CONNECTED ? _gateway : IPAddress(); }
+IPAddress ESP8266WiFiClass::subnetMask() { return status() == WL_CONNECTED ? _subnet : IPAddress(); }
+IPAddress ESP8266WiFiClass::dnsIP(uint8_t) { return status() == WL_CONNECTED ? _dns : IPAddress(); }
+
+String ESP8266WiFiClass::SSID() {
+    return _current >= 0 ? String(_accessPoints[_current].ssid.c_str()) : String();
+}
+
+uint8_t* ESP8266WiFiClass::BSSID() {
+    static uint8_t none[6];
+    return _current >= 0 ? _accessPoints[_current].bssid : none;
+}
+
+String ESP8266WiFiClass::BSSIDstr() {
+    const uint8_t* bssid = BSSID();
+    char text[18];
+    snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+    return String(text);
+}
+
+int32_t ESP8266WiFiClass::RSSI() {
+    return _current >= 0 ? _accessPoints[_current].rssi : 31; // 31: not connected, as in the SDK
+}
+
+int32_t ESP8266WiFiClass::channel() {
+    return _current >= 0 ? _accessPoints[_current].channel : 0;
+}
+
+int8_t ESP8266WiFiClass::scanNetworks(bool async, bool) {
+    _scans++;
+    if (async) {
+        _scanRunning = true;
+        _scanDone = false;
+        _scanStart = millis();
+        return WIFI_SCAN_RUNNING;
+    }
+    _scanRunning = false;
+    _scanResults = _accessPoints;
+    _scanDone = true;
+    return (int8_t)_scanResults.size();
+}
+
+int8_t ESP8266WiFiClass::scanComplete() {
+    if (_scanRunning) {
+        if (millis() - _scanStart < _scanDuration) {
+            return WIFI_SCAN_RUNNING;
+        }
+        _scanRunning = false;
+        _scanResults = _accessPoints; // What is around when the scan ends
+        _scanDone = true;
+    }
+    return _scanDone ? (int8_t)_scanResults.size() : WIFI_SCAN_FAILED;
+}
+
+void ESP8266WiFiClass::scanDelete() {
+    _scanResults.clear();
+    _scanDone = false;
+}
+
+const ESP8266WiFiClass::AccessPoint* ESP8266WiFiClass::scanned(uint8_t index) const {
+    return index < _scanResults.size() ? &_scanResults[index] : nullptr;
+}
+
+String ESP8266WiFiClass::SSID(uint8_t index) { return scanned(index) != nullptr ? String(scanned(index)->ssid.c_str()) : String(); }
+int32_t ESP8266WiFiClass::RSSI(uint8_t index) { return scanned(index) != nullptr ? scanned(index)->rssi : 0; }
+int32_t ESP8266WiFiClass::channel(uint8_t index) { return scanned(index) != nullptr ? scanned(index)->channel : 0; }
+uint8_t ESP8266WiFiClass::encryptionType(uint8_t index) { return scanned(index) != nullptr ? scanned(index)->encryption : 0; }
+
+uint8_t* ESP8266WiFiClass::BSSID(uint8_t index) {
+    return index < _scanResults.size() ? _scanResults[index].bssid : nullptr;
+}
+
+bool ESP8266WiFiClass::softAP(const char* ssid, const char*, int, int, int) {
+    _softAP = true;
+    _softAPSSID = ssid != nullptr ? ssid : "";
+    return true;
+}
+
+void ESP8266WiFiClass::addAccessPoint(const char* ssid, const char* password, uint8_t bssidEnd, int32_t channel, int32_t rssi, uint8_t encryption) {
+    AccessPoint accessPoint;
+    accessPoint.ssid = ssid;
+    accessPoint.password = password != nullptr ? password : "";
+    const uint8_t bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, bssidEnd };
+    memcpy(accessPoint.bssid, bssid, 6);
+    accessPoint.channel = channel;
+    accessPoint.rssi = rssi;
+    accessPoint.encryption = encryption;
+    accessPoint.lease = IPAddress(192, 168, 1 + (uint8_t)_accessPoints.size(), 100);
+    _accessPoints.push_back(accessPoint);
+}
+
+void ESP8266WiFiClass::setAccessPointRSSI(uint8_t bssidEnd, int32_t rssi) {
+    for (AccessPoint& accessPoint : _accessPoints) {
+        if (accessPoint.bssid[5] == bssidEnd) accessPoint.rssi = rssi;
+    }
+}
+
+void ESP8266WiFiClass::removeAccessPoint(uint8_t bssidEnd) {
+    for (size_t i = 0; i < _accessPoints.size(); i++) {
+        if (_accessPoints[i].bssid[5] != bssidEnd) continue;
+        if (_current == (int)i) {
+            _current = -1;
+            _status = WL_CONNECTION_LOST;
+        } else if (_current > (int)i) {
+            _current--;
+        }
+        _pending = -1;
+        _accessPoints.erase(_accessPoints.begin() + i);
+        return;
+    }
+}
+
+void ESP8266WiFiClass::reset() {
+    _accessPoints.clear();
+    _scanResults.clear();
+    _scanDone = false;
+    _scanRunning = false;
+    _scans = 0;
+    _begins.clear();
+    _pending = -1;
+    _current = -1;
+    _status = WL_DISCONNECTED;
+    _staticIP = _staticGateway = _staticSubnet = _staticDns = IPAddress();
+    _ip = _gateway = _subnet = _dns = IPAddress();
+    _dhcpRequests = 0;
+    _softAP = false;
+    _softAPSSID.clear();
+    _connectDelay = 100;
+    _scanDuration = 2000;
+}
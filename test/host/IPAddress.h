@@ -0,0 +1,43 @@
+/**
+ * @file IPAddress.h
+ * @brief Host stand-in of the Arduino IPAddress class (IPv4).
+ */
+#ifndef HOST_IP_ADDRESS_H
+#define HOST_IP_ADDRESS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "WString.h"
+
+class IPAddress {
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t address) : _address(address) {}
+
+    operator uint32_t() const { return _address; }
+    uint8_t operator[](int index) const { return (_address >> (8 * index)) & 0xFF; }
+    bool operator==(const IPAddress& other) const { return _address == other._address; }
+    bool isSet() const { return _address != 0; }
+
+    bool fromString(const char* text) {
+        unsigned a, b, c, d;
+        char end;
+        if (text == nullptr || sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+        return String(text);
+    }
+
+private:
+    uint32_t _address = 0;   ///< Address, first byte in the low bits as in the core.
+};
+
+#endif
@@ -0,0 +1,343 @@
+/**
+ * @file LittleFS.cpp
+ * @brief Implementation of the host file system, on POSIX files.
+ */
+#include "LittleFS.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+fs::FS LittleFS;
+
+namespace fs {
+
+File::Impl::~Impl() {
+    if (file != nullptr) {
+        fclose(file);
+    }
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (_impl == nullptr || _impl->file == nullptr || size == 0) {
+        return 0;
+    }
+    if (_impl->fs->_capacity > 0) {
+        size_t used = _impl->fs->usedBytes();
+        size_t free = used < _impl->fs->_capacity ? _impl->fs->_capacity - used : 0;
+        if (size > free) size = free; // Full: a short write, as LittleFS
+    }
+    if (!_impl->writing) {
+        fseek(_impl->file, 0, SEEK_CUR); // Required between a read and a write
+        _impl->writing = true;
+    }
+    return fwrite(buffer, 1, size, _impl->file);
+}
+
+int File::read(uint8_t* buffer, size_t size) {
+    if (_impl == nullptr || _impl->file == nullptr) {
+        return -1;
+    }
+    if (_impl->writing) {
+        fseek(_impl->file, 0, SEEK_CUR);
+        _impl->writing = false;
+    }
+    return (int)fread(buffer, 1, size, _impl->file);
+}
+
+int File::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int File::peek() {
+    size_t current = position();
+    int b = read();
+    seek(current);
+    return b;
+}
+
+int File::available() {
+    return _impl != nullptr && _impl->file != nullptr ? (int)(size() - position()) : 0;
+}
+
+void File::flush() {
+    if (_impl != nullptr && _impl->file != nullptr) {
+        fflush(_impl->file);
+    }
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+    if (_impl == nullptr || _impl->file == nullptr) {
+        return false;
+    }
+    int whence = mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END);
+    if (mode == SeekSet && position > size()) {
+        return false; // LittleFS does not seek past the end
+    }
+    _impl->writing = false;
+    return fseek(_impl->file, position, whence) == 0;
+}
+
+size_t File::position() const {
+    return _impl != nullptr && _impl->file != nullptr ? (size_t)ftell(_impl->file) : 0;
+}
+
+size_t File::size() const {
+    if (_impl == nullptr || _impl->file == nullptr) {
+        return 0;
+    }
+    fflush(_impl->file);
+    struct stat status;
+    return fstat(fileno(_impl->file), &status) == 0 ? (size_t)status.st_size : 0;
+}
+
+void File::close() {
+    _impl.reset();
+}
+
+const char* File::name() const {
+    if (_impl == nullptr) {
+        return "";
+    }
+    const char* path = _impl->path.c_str();
+    const char* slash = strrchr(path, '/');
+    return slash != nullptr ? slash + 1 : path;
+}
+
+const char* File::fullName() const {
+    return _impl != nullptr ? _impl->path.c_str() : "";
+}
+
+time_t File::getLastWrite() {
+    struct stat status;
+    return _impl != nullptr && stat(_impl->fs->hostPath(_impl->path.c_str()).c_str(), &status) == 0 ? status.st_mtime : 0;
+}
+
+bool Dir::next() {
+    return _fs != nullptr && ++_index < (int)_names.size();
+}
+
+String Dir::fileName() const {
+    return _index >= 0 && _index < (int)_names.size() ? _names[_index] : String();
+}
+
+size_t Dir::fileSize() const {
+    struct stat status;
+    return stat(_fs->hostPath((_path + fileName()).c_str()).c_str(), &status) == 0 && S_ISREG(status.st_mode) ? (size_t)status.st_size : 0;
+}
+
+time_t Dir::fileTime() const {
+    struct stat status;
+    return stat(_fs->hostPath((_path + fileName()).c_str()).c_str(), &status) == 0 ? status.st_mtime : 0;
+}
+
+bool Dir::isDirectory() const {
+    struct stat status;
+    return stat(_fs->hostPath((_path + fileName()).c_str()).c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+bool Dir::isFile() const {
+    return !isDirectory();
+}
+
+File Dir::openFile(const char* mode) const {
+    return _fs->open((_path + fileName()).c_str(), mode);
+}
+
+static String temporaryRoot;   ///< Temporary directory created by begin(), removed at exit.
+
+static void removeTree(const String& path);
+
+static void removeTemporaryRoot() {
+    removeTree(temporaryRoot);
+}
+
+bool FS::begin() {
+    if (_root.isEmpty()) {
+        char directory[] = "/tmp/littlefs.XXXXXX";
+        if (mkdtemp(directory) == nullptr) {
+            return false;
+        }
+        _root = directory;
+        if (temporaryRoot.isEmpty()) {
+            atexit(removeTemporaryRoot);
+        }
+        temporaryRoot = _root;
+    }
+    ::mkdir(_root.c_str(), 0755);
+    return true;
+}
+
+static void removeTree(const String& path) {
+    DIR* directory = opendir(path.c_str());
+    if (directory != nullptr) {
+        while (struct dirent* entry = readdir(directory)) {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+                removeTree(path + "/" + entry->d_name);
+            }
+        }
+        closedir(directory);
+        ::rmdir(path.c_str());
+    } else {
+        unlink(path.c_str());
+    }
+}
+
+bool FS::format() {
+    if (_root.isEmpty()) {
+        return false;
+    }
+    removeTree(_root);
+    return ::mkdir(_root.c_str(), 0755) == 0;
+}
+
+static size_t treeSize(const String& path) {
+    size_t total = 0;
+    DIR* directory = opendir(path.c_str());
+    if (directory == nullptr) {
+        return 0;
+    }
+    while (struct dirent* entry = readdir(directory)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        String child = path + "/" + entry->d_name;
+        struct stat status;
+        if (stat(child.c_str(), &status) == 0) {
+            total += S_ISDIR(status.st_mode) ? treeSize(child) : (size_t)status.st_size;
+        }
+    }
+    closedir(directory);
+    return total;
+}
+
+size_t FS::usedBytes() {
+    return treeSize(_root);
+}
+
+bool FS::info(FSInfo& info) {
+    info.blockSize = 4096;
+    info.pageSize = 256;
+    info.maxOpenFiles = 5;
+    info.maxPathLength = 32;
+    info.totalBytes = _capacity > 0 ? _capacity : 2 * 1024 * 1024;
+    info.usedBytes = usedBytes();
+    return true;
+}
+
+String FS::hostPath(const char* path) const {
+    String result = _root;
+    if (path[0] != '/') {
+        result += '/';
+    }
+    result += path;
+    while (result.length() > _root.length() + 1 && result.endsWith("/")) {
+        result.remove(result.length() - 1);
+    }
+    return result;
+}
+
+bool FS::makeParents(const String& path) {
+    for (int slash = path.indexOf('/', 1); slash > 0; slash = path.indexOf('/', slash + 1)) {
+        String parent = hostPath(path.substring(0, slash).c_str());
+        struct stat status;
+        if (stat(parent.c_str(), &status) != 0 && ::mkdir(parent.c_str(), 0755) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FS::removeEmptyParents(const String& path) {
+    for (int slash = path.lastIndexOf('/'); slash > 0; slash = path.substring(0, slash).lastIndexOf('/')) {
+        if (::rmdir(hostPath(path.substring(0, slash).c_str()).c_str()) != 0) {
+            return; // Not empty
+        }
+    }
+}
+
+File FS::open(const char* path, const char* mode) {
+    File file;
+    String hostFile = hostPath(path);
+    struct stat status;
+    bool exists = stat(hostFile.c_str(), &status) == 0;
+    bool create = mode[0] == 'w' || mode[0] == 'a';
+    if (exists && S_ISDIR(status.st_mode)) {
+        if (create) {
+            return file;
+        }
+        file._impl = std::make_shared<File::Impl>();
+    } else {
+        if (create && !makeParents(path)) {
+            return file;
+        }
+        String hostMode = String(mode[0]) + "b";
+        if (strchr(mode, '+') != nullptr) {
+            hostMode += '+';
+        }
+        FILE* handle = fopen(hostFile.c_str(), hostMode.c_str());
+        if (handle == nullptr) {
+            return file;
+        }
+        file._impl = std::make_shared<File::Impl>();
+        file._impl->file = handle;
+    }
+    file._impl->fs = this;
+    file._impl->path = path;
+    file._impl->directory = exists && S_ISDIR(status.st_mode);
+    return file;
+}
+
+bool FS::exists(const char* path) {
+    struct stat status;
+    return stat(hostPath(path).c_str(), &status) == 0;
+}
+
+Dir FS::openDir(const char* path) {
+    Dir dir;
+    dir._fs = this;
+    dir._path = path;
+    if (!dir._path.endsWith("/")) {
+        dir._path += '/';
+    }
+    DIR* directory = opendir(hostPath(path).c_str());
+    if (directory == nullptr) {
+        return dir;
+    }
+    while (struct dirent* entry = readdir(directory)) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            dir._names.push_back(String(entry->d_name));
+        }
+    }
+    closedir(directory);
+    std::sort(dir._names.begin(), dir._names.end());
+    return dir;
+}
+
+bool FS::remove(const char* path) {
+    String hostFile = hostPath(path);
+    struct stat status;
+    if (stat(hostFile.c_str(), &status) != 0) {
+        return false;
+    }
+    if ((S_ISDIR(status.st_mode) ? ::rmdir(hostFile.c_str()) : unlink(hostFile.c_str())) != 0) {
+        return false;
+    }
+    removeEmptyParents(path);
+    return true;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    if (_renameFailures > 0) {
+        _renameFailures--;
+        return false;
+    }
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+} // namespace fs
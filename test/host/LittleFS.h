@@ -0,0 +1,12 @@
+/**
+ * @file LittleFS.h
+ * @brief Host stand-in of LittleFS, see FS.h.
+ */
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "FS.h"
+
+extern fs::FS LittleFS;
+
+#endif
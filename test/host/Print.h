@@ -0,0 +1,38 @@
+/**
+ * @file Print.h
+ * @brief Host stand-in of the Arduino Print class.
+ */
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "WString.h"
+
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t written = 0;
+        while (written < size && write(buffer[written]) == 1) written++;
+        return written;
+    }
+    size_t write(const char* text) { return text != nullptr ? write((const uint8_t*)text, strlen(text)) : 0; }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char* text) { return write(text); }
+    size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long value) { return print(String(value)); }
+    size_t print(int value) { return print((long)value); }
+    size_t print(unsigned long value) { return print(String(value)); }
+    size_t println(const char* text = "") { return print(text) + print("\r\n"); }
+    size_t println(const String& text) { return print(text) + print("\r\n"); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+#endif
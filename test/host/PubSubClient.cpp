@@ -0,0 +1,248 @@
+/**
+ * @file PubSubClient.cpp
+ * @brief Implementation of the host PubSubClient, following the packet handling of the library.
+ */
+#include "PubSubClient.h"
+#include <new>
+
+PubSubClient::PubSubClient(Client& client) : _client(&client) {
+    setBufferSize(MQTT_MAX_PACKET_SIZE);
+}
+
+PubSubClient::~PubSubClient() {
+    free(_buffer);
+}
+
+PubSubClient& PubSubClient::setServer(IPAddress ip, uint16_t port) {
+    _ip = ip;
+    _domain = nullptr;
+    _port = port;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setServer(const char* domain, uint16_t port) {
+    _domain = domain;
+    _port = port;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
+    this->callback = callback;
+    return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size) {
+    if (size == 0) {
+        return false;
+    }
+    uint8_t* buffer = (uint8_t*)realloc(_buffer, size);
+    if (buffer == nullptr) {
+        return false;
+    }
+    _buffer = buffer;
+    _bufferSize = size;
+    return true;
+}
+
+bool PubSubClient::connect(const char* id, const char* user, const char* pass) {
+    if (connected()) {
+        return true;
+    }
+    int result = _domain != nullptr ? _client->connect(_domain, _port) : _client->connect(_ip, _port);
+    if (result != 1) {
+        _state = MQTT_CONNECT_FAILED;
+        return false;
+    }
+    _nextMsgId = 1;
+    size_t length = MQTT_MAX_HEADER_SIZE;
+    const uint8_t protocol[] = { 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04 };
+    memcpy(_buffer + length, protocol, sizeof(protocol));
+    length += sizeof(protocol);
+    uint8_t flags = 0x02; // Clean session
+    if (user != nullptr) {
+        flags |= 0x80;
+        if (pass != nullptr) flags |= 0x40;
+    }
+    _buffer[length++] = flags;
+    _buffer[length++] = 0;  // Keep alive: 15 s
+    _buffer[length++] = 15;
+    length = writeString(id != nullptr ? id : "", length);
+    if (user != nullptr) {
+        length = writeString(user, length);
+        if (pass != nullptr) length = writeString(pass, length);
+    }
+    if (!write(MQTTCONNECT, length - MQTT_MAX_HEADER_SIZE)) {
+        _state = MQTT_CONNECT_FAILED;
+        _client->stop();
+        return false;
+    }
+    size_t packetLength;
+    if (_client->available() == 0 || !readPacket(packetLength)) {
+        _state = MQTT_CONNECTION_TIMEOUT;
+        _client->stop();
+        return false;
+    }
+    if (packetLength == 4 && _buffer[3] == 0) {
+        _state = MQTT_CONNECTED;
+        return true;
+    }
+    _state = packetLength == 4 ? _buffer[3] : MQTT_CONNECT_BAD_PROTOCOL;
+    _client->stop();
+    return false;
+}
+
+void PubSubClient::disconnect() {
+    _buffer[0] = MQTTDISCONNECT;
+    _buffer[1] = 0;
+    _client->write(_buffer, 2);
+    _state = MQTT_DISCONNECTED;
+    _client->stop();
+}
+
+bool PubSubClient::connected() {
+    if (!_client->connected()) {
+        if (_state == MQTT_CONNECTED) {
+            _state = MQTT_CONNECTION_LOST;
+            _client->stop();
+        }
+        return false;
+    }
+    return _state == MQTT_CONNECTED;
+}
+
+/**
+ * @brief Handles one incoming packet, if any: a PUBLISH is handed to the callback with
+ * its topic and payload in the packet buffer, and acknowledged afterwards at QoS 1.
+ */
+bool PubSubClient::loop() {
+    if (!connected()) {
+        return false;
+    }
+    size_t length;
+    if (_client->available() == 0 || !readPacket(length)) {
+        return connected();
+    }
+    uint8_t type = _buffer[0] & 0xF0;
+    size_t lengthBytes = 1;
+    while (_buffer[lengthBytes] & 0x80) lengthBytes++;
+    if (type == MQTTPUBLISH && callback) {
+        uint16_t topicLength = (_buffer[lengthBytes + 1] << 8) + _buffer[lengthBytes + 2];
+        memmove(_buffer + lengthBytes + 2, _buffer + lengthBytes + 3, topicLength); // Room for the terminator
+        _buffer[lengthBytes + 2 + topicLength] = 0;
+        char* topic = (char*)_buffer + lengthBytes + 2;
+        if ((_buffer[0] & 0x06) == 0x02) { // QoS 1
+            uint16_t msgId = (_buffer[lengthBytes + 3 + topicLength] << 8) + _buffer[lengthBytes + 4 + topicLength];
+            uint8_t* payload = _buffer + lengthBytes + 5 + topicLength;
+            callback(topic, payload, length - lengthBytes - 5 - topicLength);
+            _buffer[0] = MQTTPUBACK;
+            _buffer[1] = 2;
+            _buffer[2] = msgId >> 8;
+            _buffer[3] = msgId & 0xFF;
+            _client->write(_buffer, 4);
+        } else {
+            uint8_t* payload = _buffer + lengthBytes + 3 + topicLength;
+            callback(topic, payload, length - lengthBytes - 3 - topicLength);
+        }
+    } else if (type == MQTTPINGREQ) {
+        _buffer[0] = MQTTPINGRESP;
+        _buffer[1] = 0;
+        _client->write(_buffer, 2);
+    }
+    return connected();
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    if (!connected() || MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + length > _bufferSize) {
+        return false;
+    }
+    size_t position = writeString(topic, MQTT_MAX_HEADER_SIZE);
+    memcpy(_buffer + position, payload, length);
+    position += length;
+    return write(MQTTPUBLISH | (retained ? 1 : 0), position - MQTT_MAX_HEADER_SIZE);
+}
+
+bool PubSubClient::subscribe(const char* topic, uint8_t qos) {
+    if (qos > 1 || !connected() || MQTT_MAX_HEADER_SIZE + 2 + 2 + strlen(topic) + 1 > _bufferSize) {
+        return false;
+    }
+    size_t position = MQTT_MAX_HEADER_SIZE;
+    _nextMsgId = _nextMsgId == 0xFFFF ? 1 : _nextMsgId + 1;
+    _buffer[position++] = _nextMsgId >> 8;
+    _buffer[position++] = _nextMsgId & 0xFF;
+    position = writeString(topic, position);
+    _buffer[position++] = qos;
+    return write(MQTTSUBSCRIBE | 0x02, position - MQTT_MAX_HEADER_SIZE);
+}
+
+bool PubSubClient::unsubscribe(const char* topic) {
+    if (!connected() || MQTT_MAX_HEADER_SIZE + 2 + 2 + strlen(topic) > _bufferSize) {
+        return false;
+    }
+    size_t position = MQTT_MAX_HEADER_SIZE;
+    _nextMsgId = _nextMsgId == 0xFFFF ? 1 : _nextMsgId + 1;
+    _buffer[position++] = _nextMsgId >> 8;
+    _buffer[position++] = _nextMsgId & 0xFF;
+    position = writeString(topic, position);
+    return write(MQTTUNSUBSCRIBE | 0x02, position - MQTT_MAX_HEADER_SIZE);
+}
+
+size_t PubSubClient::writeString(const char* text, size_t position) {
+    size_t length = strlen(text);
+    _buffer[position++] = length >> 8;
+    _buffer[position++] = length & 0xFF;
+    memcpy(_buffer + position, text, length);
+    return position + length;
+}
+
+/**
+ * @brief Writes the fixed header in front of the length bytes built at MQTT_MAX_HEADER_SIZE,
+ * and sends the packet.
+ */
+bool PubSubClient::write(uint8_t header, size_t length) {
+    uint8_t lengthBytes[4];
+    size_t count = 0;
+    size_t remaining = length;
+    do {
+        uint8_t digit = remaining & 0x7F;
+        remaining >>= 7;
+        lengthBytes[count++] = remaining > 0 ? (digit | 0x80) : digit;
+    } while (remaining > 0);
+    size_t start = MQTT_MAX_HEADER_SIZE - 1 - count;
+    _buffer[start] = header;
+    memcpy(_buffer + start + 1, lengthBytes, count);
+    size_t total = 1 + count + length;
+    return _client->write(_buffer + start, total) == total;
+}
+
+/**
+ * @brief Reads one packet into the buffer; the remote side delivers whole packets.
+ */
+bool PubSubClient::readPacket(size_t& length) {
+    length = 0;
+    int b = _client->read();
+    if (b < 0) {
+        return false;
+    }
+    _buffer[length++] = b;
+    uint32_t remaining = 0;
+    uint8_t shift = 0;
+    do {
+        b = _client->read();
+        if (b < 0 || length >= 5) {
+            return false;
+        }
+        _buffer[length++] = b;
+        remaining |= (uint32_t)(b & 0x7F) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    for (; remaining > 0; remaining--) {
+        b = _client->read();
+        if (b < 0) {
+            return false;
+        }
+        if (length < _bufferSize) {
+            _buffer[length++] = b;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file PubSubClient.h
+ * @brief Host stand-in of the PubSubClient MQTT 3.1.1 client (knolleary/pubsubclient 2.8).
+ *
+ * Implements the part of the library MqttManager uses, with the same packet encoding and
+ * the same single packet buffer: incoming topics and payloads handed to the callback point
+ * into it, and publish(), subscribe() and the PUBACK of a QoS 1 message build their packet
+ * in it. One difference: connect() does not wait for the CONNACK, the remote side (a fake
+ * broker) must have answered the CONNECT synchronously, otherwise the attempt times out at
+ * once (MQTT_CONNECTION_TIMEOUT).
+ */
+#ifndef HOST_PUB_SUB_CLIENT_H
+#define HOST_PUB_SUB_CLIENT_H
+
+#include <functional>
+#include "Arduino.h"
+#include "Client.h"
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_MAX_HEADER_SIZE 5
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+#define MQTT_CONNECT_BAD_PROTOCOL    1
+#define MQTT_CONNECT_BAD_CLIENT_ID   2
+#define MQTT_CONNECT_UNAVAILABLE     3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED    5
+
+#define MQTTCONNECT     (1 << 4)
+#define MQTTCONNACK     (2 << 4)
+#define MQTTPUBLISH     (3 << 4)
+#define MQTTPUBACK      (4 << 4)
+#define MQTTSUBSCRIBE   (8 << 4)
+#define MQTTSUBACK      (9 << 4)
+#define MQTTUNSUBSCRIBE (10 << 4)
+#define MQTTUNSUBACK    (11 << 4)
+#define MQTTPINGREQ     (12 << 4)
+#define MQTTPINGRESP    (13 << 4)
+#define MQTTDISCONNECT  (14 << 4)
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient {
+public:
+    PubSubClient(Client& client);
+    ~PubSubClient();
+
+    PubSubClient& setServer(IPAddress ip, uint16_t port);
+    PubSubClient& setServer(const char* domain, uint16_t port);
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+    bool setBufferSize(uint16_t size);
+    uint16_t getBufferSize() const { return _bufferSize; }
+
+    bool connect(const char* id, const char* user, const char* pass);
+    void disconnect();
+    bool connected();
+    bool loop();
+    int state() const { return _state; }
+
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained = false);
+    bool publish(const char* topic, const char* payload, bool retained = false) { return publish(topic, (const uint8_t*)payload, strlen(payload), retained); }
+    bool subscribe(const char* topic, uint8_t qos = 0);
+    bool unsubscribe(const char* topic);
+
+private:
+    size_t writeString(const char* text, size_t position);
+    bool write(uint8_t header, size_t length);
+    bool readPacket(size_t& length);
+
+    Client* _client;                   ///< Connection to the broker.
+    uint8_t* _buffer = nullptr;        ///< Packet buffer, shared by every incoming and outgoing packet.
+    uint16_t _bufferSize = 0;          ///< Size of _buffer.
+    uint16_t _nextMsgId = 1;           ///< Next packet identifier.
+    IPAddress _ip;                     ///< Broker address, if set by address.
+    const char* _domain = nullptr;     ///< Broker name, if set by name.
+    uint16_t _port = 0;                ///< Broker port.
+    int _state = MQTT_DISCONNECTED;    ///< Connection state.
+    MQTT_CALLBACK_SIGNATURE;           ///< Handler of incoming messages.
+};
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * @file Stream.h
+ * @brief Host stand-in of the Arduino Stream class.
+ */
+#ifndef HOST_STREAM_H
+#define HOST_STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytes(uint8_t* buffer, size_t length) {
+        size_t count = 0;
+        for (int b; count < length && (b = read()) >= 0; count++) buffer[count] = (uint8_t)b;
+        return count;
+    }
+    void setTimeout(unsigned long value) { _timeout = value; }
+    unsigned long getTimeout() const { return _timeout; }
+
+protected:
+    unsigned long _timeout = 1000;   ///< Timeout of the blocking reads, in ms.
+};
+
+#endif
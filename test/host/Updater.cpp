@@ -0,0 +1,212 @@
+/**
+ * @file Updater.cpp
+ * @brief Implementation of the host stand-ins of Updater and of the BearSSL helpers.
+ */
+#include "Updater.h"
+#include "BearSSLHelpers.h"
+#include <string>
+
+UpdaterClass Update;
+
+bool UpdaterClass::begin(size_t size, int command, int, uint8_t) {
+    if (_size > 0) {
+        return false; // Already running
+    }
+    _error = UPDATE_ERROR_OK;
+    if (size == 0) {
+        _error = UPDATE_ERROR_SIZE;
+        return false;
+    }
+    if (_failBegin || (command == U_FLASH && size > _freeSpace)) {
+        _failBegin = false;
+        _error = UPDATE_ERROR_SPACE;
+        return false;
+    }
+    _begins++;
+    _size = size;
+    _image.clear();
+    return true;
+}
+
+size_t UpdaterClass::write(uint8_t* data, size_t length) {
+    if (_size == 0 || hasError()) {
+        return 0;
+    }
+    if (length > remaining()) {
+        _error = UPDATE_ERROR_SPACE;
+        return 0;
+    }
+    if (_image.empty() && length > 0 && data[0] != 0xE9 && data[0] != 0x1F) { // Image or gzip-compressed image
+        _error = UPDATE_ERROR_MAGIC_BYTE;
+        return 0;
+    }
+    if (_failWriteAt != SIZE_MAX && _image.size() + length > _failWriteAt) {
+        _failWriteAt = SIZE_MAX;
+        _error = UPDATE_ERROR_WRITE;
+        return 0;
+    }
+    _image.insert(_image.end(), data, data + length);
+    return length;
+}
+
+bool UpdaterClass::end(bool evenIfRemaining) {
+    if (_size == 0) {
+        return false;
+    }
+    if (hasError() || (!isFinished() && !evenIfRemaining)) {
+        abandon();
+        return false;
+    }
+    if (_image.empty()) {
+        _error = UPDATE_ERROR_NO_DATA;
+        abandon();
+        return false;
+    }
+    if (_verify != nullptr) { // Signature, then its length, at the end of the image
+        uint32_t signatureLength = 0;
+        if (_image.size() >= 4) {
+            memcpy(&signatureLength, _image.data() + _image.size() - 4, 4);
+        }
+        if (_hash == nullptr || signatureLength != _verify->length() || _image.size() < signatureLength + 4) {
+            _error = UPDATE_ERROR_SIGN;
+            abandon();
+            return false;
+        }
+        size_t binarySize = _image.size() - signatureLength - 4;
+        _hash->begin();
+        _hash->add(_image.data(), binarySize);
+        _hash->end();
+        if (!_verify->verify(_hash, _image.data() + binarySize, signatureLength)) {
+            _error = UPDATE_ERROR_SIGN;
+            abandon();
+            return false;
+        }
+    }
+    _installed = _image;
+    _installs++;
+    _image.clear();
+    _size = 0;
+    return true;
+}
+
+void UpdaterClass::abandon() {
+    _aborts++;
+    _image.clear();
+    _size = 0;
+}
+
+void UpdaterClass::printError(Print& out) {
+    out.printf("ERROR[%u]: %s\n", _error, getErrorString());
+}
+
+const char* UpdaterClass::getErrorString() const {
+    switch (_error) {
+        case UPDATE_ERROR_OK: return "No Error";
+        case UPDATE_ERROR_WRITE: return "Flash Write Failed";
+        case UPDATE_ERROR_SPACE: return "Not Enough Space";
+        case UPDATE_ERROR_SIZE: return "Bad Size Given";
+        case UPDATE_ERROR_MAGIC_BYTE: return "Magic byte is wrong, not 0xE9";
+        case UPDATE_ERROR_SIGN: return "Signature verification failed";
+        case UPDATE_ERROR_NO_DATA: return "No data supplied";
+        default: return "UNKNOWN";
+    }
+}
+
+void UpdaterClass::reset() {
+    _size = 0;
+    _image.clear();
+    _installed.clear();
+    _error = UPDATE_ERROR_OK;
+    _hash = nullptr;
+    _verify = nullptr;
+    _freeSpace = 0x100000;
+    _failBegin = false;
+    _failWriteAt = SIZE_MAX;
+    _begins = 0;
+    _installs = 0;
+    _aborts = 0;
+}
+
+namespace BearSSL {
+
+const unsigned char* HashSHA256::oid() {
+    static const unsigned char sha256Oid[] = { 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01 };
+    return sha256Oid;
+}
+
+/**
+ * @brief Decodes base64, skipping the characters outside the alphabet (line breaks).
+ */
+static std::vector<uint8_t> decodeBase64(const std::string& text) {
+    static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::vector<uint8_t> data;
+    uint32_t bits = 0;
+    int count = 0;
+    for (char c : text) {
+        size_t value = alphabet.find(c);
+        if (c == '=') break;
+        if (value == std::string::npos) continue;
+        bits = (bits << 6) | (uint32_t)value;
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            data.push_back((uint8_t)(bits >> count));
+        }
+    }
+    return data;
+}
+
+static bool contains(const std::vector<uint8_t>& data, const uint8_t* pattern, size_t length) {
+    return std::search(data.begin(), data.end(), pattern, pattern + length) != data.end();
+}
+
+bool PublicKey::parse(const char* pemKey) {
+    static const uint8_t rsaOid[] = { 0x06, 0x09, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x01 };
+    static const uint8_t ecOid[] = { 0x06, 0x07, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x02, 0x01 };
+    _type = NONE;
+    _der.clear();
+    std::string pem = pemKey != nullptr ? pemKey : "";
+    size_t begin = pem.find("-----BEGIN PUBLIC KEY-----");
+    size_t end = pem.find("-----END PUBLIC KEY-----");
+    if (begin == std::string::npos || end == std::string::npos || end < begin) {
+        return false;
+    }
+    begin += strlen("-----BEGIN PUBLIC KEY-----");
+    _der = decodeBase64(pem.substr(begin, end - begin));
+    if (contains(_der, rsaOid, sizeof(rsaOid))) {
+        _type = RSA;
+    } else if (contains(_der, ecOid, sizeof(ecOid))) {
+        _type = EC;
+    }
+    return _type != NONE;
+}
+
+static void signHash(const PublicKey& key, const void* hash, uint8_t signature[32]) {
+    HostSHA256 sha;
+    sha.add(key.getDER().data(), key.getDER().size());
+    sha.add(hash, 32);
+    sha.end(signature);
+}
+
+bool SigningVerifier::verify(UpdaterHashClass* hash, const void* signature, uint32_t signatureLength) {
+    if (_key == nullptr || hash == nullptr || hash->len() != 32 || signatureLength != 32) {
+        return false;
+    }
+    uint8_t expected[32];
+    signHash(*_key, hash->hash(), expected);
+    return memcmp(expected, signature, sizeof(expected)) == 0;
+}
+
+std::vector<uint8_t> SigningVerifier::sign(const PublicKey& key, const std::vector<uint8_t>& image) {
+    HostSHA256 sha;
+    uint8_t hash[32];
+    sha.add(image.data(), image.size());
+    sha.end(hash);
+    std::vector<uint8_t> signature(32 + 4);
+    signHash(key, hash, signature.data());
+    uint32_t length = 32;
+    memcpy(signature.data() + 32, &length, 4);
+    return signature;
+}
+
+} // namespace BearSSL
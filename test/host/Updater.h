@@ -0,0 +1,117 @@
+/**
+ * @file Updater.h
+ * @brief Host stand-in of the core's Updater: records the image written instead of flashing it.
+ *
+ * As on the device, an update is begun once (begin() fails while one runs), the first byte
+ * written must be the magic byte of an image (0xE9) or of a gzip file, end() abandons an
+ * incomplete update unless asked to install what was written, and an installed signature
+ * verifier checks the signature appended to the image before it is installed. The tests
+ * read the image installed, count the updates and inject the failures of the flash.
+ */
+#ifndef HOST_UPDATER_H
+#define HOST_UPDATER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "Arduino.h"
+
+#define UPDATE_ERROR_OK                 (0)
+#define UPDATE_ERROR_WRITE              (1)
+#define UPDATE_ERROR_ERASE              (2)
+#define UPDATE_ERROR_READ               (3)
+#define UPDATE_ERROR_SPACE              (4)
+#define UPDATE_ERROR_SIZE               (5)
+#define UPDATE_ERROR_STREAM             (6)
+#define UPDATE_ERROR_MD5                (7)
+#define UPDATE_ERROR_FLASH_CONFIG       (8)
+#define UPDATE_ERROR_NEW_FLASH_CONFIG   (9)
+#define UPDATE_ERROR_MAGIC_BYTE         (10)
+#define UPDATE_ERROR_BOOTSTRAP          (11)
+#define UPDATE_ERROR_SIGN               (12)
+#define UPDATE_ERROR_NO_DATA            (13)
+#define UPDATE_ERROR_OOM                (14)
+
+#define U_FLASH   0
+#define U_FS      100
+
+class UpdaterHashClass {
+public:
+    virtual ~UpdaterHashClass() {}
+    virtual void begin() = 0;
+    virtual void add(const void* data, uint32_t length) = 0;
+    virtual void end() = 0;
+    virtual int len() = 0;
+    virtual const void* hash() = 0;
+    virtual const unsigned char* oid() = 0;
+};
+
+class UpdaterVerifyClass {
+public:
+    virtual ~UpdaterVerifyClass() {}
+    virtual uint32_t length() = 0;   ///< Length of the signature.
+    virtual bool verify(UpdaterHashClass* hash, const void* signature, uint32_t signatureLength) = 0;
+};
+
+class UpdaterClass {
+public:
+    bool begin(size_t size, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = 0);
+    size_t write(uint8_t* data, size_t length);
+    bool end(bool evenIfRemaining = false);
+    void installSignature(UpdaterHashClass* hash, UpdaterVerifyClass* verify) { _hash = hash; _verify = verify; }
+    void printError(Print& out);
+    const char* getErrorString() const;
+    uint8_t getError() const { return _error; }
+    bool hasError() const { return _error != UPDATE_ERROR_OK; }
+    bool isRunning() const { return _size > 0; }
+    bool isFinished() const { return _size > 0 && _image.size() == _size; }
+    size_t size() const { return _size; }
+    size_t progress() const { return _image.size(); }
+    size_t remaining() const { return _size - _image.size(); }
+
+    /**
+     * @brief Host only: size of the flash the updates may use (default 1 MB).
+     */
+    void setFreeSpace(size_t value) { _freeSpace = value; }
+
+    /**
+     * @brief Host only: makes the next begin() fail (UPDATE_ERROR_SPACE).
+     */
+    void failBegin(bool value) { _failBegin = value; }
+
+    /**
+     * @brief Host only: makes the write reaching an offset of the image fail (UPDATE_ERROR_WRITE); SIZE_MAX for none.
+     */
+    void failWriteAt(size_t offset) { _failWriteAt = offset; }
+
+    const std::vector<uint8_t>& getImage() const { return _installed; } ///< Host only: image of the last update installed.
+    uint32_t getBegins() const { return _begins; }                      ///< Host only: updates begun.
+    uint32_t getInstalls() const { return _installs; }                  ///< Host only: updates installed.
+    uint32_t getAborts() const { return _aborts; }                      ///< Host only: updates abandoned.
+
+    /**
+     * @brief Host only: abandons the update and clears the image, the counters and the failures.
+     */
+    void reset();
+
+private:
+    void abandon();
+
+    size_t _size = 0;                     ///< Size reserved for the update, 0 if none runs.
+    std::vector<uint8_t> _image;          ///< Bytes written by the running update.
+    std::vector<uint8_t> _installed;      ///< Image of the last update installed.
+    uint8_t _error = UPDATE_ERROR_OK;
+    UpdaterHashClass* _hash = nullptr;
+    UpdaterVerifyClass* _verify = nullptr;
+
+    size_t _freeSpace = 0x100000;
+    bool _failBegin = false;
+    size_t _failWriteAt = SIZE_MAX;
+    uint32_t _begins = 0;
+    uint32_t _installs = 0;
+    uint32_t _aborts = 0;
+};
+
+extern UpdaterClass Update;
+
+#endif
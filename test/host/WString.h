@@ -0,0 +1,92 @@
+/**
+ * @file WString.h
+ * @brief Host stand-in of the Arduino String class, on std::string.
+ */
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+class String {
+public:
+    String() {}
+    String(const char* value) : _value(value != nullptr ? value : "") {}
+    String(const String&) = default;
+    String(String&&) = default;
+    explicit String(char value) : _value(1, value) {}
+    explicit String(int value) : _value(std::to_string(value)) {}
+    explicit String(unsigned int value) : _value(std::to_string(value)) {}
+    explicit String(long value) : _value(std::to_string(value)) {}
+    explicit String(unsigned long value) : _value(std::to_string(value)) {}
+    explicit String(double value, unsigned char decimals = 2);
+
+    String& operator=(const String&) = default;
+    String& operator=(String&&) = default;
+    String& operator=(const char* value) { _value = value != nullptr ? value : ""; return *this; }
+
+    const char* c_str() const { return _value.c_str(); }
+    unsigned int length() const { return _value.size(); }
+    bool isEmpty() const { return _value.empty(); }
+    bool reserve(unsigned int size) { _value.reserve(size); return true; }
+
+    bool concat(const char* value, unsigned int length) { _value.append(value, length); return true; }
+    bool concat(const String& value) { _value += value._value; return true; }
+    bool concat(const char* value) { _value += value; return true; }
+    bool concat(char value) { _value += value; return true; }
+    String& operator+=(const String& value) { concat(value); return *this; }
+    String& operator+=(const char* value) { concat(value); return *this; }
+    String& operator+=(char value) { concat(value); return *this; }
+    String& operator+=(int value) { _value += std::to_string(value); return *this; }
+    String& operator+=(unsigned int value) { _value += std::to_string(value); return *this; }
+    String& operator+=(long value) { _value += std::to_string(value); return *this; }
+    String& operator+=(unsigned long value) { _value += std::to_string(value); return *this; }
+
+    bool equals(const String& value) const { return _value == value._value; }
+    bool equalsIgnoreCase(const String& value) const { return strcasecmp(_value.c_str(), value._value.c_str()) == 0; }
+    bool operator==(const String& value) const { return _value == value._value; }
+    bool operator==(const char* value) const { return _value == value; }
+    bool operator!=(const String& value) const { return _value != value._value; }
+    bool operator!=(const char* value) const { return _value != value; }
+    bool operator<(const String& value) const { return _value < value._value; }
+
+    char operator[](unsigned int index) const { return index < _value.size() ? _value[index] : 0; }
+    char& operator[](unsigned int index) { return _value[index]; }
+    char charAt(unsigned int index) const { return (*this)[index]; }
+
+    bool startsWith(const String& prefix) const { return _value.compare(0, prefix._value.size(), prefix._value) == 0; }
+    bool endsWith(const String& suffix) const {
+        return _value.size() >= suffix._value.size() && _value.compare(_value.size() - suffix._value.size(), suffix._value.size(), suffix._value) == 0;
+    }
+    int indexOf(char value, unsigned int from = 0) const { return position(_value.find(value, from)); }
+    int indexOf(const String& value, unsigned int from = 0) const { return position(_value.find(value._value, from)); }
+    int lastIndexOf(char value) const { return position(_value.rfind(value)); }
+    String substring(unsigned int from) const { return from < _value.size() ? String(_value.substr(from).c_str()) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        return from < to && from < _value.size() ? String(_value.substr(from, to - from).c_str()) : String();
+    }
+    void remove(unsigned int index) { if (index < _value.size()) _value.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < _value.size()) _value.erase(index, count); }
+    void toLowerCase() { for (char& c : _value) c = tolower((unsigned char)c); }
+    void trim();
+    long toInt() const { return atol(_value.c_str()); }
+
+private:
+    static int position(size_t index) { return index == std::string::npos ? -1 : (int)index; }
+
+    std::string _value;
+};
+
+inline String operator+(const String& a, const String& b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, const char* b) { String result(a); result += b; return result; }
+inline String operator+(const char* a, const String& b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, char b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, int b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, unsigned int b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, long b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, unsigned long b) { String result(a); result += b; return result; }
+
+#endif
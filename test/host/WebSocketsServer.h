@@ -0,0 +1,160 @@
+/**
+ * @file WebSocketsServer.h
+ * @brief Host stand-in of the WebSocketsServer of the arduinoWebSockets library.
+ *
+ * The clients are simulated: the tests connect them, make them send text, and read what the
+ * server sent them. Each message sent is framed for each client as the library does (frame
+ * header, then payload copied into the client's send buffer), so that the cost of a
+ * broadcast grows with the number of clients as on the device.
+ */
+#ifndef HOST_WEB_SOCKETS_SERVER_H
+#define HOST_WEB_SOCKETS_SERVER_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+#ifndef WEBSOCKETS_SERVER_CLIENT_MAX
+#define WEBSOCKETS_SERVER_CLIENT_MAX 5
+#endif
+
+typedef enum {
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG
+} WStype_t;
+
+class WebSocketsServer {
+public:
+    typedef std::function<void(uint8_t num, WStype_t type, uint8_t* payload, size_t length)> WebSocketServerEvent;
+
+    explicit WebSocketsServer(uint16_t port) : _port(port) {}
+    ~WebSocketsServer() { if (servers()[_port] == this) servers().erase(_port); }
+
+    void begin() { servers()[_port] = this; }
+    void loop() {}
+    void onEvent(WebSocketServerEvent event) { _event = event; }
+
+    bool sendTXT(uint8_t num, const uint8_t* payload, size_t length) {
+        if (num >= WEBSOCKETS_SERVER_CLIENT_MAX || !_clients[num].connected) return false;
+        Client& client = _clients[num];
+        uint8_t header[4] = { 0x81, 0, 0, 0 }; // FIN, text
+        size_t headerLength = 2;
+        if (length < 126) {
+            header[1] = (uint8_t)length;
+        } else {
+            header[1] = 126;
+            header[2] = (uint8_t)(length >> 8);
+            header[3] = (uint8_t)length;
+            headerLength = 4;
+        }
+        client.sent.assign((const char*)header, headerLength);
+        client.sent.append((const char*)payload, length);
+        client.frames++;
+        client.bytes += client.sent.size();
+        return true;
+    }
+    bool sendTXT(uint8_t num, const char* payload) { return sendTXT(num, (const uint8_t*)payload, strlen(payload)); }
+    bool sendTXT(uint8_t num, String& payload) { return sendTXT(num, (const uint8_t*)payload.c_str(), payload.length()); }
+
+    bool broadcastTXT(const uint8_t* payload, size_t length) {
+        bool sent = true;
+        for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+            if (_clients[i].connected) sent = sendTXT(i, payload, length) && sent;
+        }
+        return sent;
+    }
+    bool broadcastTXT(const char* payload) { return broadcastTXT((const uint8_t*)payload, strlen(payload)); }
+    bool broadcastTXT(String& payload) { return broadcastTXT((const uint8_t*)payload.c_str(), payload.length()); }
+
+    uint8_t connectedClients(bool = false) {
+        uint8_t count = 0;
+        for (const Client& client : _clients) count += client.connected ? 1 : 0;
+        return count;
+    }
+    IPAddress remoteIP(uint8_t num) { return num < WEBSOCKETS_SERVER_CLIENT_MAX && _clients[num].connected ? _clients[num].ip : IPAddress(); }
+    void disconnect(uint8_t num) { hostDisconnect(num); }
+
+    /**
+     * @brief Host only: server begun on a port, nullptr if none.
+     */
+    static WebSocketsServer* find(uint16_t port) {
+        auto server = servers().find(port);
+        return server != servers().end() ? server->second : nullptr;
+    }
+
+    /**
+     * @brief Host only: connects a client, which receives WStype_CONNECTED.
+     * @return Number of the client, -1 if the server is full.
+     */
+    int hostConnect(IPAddress ip = IPAddress(192, 168, 1, 50)) {
+        for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+            if (_clients[i].connected) continue;
+            _clients[i] = Client();
+            _clients[i].connected = true;
+            _clients[i].ip = ip;
+            if (_event) _event(i, WStype_CONNECTED, (uint8_t*)"/", 1);
+            return i;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Host only: disconnects a client, which receives WStype_DISCONNECTED.
+     */
+    void hostDisconnect(uint8_t num) {
+        if (num >= WEBSOCKETS_SERVER_CLIENT_MAX || !_clients[num].connected) return;
+        _clients[num].connected = false;
+        if (_event) _event(num, WStype_DISCONNECTED, nullptr, 0);
+    }
+
+    /**
+     * @brief Host only: a client sends a text message.
+     */
+    void hostReceive(uint8_t num, const char* text) {
+        if (num >= WEBSOCKETS_SERVER_CLIENT_MAX || !_clients[num].connected || !_event) return;
+        std::string payload = text;
+        _event(num, WStype_TEXT, (uint8_t*)&payload[0], payload.size());
+    }
+
+    /**
+     * @brief Host only: payload of the last message sent to a client.
+     */
+    std::string hostLastText(uint8_t num) const {
+        if (num >= WEBSOCKETS_SERVER_CLIENT_MAX || _clients[num].sent.size() < 2) return std::string();
+        return _clients[num].sent.substr((uint8_t)_clients[num].sent[1] == 126 ? 4 : 2);
+    }
+
+    uint32_t hostFrames(uint8_t num) const { return num < WEBSOCKETS_SERVER_CLIENT_MAX ? _clients[num].frames : 0; }   ///< Host only: messages sent to a client.
+    uint64_t hostBytes(uint8_t num) const { return num < WEBSOCKETS_SERVER_CLIENT_MAX ? _clients[num].bytes : 0; }     ///< Host only: bytes sent to a client, frame headers included.
+
+private:
+    struct Client {
+        bool connected = false;
+        IPAddress ip;
+        std::string sent;     ///< Last frame sent.
+        uint32_t frames = 0;
+        uint64_t bytes = 0;
+    };
+
+    static std::map<uint16_t, WebSocketsServer*>& servers() {
+        static std::map<uint16_t, WebSocketsServer*> begun;
+        return begun;
+    }
+
+    uint16_t _port;
+    WebSocketServerEvent _event;
+    Client _clients[WEBSOCKETS_SERVER_CLIENT_MAX];
+};
+
+#endif
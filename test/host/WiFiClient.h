@@ -0,0 +1,75 @@
+/**
+ * @file WiFiClient.h
+ * @brief Host stand-in of WiFiClient: the network installed by the test, or loopback sockets.
+ *
+ * A test installs a Client playing the remote side (e.g. a fake broker) with setNetwork();
+ * every WiFiClient then talks to it. Without a network, connections to a loopback address
+ * (127.x.x.x) use a TCP socket of the host, which is how the stand-ins of the servers
+ * (WiFiServer, ESP8266WebServer) and the HTTP servers of the tests are reached; other
+ * connections fail.
+ *
+ * As in the core, copies of a client share its connection, and stop() closes it for all.
+ * Reads do not block: available() is 0 while no byte has arrived.
+ */
+#ifndef HOST_WIFI_CLIENT_H
+#define HOST_WIFI_CLIENT_H
+
+#include <memory>
+#include "Client.h"
+
+class WiFiClient : public Client {
+public:
+    WiFiClient() {}
+
+    /**
+     * @brief Host only: client of a connected socket, e.g. accepted by WiFiServer. Takes ownership.
+     */
+    explicit WiFiClient(int socket);
+
+    /**
+     * @brief Host only: installs the network every WiFiClient talks to, nullptr for none.
+     */
+    static void setNetwork(Client* network) { _network = network; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override;
+    void flush() override { if (_network != nullptr && !_socket) _network->flush(); }
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return _socket ? (bool)connected() : _network != nullptr && (bool)*_network; }
+    void setNoDelay(bool value);
+
+    /**
+     * @brief Host only: waits up to timeout ms for bytes to read or for the peer to close.
+     * @return True if bytes are available.
+     */
+    bool waitAvailable(unsigned long timeout);
+
+    /**
+     * @brief Host only: descriptor of the socket, -1 if the client uses the installed network.
+     */
+    int getSocket() const { return _socket ? _socket->fd : -1; }
+
+private:
+    /**
+     * @brief Socket shared by the copies of a client.
+     */
+    struct Socket {
+        explicit Socket(int value) : fd(value) {}
+        ~Socket() { close(); }
+        void close();
+        int fd;
+    };
+
+    static Client* _network;            ///< Remote side of the connections.
+    std::shared_ptr<Socket> _socket;    ///< Loopback connection, if any.
+};
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * @file WiFiServer.h
+ * @brief Host stand-in of WiFiServer: a TCP server on a loopback port of the host.
+ *
+ * The device port (23, 80...) may be privileged or in use on the host, and tests run in
+ * parallel: begin() listens on a free port chosen by the system instead, which the tests
+ * find with hostPort(). Accepting does not block.
+ */
+#ifndef HOST_WIFI_SERVER_H
+#define HOST_WIFI_SERVER_H
+
+#include "WiFiClient.h"
+
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port) : _port(port) {}
+    WiFiServer(IPAddress, uint16_t port) : _port(port) {}
+    ~WiFiServer() { close(); }
+    WiFiServer(const WiFiServer&) = delete;
+    WiFiServer& operator=(const WiFiServer&) = delete;
+
+    void begin();
+    void begin(uint16_t port) { _port = port; begin(); }
+    void close();
+    void stop() { close(); }
+    void setNoDelay(bool value) { _noDelay = value; }
+    bool getNoDelay() const { return _noDelay; }
+    uint8_t status() const { return _listener >= 0 ? 1 : 0; }   ///< LISTEN (1) or CLOSED (0).
+
+    /**
+     * @brief Tells whether a connection waits to be accepted.
+     */
+    bool hasClient();
+
+    /**
+     * @brief Accepts a waiting connection; the client is not connected if none waits.
+     */
+    WiFiClient accept();
+    WiFiClient available() { return accept(); }   ///< Former name of accept().
+
+    /**
+     * @brief Host only: loopback port the server listens on, 0 before begin().
+     */
+    uint16_t localPort() const { return _localPort; }
+
+    /**
+     * @brief Host only: loopback port of the server last begun for a device port, 0 if none.
+     */
+    static uint16_t hostPort(uint16_t port);
+
+private:
+    uint16_t _port;               ///< Device port.
+    uint16_t _localPort = 0;      ///< Loopback port listened on.
+    int _listener = -1;           ///< Listening socket.
+    int _pending = -1;            ///< Connection accepted by hasClient(), not yet taken by accept().
+    bool _noDelay = false;        ///< Nagle disabled on the accepted connections.
+};
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ * @file WiFiUdp.h
+ * @brief Host stand-in of WiFiUDP: datagrams are answered by a responder set by the test.
+ *
+ * beginPacket() with a host name resolves it through WiFi.hostByName(), as the core does,
+ * on every call.
+ */
+#ifndef HOST_WIFI_UDP_H
+#define HOST_WIFI_UDP_H
+
+#include <functional>
+#include <vector>
+#include "Stream.h"
+#include "IPAddress.h"
+
+class WiFiUDP : public Stream {
+public:
+    /**
+     * @brief Answers a datagram sent to address:port; returns false to send no answer.
+     */
+    typedef std::function<bool(IPAddress address, uint16_t port, const std::vector<uint8_t>& request, std::vector<uint8_t>& response)> Responder;
+
+    static void setResponder(Responder responder) { _responder = responder; }   ///< Host only: remote side of the datagrams.
+
+    uint8_t begin(uint16_t) { _open = true; return 1; }
+    void stop() { _open = false; _response.clear(); _position = 0; }
+    int beginPacket(const char* host, uint16_t port);
+    int beginPacket(IPAddress address, uint16_t port);
+    int endPacket();
+    size_t write(uint8_t b) override { _request.push_back(b); return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { _request.insert(_request.end(), buffer, buffer + size); return size; }
+    using Print::write;
+
+    int parsePacket() { return (int)(_response.size() - _position); }
+    int available() override { return parsePacket(); }
+    int read() override { return _position < _response.size() ? _response[_position++] : -1; }
+    int read(uint8_t* buffer, size_t size);
+    int peek() override { return _position < _response.size() ? _response[_position] : -1; }
+
+private:
+    static Responder _responder;       ///< Remote side.
+    bool _open = false;                ///< begin() was called.
+    IPAddress _address;                ///< Destination of the packet being written.
+    uint16_t _port = 0;                ///< Destination port.
+    std::vector<uint8_t> _request;     ///< Packet being written.
+    std::vector<uint8_t> _response;    ///< Answer received.
+    size_t _position = 0;              ///< Bytes of the answer read.
+};
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ * @file coredecls.h
+ * @brief Host stand-in of the core declarations used by TimeService.
+ */
+#ifndef HOST_COREDECLS_H
+#define HOST_COREDECLS_H
+
+#include <functional>
+
+/**
+ * @brief Registers the callback of the SNTP synchronizations.
+ */
+void settimeofday_cb(const std::function<void()>& callback);
+
+/**
+ * @brief Host only: calls the registered callback, as the SNTP client does after setting the clock.
+ */
+void hostTimeSet();
+
+#endif
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""Benchmark a device running the framework and print the results as JSON.
+
+Measures from the client side:
+  - static file requests (requests per second, latency percentiles),
+  - API requests (latency percentiles),
+  - file upload throughput through /api/upload, optionally also gzip-compressed
+    for the 4 KB inflate window of the device to measure the time saved by compression,
+  - optionally, many small file uploads (files per second),
+  - optionally, sustained download throughput of a file through /api/download, and
+    a resumed download (Range) checked against the full one,
+then appends the device-side metrics of /api/metrics (request, WebSocket broadcast,
+OTA and application sections), reset before the run so they cover it only.
+
+Usage:
+  tools/benchmark.py 192.168.1.50 > bench-$(git rev-parse --short HEAD).json
+  tools/benchmark.py 192.168.1.50 --requests 200 --api /api/files --upload-size 65536
+  tools/benchmark.py 192.168.1.50 --upload-file .pio/build/esp12e/firmware.bin --upload-gzip
+  tools/benchmark.py 192.168.1.50 --upload-size 262144 --upload-many 50 --upload-many-size 512
+  tools/benchmark.py 192.168.1.50 --download /logs/data.csv --download-count 5
+
+Only the Python standard library is needed.
+"""
+import argparse
+import http.client
+import json
+import os
+import subprocess
+import time
+import uuid
+import zlib
+
+WINDOW_BITS = 12   # inflate window of the device, GZIP_INFLATER_WINDOW_SIZE (4 KB)
+
+
+def percentile(samples, percent):
+    if not samples:
+        return 0
+    ordered = sorted(samples)
+    rank = max(0, min(len(ordered) - 1, int(round(percent / 100.0 * len(ordered) + 0.5)) - 1))
+    return ordered[rank]
+
+
+def summary(samples, elapsed):
+    """Latencies in ms, rate in requests per second."""
+    return {
+        "count": len(samples),
+        "rps": round(len(samples) / elapsed, 2) if elapsed > 0 else 0,
+        "p50": round(percentile(samples, 50), 2),
+        "p90": round(percentile(samples, 90), 2),
+        "p99": round(percentile(samples, 99), 2),
+        "max": round(max(samples), 2) if samples else 0,
+    }
+
+
+def request(host, port, method, path, body=None, headers=None, timeout=10):
+    connection = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        connection.request(method, path, body=body, headers=headers or {})
+        response = connection.getresponse()
+        data = response.read()
+        return response.status, data
+    finally:
+        connection.close()
+
+
+def bench_get(host, port, path, count):
+    latencies = []
+    errors = 0
+    start = time.perf_counter()
+    for _ in range(count):
+        t0 = time.perf_counter()
+        try:
+            status, _ = request(host, port, "GET", path)
+            if status != 200:
+                errors += 1
+        except OSError:
+            errors += 1
+            continue
+        latencies.append((time.perf_counter() - t0) * 1000)
+    result = summary(latencies, time.perf_counter() - start)
+    result["path"] = path
+    result["errors"] = errors
+    return result
+
+
+def bench_upload(host, port, payload, directory, compress=False):
+    """Uploads payload, gzip-compressed as NAME.gz if compress, then deletes the stored file."""
+    boundary = uuid.uuid4().hex
+    name = "bench-%s.bin" % boundary[:8]
+    if compress:
+        compressor = zlib.compressobj(9, zlib.DEFLATED, 16 + WINDOW_BITS)
+        content = compressor.compress(payload) + compressor.flush()
+    else:
+        content = payload
+    head = ("--%s\r\nContent-Disposition: form-data; name=\"file\"; filename=\"%s\"\r\n"
+            "Content-Type: application/octet-stream\r\n\r\n" % (boundary, name + (".gz" if compress else ""))).encode()
+    body = head + content + ("\r\n--%s--\r\n" % boundary).encode()
+    headers = {"Content-Type": "multipart/form-data; boundary=%s" % boundary}
+
+    t0 = time.perf_counter()
+    status, _ = request(host, port, "POST", "/api/upload?directory=%s%s" % (directory, "&inflate=1" if compress else ""), body, headers, timeout=120)
+    elapsed = time.perf_counter() - t0
+    request(host, port, "DELETE", "/api/delete?path=%s/%s" % (directory.rstrip("/"), name))
+    return {
+        "bytes": len(payload),
+        "sent": len(content),
+        "status": status,
+        "seconds": round(elapsed, 3),
+        "kbps": round(len(payload) / 1024.0 / elapsed, 1) if elapsed > 0 else 0,
+    }
+
+
+def bench_upload_many(host, port, count, size, directory):
+    """Uploads count files of size random bytes, one after the other."""
+    uploads = [bench_upload(host, port, os.urandom(size), directory) for _ in range(count)]
+    seconds = sum(upload["seconds"] for upload in uploads)
+    return {
+        "files": count,
+        "bytes": size,
+        "errors": sum(1 for upload in uploads if upload["status"] != 200),
+        "seconds": round(seconds, 3),
+        "filesPerSecond": round(count / seconds, 2) if seconds > 0 else 0,
+        "kbps": round(count * size / 1024.0 / seconds, 1) if seconds > 0 else 0,
+        "p50": round(percentile([upload["seconds"] * 1000 for upload in uploads], 50), 2),
+    }
+
+
+def bench_download(host, port, path, count):
+    """Downloads path count times, then its second half with a Range request."""
+    rates = []
+    body = b""
+    for _ in range(count):
+        t0 = time.perf_counter()
+        status, body = request(host, port, "GET", "/api/download?file=%s" % path, timeout=120)
+        elapsed = time.perf_counter() - t0
+        if status == 200 and elapsed > 0:
+            rates.append(len(body) / 1024.0 / elapsed)
+    half = len(body) // 2
+    status, tail = request(host, port, "GET", "/api/download?file=%s" % path, headers={"Range": "bytes=%d-" % half}, timeout=120)
+    return {
+        "path": path,
+        "bytes": len(body),
+        "count": len(rates),
+        "kbps": round(sum(rates) / len(rates), 1) if rates else 0,
+        "kbpsMin": round(min(rates), 1) if rates else 0,
+        "kbpsMax": round(max(rates), 1) if rates else 0,
+        "rangeStatus": status,
+        "rangeOk": status == 206 and tail == body[half:],
+    }
+
+
+def git_commit():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "HEAD"], stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="address of the device")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--requests", type=int, default=100, help="requests per measured path")
+    parser.add_argument("--file", default="/index.html", help="static file to request")
+    parser.add_argument("--api", action="append", help="API endpoint to request (repeatable, default /api/directories)")
+    parser.add_argument("--upload-size", type=int, default=32768, help="bytes uploaded, 0 to skip")
+    parser.add_argument("--upload-file", help="file uploaded instead of --upload-size random bytes (e.g. a firmware image)")
+    parser.add_argument("--upload-gzip", action="store_true", help="upload again gzip-compressed and report the time saved")
+    parser.add_argument("--upload-many", type=int, default=0, help="number of small files uploaded one after the other, 0 to skip")
+    parser.add_argument("--upload-many-size", type=int, default=1024, help="bytes of each small file")
+    parser.add_argument("--upload-directory", default="/")
+    parser.add_argument("--download", help="file downloaded through /api/download to measure sustained throughput")
+    parser.add_argument("--download-count", type=int, default=3, help="downloads of --download")
+    args = parser.parse_args()
+
+    request(args.host, args.port, "GET", "/api/metrics?reset=1")
+
+    results = {
+        "commit": git_commit(),
+        "time": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+        "host": args.host,
+        "client": {
+            "files": bench_get(args.host, args.port, args.file, args.requests),
+            "api": [bench_get(args.host, args.port, path, args.requests) for path in (args.api or ["/api/directories"])],
+        },
+    }
+    payload = None
+    if args.upload_file:
+        with open(args.upload_file, "rb") as f:
+            payload = f.read()
+    elif args.upload_size > 0:
+        payload = os.urandom(args.upload_size)
+    if payload:
+        upload = bench_upload(args.host, args.port, payload, args.upload_directory)
+        results["client"]["upload"] = upload
+        if args.upload_gzip:
+            compressed = bench_upload(args.host, args.port, payload, args.upload_directory, compress=True)
+            compressed["reduction"] = round(1 - compressed["seconds"] / upload["seconds"], 3) if upload["seconds"] > 0 else 0
+            results["client"]["uploadGzip"] = compressed
+    if args.upload_many > 0:
+        results["client"]["uploadMany"] = bench_upload_many(args.host, args.port, args.upload_many, args.upload_many_size, args.upload_directory)
+
+    if args.download:
+        results["client"]["download"] = bench_download(args.host, args.port, args.download, args.download_count)
+
+    status, data = request(args.host, args.port, "GET", "/api/metrics")
+    results["device"] = json.loads(data) if status == 200 else None
+    print(json.dumps(results, indent=2))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""Gzip-compress files for the inflate window of the device, for /api/upload and /api/archive.
+
+The device inflates compressed uploads (with inflate=1) with a window of GZIP_INFLATER_WINDOW_SIZE bytes
+(4 KB by default) and rejects back-references beyond it. The gzip tool compresses with a
+32 KB window; this tool limits the window with --window-bits (12 for 4 KB, up to 15 for a
+device built with -DGZIP_INFLATER_WINDOW_SIZE=32768). Every file is decompressed again
+and compared with the original before it is written.
+
+Usage:
+  tools/compress.py datalog.csv                  writes datalog.csv.gz
+  tools/compress.py --window-bits 13 a.json b.js
+  tools/compress.py config.json -o - | curl -F "file=@-;filename=config.json.gz" "http://192.168.1.50/api/upload?inflate=1"
+
+Only the Python standard library is needed.
+"""
+import argparse
+import sys
+import zlib
+
+
+def compress(data, window_bits=12):
+    """gzip stream of data whose back-references reach at most 2 ** window_bits bytes."""
+    compressor = zlib.compressobj(9, zlib.DEFLATED, 16 + window_bits)
+    return compressor.compress(data) + compressor.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("files", nargs="+")
+    parser.add_argument("--window-bits", type=int, default=12, choices=range(9, 16), metavar="9..15",
+                        help="log2 of the inflate window of the device (default 12, GZIP_INFLATER_WINDOW_SIZE 4096)")
+    parser.add_argument("-o", "--output", help="output file, - for stdout (only with one input; default FILE.gz)")
+    args = parser.parse_args()
+    if args.output is not None and len(args.files) > 1:
+        parser.error("--output takes a single input file")
+
+    for path in args.files:
+        with open(path, "rb") as f:
+            data = f.read()
+        compressed = compress(data, args.window_bits)
+        if zlib.decompress(compressed, 16 + args.window_bits) != data:
+            sys.exit("%s: compressed stream does not decompress to the original" % path)
+        output = args.output or path + ".gz"
+        if output == "-":
+            sys.stdout.buffer.write(compressed)
+        else:
+            with open(output, "wb") as f:
+                f.write(compressed)
+            print("%s: %d -> %d bytes (%.0f%%), %d-byte window" % (output, len(data), len(compressed),
+                  100.0 * len(compressed) / len(data) if data else 0, 1 << args.window_bits), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
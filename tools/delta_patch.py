@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""Make or apply a delta patch between two firmware images, for /api/firmware/delta.
+
+A patch describes the new image as records of (diff run, extra run, seek) against the
+running image, bsdiff-style: code that only moved or had its addresses shifted becomes
+runs of mostly zero diff bytes, which compress well. The patch is gzip-compressed with a
+4 KB window (--window-bits 12), the size of the inflate window of the device
+(OTA_DELTA_WINDOW_SIZE).
+
+Format (integers little-endian): "IOTDIFF1", base size (u32), new size (u32), MD5 of the
+base (16 bytes), SHA-256 of the new image (32 bytes), then records of diff length (u32),
+extra length (u32), seek (i32), diff bytes and extra bytes.
+
+The base is the running sketch as the device sees it: the application image without a
+signature appended by the signing tool, whose size is read from the image header.
+Every patch made is applied again and compared with the new image before it is written.
+
+Usage:
+  tools/delta_patch.py diff firmware-1.3.0.bin firmware-1.4.0.bin update.patch
+  tools/delta_patch.py apply firmware-1.3.0.bin update.patch firmware-check.bin
+  curl -F "file=@update.patch" http://192.168.1.50/api/firmware/delta
+
+Only the Python standard library is needed.
+"""
+import argparse
+import gzip
+import hashlib
+import struct
+import sys
+import zlib
+
+MAGIC = b"IOTDIFF1"
+HEADER = struct.Struct("<8sII16s32s")
+CONTROL = struct.Struct("<IIi")
+KEY = 8            # bytes of the exact match that starts a diff run
+MIN_MATCH = 16     # shorter matches cost more than their control record saves
+TOLERANCE = 32     # mismatches beyond the best score before a diff run stops
+
+
+def app_size(image):
+    """Size of the application image as ESP.getSketchSize() computes it, or the file size."""
+    pos = 0x1000
+    if len(image) < pos + 8 or image[pos] != 0xE9:
+        return len(image)
+    segments = image[pos + 1]
+    pos += 8
+    for _ in range(segments):
+        if pos + 8 > len(image):
+            return len(image)
+        pos += 8 + struct.unpack_from("<I", image, pos + 4)[0]
+    return min(len(image), (pos + 16) & ~15)
+
+
+def extend(old, os_, new, ns, step, limit):
+    """Length of the run from (os_, ns) in direction step where more bytes match than differ."""
+    score = best = length = 0
+    j = 0
+    while j < limit:
+        if step > 0:
+            same = old[os_ + j] == new[ns + j]
+        else:
+            same = old[os_ - 1 - j] == new[ns - 1 - j]
+        score += 1 if same else -1
+        j += 1
+        if score > best:
+            best, length = score, j
+        elif score < best - TOLERANCE:
+            break
+    return length
+
+
+def find_matches(old, new):
+    """Greedy matches (new offset, old offset, length), in order of new offset."""
+    index = {}
+    for i in range(len(old) - KEY + 1):
+        index.setdefault(old[i:i + KEY], i)
+    matches = []
+    gap = 0
+    delta = 0
+    i = 0
+    while i + KEY <= len(new):
+        key = new[i:i + KEY]
+        os_ = i + delta
+        if not (0 <= os_ and old[os_:os_ + KEY] == key):
+            os_ = index.get(key)
+            if os_ is None:
+                i += 1
+                continue
+        length = extend(old, os_, new, i, 1, min(len(old) - os_, len(new) - i))
+        back = extend(old, os_, new, i, -1, min(os_, i - gap))
+        if length + back < MIN_MATCH:
+            i += 1
+            continue
+        matches.append((i - back, os_ - back, length + back))
+        delta = os_ - i
+        i += length
+        gap = i
+    return matches
+
+
+def make_patch(old, new):
+    records = []
+    matches = find_matches(old, new)
+    if not matches or matches[0][0] > 0 or matches[0][1] > 0:
+        records.append((b"", new[:matches[0][0]] if matches else new, matches[0][1] if matches else 0))
+    for k, (ns, os_, length) in enumerate(matches):
+        diff = bytes((new[ns + j] - old[os_ + j]) & 0xFF for j in range(length))
+        following = matches[k + 1] if k + 1 < len(matches) else (len(new), os_ + length, 0)
+        extra = new[ns + length:following[0]]
+        records.append((diff, extra, following[1] - (os_ + length)))
+    out = [HEADER.pack(MAGIC, len(old), len(new), hashlib.md5(old).digest(), hashlib.sha256(new).digest())]
+    for diff, extra, seek in records:
+        out.append(CONTROL.pack(len(diff), len(extra), seek))
+        out.append(diff)
+        out.append(extra)
+    return b"".join(out)
+
+
+def apply_patch(old, patch):
+    if patch[:2] == b"\x1f\x8b":
+        patch = gzip.decompress(patch)
+    magic, base_size, new_size, base_md5, new_sha256 = HEADER.unpack_from(patch, 0)
+    if magic != MAGIC:
+        raise ValueError("not a delta patch")
+    if base_size != len(old) or hashlib.md5(old).digest() != base_md5:
+        raise ValueError("patch made for another base image")
+    out = bytearray()
+    pos = HEADER.size
+    base = 0
+    while len(out) < new_size:
+        diff_length, extra_length, seek = CONTROL.unpack_from(patch, pos)
+        pos += CONTROL.size
+        out += bytes((patch[pos + j] + old[base + j]) & 0xFF for j in range(diff_length))
+        pos += diff_length
+        base += diff_length
+        out += patch[pos:pos + extra_length]
+        pos += extra_length
+        base += seek
+    if hashlib.sha256(out).digest() != new_sha256:
+        raise ValueError("SHA-256 of the result does not match")
+    return bytes(out)
+
+
+def compress(data, window_bits):
+    compressor = zlib.compressobj(9, zlib.DEFLATED, 16 + window_bits)
+    return compressor.compress(data) + compressor.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+    diff = commands.add_parser("diff", help="make a patch from OLD to NEW")
+    diff.add_argument("old")
+    diff.add_argument("new")
+    diff.add_argument("patch")
+    diff.add_argument("--window-bits", type=int, default=12, help="gzip window of the patch, 9 to 15 (default 12: 4 KB)")
+    diff.add_argument("--base-size", type=int, help="size of the running image, instead of reading it from the header")
+    diff.add_argument("--raw", action="store_true", help="do not compress the patch")
+    apply = commands.add_parser("apply", help="apply PATCH to OLD into NEW")
+    apply.add_argument("old")
+    apply.add_argument("patch")
+    apply.add_argument("new")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    if args.command == "apply":
+        with open(args.patch, "rb") as f:
+            patch = f.read()
+        old = old[:app_size(old)]
+        with open(args.new, "wb") as f:
+            f.write(apply_patch(old, patch))
+        return
+
+    with open(args.new, "rb") as f:
+        new = f.read()
+    old = old[:args.base_size or app_size(old)]
+    patch = make_patch(old, new)
+    if not args.raw:
+        patch = compress(patch, args.window_bits)
+    if apply_patch(old, patch) != new:
+        sys.exit("round trip failed: the patch does not rebuild the new image")
+    with open(args.patch, "wb") as f:
+        f.write(patch)
+    full = len(compress(new, 15))
+    print("base %d bytes, new %d bytes (%d gzip), patch %d bytes: %.1fx smaller than the image, %.1fx than gzip"
+          % (len(old), len(new), full, len(patch), len(new) / max(1, len(patch)), full / max(1, len(patch))), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
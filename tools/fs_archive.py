@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""Provision or back up the file system of a device with one tar archive through /api/archive.
+
+  push       pack a local directory and extract it on the device (POST /api/archive)
+  pull       download a directory of the device as a tar and extract it locally (GET)
+  pack       only write the archive push would send, e.g. to upload it from the web UI
+  roundtrip  push a directory to a scratch directory of the device, pull it back and
+             compare every file and directory with the original; exits with 1 on any
+             difference, and prints the timings as JSON
+
+Archives are ustar, with names relative to the directory, so that they are read by the
+device (names up to 255 bytes). --gzip compresses the archive with a 4 KB window
+(--window-bits 12, as tools/compress.py), the inflate window of the device for compressed
+uploads (GZIP_INFLATER_WINDOW_SIZE).
+
+Usage:
+  tools/fs_archive.py push 192.168.1.50 data --directory /
+  tools/fs_archive.py pull 192.168.1.50 /logs backup/logs
+  tools/fs_archive.py pack data data.tar.gz --gzip
+  tools/fs_archive.py roundtrip 192.168.1.50 data --directory /roundtrip --gzip
+
+Only the Python standard library is needed.
+"""
+import argparse
+import http.client
+import io
+import json
+import os
+import sys
+import tarfile
+import tempfile
+import time
+import urllib.parse
+import uuid
+import zlib
+
+
+def pack(directory, compress=False, window_bits=12):
+    """Archive of the content of directory, in name order."""
+    buffer = io.BytesIO()
+    with tarfile.open(fileobj=buffer, mode="w", format=tarfile.USTAR_FORMAT) as archive:
+        for root, directories, files in os.walk(directory):
+            directories.sort()
+            for name in sorted(directories) + sorted(files):
+                path = os.path.join(root, name)
+                if os.path.islink(path):
+                    continue
+                info = archive.gettarinfo(path, os.path.relpath(path, directory).replace(os.sep, "/"))
+                info.uid = info.gid = 0
+                info.uname = info.gname = ""
+                if info.isfile():
+                    with open(path, "rb") as f:
+                        archive.addfile(info, f)
+                else:
+                    archive.addfile(info)
+    data = buffer.getvalue()
+    if compress:
+        compressor = zlib.compressobj(9, zlib.DEFLATED, 16 + window_bits)
+        data = compressor.compress(data) + compressor.flush()
+    return data
+
+
+def push(host, port, data, directory, compress=False):
+    """Uploads an archive; returns the JSON response of the device."""
+    boundary = uuid.uuid4().hex
+    name = "archive.tar" + (".gz" if compress else "")
+    head = ("--%s\r\nContent-Disposition: form-data; name=\"file\"; filename=\"%s\"\r\n"
+            "Content-Type: application/x-tar\r\n\r\n" % (boundary, name)).encode()
+    body = head + data + ("\r\n--%s--\r\n" % boundary).encode()
+    connection = http.client.HTTPConnection(host, port, timeout=120)
+    try:
+        connection.request("POST", "/api/archive?directory=" + urllib.parse.quote(directory) + ("&inflate=1" if compress else ""), body=body,
+                           headers={"Content-Type": "multipart/form-data; boundary=%s" % boundary})
+        response = connection.getresponse()
+        result = json.loads(response.read() or b"{}")
+    finally:
+        connection.close()
+    if result.get("status") != "ok":
+        sys.exit("push failed: %s" % json.dumps(result))
+    return result
+
+
+def pull(host, port, path, target):
+    """Downloads a directory and extracts it into target; returns the archive size."""
+    connection = http.client.HTTPConnection(host, port, timeout=120)
+    try:
+        connection.request("GET", "/api/archive?path=" + urllib.parse.quote(path))
+        response = connection.getresponse()
+        if response.status != 200:
+            sys.exit("pull failed: %d %s" % (response.status, response.read().decode(errors="replace")))
+        data = response.read()
+    finally:
+        connection.close()
+    os.makedirs(target, exist_ok=True)
+    with tarfile.open(fileobj=io.BytesIO(data), mode="r:") as archive:
+        for member in archive.getmembers():
+            name = os.path.normpath(member.name)
+            if name.startswith("..") or os.path.isabs(name):
+                sys.exit("pull failed: unsafe name %r" % member.name)
+        if hasattr(tarfile, "data_filter"):
+            archive.extractall(target, filter="data")
+        else:
+            archive.extractall(target)
+    return len(data)
+
+
+def tree(directory):
+    """Relative path of every file (with its content) and directory (with None)."""
+    entries = {}
+    for root, directories, files in os.walk(directory):
+        for name in directories:
+            entries[os.path.relpath(os.path.join(root, name), directory)] = None
+        for name in files:
+            path = os.path.join(root, name)
+            if not os.path.islink(path):
+                with open(path, "rb") as f:
+                    entries[os.path.relpath(path, directory)] = f.read()
+    return entries
+
+
+def roundtrip(args):
+    original = tree(args.source)
+    data = pack(args.source, args.gzip, args.window_bits)
+    start = time.time()
+    pushed = push(args.host, args.port, data, args.directory, args.gzip)
+    push_seconds = time.time() - start
+    with tempfile.TemporaryDirectory() as target:
+        start = time.time()
+        size = pull(args.host, args.port, args.directory, target)
+        pull_seconds = time.time() - start
+        copy = tree(target)
+    missing = sorted(set(original) - set(copy))
+    different = sorted(name for name in set(original) & set(copy) if original[name] != copy[name])
+    extra = sorted(set(copy) - set(original))
+    content = sum(len(value) for value in original.values() if value is not None)
+    print(json.dumps({
+        "files": sum(1 for value in original.values() if value is not None),
+        "directories": sum(1 for value in original.values() if value is None),
+        "bytes": content,
+        "push": {"archiveBytes": len(data), "seconds": round(push_seconds, 2),
+                 "kbps": round(content / 1024 / push_seconds, 1) if push_seconds > 0 else 0, "device": pushed},
+        "pull": {"archiveBytes": size, "seconds": round(pull_seconds, 2),
+                 "kbps": round(content / 1024 / pull_seconds, 1) if pull_seconds > 0 else 0},
+        "missing": missing, "different": different, "extra": extra,
+    }, indent=2))
+    if missing or different:
+        sys.exit("round trip failed: %d missing, %d different" % (len(missing), len(different)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=80)
+    commands = parser.add_subparsers(dest="command", required=True)
+    command = commands.add_parser("push", help="extract a local directory into a directory of the device")
+    command.add_argument("host")
+    command.add_argument("source")
+    command.add_argument("--directory", default="/", help="target directory on the device (default /)")
+    command.add_argument("--gzip", action="store_true", help="compress the archive")
+    command.add_argument("--window-bits", type=int, default=12, help="log2 of the inflate window of the device (default 12)")
+    command = commands.add_parser("pull", help="download a directory of the device into a local directory")
+    command.add_argument("host")
+    command.add_argument("path")
+    command.add_argument("target")
+    command = commands.add_parser("pack", help="write the archive of a local directory")
+    command.add_argument("source")
+    command.add_argument("archive")
+    command.add_argument("--gzip", action="store_true", help="compress the archive")
+    command.add_argument("--window-bits", type=int, default=12, help="log2 of the inflate window of the device (default 12)")
+    command = commands.add_parser("roundtrip", help="push a directory, pull it back and compare")
+    command.add_argument("host")
+    command.add_argument("source")
+    command.add_argument("--directory", default="/roundtrip", help="scratch directory on the device (default /roundtrip)")
+    command.add_argument("--gzip", action="store_true", help="compress the archive")
+    command.add_argument("--window-bits", type=int, default=12, help="log2 of the inflate window of the device (default 12)")
+    args = parser.parse_args()
+
+    if args.command == "push":
+        data = pack(args.source, args.gzip, args.window_bits)
+        start = time.time()
+        result = push(args.host, args.port, data, args.directory, args.gzip)
+        print("%d files, %d directories (%d bytes) in %.1f s" % (result.get("files", 0), result.get("directories", 0), len(data), time.time() - start), file=sys.stderr)
+    elif args.command == "pull":
+        start = time.time()
+        size = pull(args.host, args.port, args.path, args.target)
+        print("%d bytes in %.1f s" % (size, time.time() - start), file=sys.stderr)
+    elif args.command == "pack":
+        with open(args.archive, "wb") as f:
+            f.write(pack(args.source, args.gzip))
+    else:
+        roundtrip(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Local stand-in for the update server polled by OTAPull.
+
+Serves a firmware image and its manifest:
+  GET /manifest.json  {"version", "url", "size", "sha256"}, with ETag and Last-Modified,
+                      answered 304 Not Modified on If-None-Match / If-Modified-Since,
+  GET /<image name>   the image, with ETag, Range (206) and If-Range support.
+
+--drop-after closes the connection after that many bytes of each full or partial image
+response, --drop-count times, to exercise the resume path of the device.
+
+Usage:
+  tools/update_server.py .pio/build/esp12e/firmware.bin --version 1.4.0
+  tools/update_server.py firmware.bin --version 1.4.0 --port 8080 --drop-after 100000 --drop-count 2
+
+then point the device at it, e.g. "entryPointUrl": "http://192.168.1.10:8000/manifest.json".
+Only the Python standard library is needed.
+"""
+import argparse
+import email.utils
+import hashlib
+import http.server
+import json
+import os
+import sys
+import time
+
+
+def make_handler(image, name, version, drop_after, drop_count):
+    sha256 = hashlib.sha256(image).hexdigest()
+    image_etag = '"%s"' % sha256[:16]
+    manifest = json.dumps({"version": version, "url": name, "size": len(image), "sha256": sha256}).encode()
+    manifest_etag = '"%s"' % hashlib.sha256(manifest).hexdigest()[:16]
+    modified = email.utils.formatdate(time.time(), usegmt=True)
+    drops = {"left": drop_count}
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def do_GET(self):
+            if self.path == "/manifest.json":
+                self.send_manifest()
+            elif self.path == "/" + name:
+                self.send_image()
+            else:
+                self.send_error(404)
+
+        def send_manifest(self):
+            if self.headers.get("If-None-Match") == manifest_etag or self.headers.get("If-Modified-Since") == modified:
+                self.send_response(304)
+                self.send_header("ETag", manifest_etag)
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+            self.send_response(200)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(manifest)))
+            self.send_header("ETag", manifest_etag)
+            self.send_header("Last-Modified", modified)
+            self.end_headers()
+            self.wfile.write(manifest)
+
+        def send_image(self):
+            start = 0
+            ranged = self.headers.get("Range", "")
+            if_range = self.headers.get("If-Range")
+            if ranged.startswith("bytes=") and (if_range is None or if_range == image_etag):
+                start = int(ranged[6:].split("-")[0] or 0)
+                if start >= len(image):
+                    self.send_error(416)
+                    return
+                self.send_response(206)
+                self.send_header("Content-Range", "bytes %d-%d/%d" % (start, len(image) - 1, len(image)))
+            else:
+                self.send_response(200)
+            body = image[start:]
+            self.send_header("Content-Type", "application/octet-stream")
+            self.send_header("Content-Length", str(len(body)))
+            self.send_header("ETag", image_etag)
+            self.send_header("Accept-Ranges", "bytes")
+            self.end_headers()
+            if drop_after and drops["left"] > 0 and len(body) > drop_after:
+                drops["left"] -= 1
+                self.wfile.write(body[:drop_after])
+                self.wfile.flush()
+                self.log_message("dropped the connection after %d bytes", drop_after)
+                self.close_connection = True
+                return
+            self.wfile.write(body)
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("image", help="firmware image to serve")
+    parser.add_argument("--version", required=True, help="version announced by the manifest")
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--drop-after", type=int, default=0, help="bytes sent before dropping an image response")
+    parser.add_argument("--drop-count", type=int, default=1, help="number of responses dropped")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    name = os.path.basename(args.image)
+    handler = make_handler(image, name, args.version, args.drop_after, args.drop_count)
+    server = http.server.ThreadingHTTPServer(("", args.port), handler)
+    print("Serving %s (%d bytes) as version %s on port %d" % (name, len(image), args.version, args.port), file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()